@@ -127,6 +127,13 @@ private:
         _last_write_next_committed = false;
     }
 
+    // the appended blob is referenced by the message, which is sent as a scatter list
+    virtual void append_buffer(const blob &bb) override
+    {
+        commit_buffer();
+        _msg->write_append(bb);
+    }
+
 private:
     message_ex *_msg;
     bool _last_write_next_committed;
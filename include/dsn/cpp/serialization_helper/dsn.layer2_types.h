@@ -147,9 +147,13 @@ inline std::ostream &operator<<(std::ostream &out, const partition_configuration
 
 typedef struct _configuration_query_by_index_request__isset
 {
-    _configuration_query_by_index_request__isset() : app_name(false), partition_indices(false) {}
+    _configuration_query_by_index_request__isset()
+        : app_name(false), partition_indices(false), known_ballots(false)
+    {
+    }
     bool app_name : 1;
     bool partition_indices : 1;
+    bool known_ballots : 1;
 } _configuration_query_by_index_request__isset;
 
 class configuration_query_by_index_request
@@ -164,6 +168,7 @@ public:
     virtual ~configuration_query_by_index_request() throw();
     std::string app_name;
     std::vector<int32_t> partition_indices;
+    std::vector<int64_t> known_ballots;
 
     _configuration_query_by_index_request__isset __isset;
 
@@ -171,12 +176,18 @@ public:
 
     void __set_partition_indices(const std::vector<int32_t> &val);
 
+    void __set_known_ballots(const std::vector<int64_t> &val);
+
     bool operator==(const configuration_query_by_index_request &rhs) const
     {
         if (!(app_name == rhs.app_name))
             return false;
         if (!(partition_indices == rhs.partition_indices))
             return false;
+        if (__isset.known_ballots != rhs.__isset.known_ballots)
+            return false;
+        else if (__isset.known_ballots && !(known_ballots == rhs.known_ballots))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_index_request &rhs) const
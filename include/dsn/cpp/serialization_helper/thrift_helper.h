@@ -71,6 +71,8 @@ public:
         return (uint32_t)l;
     }
 
+    binary_reader &reader() { return _reader; }
+
 private:
     binary_reader &_reader;
 };
@@ -91,6 +93,8 @@ public:
         _writer.write((const char *)buf, static_cast<int>(len));
     }
 
+    binary_writer &writer() { return _writer; }
+
 private:
     binary_writer &_writer;
 };
@@ -199,17 +203,18 @@ private:
 public:
     blob_string(blob &bb) : _buffer(bb) {}
 
-    void clear() { _buffer.assign(std::shared_ptr<char>(nullptr), 0, 0); }
+    void clear() { _buffer.assign(blob_buffer_ptr(), 0, 0); }
     void resize(std::size_t new_size)
     {
-        std::shared_ptr<char> b(dsn::utils::make_shared_array<char>(new_size));
-        _buffer.assign(b, 0, static_cast<int>(new_size));
+        if (new_size <= blob::INLINE_CAPACITY) {
+            _buffer.assign_inline(nullptr, static_cast<unsigned int>(new_size));
+        } else {
+            _buffer.assign(blob_buffer::create(new_size), 0, static_cast<int>(new_size));
+        }
     }
     void assign(const char *ptr, std::size_t size)
     {
-        std::shared_ptr<char> b(dsn::utils::make_shared_array<char>(size));
-        memcpy(b.get(), ptr, size);
-        _buffer.assign(b, 0, static_cast<int>(size));
+        _buffer = blob::create_from_bytes(ptr, size);
     }
     const char *data() const { return _buffer.data(); }
     size_t size() const { return _buffer.length(); }
@@ -449,11 +454,39 @@ inline uint32_t task_code::write(apache::thrift::protocol::TProtocol *oprot) con
     }
 }
 
+// blobs not smaller than this are deserialized by referencing the reader's buffer,
+// smaller ones are copied so that they won't pin a large receiving buffer
+static const int32_t blob_zero_copy_read_min_bytes = 4096;
+
 inline uint32_t blob::read(apache::thrift::protocol::TProtocol *iprot)
 {
     // for optimization, it is dangerous if the oprot is not a binary proto
     apache::thrift::protocol::TBinaryProtocol *binary_proto =
         static_cast<apache::thrift::protocol::TBinaryProtocol *>(iprot);
+
+    // a binary string is encoded as | length(i32) | bytes |, so we can read the bytes
+    // from the binary_reader directly without copying
+    binary_reader_transport *trans =
+        dynamic_cast<binary_reader_transport *>(binary_proto->getTransport().get());
+    if (trans != nullptr) {
+        int32_t len = 0;
+        uint32_t xfer = binary_proto->readI32(len);
+        if (len < 0 || len > trans->reader().get_remaining_size()) {
+            throw ::apache::thrift::protocol::TProtocolException(
+                ::apache::thrift::protocol::TProtocolException::INVALID_DATA);
+        }
+        blob_string str(*this);
+        if (len >= blob_zero_copy_read_min_bytes) {
+            trans->reader().read(*this, len);
+        } else if (len > 0) {
+            str.resize(len);
+            trans->reader().read(&str[0], len);
+        } else {
+            str.clear();
+        }
+        return xfer + static_cast<uint32_t>(len);
+    }
+
     blob_string str(*this);
     return binary_proto->readString<blob_string>(str);
 }
@@ -462,6 +495,18 @@ inline uint32_t blob::write(apache::thrift::protocol::TProtocol *oprot) const
 {
     apache::thrift::protocol::TBinaryProtocol *binary_proto =
         static_cast<apache::thrift::protocol::TBinaryProtocol *>(oprot);
+
+    // the same as writeBinary(), but a large blob is appended to the writer by reference,
+    // e.g. as a segment of the rpc message, instead of being copied
+    binary_writer_transport *trans =
+        dynamic_cast<binary_writer_transport *>(binary_proto->getTransport().get());
+    if (trans != nullptr && length() >= binary_writer::zero_copy_write_min_bytes &&
+        buffer_ptr() != nullptr) {
+        uint32_t xfer = binary_proto->writeI32(static_cast<int32_t>(length()));
+        trans->writer().append(*this);
+        return xfer + length();
+    }
+
     return binary_proto->writeString<blob_string>(blob_string(const_cast<blob &>(*this)));
 }
 
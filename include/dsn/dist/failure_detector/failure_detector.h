@@ -58,6 +58,19 @@
  *
  * 4. The lease_periods must be less than the grace_periods, as required by prefect FD.
  *
+ * 5. With phi-accrual enabled, a worker adapts its lease to the jitter of its beacon acks:
+ *    the time at which phi reaches the threshold, plus "check_interval" and the beacon
+ *    timeout, no less than "min_lease" and "beacon_interval" + "check_interval", and no more
+ *    than "lease". The lease in use is announced in every beacon, and the
+ *    master gives the worker a grace of "announced lease" + ("grace" - "lease"). A shorter
+ *    lease is applied at once, while a longer one is applied only after the master echoes
+ *    it in an ack, so the master's grace never falls behind the worker's lease.
+ *
+ * 6. Other traffic between the worker and the master, e.g. config sync, may be counted as
+ *    beacons via record_master_traffic()/record_worker_traffic(), as long as both sides
+ *    record the same messages: the master when it handles the request, and the worker
+ *    with the send time of the request when the master's reply arrives.
+ *
  */
 #pragma once
 
@@ -65,6 +78,7 @@
 #include <dsn/dist/failure_detector/fd.server.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/tool-api/zlocks.h>
+#include <deque>
 
 namespace dsn {
 namespace fd {
@@ -73,6 +87,38 @@ DEFINE_THREAD_POOL_CODE(THREAD_POOL_FD)
 DEFINE_TASK_CODE(LPC_BEACON_CHECK, TASK_PRIORITY_HIGH, THREAD_POOL_FD)
 DEFINE_TASK_CODE(LPC_BEACON_SEND, TASK_PRIORITY_HIGH, THREAD_POOL_FD)
 
+//
+// phi-accrual estimation over the intervals between beacon acks, see "The phi Accrual Failure
+// Detector" (Hayashibara et al.). The intervals are modeled as a normal distribution, and
+// phi(t) = -log10(probability of getting no ack within t since the last one).
+//
+class phi_accrual_window
+{
+public:
+    explicit phi_accrual_window(size_t capacity = 100)
+        : _capacity(capacity), _sum(0), _square_sum(0)
+    {
+    }
+
+    void add(uint64_t interval_ms);
+    void clear();
+    size_t size() const { return _intervals.size(); }
+
+    double phi(uint64_t elapsed_ms) const;
+
+    // the smallest elapsed time at which phi reaches threshold
+    uint64_t elapsed_for_phi(double threshold) const;
+
+private:
+    void get_distribution(/*out*/ double &mean, /*out*/ double &stddev) const;
+
+private:
+    size_t _capacity;
+    std::deque<uint64_t> _intervals;
+    double _sum;
+    double _square_sum;
+};
+
 class failure_detector_callback
 {
 public:
@@ -109,11 +155,35 @@ public:
                      uint32_t grace_seconds,
                      bool use_allow_list = false);
 
+    // same as start(), with all the periods in milliseconds
+    error_code start_ms(uint32_t check_interval_ms,
+                        uint32_t beacon_interval_ms,
+                        uint32_t lease_ms,
+                        uint32_t grace_ms,
+                        bool use_allow_list = false);
+
     error_code stop();
 
+    // should be called before start, the lease is then adapted between min_lease_ms and
+    // the lease passed to start
+    void enable_phi_accrual(double phi_threshold, uint32_t min_lease_ms);
+
     uint32_t get_lease_ms() const { return _lease_milliseconds; }
     uint32_t get_grace_ms() const { return _grace_milliseconds; }
 
+    // the lease currently applied for the master, 0 if the master is not registered
+    uint32_t get_master_lease_ms(::dsn::rpc_address node) const;
+
+    // the grace currently given to the worker, 0 if the worker is not registered
+    uint32_t get_worker_grace_ms(::dsn::rpc_address node) const;
+
+    // worker side, count a reply from the master as the ack of a beacon sent at send_time
+    void record_master_traffic(::dsn::rpc_address node, uint64_t send_time);
+
+    // master side, count a request from the worker as a beacon,
+    // the caller should hold _lock
+    void record_worker_traffic(::dsn::rpc_address node);
+
     void register_master(::dsn::rpc_address target);
 
     bool switch_master(::dsn::rpc_address from, ::dsn::rpc_address to, uint32_t delay_milliseconds);
@@ -155,6 +225,9 @@ protected:
 
     bool is_time_greater_than(uint64_t ts, uint64_t base);
 
+    // the lease adapted to the intervals of the acked beacons
+    uint64_t get_adapted_lease_ms(const phi_accrual_window &intervals) const;
+
     void report(::dsn::rpc_address node, bool is_master, bool is_connected);
 
 private:
@@ -170,14 +243,28 @@ private:
         bool rejected;
         task_ptr send_beacon_timer;
 
+        // the lease applied, and the lease announced in the beacons sent since announce_time
+        uint64_t lease_ms;
+        uint64_t announced_lease_ms;
+        uint64_t announce_time;
+        // intervals between the acked beacons, excluding the piggybacked ones
+        uint64_t last_acked_beacon_time;
+        phi_accrual_window ack_intervals;
+
         // masters are always considered *disconnected* initially which is ok even when master
         // thinks workers are connected
-        master_record(::dsn::rpc_address n, uint64_t last_send_time_for_beacon_with_ack_)
+        master_record(::dsn::rpc_address n,
+                      uint64_t last_send_time_for_beacon_with_ack_,
+                      uint64_t lease_ms_)
         {
             node = n;
             last_send_time_for_beacon_with_ack = last_send_time_for_beacon_with_ack_;
             is_alive = false;
             rejected = false;
+            lease_ms = lease_ms_;
+            announced_lease_ms = lease_ms_;
+            announce_time = 0;
+            last_acked_beacon_time = 0;
         }
     };
 
@@ -188,6 +275,11 @@ private:
         uint64_t last_beacon_recv_time;
         bool is_alive;
 
+        // the lease announced by the worker and the time of the beacon carrying it,
+        // 0 if the worker doesn't announce its lease
+        uint64_t lease_ms;
+        uint64_t lease_beacon_time;
+
         // workers are always considered *connected* initially which is ok even when workers think
         // master is disconnected
         worker_record(::dsn::rpc_address node, uint64_t last_beacon_recv_time)
@@ -195,9 +287,14 @@ private:
             this->node = node;
             this->last_beacon_recv_time = last_beacon_recv_time;
             is_alive = true;
+            lease_ms = 0;
+            lease_beacon_time = 0;
         }
     };
 
+    void update_lease(master_record &record, const beacon_ack &ack);
+    uint64_t get_grace_ms(const worker_record &record) const;
+
 private:
     typedef std::unordered_map<::dsn::rpc_address, master_record> master_map;
     typedef std::unordered_map<::dsn::rpc_address, worker_record> worker_map;
@@ -214,6 +311,10 @@ private:
     uint32_t _lease_milliseconds;
     uint32_t _grace_milliseconds;
     bool _is_started;
+
+    bool _phi_accrual_enabled;
+    double _phi_threshold;
+    uint32_t _min_lease_milliseconds;
     ::dsn::task_ptr _check_task;
 
     bool _use_allow_list;
@@ -28,11 +28,15 @@ class config_master_message;
 
 typedef struct _beacon_msg__isset
 {
-    _beacon_msg__isset() : time(false), from_addr(false), to_addr(false), start_time(false) {}
+    _beacon_msg__isset()
+        : time(false), from_addr(false), to_addr(false), start_time(false), lease_ms(false)
+    {
+    }
     bool time : 1;
     bool from_addr : 1;
     bool to_addr : 1;
     bool start_time : 1;
+    bool lease_ms : 1;
 } _beacon_msg__isset;
 
 class beacon_msg
@@ -42,13 +46,14 @@ public:
     beacon_msg(beacon_msg &&);
     beacon_msg &operator=(const beacon_msg &);
     beacon_msg &operator=(beacon_msg &&);
-    beacon_msg() : time(0), start_time(0) {}
+    beacon_msg() : time(0), start_time(0), lease_ms(0) {}
 
     virtual ~beacon_msg() throw();
     int64_t time;
     ::dsn::rpc_address from_addr;
     ::dsn::rpc_address to_addr;
     int64_t start_time;
+    int64_t lease_ms;
 
     _beacon_msg__isset __isset;
 
@@ -60,6 +65,8 @@ public:
 
     void __set_start_time(const int64_t val);
 
+    void __set_lease_ms(const int64_t val);
+
     bool operator==(const beacon_msg &rhs) const
     {
         if (!(time == rhs.time))
@@ -72,6 +79,10 @@ public:
             return false;
         else if (__isset.start_time && !(start_time == rhs.start_time))
             return false;
+        if (__isset.lease_ms != rhs.__isset.lease_ms)
+            return false;
+        else if (__isset.lease_ms && !(lease_ms == rhs.lease_ms))
+            return false;
         return true;
     }
     bool operator!=(const beacon_msg &rhs) const { return !(*this == rhs); }
@@ -95,7 +106,12 @@ inline std::ostream &operator<<(std::ostream &out, const beacon_msg &obj)
 typedef struct _beacon_ack__isset
 {
     _beacon_ack__isset()
-        : time(false), this_node(false), primary_node(false), is_master(false), allowed(false)
+        : time(false),
+          this_node(false),
+          primary_node(false),
+          is_master(false),
+          allowed(false),
+          lease_ms(false)
     {
     }
     bool time : 1;
@@ -103,6 +119,7 @@ typedef struct _beacon_ack__isset
     bool primary_node : 1;
     bool is_master : 1;
     bool allowed : 1;
+    bool lease_ms : 1;
 } _beacon_ack__isset;
 
 class beacon_ack
@@ -112,7 +129,7 @@ public:
     beacon_ack(beacon_ack &&);
     beacon_ack &operator=(const beacon_ack &);
     beacon_ack &operator=(beacon_ack &&);
-    beacon_ack() : time(0), is_master(0), allowed(0) {}
+    beacon_ack() : time(0), is_master(0), allowed(0), lease_ms(0) {}
 
     virtual ~beacon_ack() throw();
     int64_t time;
@@ -120,6 +137,7 @@ public:
     ::dsn::rpc_address primary_node;
     bool is_master;
     bool allowed;
+    int64_t lease_ms;
 
     _beacon_ack__isset __isset;
 
@@ -133,6 +151,8 @@ public:
 
     void __set_allowed(const bool val);
 
+    void __set_lease_ms(const int64_t val);
+
     bool operator==(const beacon_ack &rhs) const
     {
         if (!(time == rhs.time))
@@ -145,6 +165,10 @@ public:
             return false;
         if (!(allowed == rhs.allowed))
             return false;
+        if (__isset.lease_ms != rhs.__isset.lease_ms)
+            return false;
+        else if (__isset.lease_ms && !(lease_ms == rhs.lease_ms))
+            return false;
         return true;
     }
     bool operator!=(const beacon_ack &rhs) const { return !(*this == rhs); }
@@ -90,7 +90,8 @@ struct config_type
         CT_REMOVE = 7,
         CT_ADD_SECONDARY_FOR_LB = 8,
         CT_PRIMARY_FORCE_UPDATE_BALLOT = 9,
-        CT_DROP_PARTITION = 10
+        CT_DROP_PARTITION = 10,
+        CT_HANDOVER_PRIMARY = 11
     };
 };
 
@@ -203,6 +204,8 @@ class configuration_query_by_node_request;
 
 class configuration_query_by_node_response;
 
+class meta_standby_push_request;
+
 class create_app_options;
 
 class configuration_create_app_request;
@@ -1651,12 +1654,19 @@ inline std::ostream &operator<<(std::ostream &out, const replica_server_info &ob
 
 typedef struct _configuration_query_by_node_request__isset
 {
-    _configuration_query_by_node_request__isset() : node(false), stored_replicas(false), info(false)
+    _configuration_query_by_node_request__isset()
+        : node(false),
+          stored_replicas(false),
+          info(false),
+          sync_version(false),
+          base_sync_version(false)
     {
     }
     bool node : 1;
     bool stored_replicas : 1;
     bool info : 1;
+    bool sync_version : 1;
+    bool base_sync_version : 1;
 } _configuration_query_by_node_request__isset;
 
 class configuration_query_by_node_request
@@ -1666,12 +1676,14 @@ public:
     configuration_query_by_node_request(configuration_query_by_node_request &&);
     configuration_query_by_node_request &operator=(const configuration_query_by_node_request &);
     configuration_query_by_node_request &operator=(configuration_query_by_node_request &&);
-    configuration_query_by_node_request() {}
+    configuration_query_by_node_request() : sync_version(0), base_sync_version(0) {}
 
     virtual ~configuration_query_by_node_request() throw();
     ::dsn::rpc_address node;
     std::vector<replica_info> stored_replicas;
     replica_server_info info;
+    int64_t sync_version;
+    int64_t base_sync_version;
 
     _configuration_query_by_node_request__isset __isset;
 
@@ -1681,6 +1693,10 @@ public:
 
     void __set_info(const replica_server_info &val);
 
+    void __set_sync_version(const int64_t val);
+
+    void __set_base_sync_version(const int64_t val);
+
     bool operator==(const configuration_query_by_node_request &rhs) const
     {
         if (!(node == rhs.node))
@@ -1693,6 +1709,14 @@ public:
             return false;
         else if (__isset.info && !(info == rhs.info))
             return false;
+        if (__isset.sync_version != rhs.__isset.sync_version)
+            return false;
+        else if (__isset.sync_version && !(sync_version == rhs.sync_version))
+            return false;
+        if (__isset.base_sync_version != rhs.__isset.base_sync_version)
+            return false;
+        else if (__isset.base_sync_version && !(base_sync_version == rhs.base_sync_version))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_request &rhs) const
@@ -1719,12 +1743,13 @@ inline std::ostream &operator<<(std::ostream &out, const configuration_query_by_
 typedef struct _configuration_query_by_node_response__isset
 {
     _configuration_query_by_node_response__isset()
-        : err(false), partitions(false), gc_replicas(false)
+        : err(false), partitions(false), gc_replicas(false), need_full_sync(false)
     {
     }
     bool err : 1;
     bool partitions : 1;
     bool gc_replicas : 1;
+    bool need_full_sync : 1;
 } _configuration_query_by_node_response__isset;
 
 class configuration_query_by_node_response
@@ -1734,12 +1759,13 @@ public:
     configuration_query_by_node_response(configuration_query_by_node_response &&);
     configuration_query_by_node_response &operator=(const configuration_query_by_node_response &);
     configuration_query_by_node_response &operator=(configuration_query_by_node_response &&);
-    configuration_query_by_node_response() {}
+    configuration_query_by_node_response() : need_full_sync(0) {}
 
     virtual ~configuration_query_by_node_response() throw();
     ::dsn::error_code err;
     std::vector<configuration_update_request> partitions;
     std::vector<replica_info> gc_replicas;
+    bool need_full_sync;
 
     _configuration_query_by_node_response__isset __isset;
 
@@ -1749,6 +1775,8 @@ public:
 
     void __set_gc_replicas(const std::vector<replica_info> &val);
 
+    void __set_need_full_sync(const bool val);
+
     bool operator==(const configuration_query_by_node_response &rhs) const
     {
         if (!(err == rhs.err))
@@ -1759,6 +1787,10 @@ public:
             return false;
         else if (__isset.gc_replicas && !(gc_replicas == rhs.gc_replicas))
             return false;
+        if (__isset.need_full_sync != rhs.__isset.need_full_sync)
+            return false;
+        else if (__isset.need_full_sync && !(need_full_sync == rhs.need_full_sync))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_response &rhs) const
@@ -1782,6 +1814,58 @@ inline std::ostream &operator<<(std::ostream &out, const configuration_query_by_
     return out;
 }
 
+typedef struct _meta_standby_push_request__isset
+{
+    _meta_standby_push_request__isset() : sequence(false), partitions(false) {}
+    bool sequence : 1;
+    bool partitions : 1;
+} _meta_standby_push_request__isset;
+
+class meta_standby_push_request
+{
+public:
+    meta_standby_push_request(const meta_standby_push_request &);
+    meta_standby_push_request(meta_standby_push_request &&);
+    meta_standby_push_request &operator=(const meta_standby_push_request &);
+    meta_standby_push_request &operator=(meta_standby_push_request &&);
+    meta_standby_push_request() : sequence(0) {}
+
+    virtual ~meta_standby_push_request() throw();
+    int64_t sequence;
+    std::vector<::dsn::partition_configuration> partitions;
+
+    _meta_standby_push_request__isset __isset;
+
+    void __set_sequence(const int64_t val);
+
+    void __set_partitions(const std::vector<::dsn::partition_configuration> &val);
+
+    bool operator==(const meta_standby_push_request &rhs) const
+    {
+        if (!(sequence == rhs.sequence))
+            return false;
+        if (!(partitions == rhs.partitions))
+            return false;
+        return true;
+    }
+    bool operator!=(const meta_standby_push_request &rhs) const { return !(*this == rhs); }
+
+    bool operator<(const meta_standby_push_request &) const;
+
+    uint32_t read(::apache::thrift::protocol::TProtocol *iprot);
+    uint32_t write(::apache::thrift::protocol::TProtocol *oprot) const;
+
+    virtual void printTo(std::ostream &out) const;
+};
+
+void swap(meta_standby_push_request &a, meta_standby_push_request &b);
+
+inline std::ostream &operator<<(std::ostream &out, const meta_standby_push_request &obj)
+{
+    obj.printTo(out);
+    return out;
+}
+
 typedef struct _create_app_options__isset
 {
     _create_app_options__isset()
@@ -2915,7 +2999,11 @@ typedef struct _replica_info__isset
           last_prepared_decree(false),
           last_durable_decree(false),
           app_type(false),
-          disk_tag(false)
+          disk_tag(false),
+          read_qps(false),
+          write_qps(false),
+          read_bytes_per_second(false),
+          write_bytes_per_second(false)
     {
     }
     bool pid : 1;
@@ -2926,6 +3014,10 @@ typedef struct _replica_info__isset
     bool last_durable_decree : 1;
     bool app_type : 1;
     bool disk_tag : 1;
+    bool read_qps : 1;
+    bool write_qps : 1;
+    bool read_bytes_per_second : 1;
+    bool write_bytes_per_second : 1;
 } _replica_info__isset;
 
 class replica_info
@@ -2942,7 +3034,11 @@ public:
           last_prepared_decree(0),
           last_durable_decree(0),
           app_type(),
-          disk_tag()
+          disk_tag(),
+          read_qps(0),
+          write_qps(0),
+          read_bytes_per_second(0),
+          write_bytes_per_second(0)
     {
     }
 
@@ -2955,6 +3051,10 @@ public:
     int64_t last_durable_decree;
     std::string app_type;
     std::string disk_tag;
+    int64_t read_qps;
+    int64_t write_qps;
+    int64_t read_bytes_per_second;
+    int64_t write_bytes_per_second;
 
     _replica_info__isset __isset;
 
@@ -2974,6 +3074,14 @@ public:
 
     void __set_disk_tag(const std::string &val);
 
+    void __set_read_qps(const int64_t val);
+
+    void __set_write_qps(const int64_t val);
+
+    void __set_read_bytes_per_second(const int64_t val);
+
+    void __set_write_bytes_per_second(const int64_t val);
+
     bool operator==(const replica_info &rhs) const
     {
         if (!(pid == rhs.pid))
@@ -2992,6 +3100,24 @@ public:
             return false;
         if (!(disk_tag == rhs.disk_tag))
             return false;
+        if (__isset.read_qps != rhs.__isset.read_qps)
+            return false;
+        else if (__isset.read_qps && !(read_qps == rhs.read_qps))
+            return false;
+        if (__isset.write_qps != rhs.__isset.write_qps)
+            return false;
+        else if (__isset.write_qps && !(write_qps == rhs.write_qps))
+            return false;
+        if (__isset.read_bytes_per_second != rhs.__isset.read_bytes_per_second)
+            return false;
+        else if (__isset.read_bytes_per_second &&
+                 !(read_bytes_per_second == rhs.read_bytes_per_second))
+            return false;
+        if (__isset.write_bytes_per_second != rhs.__isset.write_bytes_per_second)
+            return false;
+        else if (__isset.write_bytes_per_second &&
+                 !(write_bytes_per_second == rhs.write_bytes_per_second))
+            return false;
         return true;
     }
     bool operator!=(const replica_info &rhs) const { return !(*this == rhs); }
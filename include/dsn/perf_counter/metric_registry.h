@@ -0,0 +1,191 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <dsn/utility/singleton.h>
+
+namespace dsn {
+
+///
+/// labeled metrics, as a complement of the perf counters for the dimensions with many
+/// values, such as the partitions and the rpc codes.
+///
+/// a metric family (e.g. "replica_write_requests") holds a series for each label set
+/// in use. users get the series of a label set with metric_family::get(), and update
+/// it with increment() or observe():
+///
+///  - the lookup is lock-free, only the first use of a label set takes a lock.
+///  - the values are sharded by cpu, an update is a relaxed atomic add on the shard of
+///    the current cpu.
+///  - the number of the series of a family is bounded by max_series, the label sets
+///    beyond it are counted in a single series labeled overflow="true".
+///  - the series are never removed, so the snapshots are taken without any lock.
+///
+/// all the metrics are exported in the prometheus text format at
+/// http://ip:port/metrics.
+///
+struct metric_labels
+{
+    // -1 if the label is not set
+    int32_t app_id;
+    int32_t partition_index;
+    int32_t task_code;
+
+    explicit metric_labels(int32_t app_id = -1, int32_t partition_index = -1, int32_t code = -1)
+        : app_id(app_id), partition_index(partition_index), task_code(code)
+    {
+    }
+
+    bool operator==(const metric_labels &r) const
+    {
+        return app_id == r.app_id && partition_index == r.partition_index &&
+               task_code == r.task_code;
+    }
+
+    uint64_t hash() const;
+};
+
+enum class metric_type
+{
+    // increases monotonically
+    counter,
+    // counts the observed values in buckets
+    histogram,
+};
+
+class metric_family;
+
+// a series of a family, whose values are sharded by cpu
+class metric_series
+{
+public:
+    metric_series(const metric_family *family, const metric_labels &labels, bool overflow);
+
+    // for counters
+    void increment(uint64_t n = 1)
+    {
+        value_of_current_shard(0).fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // for histograms
+    void observe(uint64_t value);
+
+    const metric_labels &labels() const { return _labels; }
+    bool is_overflow() const { return _overflow; }
+
+    // for counters: the value
+    // for histograms: the sum, followed by the counts of the buckets (not cumulative),
+    // the last bucket is +Inf
+    std::vector<uint64_t> snapshot() const;
+
+private:
+    std::atomic<uint64_t> &value_of_current_shard(size_t index);
+
+    const metric_family *_family;
+    const metric_labels _labels;
+    const bool _overflow;
+    // _shard_count shards, each starts at a cache line and holds _values_per_shard values
+    size_t _values_per_shard;
+    size_t _stride;
+    std::unique_ptr<std::atomic<uint64_t>[]> _buffer;
+    std::atomic<uint64_t> *_values;
+};
+
+class metric_family
+{
+public:
+    metric_family(const std::string &name,
+                  const std::string &help,
+                  metric_type type,
+                  const std::vector<uint64_t> &buckets,
+                  size_t max_series);
+
+    // lock-free unless the label set is used for the first time
+    metric_series *get(const metric_labels &labels);
+
+    const std::string &name() const { return _name; }
+    const std::string &help() const { return _help; }
+    metric_type type() const { return _type; }
+    // the upper bounds of the buckets of a histogram, +Inf not included
+    const std::vector<uint64_t> &buckets() const { return _buckets; }
+
+    // the series in use, which are never removed
+    void get_all_series(std::vector<const metric_series *> &series) const;
+
+private:
+    const std::string _name;
+    const std::string _help;
+    const metric_type _type;
+    const std::vector<uint64_t> _buckets;
+    const size_t _max_series;
+
+    // an open addressing hash table, the slots are only set once, with _lock held
+    std::mutex _lock;
+    std::vector<std::atomic<metric_series *>> _slots;
+    std::atomic<size_t> _series_count;
+    std::vector<std::unique_ptr<metric_series>> _series;
+    std::unique_ptr<metric_series> _overflow_series;
+};
+
+class metric_registry : public utils::singleton<metric_registry>
+{
+public:
+    metric_registry();
+
+    // return the registered family if the name is used,
+    // which should be of the same type
+    metric_family *register_counter(const std::string &name,
+                                    const std::string &help,
+                                    size_t max_series = 4096);
+    metric_family *register_histogram(const std::string &name,
+                                      const std::string &help,
+                                      const std::vector<uint64_t> &buckets,
+                                      size_t max_series = 4096);
+
+    std::string to_prometheus_text() const;
+
+    // upper bounds for the latencies in microseconds, 100us to about 13s
+    static std::vector<uint64_t> latency_us_buckets();
+
+private:
+    metric_family *register_family(const std::string &name,
+                                   const std::string &help,
+                                   metric_type type,
+                                   const std::vector<uint64_t> &buckets,
+                                   size_t max_series);
+
+    mutable std::mutex _lock;
+    std::vector<std::unique_ptr<metric_family>> _families;
+};
+
+} // namespace dsn
@@ -196,6 +196,9 @@ public:
     //
     DSN_API void write_next(void **ptr, size_t *size, size_t min_size);
     DSN_API void write_commit(size_t size);
+    // append data as a new buffer by reference, without copying it.
+    // the data must not be modified until the message is sent.
+    DSN_API void write_append(const blob &data);
     DSN_API bool read_next(void **ptr, size_t *size);
     bool read_next(blob &data);
     DSN_API void read_commit(size_t size);
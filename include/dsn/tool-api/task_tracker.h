@@ -40,6 +40,7 @@
 #include <dsn/utility/synchronize.h>
 #include <dsn/c/api_utilities.h>
 #include <atomic>
+#include <cstdint>
 
 namespace dsn {
 //
@@ -50,10 +51,11 @@ namespace dsn {
 //
 class task;
 class task_tracker;
+struct tracked_task_node;
 class trackable_task
 {
 public:
-    trackable_task() : _task(nullptr), _owner(nullptr), _dl_bucket_id(0) {}
+    trackable_task() : _owner(nullptr), _node(nullptr) {}
     virtual ~trackable_task() {}
 
     void set_tracker(task_tracker *owner, task *tsk);
@@ -61,26 +63,9 @@ public:
     task_tracker *tracker() const { return _owner; }
 
 private:
-    friend class task_tracker;
-
-    enum owner_delete_state
-    {
-        OWNER_DELETE_NOT_LOCKED = 0,
-        OWNER_DELETE_LOCKED = 1,
-        OWNER_DELETE_FINISHED = 2
-    };
-
-    task *_task;
     task_tracker *_owner;
-    std::atomic<owner_delete_state> _deleting_owner;
-
-    // double-linked list for put into _owner
-    dlink _dl;
-    int _dl_bucket_id;
-
-private:
-    owner_delete_state owner_delete_prepare();
-    void owner_delete_commit();
+    // in the list of the thread which sets the tracker, see task_tracker.cpp
+    tracked_task_node *_node;
 };
 
 //
@@ -150,9 +135,16 @@ private:
 //    t.cancel_outstanding_tasks(); <-- right, cancel can apply to any tasks.
 //    tsk2.cancel(true); t.wait_out_standing_tasks(); <-- right, first cancel timer, then wait.
 //
+// the tracked tasks are kept in the lists of the threads creating them, rather than
+// in the tracker, so that tracking a task costs a relaxed increment on the tracker and
+// no lock. the nodes of the destroyed tasks are unlinked lazily by the owner threads.
+// on the other hand, "wait" and "cancel" scan the lists of all the threads, unless
+// there are no outstanding tasks of the tracker.
+//
 class task_tracker
 {
 public:
+    // task_bucket_count is not used any more, kept for compatibility
     explicit task_tracker(int task_bucket_count = 1);
     virtual ~task_tracker();
 
@@ -168,62 +160,7 @@ public:
 
 private:
     friend class trackable_task;
-    const int _task_bucket_count;
-    ::dsn::utils::ex_lock_nr_spin *_outstanding_tasks_lock;
-    dlink *_outstanding_tasks;
+    // the tracked tasks which are neither destroyed nor waited/cancelled by the tracker
+    std::atomic<int64_t> _outstanding_count;
 };
-
-// ------- inlined implementation ----------
-inline void trackable_task::set_tracker(task_tracker *owner, task *tsk)
-{
-    dassert(_owner == nullptr, "task tracker is already set");
-    _owner = owner;
-    _task = tsk;
-    _deleting_owner.store(OWNER_DELETE_NOT_LOCKED, std::memory_order_release);
-
-    if (nullptr != _owner) {
-        _dl_bucket_id =
-            static_cast<int>(::dsn::utils::get_current_tid() % _owner->_task_bucket_count);
-        {
-            utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(
-                _owner->_outstanding_tasks_lock[_dl_bucket_id]);
-            _dl.insert_after(&_owner->_outstanding_tasks[_dl_bucket_id]);
-        }
-    }
-}
-
-inline void trackable_task::unset_tracker()
-{
-    if (nullptr != _owner) {
-        auto s = owner_delete_prepare();
-        switch (s) {
-        case OWNER_DELETE_NOT_LOCKED:
-            owner_delete_commit();
-            break;
-        case OWNER_DELETE_LOCKED:
-            while (OWNER_DELETE_LOCKED == _deleting_owner.load(std::memory_order_consume)) {
-            }
-            break;
-        case OWNER_DELETE_FINISHED:
-            break;
-        }
-        _owner = nullptr;
-    }
-}
-
-inline trackable_task::owner_delete_state trackable_task::owner_delete_prepare()
-{
-    return _deleting_owner.exchange(OWNER_DELETE_LOCKED, std::memory_order_acquire);
-}
-
-inline void trackable_task::owner_delete_commit()
-{
-    {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(
-            _owner->_outstanding_tasks_lock[_dl_bucket_id]);
-        _dl.remove();
-    }
-
-    _deleting_owner.store(OWNER_DELETE_FINISHED, std::memory_order_relaxed);
-}
 }
@@ -0,0 +1,126 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <dsn/c/api_layer1.h>
+#include <dsn/tool-api/rpc_address.h>
+
+namespace dsn {
+//
+// always-on sampled tracing of requests.
+//
+// a request is traced if the trace id in its rpc header is sampled, and the trace id
+// is passed on to the rpcs issued for the request, so all the nodes on the path
+// record the spans of the same requests without carrying a flag in the message.
+//
+// the spans are kept in per-thread ring buffers which overwrite the oldest spans,
+// recording a span never takes a lock. the recent spans can be dumped as the chrome
+// trace format ("tracing/chrome" of the http server), which can be loaded by
+// chrome://tracing.
+//
+// options in [core]:
+//   tracing_sample_rate: trace one of every N requests, 0 to disable, default is 1000
+//   tracing_spans_per_thread: size of the ring buffers, default is 1024
+//
+namespace tracing {
+
+enum class span_arg
+{
+    none,
+    number,
+    // an ipv4 address packed by pack_address
+    address,
+};
+
+namespace internal_use_only {
+extern uint32_t sample_rate;
+}
+
+// called on start with the options, spans_per_thread only applies to the threads which
+// haven't recorded any span
+extern void init(uint32_t sample_rate, uint32_t spans_per_thread);
+
+inline bool is_sampled(uint64_t trace_id)
+{
+    // the trace ids are random, so the decision is the same on every node
+    uint32_t rate = internal_use_only::sample_rate;
+    return rate != 0 && trace_id != 0 && (trace_id >> 8) % rate == 0;
+}
+
+inline uint64_t pack_address(rpc_address addr)
+{
+    return (static_cast<uint64_t>(addr.ip()) << 16) | addr.port();
+}
+
+// name should be a string literal, as only the pointer is kept
+extern void add_span(uint64_t trace_id,
+                     const char *name,
+                     uint64_t start_ns,
+                     uint64_t end_ns,
+                     span_arg arg_type = span_arg::none,
+                     uint64_t arg = 0);
+
+// dump the spans in all the ring buffers as the chrome trace format,
+// only the spans of the specified trace if trace_id is not 0
+extern std::string dump_chrome_trace(uint64_t trace_id = 0);
+
+// record a span from the construction to the destruction if the trace is sampled
+class scoped_span
+{
+public:
+    scoped_span(uint64_t trace_id,
+                const char *name,
+                span_arg arg_type = span_arg::none,
+                uint64_t arg = 0)
+        : _trace_id(is_sampled(trace_id) ? trace_id : 0),
+          _name(name),
+          _arg_type(arg_type),
+          _arg(arg),
+          _start_ns(_trace_id != 0 ? dsn_now_ns() : 0)
+    {
+    }
+
+    ~scoped_span()
+    {
+        if (_trace_id != 0)
+            add_span(_trace_id, _name, _start_ns, dsn_now_ns(), _arg_type, _arg);
+    }
+
+    scoped_span(const scoped_span &) = delete;
+    scoped_span &operator=(const scoped_span &) = delete;
+
+private:
+    uint64_t _trace_id;
+    const char *_name;
+    span_arg _arg_type;
+    uint64_t _arg;
+    uint64_t _start_ns;
+};
+}
+}
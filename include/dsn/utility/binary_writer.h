@@ -34,13 +34,19 @@ public:
 
     void write(const std::string &val);
     void write(const char *buffer, int sz);
+    // blobs not smaller than zero_copy_write_min_bytes are appended by reference
     void write(const blob &val);
     void write_empty(int sz);
 
+    // append the bytes of val as a new segment by reference, without copying, so val must
+    // not be modified until the writer and the buffers got from it are released
+    void append(const blob &val);
+
     bool next(void **data, int *size);
     bool backup(int count);
 
-    void get_buffers(/*out*/ std::vector<blob> &buffers);
+    // the segments written, including the ones appended by reference
+    const std::vector<blob> &get_buffers();
     int get_buffer_count() const { return static_cast<int>(_buffers.size()); }
     blob get_buffer();
     blob get_current_buffer(); // without commit, write can be continued on the last buffer
@@ -48,11 +54,17 @@ public:
 
     int total_size() const { return _total_size; }
 
+    // blobs smaller than this are copied by write(const blob &), as a segment costs more
+    // than a memcpy for small data when it is sent or written to disk
+    static const int zero_copy_write_min_bytes = 4096;
+
 protected:
     // bb may have large space than size
     void create_buffer(size_t size);
     void commit();
     virtual void create_new_buffer(size_t size, /*out*/ blob &bb);
+    // called by append() before bb is added as a segment
+    virtual void append_buffer(const blob &bb) {}
 
 private:
     std::vector<blob> _buffers;
@@ -73,10 +85,10 @@ inline void binary_writer::write_pod(const T &val)
     write((char *)&val, static_cast<int>(sizeof(T)));
 }
 
-inline void binary_writer::get_buffers(/*out*/ std::vector<blob> &buffers)
+inline const std::vector<blob> &binary_writer::get_buffers()
 {
     commit();
-    buffers = _buffers;
+    return _buffers;
 }
 
 inline blob binary_writer::get_first_buffer() const { return _buffers[0]; }
@@ -91,10 +103,12 @@ inline void binary_writer::write(const std::string &val)
 
 inline void binary_writer::write(const blob &val)
 {
-    // TODO: optimization by not memcpy
     int len = val.length();
     write((const char *)&len, sizeof(int));
-    if (len > 0)
+    // raw blobs are copied as their lifetime is unknown
+    if (len >= zero_copy_write_min_bytes && val.buffer_ptr() != nullptr)
+        append(val);
+    else if (len > 0)
         write((const char *)val.data(), len);
 }
 }
@@ -26,90 +26,281 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <dsn/utility/autoref_ptr.h>
 #include <thrift/protocol/TProtocol.h>
 
 namespace dsn {
 
+/// The ref-counted buffer under dsn::blob. The ref count is intrusive, so copying a
+/// blob costs a single atomic increment on the buffer, without any control block.
+class blob_buffer : public ref_counter
+{
+public:
+    char *data() const { return _data; }
+
+    /// A buffer of `size` bytes, allocated together with the header.
+    static blob_buffer *create(size_t size);
+
+    /// Take over a buffer owned by shared_ptr, for compatibility.
+    static blob_buffer *create(std::shared_ptr<char> buffer);
+
+    /// Take over a string without copying.
+    static blob_buffer *create(std::string &&bytes);
+
+protected:
+    explicit blob_buffer(char *data) : _data(data) {}
+
+    char *_data;
+};
+
+typedef ref_ptr<blob_buffer> blob_buffer_ptr;
+
+namespace internal_use_only {
+
+class heap_blob_buffer : public blob_buffer
+{
+public:
+    heap_blob_buffer() : blob_buffer(reinterpret_cast<char *>(this + 1)) {}
+
+    // allocated by ::operator new with the data
+    static void operator delete(void *p) { ::operator delete(p); }
+};
+
+class shared_blob_buffer : public blob_buffer
+{
+public:
+    explicit shared_blob_buffer(std::shared_ptr<char> &&buffer)
+        : blob_buffer(buffer.get()), _buffer(std::move(buffer))
+    {
+    }
+
+private:
+    std::shared_ptr<char> _buffer;
+};
+
+class string_blob_buffer : public blob_buffer
+{
+public:
+    explicit string_blob_buffer(std::string &&bytes)
+        : blob_buffer(nullptr), _bytes(std::move(bytes))
+    {
+        _data = &_bytes[0];
+    }
+
+private:
+    std::string _bytes;
+};
+
+} // namespace internal_use_only
+
+inline blob_buffer *blob_buffer::create(size_t size)
+{
+    void *p = ::operator new(sizeof(internal_use_only::heap_blob_buffer) + size);
+    return new (p) internal_use_only::heap_blob_buffer();
+}
+
+inline blob_buffer *blob_buffer::create(std::shared_ptr<char> buffer)
+{
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    return new internal_use_only::shared_blob_buffer(std::move(buffer));
+}
+
+inline blob_buffer *blob_buffer::create(std::string &&bytes)
+{
+    return new internal_use_only::string_blob_buffer(std::move(bytes));
+}
+
 /// dsn::blob is a special thrift type that's not generated by thrift compiler,
 /// but defined by the rDSN framework. Unlike thrift `string`, dsn::blob is
 /// implemented by ref-counted buffer.
+///
+/// Values of at most INLINE_CAPACITY bytes created by create_from_bytes() (and
+/// deserialized by thrift) are stored inside the blob without any buffer.
+/// NOTE: the data of such a blob moves with the blob, never keep data() across a copy
+/// or a move of an inline blob.
 class blob
 {
 public:
-    constexpr blob() = default;
+    static const unsigned int INLINE_CAPACITY = 64;
+
+    blob() : _shared{nullptr, nullptr} {}
+
+    blob(blob_buffer *buffer, unsigned int length) : blob(buffer, 0, length) {}
 
-    blob(std::shared_ptr<char> buffer, unsigned int length)
-        : _holder(std::move(buffer)), _buffer(_holder.get()), _data(_holder.get()), _length(length)
+    blob(blob_buffer *buffer, int offset, unsigned int length) : blob()
     {
+        assign(buffer, offset, length);
     }
 
-    blob(std::shared_ptr<char> buffer, int offset, unsigned int length)
-        : _holder(std::move(buffer)),
-          _buffer(_holder.get()),
-          _data(_holder.get() + offset),
-          _length(length)
+    blob(const blob_buffer_ptr &buffer, unsigned int length) : blob(buffer.get(), 0, length) {}
+
+    blob(const blob_buffer_ptr &buffer, int offset, unsigned int length)
+        : blob(buffer.get(), offset, length)
+    {
+    }
+
+    /// For compatibility, prefer blob_buffer to avoid wrapping the shared_ptr.
+    blob(std::shared_ptr<char> buffer, unsigned int length) : blob(std::move(buffer), 0, length)
     {
     }
 
+    blob(std::shared_ptr<char> buffer, int offset, unsigned int length) : blob()
+    {
+        assign(std::move(buffer), offset, length);
+    }
+
     /// NOTE: Use dsn::string_view whenever possible.
     /// blob is designed for shared buffer, never use it as constant view.
     /// Maybe we could deprecate this function in the future.
     blob(const char *buffer, int offset, unsigned int length)
-        : _buffer(buffer), _data(buffer + offset), _length(length)
+        : _shared{nullptr, buffer + offset}, _length(length)
+    {
+    }
+
+    blob(const blob &r) { copy_from(r); }
+
+    blob(blob &&r) noexcept { move_from(std::move(r)); }
+
+    ~blob() { release(); }
+
+    blob &operator=(const blob &r)
+    {
+        if (this != &r) {
+            blob temp(r);
+            release();
+            move_from(std::move(temp));
+        }
+        return *this;
+    }
+
+    blob &operator=(blob &&r) noexcept
     {
+        if (this != &r) {
+            release();
+            move_from(std::move(r));
+        }
+        return *this;
     }
 
     /// Create shared buffer from allocated raw bytes.
-    /// NOTE: this operation is not efficient since it involves a memory copy.
+    /// NOTE: this operation is not efficient since it involves a memory copy,
+    /// unless the bytes are stored inline.
     static blob create_from_bytes(const char *s, size_t len)
     {
-        std::shared_ptr<char> s_arr(new char[len], std::default_delete<char[]>());
-        memcpy(s_arr.get(), s, len);
-        return blob(std::move(s_arr), 0, static_cast<unsigned int>(len));
+        blob b;
+        if (len <= INLINE_CAPACITY) {
+            b.assign_inline(s, static_cast<unsigned int>(len));
+        } else {
+            blob_buffer *buffer = blob_buffer::create(len);
+            memcpy(buffer->data(), s, len);
+            b.assign(buffer, 0, static_cast<unsigned int>(len));
+        }
+        return b;
     }
 
     /// Create shared buffer without copying data.
     static blob create_from_bytes(std::string &&bytes)
     {
-        auto s = new std::string(std::move(bytes));
-        std::shared_ptr<char> buf(const_cast<char *>(s->data()), [s](char *) { delete s; });
-        return blob(std::move(buf), 0, static_cast<unsigned int>(s->length()));
+        if (bytes.length() <= INLINE_CAPACITY) {
+            return create_from_bytes(bytes.data(), bytes.length());
+        }
+        auto length = static_cast<unsigned int>(bytes.length());
+        return blob(blob_buffer::create(std::move(bytes)), 0, length);
     }
 
-    void assign(const std::shared_ptr<char> &buffer, int offset, unsigned int length)
+    void assign(const blob_buffer_ptr &buffer, int offset, unsigned int length)
+    {
+        assign(buffer.get(), offset, length);
+    }
+
+    void assign(blob_buffer *holder, int offset, unsigned int length)
     {
-        _holder = buffer;
-        _buffer = _holder.get();
-        _data = _holder.get() + offset;
+        if (holder != nullptr) {
+            holder->add_ref();
+        }
+        release();
+        _shared.holder = holder;
+        _shared.data = holder == nullptr ? nullptr : holder->data() + offset;
         _length = length;
+        _inline_offset = NOT_INLINE;
+    }
+
+    void assign(const std::shared_ptr<char> &buffer, int offset, unsigned int length)
+    {
+        assign(blob_buffer::create(buffer), offset, length);
     }
 
     void assign(std::shared_ptr<char> &&buffer, int offset, unsigned int length)
     {
-        _holder = std::move(buffer);
-        _buffer = (_holder.get());
-        _data = (_holder.get() + offset);
-        _length = length;
+        assign(blob_buffer::create(std::move(buffer)), offset, length);
     }
 
     /// Deprecated. Use dsn::string_view whenever possible.
     void assign(const char *buffer, int offset, unsigned int length)
     {
-        _holder = nullptr;
-        _buffer = buffer;
-        _data = buffer + offset;
+        release();
+        _shared.holder = nullptr;
+        _shared.data = buffer + offset;
         _length = length;
+        _inline_offset = NOT_INLINE;
     }
 
-    const char *data() const noexcept { return _data; }
+    /// Store length bytes inline, which should be at most INLINE_CAPACITY.
+    /// The bytes are left uninitialized if s is null.
+    void assign_inline(const char *s, unsigned int length)
+    {
+        assert(length <= INLINE_CAPACITY);
+        release();
+        _length = length;
+        _inline_offset = 0;
+        if (s != nullptr && length > 0) {
+            memcpy(_inline, s, length);
+        }
+    }
+
+    const char *data() const noexcept
+    {
+        return _inline_offset == NOT_INLINE ? _shared.data : _inline + _inline_offset;
+    }
 
     unsigned int length() const noexcept { return _length; }
     unsigned int size() const noexcept { return _length; }
 
-    std::shared_ptr<char> buffer() const { return _holder; }
+    bool is_inline() const noexcept { return _inline_offset != NOT_INLINE; }
+
+    blob_buffer_ptr holder() const { return is_inline() ? nullptr : _shared.holder; }
+
+    /// For compatibility, which allocates a control block for the shared_ptr.
+    /// An inline blob returns a copy of its data.
+    std::shared_ptr<char> buffer() const
+    {
+        if (is_inline()) {
+            std::shared_ptr<char> copy(new char[INLINE_CAPACITY], std::default_delete<char[]>());
+            memcpy(copy.get(), _inline, _inline_offset + _length);
+            return copy;
+        }
+        if (_shared.holder == nullptr) {
+            return nullptr;
+        }
+        blob_buffer_ptr holder = _shared.holder;
+        return std::shared_ptr<char>(holder->data(), [holder](char *) {});
+    }
 
-    const char *buffer_ptr() const { return _holder.get(); }
+    // null if the blob doesn't own its data
+    const char *buffer_ptr() const
+    {
+        if (is_inline()) {
+            return _inline;
+        }
+        return _shared.holder == nullptr ? nullptr : _shared.holder->data();
+    }
 
     // offset can be negative for buffer dereference
     blob range(int offset) const
@@ -118,8 +309,7 @@ public:
         assert(offset <= static_cast<int>(_length));
 
         blob temp = *this;
-        temp._data += offset;
-        temp._length -= offset;
+        temp.advance(offset);
         return temp;
     }
 
@@ -129,8 +319,7 @@ public:
         assert(offset <= static_cast<int>(_length));
 
         blob temp = *this;
-        temp._data += offset;
-        temp._length -= offset;
+        temp.advance(offset);
 
         // buffer length must exceed the required length
         assert(temp._length >= len);
@@ -149,7 +338,7 @@ public:
     {
         if (_length == 0)
             return {};
-        return std::string(_data, _length);
+        return std::string(data(), _length);
     }
 
     // for serialization in thrift format
@@ -157,11 +346,68 @@ public:
     uint32_t write(::apache::thrift::protocol::TProtocol *oprot) const;
 
 private:
+    static const uint8_t NOT_INLINE = 0xff;
+
+    void advance(int offset)
+    {
+        if (is_inline()) {
+            _inline_offset = static_cast<uint8_t>(_inline_offset + offset);
+        } else {
+            _shared.data += offset;
+        }
+        _length -= offset;
+    }
+
+    void release()
+    {
+        if (!is_inline() && _shared.holder != nullptr) {
+            _shared.holder->release_ref();
+        }
+        _shared.holder = nullptr;
+    }
+
+    // the fields of this blob should be released
+    void copy_from(const blob &r)
+    {
+        _length = r._length;
+        _inline_offset = r._inline_offset;
+        if (r.is_inline()) {
+            memcpy(_inline, r._inline, r._inline_offset + r._length);
+        } else {
+            _shared = r._shared;
+            if (_shared.holder != nullptr) {
+                _shared.holder->add_ref();
+            }
+        }
+    }
+
+    // the fields of this blob should be released
+    void move_from(blob &&r)
+    {
+        _length = r._length;
+        _inline_offset = r._inline_offset;
+        if (r.is_inline()) {
+            memcpy(_inline, r._inline, r._inline_offset + r._length);
+        } else {
+            _shared = r._shared;
+            r._shared.holder = nullptr;
+        }
+    }
+
+    struct shared_data
+    {
+        blob_buffer *holder;
+        const char *data;
+    };
+
     friend class binary_writer;
-    std::shared_ptr<char> _holder;
-    const char *_buffer{nullptr};
-    const char *_data{nullptr};
+    union
+    {
+        shared_data _shared;
+        char _inline[INLINE_CAPACITY];
+    };
     unsigned int _length{0}; // data length
+    uint8_t _inline_offset{NOT_INLINE};
 };
 
 } // namespace dsn
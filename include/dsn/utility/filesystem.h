@@ -128,6 +128,23 @@ struct disk_space_info
 };
 bool get_disk_space_info(const std::string &path, disk_space_info &info);
 
+// get the accumulated milliseconds spent doing I/Os ("io_ticks" in /proc/diskstats) of
+// the block device on which the path resides, only supported on linux.
+// the io utilization during a period is the delta of io_ticks divided by the period.
+bool get_disk_io_ticks(const std::string &path, /*out*/ uint64_t &io_ticks_ms);
+
+// recursively copy the directory src to dest, which must not exist.
+// dest is left partially copied on failure, the caller should remove it.
+bool copy_directory(const std::string &src, const std::string &dest);
+
+// copy the file src to dest, which is overwritten if exists. the last write time of src
+// before the copy is kept on dest, so that is_same_file_stat() tells whether src has been
+// changed since it was copied.
+bool copy_file(const std::string &src, const std::string &dest, /*out*/ uint64_t &copied_size);
+
+// whether the two files exist with the same size and last write time (in nanoseconds)
+bool is_same_file_stat(const std::string &path1, const std::string &path2);
+
 bool link_file(const std::string &src, const std::string &target);
 
 error_code md5sum(const std::string &file_path, /*out*/ std::string &result);
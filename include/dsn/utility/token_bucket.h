@@ -0,0 +1,104 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     token bucket for rate limiting, e.g. bandwidth of nfs copy
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/utility/utils.h>
+#include <dsn/utility/synchronize.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace dsn {
+
+//
+// a reservation-style token bucket:
+// consume() always succeeds and lets the bucket go into debt, returning how long the
+// caller should wait before actually using the tokens. this keeps callers fair
+// (first come, first served) and avoids busy polling.
+//
+// rate == 0 means unlimited.
+//
+class token_bucket
+{
+public:
+    explicit token_bucket(uint64_t rate_per_second = 0, uint64_t burst = 0)
+    {
+        reset(rate_per_second, burst);
+    }
+
+    void reset(uint64_t rate_per_second, uint64_t burst)
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+        _rate = rate_per_second;
+        _burst = std::max(burst, rate_per_second);
+        _tokens = static_cast<double>(_burst);
+        _last_refill_ns = utils::get_current_physical_time_ns();
+    }
+
+    // returns the delay in milliseconds after which the consumed tokens are available
+    uint64_t consume(uint64_t count)
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+        if (_rate == 0)
+            return 0;
+
+        refill();
+        _tokens -= static_cast<double>(count);
+        if (_tokens >= 0)
+            return 0;
+        return static_cast<uint64_t>(-_tokens * 1000.0 / static_cast<double>(_rate)) + 1;
+    }
+
+    bool unlimited() const { return _rate == 0; }
+
+private:
+    void refill()
+    {
+        uint64_t now = utils::get_current_physical_time_ns();
+        if (now <= _last_refill_ns)
+            return;
+        _tokens += static_cast<double>(now - _last_refill_ns) * _rate / 1000000000.0;
+        _tokens = std::min(_tokens, static_cast<double>(_burst));
+        _last_refill_ns = now;
+    }
+
+private:
+    utils::ex_lock_nr_spin _lock;
+    uint64_t _rate;
+    uint64_t _burst;
+    double _tokens;
+    uint64_t _last_refill_ns;
+};
+}
@@ -28,6 +28,7 @@
 
 #include <dsn/utility/ports.h>
 #include <dsn/utility/blob.h>
+#include <string>
 
 namespace dsn {
 
@@ -41,20 +42,26 @@ namespace dsn {
 /// |--------------- pre-allocated block --------------------| <- tls_trans_memory.block
 /// |--memory piece 1--|--memory piece 2--|--memory piece 3--|
 ///
-/// the tls_trans_memory->block is a shared_ptr pointing to the pre-allocated block,
-/// for each memory piece allocated from the block, there is also a shared-ptr pointing the whole
+/// the tls_trans_memory->block is a blob_buffer_ptr pointing to the pre-allocated block,
+/// for each memory piece allocated from the block, there is also a blob referring the whole
 /// block. please refer to @tls_trans_mem_next for details
 ///
-/// so the pre-allocated block will be free until all the shared-ptrs are destructed.
+/// so the pre-allocated block will be free until all the references are released.
 /// tls_trans_memory.block will release an old memory_block if the remaining size is
-/// too small, and other shared-ptr will release the block when "tls_trans_free" calls
+/// too small, and the blobs will release the block when they are destructed.
+///
+/// the objects allocated by "tls_trans_malloc" are not carved from the block, as a
+/// long-lived object would pin the whole block. they are allocated from the size-classed
+/// slabs of the current thread instead, which are allocated on the local numa node and
+/// reused as soon as all the objects in a slab are freed. please refer to
+/// transient_memory.cpp for details
 
 typedef struct tls_transient_memory_t
 {
     unsigned int magic;
     size_t remain_bytes;
-    char block_ptr_buffer[sizeof(std::shared_ptr<char>)];
-    std::shared_ptr<char> *block;
+    char block_ptr_buffer[sizeof(blob_buffer_ptr)];
+    blob_buffer_ptr *block;
     char *next;
     bool committed;
 } tls_transient_memory_t;
@@ -82,4 +89,29 @@ void *tls_trans_malloc(size_t sz);
 
 // free memory, ptr shouldn't be null
 void tls_trans_free(void *ptr);
+
+struct transient_memory_stats
+{
+    // slabs for tls_trans_malloc
+    uint64_t slab_count = 0;
+    uint64_t slab_bytes = 0;
+    // the free slabs kept for reuse
+    uint64_t empty_slab_count = 0;
+    // the slabs which are retired by the threads but still hold live objects
+    uint64_t pinned_slab_count = 0;
+    uint64_t slab_used_bytes = 0;
+    // the ratio of the unused bytes in the non-empty slabs
+    double slab_fragmentation = 0.0;
+
+    // blocks for tls_trans_mem_next
+    uint64_t block_count = 0;
+    uint64_t block_bytes = 0;
+    // the blocks which are retired by the threads but still referenced by the blobs
+    uint64_t pinned_block_count = 0;
+    uint64_t pinned_block_bytes = 0;
+
+    std::string to_string() const;
+};
+
+transient_memory_stats get_transient_memory_stats();
 }
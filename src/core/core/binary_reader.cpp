@@ -10,8 +10,9 @@ binary_reader::binary_reader(blob &&bb) { init(std::move(bb)); }
 void binary_reader::init(const blob &bb)
 {
     _blob = bb;
-    _size = bb.length();
-    _ptr = bb.data();
+    _size = _blob.length();
+    // the bytes of an inline blob are copied
+    _ptr = _blob.data();
     _remaining_size = _size;
 }
 
@@ -55,9 +56,7 @@ int binary_reader::read(blob &blob, int len)
 
         // optimization: zero-copy
         if (!blob.buffer_ptr()) {
-            std::shared_ptr<char> buffer(::dsn::utils::make_shared_array<char>(len));
-            memcpy(buffer.get(), blob.data(), blob.length());
-            blob = ::dsn::blob(buffer, 0, blob.length());
+            blob = ::dsn::blob::create_from_bytes(blob.data(), blob.length());
         }
 
         _ptr += len;
@@ -22,7 +22,8 @@ binary_writer::binary_writer(blob &buffer)
     _reserved_size_per_buffer = _reserved_size_per_buffer_static;
 
     _buffers.push_back(buffer);
-    _current_buffer = (char *)buffer.data();
+    // the bytes of an inline blob are copied
+    _current_buffer = (char *)_buffers[0].data();
     _current_offset = 0;
     _current_buffer_length = buffer.length();
 }
@@ -45,7 +46,7 @@ void binary_writer::create_buffer(size_t size)
 
 void binary_writer::create_new_buffer(size_t size, /*out*/ blob &bb)
 {
-    bb.assign(::dsn::utils::make_shared_array<char>(size), 0, (int)size);
+    bb.assign(blob_buffer::create(size), 0, (int)size);
 }
 
 void binary_writer::commit()
@@ -58,6 +59,27 @@ void binary_writer::commit()
     }
 }
 
+void binary_writer::append(const blob &val)
+{
+    if (val.length() == 0)
+        return;
+
+    commit();
+    if (_current_buffer_length > 0) {
+        // the current buffer is allocated but nothing is written yet
+        _buffers.pop_back();
+    }
+
+    append_buffer(val);
+    _buffers.push_back(val);
+    _total_size += val.length();
+
+    // the next write will create a new buffer
+    _current_buffer = nullptr;
+    _current_offset = 0;
+    _current_buffer_length = 0;
+}
+
 blob binary_writer::get_buffer()
 {
     commit();
@@ -67,8 +89,7 @@ blob binary_writer::get_buffer()
     } else if (_total_size == 0) {
         return blob();
     } else {
-        std::shared_ptr<char> bptr(::dsn::utils::make_shared_array<char>(_total_size));
-        blob bb(bptr, _total_size);
+        blob bb(blob_buffer::create(_total_size), _total_size);
         const char *ptr = bb.data();
 
         for (int i = 0; i < static_cast<int>(_buffers.size()); i++) {
@@ -84,8 +105,7 @@ blob binary_writer::get_current_buffer()
     if (_buffers.size() == 1) {
         return _current_offset > 0 ? _buffers[0].range(0, _current_offset) : _buffers[0];
     } else {
-        std::shared_ptr<char> bptr(::dsn::utils::make_shared_array<char>(_total_size));
-        blob bb(bptr, _total_size);
+        blob bb(blob_buffer::create(_total_size), _total_size);
         const char *ptr = bb.data();
 
         for (int i = 0; i < static_cast<int>(_buffers.size()); i++) {
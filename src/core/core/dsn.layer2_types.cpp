@@ -340,6 +340,12 @@ void configuration_query_by_index_request::__set_partition_indices(const std::ve
     this->partition_indices = val;
 }
 
+void configuration_query_by_index_request::__set_known_ballots(const std::vector<int64_t> &val)
+{
+    this->known_ballots = val;
+    __isset.known_ballots = true;
+}
+
 uint32_t configuration_query_by_index_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -386,6 +392,25 @@ uint32_t configuration_query_by_index_request::read(::apache::thrift::protocol::
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 3:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->known_ballots.clear();
+                    uint32_t _size16_1;
+                    ::apache::thrift::protocol::TType _etype19_1;
+                    xfer += iprot->readListBegin(_etype19_1, _size16_1);
+                    this->known_ballots.resize(_size16_1);
+                    uint32_t _i20_1;
+                    for (_i20_1 = 0; _i20_1 < _size16_1; ++_i20_1) {
+                        xfer += iprot->readI64(this->known_ballots[_i20_1]);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.known_ballots = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -422,6 +447,20 @@ configuration_query_by_index_request::write(::apache::thrift::protocol::TProtoco
     }
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.known_ballots) {
+        xfer += oprot->writeFieldBegin("known_ballots", ::apache::thrift::protocol::T_LIST, 3);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64,
+                                          static_cast<uint32_t>(this->known_ballots.size()));
+            std::vector<int64_t>::const_iterator _iter21_1;
+            for (_iter21_1 = this->known_ballots.begin(); _iter21_1 != this->known_ballots.end();
+                 ++_iter21_1) {
+                xfer += oprot->writeI64((*_iter21_1));
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -432,6 +471,7 @@ void swap(configuration_query_by_index_request &a, configuration_query_by_index_
     using ::std::swap;
     swap(a.app_name, b.app_name);
     swap(a.partition_indices, b.partition_indices);
+    swap(a.known_ballots, b.known_ballots);
     swap(a.__isset, b.__isset);
 }
 
@@ -440,6 +480,7 @@ configuration_query_by_index_request::configuration_query_by_index_request(
 {
     app_name = other22.app_name;
     partition_indices = other22.partition_indices;
+    known_ballots = other22.known_ballots;
     __isset = other22.__isset;
 }
 configuration_query_by_index_request::configuration_query_by_index_request(
@@ -447,6 +488,7 @@ configuration_query_by_index_request::configuration_query_by_index_request(
 {
     app_name = std::move(other23.app_name);
     partition_indices = std::move(other23.partition_indices);
+    known_ballots = std::move(other23.known_ballots);
     __isset = std::move(other23.__isset);
 }
 configuration_query_by_index_request &configuration_query_by_index_request::
@@ -454,6 +496,7 @@ operator=(const configuration_query_by_index_request &other24)
 {
     app_name = other24.app_name;
     partition_indices = other24.partition_indices;
+    known_ballots = other24.known_ballots;
     __isset = other24.__isset;
     return *this;
 }
@@ -462,6 +505,7 @@ operator=(configuration_query_by_index_request &&other25)
 {
     app_name = std::move(other25.app_name);
     partition_indices = std::move(other25.partition_indices);
+    known_ballots = std::move(other25.known_ballots);
     __isset = std::move(other25.__isset);
     return *this;
 }
@@ -472,6 +516,9 @@ void configuration_query_by_index_request::printTo(std::ostream &out) const
     out << "app_name=" << to_string(app_name);
     out << ", "
         << "partition_indices=" << to_string(partition_indices);
+    out << ", ";
+    out << "known_ballots=";
+    (__isset.known_ballots ? (out << to_string(known_ballots)) : (out << "<null>"));
     out << ")";
 }
 
@@ -39,6 +39,8 @@
 #include <dsn/utility/safe_strerror_posix.h>
 
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/sysmacros.h>
 #include <errno.h>
 #include <stdio.h>
 #include <boost/filesystem.hpp>
@@ -694,6 +696,160 @@ bool get_disk_space_info(const std::string &path, disk_space_info &info)
     }
 }
 
+bool get_disk_io_ticks(const std::string &path, /*out*/ uint64_t &io_ticks_ms)
+{
+#ifdef __linux__
+    struct stat_ st;
+    if (::stat(path.c_str(), &st) != 0) {
+        derror("get disk io ticks failed: path = %s, err = %s",
+               path.c_str(),
+               safe_strerror(errno).c_str());
+        return false;
+    }
+
+    FILE *fp = fopen("/proc/diskstats", "r");
+    if (fp == nullptr) {
+        derror("get disk io ticks failed: open /proc/diskstats failed, err = %s",
+               safe_strerror(errno).c_str());
+        return false;
+    }
+
+    // major minor name reads reads_merged sectors_read ms_reading writes writes_merged
+    // sectors_written ms_writing ios_in_progress ms_doing_io weighted_ms_doing_io ...
+    bool found = false;
+    char line[512];
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        unsigned int dev_major, dev_minor;
+        char name[128];
+        unsigned long long fields[10];
+        int n = sscanf(line,
+                       "%u %u %127s %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                       &dev_major,
+                       &dev_minor,
+                       name,
+                       &fields[0],
+                       &fields[1],
+                       &fields[2],
+                       &fields[3],
+                       &fields[4],
+                       &fields[5],
+                       &fields[6],
+                       &fields[7],
+                       &fields[8],
+                       &fields[9]);
+        if (n == 13 && dev_major == major(st.st_dev) && dev_minor == minor(st.st_dev)) {
+            io_ticks_ms = fields[9];
+            found = true;
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (!found) {
+        // e.g. tmpfs or overlay, which have no entry in /proc/diskstats
+        dinfo("get disk io ticks failed: device of path %s not found in /proc/diskstats",
+              path.c_str());
+    }
+    return found;
+#else
+    return false;
+#endif
+}
+
+bool copy_directory(const std::string &src, const std::string &dest)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::is_directory(src, ec) || boost::filesystem::exists(dest, ec)) {
+        derror("copy directory failed: src = %s is not a directory or dest = %s exists",
+               src.c_str(),
+               dest.c_str());
+        return false;
+    }
+
+    boost::filesystem::create_directories(dest, ec);
+    if (ec) {
+        derror("copy directory failed: create %s failed, err = %s",
+               dest.c_str(),
+               ec.message().c_str());
+        return false;
+    }
+
+    std::string nsrc;
+    get_normalized_path(src, nsrc);
+    boost::filesystem::path src_root(nsrc);
+    boost::filesystem::recursive_directory_iterator it(src_root, ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        boost::filesystem::path relative =
+            boost::filesystem::path(it->path().string().substr(nsrc.size() + 1));
+        boost::filesystem::path target = boost::filesystem::path(dest) / relative;
+        if (boost::filesystem::is_directory(it->status())) {
+            boost::filesystem::create_directories(target, ec);
+        } else {
+            boost::filesystem::copy_file(it->path(), target, ec);
+        }
+        if (ec) {
+            derror("copy directory failed: copy %s to %s failed, err = %s",
+                   it->path().string().c_str(),
+                   target.string().c_str(),
+                   ec.message().c_str());
+            return false;
+        }
+    }
+    if (ec) {
+        derror("copy directory failed: iterate %s failed, err = %s",
+               src.c_str(),
+               ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool copy_file(const std::string &src, const std::string &dest, /*out*/ uint64_t &copied_size)
+{
+    struct stat_ st;
+    if (::stat_(src.c_str(), &st) != 0) {
+        derror("copy file failed: stat %s failed, err = %s",
+               src.c_str(),
+               safe_strerror(errno).c_str());
+        return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::copy_file(
+        src, dest, boost::filesystem::copy_option::overwrite_if_exists, ec);
+    if (ec) {
+        derror("copy file failed: copy %s to %s failed, err = %s",
+               src.c_str(),
+               dest.c_str(),
+               ec.message().c_str());
+        return false;
+    }
+
+    // the time is taken before the copy, so a change during the copy is also detected
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    if (::utimensat(AT_FDCWD, dest.c_str(), times, 0) != 0) {
+        derror("copy file failed: set the times of %s failed, err = %s",
+               dest.c_str(),
+               safe_strerror(errno).c_str());
+        return false;
+    }
+
+    int64_t sz = 0;
+    file_size(dest, sz);
+    copied_size = static_cast<uint64_t>(sz);
+    return true;
+}
+
+bool is_same_file_stat(const std::string &path1, const std::string &path2)
+{
+    struct stat_ st1, st2;
+    if (::stat_(path1.c_str(), &st1) != 0 || ::stat_(path2.c_str(), &st2) != 0) {
+        return false;
+    }
+    return st1.st_size == st2.st_size && st1.st_mtim.tv_sec == st2.st_mtim.tv_sec &&
+           st1.st_mtim.tv_nsec == st2.st_mtim.tv_nsec;
+}
+
 bool link_file(const std::string &src, const std::string &target)
 {
     if (src.empty() || target.empty())
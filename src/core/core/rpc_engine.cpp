@@ -618,8 +618,12 @@ void rpc_engine::call(message_ex *request, const rpc_response_task_ptr &call)
 {
     auto &hdr = *request->header;
     hdr.from_address = primary_address();
-    hdr.trace_id = rand::next_u64(std::numeric_limits<decltype(hdr.trace_id)>::min(),
-                                  std::numeric_limits<decltype(hdr.trace_id)>::max());
+    // keep the trace id set by the caller, so the rpcs issued for a request can be traced
+    // together with the request
+    if (hdr.trace_id == 0) {
+        hdr.trace_id = rand::next_u64(std::numeric_limits<decltype(hdr.trace_id)>::min(),
+                                      std::numeric_limits<decltype(hdr.trace_id)>::max());
+    }
 
     call_address(request->server_address, request, call);
 }
@@ -157,13 +157,11 @@ message_ex *message_ex::create_received_request(dsn::task_code code,
 message_ex *message_ex::create_receive_message_with_standalone_header(const blob &data)
 {
     message_ex *msg = new message_ex();
-    std::shared_ptr<char> header_holder(
-        static_cast<char *>(dsn::tls_trans_malloc(sizeof(message_header))),
-        [](char *c) { dsn::tls_trans_free(c); });
-    msg->header = reinterpret_cast<message_header *>(header_holder.get());
+    blob_buffer *header_holder = blob_buffer::create(sizeof(message_header));
+    msg->header = reinterpret_cast<message_header *>(header_holder->data());
     memset(static_cast<void *>(msg->header), 0, sizeof(message_header));
 
-    msg->buffers.emplace_back(blob(std::move(header_holder), sizeof(message_header)));
+    msg->buffers.emplace_back(blob(header_holder, sizeof(message_header)));
     msg->buffers.push_back(data);
 
     msg->header->body_length = data.length();
@@ -216,8 +214,8 @@ message_ex *message_ex::copy(bool clone_content, bool copy_for_receive)
         msg->buffers = buffers;
     } else {
         int total_length = body_size() + sizeof(dsn::message_header);
-        std::shared_ptr<char> recv_buffer(dsn::utils::make_shared_array<char>(total_length));
-        char *ptr = recv_buffer.get();
+        dsn::blob_buffer_ptr recv_buffer(dsn::blob_buffer::create(total_length));
+        char *ptr = recv_buffer->data();
         int i = 0;
 
         if ((const char *)header != buffers[0].data()) {
@@ -360,7 +358,7 @@ void message_ex::prepare_buffer_header()
     ::dsn::tls_trans_mem_next(&ptr, &size, sizeof(message_header));
 
     ::dsn::blob buffer((*::dsn::tls_trans_memory.block),
-                       (int)((char *)(ptr) - ::dsn::tls_trans_memory.block->get()),
+                       (int)((char *)(ptr) - (*::dsn::tls_trans_memory.block)->data()),
                        (int)sizeof(message_header));
 
     ::dsn::tls_trans_mem_commit(sizeof(message_header));
@@ -398,9 +396,10 @@ void message_ex::write_next(void **ptr, size_t *size, size_t min_size)
 
         // if the current allocation is within the same buffer with the previous one
         if (*ptr == lbb.data() + lbb.length() &&
-            ::dsn::tls_trans_memory.block->get() == lbb.buffer_ptr()) {
-            lbb.assign(*::dsn::tls_trans_memory.block,
-                       (int)((char *)(*ptr) - ::dsn::tls_trans_memory.block->get() - lbb.length()),
+            (*::dsn::tls_trans_memory.block)->data() == lbb.buffer_ptr()) {
+            const ::dsn::blob_buffer_ptr &block = *::dsn::tls_trans_memory.block;
+            lbb.assign(block,
+                       (int)((char *)(*ptr) - block->data() - lbb.length()),
                        (int)(lbb.length() + *size));
 
             return;
@@ -408,7 +407,7 @@ void message_ex::write_next(void **ptr, size_t *size, size_t min_size)
     }
 
     ::dsn::blob buffer((*::dsn::tls_trans_memory.block),
-                       (int)((char *)(*ptr) - ::dsn::tls_trans_memory.block->get()),
+                       (int)((char *)(*ptr) - (*::dsn::tls_trans_memory.block)->data()),
                        (int)(*size));
     this->_rw_index++;
     this->_rw_offset = 0;
@@ -433,6 +432,24 @@ void message_ex::write_commit(size_t size)
     this->header->body_length += (int)size;
 }
 
+void message_ex::write_append(const blob &data)
+{
+    dassert(!this->_is_read && this->_rw_committed,
+            "there are pending msg write not committed"
+            ", please invoke dsn_msg_write_next and dsn_msg_write_commit in pairs");
+
+    if (data.length() == 0)
+        return;
+
+    this->buffers.push_back(data);
+    this->_rw_index++;
+    this->_rw_offset = data.length();
+    this->header->body_length += data.length();
+
+    dassert(this->_rw_index + 1 == (int)this->buffers.size(),
+            "message write buffer count is not right");
+}
+
 bool message_ex::read_next(void **ptr, size_t *size)
 {
     // printf("%p %s %d\n", this, __FUNCTION__, utils::get_current_tid());
@@ -30,6 +30,8 @@
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/process_utils.h>
 #include <dsn/tool-api/command_manager.h>
+#include <dsn/tool-api/tracing.h>
+#include <dsn/utility/transient_memory.h>
 #include <fstream>
 
 #include "service_engine.h"
@@ -381,6 +383,19 @@ bool run(const char *config_file,
         "thread local transient memory buffer size (KB), default is 1024");
     ::dsn::tls_trans_mem_init(tls_trans_memory_KB * 1024);
 
+    // init tracing
+    uint32_t tracing_sample_rate = (uint32_t)dsn_config_get_value_uint64(
+        "core",
+        "tracing_sample_rate",
+        1000,
+        "trace one of every N requests, 0 to disable tracing, default is 1000");
+    uint32_t tracing_spans_per_thread = (uint32_t)dsn_config_get_value_uint64(
+        "core",
+        "tracing_spans_per_thread",
+        1024,
+        "the number of recent spans kept for each thread, default is 1024");
+    ::dsn::tracing::init(tracing_sample_rate, tracing_spans_per_thread);
+
     // prepare minimum necessary
     ::dsn::service_engine::instance().init_before_toollets(spec);
 
@@ -469,6 +484,14 @@ bool run(const char *config_file,
                                                           return oss.str();
                                                       });
 
+    dsn::command_manager::instance().register_command(
+        {"trans-mem-stats"},
+        "trans-mem-stats - show the statistics of the transient memory",
+        "trans-mem-stats",
+        [](const std::vector<std::string> &args) {
+            return dsn::get_transient_memory_stats().to_string();
+        });
+
     // invoke customized init after apps are created
     dsn::tools::sys_init_after_app_created.execute();
 
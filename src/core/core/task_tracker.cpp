@@ -36,23 +36,204 @@
 #include <dsn/tool-api/task_tracker.h>
 #include <dsn/tool-api/task.h>
 #include <dsn/tool_api.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace dsn {
 
-task_tracker::task_tracker(int task_bucket_count) : _task_bucket_count(task_bucket_count)
+//
+// a tracked task is recorded by a node in the list of the thread setting the tracker.
+// only the owner thread links and unlinks the nodes of its list, and the trackers only
+// read the list, so inserting a node takes no lock.
+//
+// the node is locked by compare-and-swap on its state, by either the tracker which is
+// going to wait/cancel the task, or the task which is being destroyed. the destroyed
+// task leaves its node in the list, which is unlinked and reused by the owner thread
+// later, when no tracker is traversing the list.
+//
+enum tracked_task_state
 {
-    _outstanding_tasks_lock = new ::dsn::utils::ex_lock_nr_spin[_task_bucket_count];
-    _outstanding_tasks = new dlink[_task_bucket_count];
+    TRACKED_TASK_NOT_LOCKED = 0,
+    TRACKED_TASK_LOCKED = 1,
+    // waited or cancelled by the tracker, but the task is not destroyed yet
+    TRACKED_TASK_FINISHED = 2,
+    // the task is destroyed, the node can be unlinked
+    TRACKED_TASK_DEAD = 3
+};
+
+struct tracked_task_node
+{
+    std::atomic<int> state;
+    task *tsk;
+    task_tracker *owner;
+    std::atomic<tracked_task_node *> next;
+};
+
+namespace {
+
+struct tracked_task_list
+{
+    tracked_task_list() : head(nullptr), readers(0), free_nodes(nullptr), in_use(true) {}
+
+    std::atomic<tracked_task_node *> head;
+    // the number of the trackers traversing the list,
+    // or -1 if the owner thread is unlinking the dead nodes
+    std::atomic<int> readers;
+    // only accessed by the owner thread
+    tracked_task_node *free_nodes;
+    // the lists of the exited threads are reused by the new threads
+    std::atomic<bool> in_use;
+
+    tracked_task_node *alloc_node()
+    {
+        if (free_nodes == nullptr) {
+            unlink_dead_nodes();
+        }
+        if (free_nodes == nullptr) {
+            return new tracked_task_node();
+        }
+        tracked_task_node *n = free_nodes;
+        free_nodes = n->next.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // move the dead nodes into free_nodes, skipped if any tracker is traversing the list
+    void unlink_dead_nodes()
+    {
+        int expected = 0;
+        if (!readers.compare_exchange_strong(expected, -1, std::memory_order_acquire)) {
+            return;
+        }
+        std::atomic<tracked_task_node *> *link = &head;
+        tracked_task_node *n = link->load(std::memory_order_relaxed);
+        while (n != nullptr) {
+            tracked_task_node *next = n->next.load(std::memory_order_relaxed);
+            if (n->state.load(std::memory_order_acquire) == TRACKED_TASK_DEAD) {
+                link->store(next, std::memory_order_relaxed);
+                n->next.store(free_nodes, std::memory_order_relaxed);
+                free_nodes = n;
+            } else {
+                link = &n->next;
+            }
+            n = next;
+        }
+        readers.store(0, std::memory_order_release);
+    }
+};
+
+std::mutex s_lists_lock;
+// never freed, as the tasks may be destroyed after the threads creating them exit
+std::vector<tracked_task_list *> s_lists;
+
+struct list_holder
+{
+    tracked_task_list *list = nullptr;
+    ~list_holder()
+    {
+        if (list != nullptr)
+            list->in_use.store(false, std::memory_order_release);
+    }
+};
+
+tracked_task_list *get_list()
+{
+    static thread_local list_holder holder;
+    if (holder.list == nullptr) {
+        std::lock_guard<std::mutex> l(s_lists_lock);
+        for (tracked_task_list *r : s_lists) {
+            if (!r->in_use.load(std::memory_order_acquire)) {
+                r->in_use.store(true, std::memory_order_relaxed);
+                holder.list = r;
+                break;
+            }
+        }
+        if (holder.list == nullptr) {
+            holder.list = new tracked_task_list();
+            s_lists.push_back(holder.list);
+        }
+    }
+    return holder.list;
+}
+
+// call visitor on the nodes of all the threads
+void visit_tracked_tasks(const std::function<void(tracked_task_node *)> &visitor)
+{
+    std::vector<tracked_task_list *> lists;
+    {
+        std::lock_guard<std::mutex> l(s_lists_lock);
+        lists = s_lists;
+    }
+    for (tracked_task_list *list : lists) {
+        // wait if the owner thread is unlinking the dead nodes, which is quick
+        int r = list->readers.load(std::memory_order_relaxed);
+        while (r < 0 ||
+               !list->readers.compare_exchange_weak(r, r + 1, std::memory_order_acquire)) {
+            if (r < 0)
+                r = list->readers.load(std::memory_order_relaxed);
+        }
+
+        for (tracked_task_node *n = list->head.load(std::memory_order_acquire); n != nullptr;
+             n = n->next.load(std::memory_order_acquire)) {
+            visitor(n);
+        }
+
+        list->readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+}
+
+void trackable_task::set_tracker(task_tracker *owner, task *tsk)
+{
+    dassert(_owner == nullptr, "task tracker is already set");
+    _owner = owner;
+    if (nullptr == _owner) {
+        return;
+    }
+
+    tracked_task_list *list = get_list();
+    _node = list->alloc_node();
+    _node->tsk = tsk;
+    _node->owner = owner;
+    _node->state.store(TRACKED_TASK_NOT_LOCKED, std::memory_order_relaxed);
+
+    // counted before being visible to the tracker
+    _owner->_outstanding_count.fetch_add(1, std::memory_order_relaxed);
+    _node->next.store(list->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    list->head.store(_node, std::memory_order_release);
 }
 
-task_tracker::~task_tracker()
+void trackable_task::unset_tracker()
 {
-    cancel_outstanding_tasks();
+    if (nullptr == _owner) {
+        return;
+    }
+
+    int s = _node->state.load(std::memory_order_acquire);
+    while (s != TRACKED_TASK_FINISHED) {
+        if (s == TRACKED_TASK_NOT_LOCKED) {
+            if (_node->state.compare_exchange_weak(
+                    s, TRACKED_TASK_LOCKED, std::memory_order_acquire)) {
+                // the tracker may be destroyed once the count drops to 0
+                _owner->_outstanding_count.fetch_sub(1, std::memory_order_release);
+                break;
+            }
+        } else {
+            // locked by the tracker, which is waiting/cancelling the task
+            s = _node->state.load(std::memory_order_acquire);
+        }
+    }
+    _node->state.store(TRACKED_TASK_DEAD, std::memory_order_release);
 
-    delete[] _outstanding_tasks;
-    delete[] _outstanding_tasks_lock;
+    _owner = nullptr;
+    _node = nullptr;
 }
 
+task_tracker::task_tracker(int /*task_bucket_count*/) : _outstanding_count(0) {}
+
+task_tracker::~task_tracker() { cancel_outstanding_tasks(); }
+
 // TODO:
 // hack for wait/cancel inside spin locks
 struct tls_tracker_hack
@@ -72,103 +253,78 @@ struct tls_tracker_hack
 
 static __thread tls_tracker_hack s_hack;
 
-void task_tracker::wait_outstanding_tasks()
+// lock the nodes of the outstanding tasks of the tracker and call f, then mark them as
+// finished, until there are no outstanding tasks
+template <typename F>
+static void finish_outstanding_tasks(task_tracker *tracker,
+                                     std::atomic<int64_t> &outstanding_count,
+                                     F &&f)
 {
-    for (int i = 0; i < _task_bucket_count; i++) {
-        while (true) {
-            trackable_task::owner_delete_state prepare_state;
-            trackable_task *tcm;
-
-            {
-                utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_outstanding_tasks_lock[i]);
-                auto n = _outstanding_tasks[i].next();
-                if (n != &_outstanding_tasks[i]) {
-                    tcm = CONTAINING_RECORD(n, trackable_task, _dl);
-
-                    // try to get the lock
-                    prepare_state = tcm->owner_delete_prepare();
-                } else
-                    break; // assuming nobody is putting tasks into it anymore
+    while (outstanding_count.load(std::memory_order_acquire) > 0) {
+        bool found = false;
+        visit_tracked_tasks([&](tracked_task_node *n) {
+            int s = TRACKED_TASK_NOT_LOCKED;
+            if (n->owner != tracker ||
+                !n->state.compare_exchange_strong(
+                    s, TRACKED_TASK_LOCKED, std::memory_order_acquire)) {
+                return;
             }
+            found = true;
 
-            switch (prepare_state) {
-            // tracker get the lock
-            case trackable_task::OWNER_DELETE_NOT_LOCKED:
-                if (s_hack.under_simulation()) {
-                    task *tsk = tcm->_task;
-                    tsk->add_ref(); // released after delete commit
-                    tcm->owner_delete_commit();
-
-                    tsk->wait();        // wait outside the delete spin lock
-                    tsk->release_ref(); // added before delete commit
-                } else {
-                    tcm->_task->wait();
-                    tcm->owner_delete_commit();
-                }
-                break;
-            case trackable_task::OWNER_DELETE_LOCKED:
-            case trackable_task::OWNER_DELETE_FINISHED:
-                break;
+            task *tsk = n->tsk;
+            if (s_hack.under_simulation()) {
+                tsk->add_ref(); // released after the node is finished
+                n->state.store(TRACKED_TASK_FINISHED, std::memory_order_release);
+                outstanding_count.fetch_sub(1, std::memory_order_release);
+
+                f(tsk);             // outside the node lock
+                tsk->release_ref(); // added before the node is finished
+            } else {
+                f(tsk);
+                n->state.store(TRACKED_TASK_FINISHED, std::memory_order_release);
+                outstanding_count.fetch_sub(1, std::memory_order_release);
             }
-        }
+        });
+
+        // the rest are being destroyed, or locked by others, or not visible yet
+        if (!found)
+            std::this_thread::yield();
     }
 }
 
-void task_tracker::cancel_outstanding_tasks()
+void task_tracker::wait_outstanding_tasks()
 {
-    for (int i = 0; i < _task_bucket_count; i++) {
-        while (true) {
-            trackable_task::owner_delete_state prepare_state;
-            trackable_task *tcm;
-
-            {
-                utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_outstanding_tasks_lock[i]);
-                auto n = _outstanding_tasks[i].next();
-                if (n != &_outstanding_tasks[i]) {
-                    tcm = CONTAINING_RECORD(n, trackable_task, _dl);
-                    prepare_state = tcm->owner_delete_prepare();
-                } else
-                    break; // assuming nobody is putting tasks into it anymore
-            }
+    finish_outstanding_tasks(this, _outstanding_count, [](task *tsk) { tsk->wait(); });
+}
 
-            switch (prepare_state) {
-            case trackable_task::OWNER_DELETE_NOT_LOCKED:
-                if (s_hack.under_simulation()) {
-                    task *tsk = tcm->_task;
-                    tsk->add_ref(); // released after delete commit
-                    tcm->owner_delete_commit();
-
-                    tsk->cancel(true);  // cancel outside the delete spin lock
-                    tsk->release_ref(); // added before delete commit
-                } else {
-                    tcm->_task->cancel(true);
-                    tcm->owner_delete_commit();
-                }
-                break;
-            case trackable_task::OWNER_DELETE_LOCKED:
-            case trackable_task::OWNER_DELETE_FINISHED:
-                break;
-            }
-        }
-    }
+void task_tracker::cancel_outstanding_tasks()
+{
+    finish_outstanding_tasks(this, _outstanding_count, [](task *tsk) { tsk->cancel(true); });
 }
 
 int task_tracker::cancel_but_not_wait_outstanding_tasks()
 {
     int not_finished = 0;
-    for (int i = 0; i < _task_bucket_count; i++) {
-        utils::auto_lock<::dsn::utils::ex_lock_nr_spin> l(_outstanding_tasks_lock[i]);
-        auto n = _outstanding_tasks[i].next();
-        if (n != &_outstanding_tasks[i]) {
-            trackable_task *tcm = CONTAINING_RECORD(n, trackable_task, _dl);
-            if (tcm->_task != task::get_current_task()) {
-                bool finished;
-                tcm->_task->cancel(false, &finished);
-                if (!finished)
-                    not_finished++;
-            }
-        }
+    if (_outstanding_count.load(std::memory_order_acquire) == 0) {
+        return not_finished;
     }
+
+    task *current = task::get_current_task();
+    visit_tracked_tasks([&](tracked_task_node *n) {
+        int s = TRACKED_TASK_NOT_LOCKED;
+        if (n->owner != this ||
+            !n->state.compare_exchange_strong(s, TRACKED_TASK_LOCKED, std::memory_order_acquire)) {
+            return;
+        }
+        if (n->tsk != current) {
+            bool finished;
+            n->tsk->cancel(false, &finished);
+            if (!finished)
+                not_finished++;
+        }
+        // still tracked
+        n->state.store(TRACKED_TASK_NOT_LOCKED, std::memory_order_release);
+    });
     return not_finished;
 }
 }
@@ -0,0 +1,234 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <dsn/tool-api/tracing.h>
+#include <dsn/utility/process_utils.h>
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+
+namespace dsn {
+namespace tracing {
+
+namespace internal_use_only {
+uint32_t sample_rate = 0;
+}
+
+namespace {
+
+// the spans are written by the owner thread only, and read by the dumping thread with
+// a sequence lock: the sequence is odd while the span is being written
+struct span_slot
+{
+    std::atomic<uint32_t> seq;
+    std::atomic<uint64_t> trace_id;
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> start_ns;
+    std::atomic<uint64_t> end_ns;
+    std::atomic<uint64_t> arg;
+    std::atomic<int> arg_type;
+};
+
+struct span
+{
+    uint64_t trace_id;
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t arg;
+    span_arg arg_type;
+    int tid;
+};
+
+struct span_ring
+{
+    explicit span_ring(uint32_t capacity)
+        : slots(new span_slot[capacity]), capacity(capacity), next(0), tid(0), in_use(true)
+    {
+        for (uint32_t i = 0; i < capacity; ++i)
+            slots[i].seq.store(0, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<span_slot[]> slots;
+    const uint32_t capacity;
+    std::atomic<uint64_t> next;
+    std::atomic<int> tid;
+    // the rings of the exited threads are reused by the new threads
+    std::atomic<bool> in_use;
+};
+
+uint32_t s_spans_per_thread = 1024;
+std::mutex s_rings_lock;
+// never freed, as the thread local holders may be destroyed after the global objects
+std::vector<span_ring *> s_rings;
+
+struct ring_holder
+{
+    span_ring *ring = nullptr;
+    ~ring_holder()
+    {
+        if (ring != nullptr)
+            ring->in_use.store(false, std::memory_order_release);
+    }
+};
+
+span_ring *get_ring()
+{
+    static thread_local ring_holder holder;
+    if (holder.ring == nullptr) {
+        std::lock_guard<std::mutex> l(s_rings_lock);
+        for (span_ring *r : s_rings) {
+            if (!r->in_use.load(std::memory_order_acquire)) {
+                r->in_use.store(true, std::memory_order_relaxed);
+                holder.ring = r;
+                break;
+            }
+        }
+        if (holder.ring == nullptr) {
+            holder.ring = new span_ring(s_spans_per_thread);
+            s_rings.push_back(holder.ring);
+        }
+        holder.ring->tid.store(utils::get_current_tid(), std::memory_order_relaxed);
+    }
+    return holder.ring;
+}
+
+void append_json_escaped(std::ostringstream &os, const char *s)
+{
+    for (; *s != '\0'; ++s) {
+        if (*s == '"' || *s == '\\')
+            os << '\\';
+        os << *s;
+    }
+}
+}
+
+void init(uint32_t sample_rate, uint32_t spans_per_thread)
+{
+    internal_use_only::sample_rate = sample_rate;
+    if (spans_per_thread > 0) {
+        std::lock_guard<std::mutex> l(s_rings_lock);
+        s_spans_per_thread = spans_per_thread;
+    }
+}
+
+void add_span(uint64_t trace_id,
+              const char *name,
+              uint64_t start_ns,
+              uint64_t end_ns,
+              span_arg arg_type,
+              uint64_t arg)
+{
+    span_ring *ring = get_ring();
+    uint64_t index = ring->next.load(std::memory_order_relaxed);
+    span_slot &slot = ring->slots[index % ring->capacity];
+
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.trace_id.store(trace_id, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.arg_type.store(static_cast<int>(arg_type), std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+
+    ring->next.store(index + 1, std::memory_order_release);
+}
+
+std::string dump_chrome_trace(uint64_t trace_id)
+{
+    std::vector<span> spans;
+    {
+        std::lock_guard<std::mutex> l(s_rings_lock);
+        for (span_ring *r : s_rings) {
+            int tid = r->tid.load(std::memory_order_relaxed);
+            uint64_t next = r->next.load(std::memory_order_acquire);
+            uint64_t count = std::min<uint64_t>(next, r->capacity);
+            for (uint64_t i = next - count; i < next; ++i) {
+                span_slot &slot = r->slots[i % r->capacity];
+                uint32_t seq = slot.seq.load(std::memory_order_acquire);
+                if ((seq & 1) != 0)
+                    continue;
+                span s;
+                s.trace_id = slot.trace_id.load(std::memory_order_relaxed);
+                s.name = slot.name.load(std::memory_order_relaxed);
+                s.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+                s.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+                s.arg = slot.arg.load(std::memory_order_relaxed);
+                s.arg_type = static_cast<span_arg>(slot.arg_type.load(std::memory_order_relaxed));
+                s.tid = tid;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                // overwritten while being read
+                if (slot.seq.load(std::memory_order_relaxed) != seq)
+                    continue;
+                if (trace_id == 0 || s.trace_id == trace_id)
+                    spans.push_back(s);
+            }
+        }
+    }
+
+    int pid = static_cast<int>(getpid());
+    char buffer[32];
+    std::ostringstream os;
+    os << "{\"traceEvents\":[";
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const span &s = spans[i];
+        if (i != 0)
+            os << ",";
+        snprintf(buffer, sizeof(buffer), "%016" PRIx64, s.trace_id);
+        // the timestamps are in microseconds
+        os << "{\"name\":\"";
+        append_json_escaped(os, s.name);
+        os << "\",\"cat\":\"rdsn\",\"ph\":\"X\",\"ts\":" << s.start_ns / 1000
+           << ",\"dur\":" << (s.end_ns - s.start_ns) / 1000 << ",\"pid\":" << pid
+           << ",\"tid\":" << s.tid << ",\"args\":{\"trace_id\":\"" << buffer << "\"";
+        switch (s.arg_type) {
+        case span_arg::number:
+            os << ",\"arg\":" << s.arg;
+            break;
+        case span_arg::address:
+            os << ",\"arg\":\""
+               << rpc_address(static_cast<uint32_t>(s.arg >> 16), static_cast<uint16_t>(s.arg))
+                      .to_string()
+               << "\"";
+            break;
+        default:
+            break;
+        }
+        os << "}}";
+    }
+    os << "]}";
+    return os.str();
+}
+}
+}
@@ -33,8 +33,18 @@
  *     xxxx-xx-xx, author, fix bug about xxx
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdlib>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <dsn/utility/utils.h>
 #include <dsn/utility/transient_memory.h>
 
@@ -44,23 +54,339 @@ __thread tls_transient_memory_t tls_trans_memory;
 
 static size_t tls_trans_mem_default_block_bytes = 1024 * 1024; // 1 MB
 
+//
+// blocks for tls_trans_mem_next & tls_trans_mem_commit
+//
+// a block tells if it is retired from tls_trans_memory, so the blocks pinned by the
+// blobs can be counted
+//
+static std::atomic<uint64_t> s_block_count(0);
+static std::atomic<uint64_t> s_block_bytes(0);
+static std::atomic<uint64_t> s_pinned_block_count(0);
+static std::atomic<uint64_t> s_pinned_block_bytes(0);
+
+class transient_block : public blob_buffer
+{
+public:
+    static transient_block *create(size_t size)
+    {
+        void *p = ::operator new(sizeof(transient_block) + size);
+        return new (p) transient_block(size);
+    }
+
+    ~transient_block()
+    {
+        s_block_count.fetch_sub(1, std::memory_order_relaxed);
+        s_block_bytes.fetch_sub(_size, std::memory_order_relaxed);
+        if (_retired) {
+            s_pinned_block_count.fetch_sub(1, std::memory_order_relaxed);
+            s_pinned_block_bytes.fetch_sub(_size, std::memory_order_relaxed);
+        }
+    }
+
+    // called before tls_trans_memory releases the block,
+    // which is freed at once if no blob refers to it
+    void retire()
+    {
+        _retired = true;
+        s_pinned_block_count.fetch_add(1, std::memory_order_relaxed);
+        s_pinned_block_bytes.fetch_add(_size, std::memory_order_relaxed);
+    }
+
+    // allocated by ::operator new with the data
+    static void operator delete(void *p) { ::operator delete(p); }
+
+private:
+    explicit transient_block(size_t size)
+        : blob_buffer(reinterpret_cast<char *>(this + 1)), _size(size), _retired(false)
+    {
+        s_block_count.fetch_add(1, std::memory_order_relaxed);
+        s_block_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    size_t _size;
+    bool _retired;
+};
+
 // allocate a block from the system, the block size should be at lease "min_size"
 void tls_trans_mem_alloc(size_t min_size)
 {
     // release last buffer if necessary
     if (tls_trans_memory.magic == 0xdeadbeef) {
-        tls_trans_memory.block->reset();
+        if (*tls_trans_memory.block != nullptr) {
+            static_cast<transient_block *>(tls_trans_memory.block->get())->retire();
+        }
+        *tls_trans_memory.block = nullptr;
     } else {
         tls_trans_memory.magic = 0xdeadbeef;
-        tls_trans_memory.block = new (tls_trans_memory.block_ptr_buffer) std::shared_ptr<char>();
+        tls_trans_memory.block = new (tls_trans_memory.block_ptr_buffer) blob_buffer_ptr();
         tls_trans_memory.committed = true;
     }
 
     tls_trans_memory.remain_bytes =
         (min_size > tls_trans_mem_default_block_bytes ? min_size
                                                       : tls_trans_mem_default_block_bytes);
-    *tls_trans_memory.block = ::dsn::utils::make_shared_array<char>(tls_trans_memory.remain_bytes);
-    tls_trans_memory.next = tls_trans_memory.block->get();
+    *tls_trans_memory.block = transient_block::create(tls_trans_memory.remain_bytes);
+    tls_trans_memory.next = (*tls_trans_memory.block)->data();
+}
+
+//
+// slabs for tls_trans_malloc & tls_trans_free
+//
+// a slab is a SLAB_SIZE aligned region holding the objects of a size class. each
+// thread allocates from its own slab of each class, and the objects freed by the
+// owner thread are reused at once, while the objects freed by the other threads are
+// pushed to a lock-free list which the owner takes over when its free list is empty.
+//
+// the refs of a slab is the number of the live objects, plus one if it is owned by a
+// thread. a full slab is retired by the owner, and goes back to the pool of its numa
+// node when the last object is freed, so a long-lived object only pins its own slab.
+//
+// the slabs are mapped by the thread on the numa node, and the pages are touched by
+// the owner thread first, so they are local to the node with the default policy.
+// the empty slabs are only reused by the threads running on the same node.
+//
+// objects larger than the largest class are allocated by posix_memalign, with a
+// header at the same place of the slab header, so tls_trans_free can tell the two
+// kinds by the header at the aligned address.
+//
+static const size_t SLAB_SIZE = 64 * 1024;
+static const uint32_t SLAB_MAGIC = 0xdeadbeef;
+static const uint32_t LARGE_MAGIC = 0xdeadbeaf;
+static const uint32_t MAX_NUMA_NODES = 16;
+// the empty slabs kept in the pool of each node, the others are unmapped
+static const size_t MAX_POOLED_SLABS = 64;
+
+static const uint32_t s_class_sizes[] = {
+    16,   32,   48,   64,   80,   96,   112,  128,  160,  192,  224,  256,  320,  384,
+    448,  512,  640,  768,  896,  1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096,
+};
+static const size_t CLASS_COUNT = sizeof(s_class_sizes) / sizeof(s_class_sizes[0]);
+static const size_t MAX_CLASS_SIZE = 4096;
+
+struct slab_arena;
+
+struct slab
+{
+    uint32_t magic;
+    uint32_t node;
+    uint32_t object_size;
+    std::atomic<slab_arena *> owner;
+    std::atomic<int64_t> refs;
+    std::atomic<void *> remote_free;
+    // only accessed by the owner
+    void *local_free;
+    char *bump;
+    char *end;
+};
+static const size_t SLAB_HEADER_SIZE = 64;
+static_assert(sizeof(slab) <= SLAB_HEADER_SIZE, "slab header is too large");
+
+struct slab_pools
+{
+    std::mutex lock;
+    std::vector<slab *> empty_slabs[MAX_NUMA_NODES];
+    // all the mapped slabs, for the statistics only
+    std::unordered_set<slab *> slabs;
+};
+
+// never freed, as the objects may be freed after the global objects are destructed
+static slab_pools &pools()
+{
+    static slab_pools *p = new slab_pools();
+    return *p;
+}
+
+static uint32_t current_numa_node()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return 0;
+    }
+    return node % MAX_NUMA_NODES;
+}
+
+static size_t size_class_of(size_t sz)
+{
+    // the index of the first class not smaller than sz, indexed by (sz + 15) / 16
+    static const std::vector<uint8_t> table = []() {
+        std::vector<uint8_t> t(MAX_CLASS_SIZE / 16 + 1);
+        size_t c = 0;
+        for (size_t i = 0; i < t.size(); ++i) {
+            while (s_class_sizes[c] < i * 16) {
+                ++c;
+            }
+            t[i] = static_cast<uint8_t>(c);
+        }
+        return t;
+    }();
+    return table[(sz + 15) / 16];
+}
+
+static slab *map_slab()
+{
+    // map twice the size to get an aligned region, then trim the rest
+    char *p = static_cast<char *>(
+        mmap(nullptr, 2 * SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    char *aligned = reinterpret_cast<char *>(
+        (reinterpret_cast<uintptr_t>(p) + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1));
+    if (aligned != p) {
+        munmap(p, aligned - p);
+    }
+    munmap(aligned + SLAB_SIZE, p + SLAB_SIZE - aligned);
+
+    slab *s = new (aligned) slab();
+    std::lock_guard<std::mutex> l(pools().lock);
+    pools().slabs.insert(s);
+    return s;
+}
+
+static slab *acquire_slab(slab_arena *arena, size_t size_class)
+{
+    uint32_t node = current_numa_node();
+    slab *s = nullptr;
+    {
+        slab_pools &p = pools();
+        std::lock_guard<std::mutex> l(p.lock);
+        if (!p.empty_slabs[node].empty()) {
+            s = p.empty_slabs[node].back();
+            p.empty_slabs[node].pop_back();
+        }
+    }
+    if (s == nullptr && (s = map_slab()) == nullptr) {
+        return nullptr;
+    }
+
+    char *data = reinterpret_cast<char *>(s) + SLAB_HEADER_SIZE;
+    s->magic = SLAB_MAGIC;
+    s->node = node;
+    s->object_size = s_class_sizes[size_class];
+    s->local_free = nullptr;
+    s->bump = data;
+    s->end = data + (SLAB_SIZE - SLAB_HEADER_SIZE) / s->object_size * s->object_size;
+    s->remote_free.store(nullptr, std::memory_order_relaxed);
+    s->refs.store(1, std::memory_order_relaxed);
+    s->owner.store(arena, std::memory_order_relaxed);
+    return s;
+}
+
+static void release_slab(slab *s)
+{
+    if (s->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    // no live object and no owner
+    slab_pools &p = pools();
+    std::lock_guard<std::mutex> l(p.lock);
+    if (p.empty_slabs[s->node].size() < MAX_POOLED_SLABS) {
+        p.empty_slabs[s->node].push_back(s);
+    } else {
+        p.slabs.erase(s);
+        munmap(s, SLAB_SIZE);
+    }
+}
+
+struct slab_arena
+{
+    slab *current[CLASS_COUNT] = {nullptr};
+    bool exited = false;
+
+    ~slab_arena()
+    {
+        exited = true;
+        for (slab *&s : current) {
+            if (s != nullptr) {
+                s->owner.store(nullptr, std::memory_order_relaxed);
+                release_slab(s);
+                s = nullptr;
+            }
+        }
+    }
+};
+
+static slab_arena &current_arena()
+{
+    static thread_local slab_arena arena;
+    return arena;
+}
+
+static void *malloc_large(size_t sz)
+{
+    void *p = nullptr;
+    if (posix_memalign(&p, SLAB_SIZE, SLAB_HEADER_SIZE + sz) != 0) {
+        return nullptr;
+    }
+    static_cast<slab *>(p)->magic = LARGE_MAGIC;
+    return static_cast<char *>(p) + SLAB_HEADER_SIZE;
+}
+
+static void *slab_malloc(size_t sz)
+{
+    slab_arena &arena = current_arena();
+    if (sz > MAX_CLASS_SIZE || arena.exited) {
+        return malloc_large(sz);
+    }
+
+    size_t size_class = size_class_of(sz);
+    slab *s = arena.current[size_class];
+    while (true) {
+        if (s != nullptr) {
+            if (s->local_free == nullptr && s->bump == s->end &&
+                s->remote_free.load(std::memory_order_relaxed) != nullptr) {
+                s->local_free = s->remote_free.exchange(nullptr, std::memory_order_acquire);
+            }
+            void *obj = s->local_free;
+            if (obj != nullptr) {
+                s->local_free = *static_cast<void **>(obj);
+            } else if (s->bump < s->end) {
+                obj = s->bump;
+                s->bump += s->object_size;
+            }
+            if (obj != nullptr) {
+                s->refs.fetch_add(1, std::memory_order_relaxed);
+                return obj;
+            }
+
+            // full, retire it
+            s->owner.store(nullptr, std::memory_order_relaxed);
+            release_slab(s);
+        }
+
+        s = arena.current[size_class] = acquire_slab(&arena, size_class);
+        if (s == nullptr) {
+            return nullptr;
+        }
+    }
+}
+
+static void slab_free(void *ptr)
+{
+    slab *s = reinterpret_cast<slab *>(reinterpret_cast<uintptr_t>(ptr) &
+                                       ~(uintptr_t)(SLAB_SIZE - 1));
+    if (s->magic == LARGE_MAGIC) {
+        free(s);
+        return;
+    }
+    // invalid transient memory
+    assert(s->magic == SLAB_MAGIC);
+
+    // the owner is only set by the owner thread itself, so it equals to the arena of
+    // this thread only if this thread is the owner
+    if (s->owner.load(std::memory_order_relaxed) == &current_arena()) {
+        *static_cast<void **>(ptr) = s->local_free;
+        s->local_free = ptr;
+    } else {
+        void *head = s->remote_free.load(std::memory_order_relaxed);
+        do {
+            *static_cast<void **>(ptr) = head;
+        } while (!s->remote_free.compare_exchange_weak(
+            head, ptr, std::memory_order_release, std::memory_order_relaxed));
+    }
+    release_slab(s);
 }
 
 ///
@@ -106,38 +432,82 @@ blob tls_trans_mem_alloc_blob(size_t sz)
     tls_trans_mem_next(&ptr, &sz2, sz);
 
     ::dsn::blob buffer((*::dsn::tls_trans_memory.block),
-                       (int)((char *)(ptr) - ::dsn::tls_trans_memory.block->get()),
+                       (int)((char *)(ptr) - (*::dsn::tls_trans_memory.block)->data()),
                        (int)sz);
 
     tls_trans_mem_commit(sz);
     return buffer;
 }
 
-void *tls_trans_malloc(size_t sz)
-{
-    sz += sizeof(std::shared_ptr<char>) + sizeof(uint32_t);
-    void *ptr;
-    size_t sz2;
-    tls_trans_mem_next(&ptr, &sz2, sz);
-
-    // add ref
-    new (ptr) std::shared_ptr<char>(*::dsn::tls_trans_memory.block);
+void *tls_trans_malloc(size_t sz) { return slab_malloc(sz); }
 
-    // add magic
-    *(uint32_t *)((char *)(ptr) + sizeof(std::shared_ptr<char>)) = 0xdeadbeef;
+void tls_trans_free(void *ptr) { slab_free(ptr); }
 
-    tls_trans_mem_commit(sz);
+// the number of the pinned slabs holding the objects, for the tests only, as the
+// stats of the whole process are changed by the other threads
+size_t tls_trans_pinned_slab_count(const std::vector<void *> &objects)
+{
+    std::unordered_set<slab *> bases;
+    for (void *ptr : objects) {
+        bases.insert(reinterpret_cast<slab *>(reinterpret_cast<uintptr_t>(ptr) &
+                                              ~(uintptr_t)(SLAB_SIZE - 1)));
+    }
 
-    return (void *)((char *)(ptr) + sizeof(std::shared_ptr<char>) + sizeof(uint32_t));
+    // a slab freed since may be unmapped, so only the mapped ones are checked
+    slab_pools &p = pools();
+    std::lock_guard<std::mutex> l(p.lock);
+    size_t count = 0;
+    for (slab *s : bases) {
+        if (p.slabs.count(s) != 0 && s->refs.load(std::memory_order_relaxed) > 0 &&
+            s->owner.load(std::memory_order_relaxed) == nullptr) {
+            ++count;
+        }
+    }
+    return count;
 }
 
-void tls_trans_free(void *ptr)
+transient_memory_stats get_transient_memory_stats()
 {
-    ptr = (void *)((char *)ptr - sizeof(uint32_t));
-    // invalid transient memory block
-    assert(*(uint32_t *)(ptr) == 0xdeadbeef);
+    transient_memory_stats stats;
+    {
+        slab_pools &p = pools();
+        std::lock_guard<std::mutex> l(p.lock);
+        uint64_t bytes_in_use = 0;
+        stats.slab_count = p.slabs.size();
+        for (slab *s : p.slabs) {
+            int64_t refs = s->refs.load(std::memory_order_relaxed);
+            bool owned = s->owner.load(std::memory_order_relaxed) != nullptr;
+            if (refs <= 0) {
+                ++stats.empty_slab_count;
+                continue;
+            }
+            if (!owned) {
+                ++stats.pinned_slab_count;
+            }
+            bytes_in_use += SLAB_SIZE;
+            stats.slab_used_bytes += (refs - (owned ? 1 : 0)) * s->object_size;
+        }
+        stats.slab_bytes = stats.slab_count * SLAB_SIZE;
+        stats.slab_fragmentation =
+            bytes_in_use == 0 ? 0.0 : 1.0 - (double)stats.slab_used_bytes / bytes_in_use;
+    }
+    stats.block_count = s_block_count.load(std::memory_order_relaxed);
+    stats.block_bytes = s_block_bytes.load(std::memory_order_relaxed);
+    stats.pinned_block_count = s_pinned_block_count.load(std::memory_order_relaxed);
+    stats.pinned_block_bytes = s_pinned_block_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
 
-    ptr = (void *)((char *)ptr - sizeof(std::shared_ptr<char>));
-    ((std::shared_ptr<char> *)(ptr))->~shared_ptr<char>();
+std::string transient_memory_stats::to_string() const
+{
+    std::ostringstream os;
+    os << "slabs: count = " << slab_count << ", bytes = " << slab_bytes
+       << ", empty = " << empty_slab_count << ", pinned = " << pinned_slab_count
+       << ", used_bytes = " << slab_used_bytes << ", fragmentation = " << slab_fragmentation
+       << std::endl;
+    os << "blocks: count = " << block_count << ", bytes = " << block_bytes
+       << ", pinned = " << pinned_block_count << ", pinned_bytes = " << pinned_block_bytes
+       << std::endl;
+    return os.str();
 }
 }
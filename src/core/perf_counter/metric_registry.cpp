@@ -0,0 +1,321 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <dsn/perf_counter/metric_registry.h>
+#include <dsn/tool-api/task_code.h>
+#include <dsn/utility/utils.h>
+#include <dsn/c/api_utilities.h>
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace dsn {
+
+// the values of a series are sharded by cpu to avoid the contention on the cache lines,
+// at most 16 shards to bound the memory
+static size_t shard_count()
+{
+    static const size_t count = []() {
+        size_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        size_t n = 1;
+        while (n < cpus && n < 16)
+            n <<= 1;
+        return n;
+    }();
+    return count;
+}
+
+static size_t current_shard()
+{
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0)
+        return static_cast<size_t>(cpu) & (shard_count() - 1);
+#endif
+    static std::atomic<size_t> next_thread_shard(0);
+    static thread_local size_t thread_shard = next_thread_shard.fetch_add(1);
+    return thread_shard & (shard_count() - 1);
+}
+
+static const size_t VALUES_PER_CACHE_LINE = 64 / sizeof(uint64_t);
+
+uint64_t metric_labels::hash() const
+{
+    uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(app_id)) << 32) |
+                 static_cast<uint32_t>(partition_index);
+    h ^= static_cast<uint64_t>(static_cast<uint32_t>(task_code)) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+metric_series::metric_series(const metric_family *family,
+                             const metric_labels &labels,
+                             bool overflow)
+    : _family(family), _labels(labels), _overflow(overflow)
+{
+    // counter: value, histogram: sum and the buckets
+    _values_per_shard = family->type() == metric_type::counter ? 1 : family->buckets().size() + 2;
+    _stride = (_values_per_shard + VALUES_PER_CACHE_LINE - 1) / VALUES_PER_CACHE_LINE *
+              VALUES_PER_CACHE_LINE;
+
+    // allocate one more cache line to align the shards with the cache lines
+    size_t size = _stride * shard_count() + VALUES_PER_CACHE_LINE;
+    _buffer.reset(new std::atomic<uint64_t>[size]());
+    uintptr_t addr = reinterpret_cast<uintptr_t>(_buffer.get());
+    _values = _buffer.get() + ((64 - addr % 64) % 64) / sizeof(uint64_t);
+}
+
+std::atomic<uint64_t> &metric_series::value_of_current_shard(size_t index)
+{
+    return _values[current_shard() * _stride + index];
+}
+
+void metric_series::observe(uint64_t value)
+{
+    const std::vector<uint64_t> &buckets = _family->buckets();
+    size_t bucket =
+        std::lower_bound(buckets.begin(), buckets.end(), value) - buckets.begin();
+    std::atomic<uint64_t> *shard = &value_of_current_shard(0);
+    shard[0].fetch_add(value, std::memory_order_relaxed);
+    shard[bucket + 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<uint64_t> metric_series::snapshot() const
+{
+    std::vector<uint64_t> values(_values_per_shard, 0);
+    for (size_t s = 0; s < shard_count(); ++s) {
+        for (size_t i = 0; i < _values_per_shard; ++i) {
+            values[i] += _values[s * _stride + i].load(std::memory_order_relaxed);
+        }
+    }
+    return values;
+}
+
+metric_family::metric_family(const std::string &name,
+                             const std::string &help,
+                             metric_type type,
+                             const std::vector<uint64_t> &buckets,
+                             size_t max_series)
+    : _name(name),
+      _help(help),
+      _type(type),
+      _buckets(buckets),
+      _max_series(std::max<size_t>(max_series, 1)),
+      _series_count(0)
+{
+    // at most half full to keep the probing short
+    size_t slot_count = 2;
+    while (slot_count < _max_series * 2)
+        slot_count <<= 1;
+    std::vector<std::atomic<metric_series *>> slots(slot_count);
+    _slots.swap(slots);
+    _series.reserve(_max_series);
+    _overflow_series.reset(new metric_series(this, metric_labels(), true));
+}
+
+metric_series *metric_family::get(const metric_labels &labels)
+{
+    size_t mask = _slots.size() - 1;
+    size_t start = labels.hash() & mask;
+
+    // the slots are never cleared, so an empty slot ends the probing
+    for (size_t i = start;; i = (i + 1) & mask) {
+        metric_series *series = _slots[i].load(std::memory_order_acquire);
+        if (series == nullptr)
+            break;
+        if (series->labels() == labels)
+            return series;
+    }
+
+    std::lock_guard<std::mutex> l(_lock);
+    size_t i = start;
+    for (;; i = (i + 1) & mask) {
+        metric_series *series = _slots[i].load(std::memory_order_relaxed);
+        if (series == nullptr)
+            break;
+        if (series->labels() == labels)
+            return series;
+    }
+    if (_series.size() >= _max_series) {
+        return _overflow_series.get();
+    }
+
+    _series.emplace_back(new metric_series(this, labels, false));
+    _slots[i].store(_series.back().get(), std::memory_order_release);
+    _series_count.store(_series.size(), std::memory_order_release);
+    return _series.back().get();
+}
+
+void metric_family::get_all_series(std::vector<const metric_series *> &series) const
+{
+    for (const auto &slot : _slots) {
+        const metric_series *s = slot.load(std::memory_order_acquire);
+        if (s != nullptr)
+            series.push_back(s);
+    }
+    if (_series_count.load(std::memory_order_acquire) >= _max_series)
+        series.push_back(_overflow_series.get());
+}
+
+metric_registry::metric_registry() {}
+
+metric_family *metric_registry::register_counter(const std::string &name,
+                                                 const std::string &help,
+                                                 size_t max_series)
+{
+    return register_family(name, help, metric_type::counter, {}, max_series);
+}
+
+metric_family *metric_registry::register_histogram(const std::string &name,
+                                                   const std::string &help,
+                                                   const std::vector<uint64_t> &buckets,
+                                                   size_t max_series)
+{
+    std::vector<uint64_t> sorted_buckets(buckets);
+    std::sort(sorted_buckets.begin(), sorted_buckets.end());
+    sorted_buckets.erase(std::unique(sorted_buckets.begin(), sorted_buckets.end()),
+                         sorted_buckets.end());
+    return register_family(name, help, metric_type::histogram, sorted_buckets, max_series);
+}
+
+metric_family *metric_registry::register_family(const std::string &name,
+                                                const std::string &help,
+                                                metric_type type,
+                                                const std::vector<uint64_t> &buckets,
+                                                size_t max_series)
+{
+    std::lock_guard<std::mutex> l(_lock);
+    for (const auto &family : _families) {
+        if (family->name() == name) {
+            dassert(family->type() == type,
+                    "metric %s is registered with a different type",
+                    name.c_str());
+            return family.get();
+        }
+    }
+    _families.emplace_back(new metric_family(name, help, type, buckets, max_series));
+    return _families.back().get();
+}
+
+static void format_labels(std::ostringstream &os,
+                          const metric_series &series,
+                          const char *le = nullptr)
+{
+    const metric_labels &labels = series.labels();
+    std::vector<std::string> pairs;
+    if (series.is_overflow()) {
+        pairs.push_back("overflow=\"true\"");
+    }
+    if (labels.app_id >= 0) {
+        pairs.push_back("app_id=\"" + std::to_string(labels.app_id) + "\"");
+    }
+    if (labels.partition_index >= 0) {
+        pairs.push_back("partition=\"" + std::to_string(labels.partition_index) + "\"");
+    }
+    if (labels.task_code >= 0) {
+        pairs.push_back(std::string("task_code=\"") +
+                        task_code(labels.task_code).to_string() + "\"");
+    }
+    if (le != nullptr) {
+        pairs.push_back(std::string("le=\"") + le + "\"");
+    }
+    if (pairs.empty())
+        return;
+
+    os << "{";
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (i != 0)
+            os << ",";
+        os << pairs[i];
+    }
+    os << "}";
+}
+
+std::string metric_registry::to_prometheus_text() const
+{
+    std::vector<const metric_family *> families;
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        for (const auto &family : _families)
+            families.push_back(family.get());
+    }
+
+    std::ostringstream os;
+    for (const metric_family *family : families) {
+        bool is_counter = family->type() == metric_type::counter;
+        os << "# HELP " << family->name() << " " << family->help() << "\n";
+        os << "# TYPE " << family->name() << " " << (is_counter ? "counter" : "histogram")
+           << "\n";
+
+        std::vector<const metric_series *> all_series;
+        family->get_all_series(all_series);
+        for (const metric_series *series : all_series) {
+            std::vector<uint64_t> values = series->snapshot();
+            if (is_counter) {
+                os << family->name();
+                format_labels(os, *series);
+                os << " " << values[0] << "\n";
+                continue;
+            }
+
+            // the buckets are cumulative in prometheus
+            uint64_t count = 0;
+            for (size_t i = 0; i < family->buckets().size(); ++i) {
+                count += values[i + 1];
+                os << family->name() << "_bucket";
+                format_labels(os, *series, std::to_string(family->buckets()[i]).c_str());
+                os << " " << count << "\n";
+            }
+            count += values.back();
+            os << family->name() << "_bucket";
+            format_labels(os, *series, "+Inf");
+            os << " " << count << "\n";
+            os << family->name() << "_sum";
+            format_labels(os, *series);
+            os << " " << values[0] << "\n";
+            os << family->name() << "_count";
+            format_labels(os, *series);
+            os << " " << count << "\n";
+        }
+    }
+    return os.str();
+}
+
+std::vector<uint64_t> metric_registry::latency_us_buckets()
+{
+    // 100us * 2^n
+    std::vector<uint64_t> buckets;
+    for (uint64_t bound = 100; bound <= 15000000; bound *= 2)
+        buckets.push_back(bound);
+    return buckets;
+}
+
+} // namespace dsn
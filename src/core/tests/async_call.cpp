@@ -250,3 +250,39 @@ TEST(async_call, task_destructor)
     }
     ASSERT_TRUE(spin_wait([&]() { return simple_task::allocate_count.load() == 0; }, 10));
 }
+
+TEST(async_call, task_tracker_multi_producer)
+{
+    // the tasks are tracked from the threads of the pool, and most of them are
+    // destroyed before the tracker waits or cancels the rest
+    for (bool cancel : {false, true}) {
+        tracker_class *tc = new tracker_class();
+        std::atomic<int> count(0);
+        std::vector<task_ptr> delayed_tasks(4);
+        std::vector<task_ptr> producers;
+        for (int i = 0; i < 4; ++i) {
+            producers.push_back(tasking::enqueue(LPC_TEST_CLIENTLET, nullptr, [&, i]() {
+                for (int j = 0; j < 1000; ++j) {
+                    tasking::enqueue(LPC_TEST_CLIENTLET, &tc->_tracker, [&count] { ++count; });
+                }
+                delayed_tasks[i] = tasking::enqueue(LPC_TEST_CLIENTLET,
+                                                    &tc->_tracker,
+                                                    [&count] { ++count; },
+                                                    0,
+                                                    std::chrono::milliseconds(100));
+            }));
+        }
+        for (const task_ptr &t : producers)
+            t->wait();
+
+        if (cancel) {
+            tc->_tracker.cancel_outstanding_tasks();
+        } else {
+            tc->_tracker.wait_outstanding_tasks();
+            ASSERT_EQ(4004, count.load());
+        }
+        for (const task_ptr &t : delayed_tasks)
+            ASSERT_FALSE(t->cancel(false));
+        delete tc;
+    }
+}
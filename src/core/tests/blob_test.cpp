@@ -0,0 +1,239 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <dsn/utility/binary_reader.h>
+#include <dsn/utility/binary_writer.h>
+#include <dsn/utility/blob.h>
+#include <dsn/utility/utils.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace ::dsn;
+
+TEST(core, blob_buffer)
+{
+    blob_buffer *buffer = blob_buffer::create(100);
+    memset(buffer->data(), 'a', 100);
+    blob b(buffer, 100);
+    ASSERT_FALSE(b.is_inline());
+    blob_buffer_ptr holder = b.holder();
+    ASSERT_EQ(2, holder->get_count());
+
+    blob c = b.range(10, 20);
+    ASSERT_EQ(3, holder->get_count());
+    ASSERT_EQ(b.data() + 10, c.data());
+    ASSERT_EQ(b.buffer_ptr(), c.buffer_ptr());
+    ASSERT_EQ(std::string(20, 'a'), c.to_string());
+
+    blob d = std::move(c);
+    ASSERT_EQ(3, holder->get_count());
+    ASSERT_EQ(nullptr, c.holder());
+    ASSERT_EQ(20u, d.length());
+
+    // the shared_ptr keeps a reference
+    std::shared_ptr<char> sp = b.buffer();
+    ASSERT_EQ(b.buffer_ptr(), sp.get());
+    ASSERT_EQ(4, holder->get_count());
+    sp.reset();
+    ASSERT_EQ(3, holder->get_count());
+
+    b = d;
+    d = blob();
+    ASSERT_EQ(2, holder->get_count());
+    b = blob("raw", 0, 3);
+    ASSERT_EQ(1, holder->get_count());
+    ASSERT_EQ(nullptr, b.buffer_ptr());
+    ASSERT_EQ("raw", b.to_string());
+}
+
+TEST(core, blob_shared_ptr)
+{
+    std::shared_ptr<char> sp = utils::make_shared_array<char>(100);
+    memset(sp.get(), 'b', 100);
+    blob b(sp, 10, 90);
+    ASSERT_EQ(2, sp.use_count());
+    ASSERT_EQ(sp.get() + 10, b.data());
+    ASSERT_EQ(sp.get(), b.buffer_ptr());
+
+    blob c = b;
+    ASSERT_EQ(2, sp.use_count());
+    b = blob();
+    c = blob();
+    ASSERT_EQ(1, sp.use_count());
+
+    blob e(std::shared_ptr<char>(nullptr), 0, 0);
+    ASSERT_EQ(nullptr, e.holder());
+    ASSERT_EQ(nullptr, e.buffer());
+}
+
+TEST(core, blob_inline)
+{
+    std::string s(blob::INLINE_CAPACITY, 'c');
+    blob b = blob::create_from_bytes(s.data(), s.length());
+    ASSERT_TRUE(b.is_inline());
+    ASSERT_EQ(nullptr, b.holder());
+    ASSERT_EQ(s, b.to_string());
+
+    // the data moves with the blob
+    blob c = b;
+    ASSERT_NE(b.data(), c.data());
+    ASSERT_EQ(s, c.to_string());
+
+    blob d = c.range(10, 5);
+    ASSERT_TRUE(d.is_inline());
+    ASSERT_EQ(std::string(5, 'c'), d.to_string());
+    ASSERT_EQ(d.buffer_ptr() + 10, d.data());
+    blob e = d.range(-10);
+    ASSERT_EQ(15u, e.length());
+
+    std::vector<blob> blobs;
+    for (int i = 0; i < 100; ++i) {
+        blobs.push_back(blob::create_from_bytes(std::to_string(i)));
+    }
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(std::to_string(i), blobs[i].to_string());
+    }
+
+    // larger values are not inline
+    s.push_back('c');
+    b = blob::create_from_bytes(s.data(), s.length());
+    ASSERT_FALSE(b.is_inline());
+    ASSERT_EQ(s, b.to_string());
+    b = blob::create_from_bytes(std::string(s));
+    ASSERT_FALSE(b.is_inline());
+    ASSERT_EQ(s, b.to_string());
+}
+
+TEST(core, blob_inline_binary_io)
+{
+    binary_writer writer;
+    writer.write(blob::create_from_bytes(std::string("hello")));
+    blob data = writer.get_buffer();
+    data = blob::create_from_bytes(data.data(), data.length());
+    ASSERT_TRUE(data.is_inline());
+
+    // the reader and the writer keep their own copies of the inline bytes
+    binary_reader reader(data);
+    data = blob::create_from_bytes(std::string(data.length(), 'x'));
+    blob value;
+    ASSERT_LT(0, reader.read(value));
+    ASSERT_EQ("hello", value.to_string());
+    ASSERT_TRUE(reader.is_eof());
+
+    blob out = blob::create_from_bytes(std::string(sizeof(int), '\0'));
+    ASSERT_TRUE(out.is_inline());
+    binary_writer writer2(out);
+    writer2.write(0x12345678);
+    out = blob();
+    binary_reader reader2(writer2.get_buffer());
+    int v = 0;
+    reader2.read(v);
+    ASSERT_EQ(0x12345678, v);
+    ASSERT_TRUE(reader2.is_eof());
+}
+
+namespace {
+
+// the blob before the buffer is ref-counted intrusively, for comparison
+struct shared_ptr_blob
+{
+    std::shared_ptr<char> holder;
+    const char *data;
+    unsigned int length;
+
+    shared_ptr_blob range(int offset, unsigned int len) const
+    {
+        shared_ptr_blob temp = *this;
+        temp.data += offset;
+        temp.length = len;
+        return temp;
+    }
+};
+
+template <typename T, typename Create>
+int64_t copy_range_us(Create create)
+{
+    const int count = 1000000;
+    std::vector<T> blobs(100);
+    auto start = std::chrono::steady_clock::now();
+    T b = create();
+    for (int i = 0; i < count; ++i) {
+        blobs[i % blobs.size()] = b.range(i % 10, 10);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 start)
+        .count();
+}
+
+template <typename T, typename Create>
+int64_t create_us(Create create)
+{
+    const int count = 1000000;
+    std::vector<T> blobs(100);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        blobs[i % blobs.size()] = create();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 start)
+        .count();
+}
+
+} // anonymous namespace
+
+TEST(core, blob_benchmark)
+{
+    // shared_ptr skips the atomic operations if the process has never been multi-threaded
+    std::thread([]() {}).join();
+
+    char value[256];
+    memset(value, 'd', sizeof(value));
+
+    auto create_shared = [&value]() {
+        std::shared_ptr<char> sp(new char[32], std::default_delete<char[]>());
+        memcpy(sp.get(), value, 32);
+        return shared_ptr_blob{sp, sp.get(), 32};
+    };
+    auto create_large_shared = [&value]() {
+        std::shared_ptr<char> sp(new char[256], std::default_delete<char[]>());
+        memcpy(sp.get(), value, 256);
+        return shared_ptr_blob{sp, sp.get(), 256};
+    };
+    auto create_blob = [&value]() { return blob::create_from_bytes(value, 32); };
+    auto create_large_blob = [&value]() { return blob::create_from_bytes(value, 256); };
+
+    std::cout << "create 1M 32B blobs: shared_ptr " << create_us<shared_ptr_blob>(create_shared)
+              << "us, blob " << create_us<blob>(create_blob) << "us" << std::endl;
+    std::cout << "create 1M 256B blobs: shared_ptr "
+              << create_us<shared_ptr_blob>(create_large_shared) << "us, blob "
+              << create_us<blob>(create_large_blob) << "us" << std::endl;
+    std::cout << "copy 1M ranges of a 256B blob: shared_ptr "
+              << copy_range_us<shared_ptr_blob>(create_large_shared) << "us, blob "
+              << copy_range_us<blob>(create_large_blob) << "us" << std::endl;
+}
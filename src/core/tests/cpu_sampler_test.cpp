@@ -0,0 +1,222 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#ifdef DSN_ENABLE_GPERF
+
+#include <dsn/service_api_cpp.h>
+#include <dsn/tool-api/async_calls.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "cpu_sampler.h"
+#include "pprof_http_service.h"
+
+namespace dsn {
+
+DEFINE_TASK_CODE(LPC_CPU_SAMPLER_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+static uint64_t now_minute()
+{
+    return std::chrono::duration_cast<std::chrono::minutes>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static uint64_t count_of(const cpu_sampler::stack_counts &samples, int task_code)
+{
+    uint64_t count = 0;
+    for (const auto &kv : samples) {
+        if (kv.first.task_code == task_code) {
+            count += kv.second;
+        }
+    }
+    return count;
+}
+
+static http_request make_request(const std::string &url)
+{
+    http_request req;
+    req.full_url = blob::create_from_bytes(std::string(url));
+    return req;
+}
+
+class cpu_sampler_test : public testing::Test
+{
+public:
+    static const int WRITING = cpu_sampler::WRITING;
+    static const int READY = cpu_sampler::READY;
+    static const size_t SLOT_COUNT = cpu_sampler::SLOT_COUNT;
+
+    static int window_minutes(cpu_sampler &sampler) { return sampler._window_minutes; }
+    static void set_window_minutes(cpu_sampler &sampler, int minutes)
+    {
+        sampler._window_minutes = minutes;
+    }
+
+    // write a sample of one frame into the next slot, as on_sample does
+    static void write_slot(cpu_sampler &sampler, int state, int task_code)
+    {
+        uint64_t index = sampler._write_index.fetch_add(1);
+        cpu_sampler::sample_slot &slot = sampler._slots[index % cpu_sampler::SLOT_COUNT];
+        slot.task_code = task_code;
+        slot.depth = 1;
+        slot.pcs[0] = 0x1234;
+        slot.state.store(state);
+    }
+
+    static void add_bucket(cpu_sampler &sampler, uint64_t minute, int task_code, uint64_t count)
+    {
+        cpu_sampler::stack s;
+        s.task_code = task_code;
+        s.pcs.push_back(0x1234);
+        std::lock_guard<std::mutex> l(sampler._window_lock);
+        sampler._window.emplace_back(minute, cpu_sampler::stack_counts());
+        sampler._window.back().second[s] = count;
+    }
+
+    static int get_minutes(pprof_http_service &service, int window, const std::string &url)
+    {
+        service._sampling_window_minutes = window;
+        return service.get_minutes(make_request(url));
+    }
+};
+
+TEST_F(cpu_sampler_test, drain_stalled_slot)
+{
+    cpu_sampler sampler;
+    set_window_minutes(sampler, 10);
+
+    // the first sample is being written, or was dropped
+    write_slot(sampler, WRITING, LPC_CPU_SAMPLER_TEST);
+    write_slot(sampler, READY, LPC_CPU_SAMPLER_TEST);
+    ASSERT_EQ(0u, count_of(sampler.get_samples(10), LPC_CPU_SAMPLER_TEST));
+
+    // skipped as it is still not ready
+    ASSERT_EQ(1u, count_of(sampler.get_samples(10), LPC_CPU_SAMPLER_TEST));
+    write_slot(sampler, READY, LPC_CPU_SAMPLER_TEST);
+    ASSERT_EQ(2u, count_of(sampler.get_samples(10), LPC_CPU_SAMPLER_TEST));
+}
+
+TEST_F(cpu_sampler_test, drain_catch_up)
+{
+    cpu_sampler sampler;
+    set_window_minutes(sampler, 10);
+
+    // the aggregate thread falls behind by more than the ring, the oldest samples are
+    // overwritten
+    const uint64_t total = SLOT_COUNT + 100;
+    for (uint64_t i = 0; i < total; ++i) {
+        write_slot(sampler, READY, LPC_CPU_SAMPLER_TEST);
+    }
+    ASSERT_EQ(static_cast<uint64_t>(SLOT_COUNT),
+              count_of(sampler.get_samples(10), LPC_CPU_SAMPLER_TEST));
+
+    write_slot(sampler, READY, LPC_CPU_SAMPLER_TEST);
+    ASSERT_EQ(SLOT_COUNT + 1,
+              count_of(sampler.get_samples(10), LPC_CPU_SAMPLER_TEST));
+}
+
+TEST_F(cpu_sampler_test, window)
+{
+    cpu_sampler sampler;
+    set_window_minutes(sampler, 10);
+
+    uint64_t minute = now_minute();
+    add_bucket(sampler, minute - 11, LPC_CPU_SAMPLER_TEST, 1);
+    add_bucket(sampler, minute - 2, LPC_CPU_SAMPLER_TEST, 2);
+
+    // the bucket out of the window expires, and the one before the last minute is
+    // only in the longer queries
+    ASSERT_EQ(0u, count_of(sampler.get_samples(1), LPC_CPU_SAMPLER_TEST));
+    ASSERT_EQ(2u, count_of(sampler.get_samples(5), LPC_CPU_SAMPLER_TEST));
+    ASSERT_EQ(2u, count_of(sampler.get_samples(100), LPC_CPU_SAMPLER_TEST));
+}
+
+TEST_F(cpu_sampler_test, sample_task)
+{
+    cpu_sampler &sampler = cpu_sampler::instance();
+    int frequency = sampler.frequency();
+    int window = window_minutes(sampler);
+    sampler.stop();
+    sampler.start(1000, 10);
+
+    task_ptr t = tasking::enqueue(LPC_CPU_SAMPLER_TEST, nullptr, []() {
+        auto start = std::chrono::steady_clock::now();
+        volatile uint64_t n = 0;
+        while (std::chrono::steady_clock::now() - start < std::chrono::seconds(1)) {
+            ++n;
+        }
+    });
+    t->wait();
+    // the task may run across the minute boundary
+    ASSERT_GT(count_of(sampler.get_samples(2), LPC_CPU_SAMPLER_TEST), 0u);
+
+    // not started again by the service, as it is running
+    pprof_http_service service;
+    std::string url = "http://127.0.0.1:34601/pprof/flamegraph";
+    ASSERT_EQ(10, get_minutes(service, 10, url));
+    ASSERT_EQ(3, get_minutes(service, 10, url + "?minutes=3"));
+    ASSERT_EQ(10, get_minutes(service, 10, url + "?minutes=100"));
+    ASSERT_EQ(10, get_minutes(service, 10, url + "?minutes=-1"));
+    ASSERT_EQ(10, get_minutes(service, 10, url + "?minutes=abc"));
+
+    // "task_code;outermost;...;innermost count"
+    http_response resp;
+    service.flamegraph_handler(
+        make_request("http://127.0.0.1:34601/pprof/flamegraph?minutes=2"), resp);
+    ASSERT_EQ(http_status_code::ok, resp.status_code);
+    std::istringstream lines(resp.body);
+    std::string line;
+    bool found = false;
+    while (std::getline(lines, line)) {
+        size_t space = line.rfind(' ');
+        ASSERT_NE(std::string::npos, space) << line;
+        ASSERT_GT(std::stoull(line.substr(space + 1)), 0u) << line;
+        size_t semicolon = line.find(';');
+        ASSERT_LT(semicolon, space) << line;
+        if (line.substr(0, semicolon) == LPC_CPU_SAMPLER_TEST.to_string()) {
+            found = true;
+        }
+    }
+    ASSERT_TRUE(found);
+
+    // the legacy cpu profile: header, (count, depth, pcs) of each stack, trailer, maps
+    resp = http_response();
+    service.continuous_handler(
+        make_request("http://127.0.0.1:34601/pprof/continuous?minutes=2"), resp);
+    ASSERT_EQ(http_status_code::ok, resp.status_code);
+    const uintptr_t *words = reinterpret_cast<const uintptr_t *>(resp.body.data());
+    size_t word_count = resp.body.size() / sizeof(uintptr_t);
+    ASSERT_GE(word_count, 8u);
+    ASSERT_EQ(0u, words[0]);
+    ASSERT_EQ(3u, words[1]);
+    ASSERT_EQ(0u, words[2]);
+    ASSERT_EQ(1000u, words[3]);
+    ASSERT_EQ(0u, words[4]);
+    size_t i = 5;
+    uint64_t stack_count = 0;
+    while (i + 2 < word_count && !(words[i] == 0 && words[i + 1] == 1)) {
+        ASSERT_GT(words[i], 0u);
+        ASSERT_GT(words[i + 1], 0u);
+        ASSERT_LE(words[i + 1], static_cast<uintptr_t>(cpu_sampler::MAX_DEPTH));
+        i += 2 + words[i + 1];
+        ++stack_count;
+    }
+    ASSERT_GT(stack_count, 0u);
+    ASSERT_LT(i + 2, word_count);
+    ASSERT_EQ(0u, words[i]);
+    ASSERT_EQ(1u, words[i + 1]);
+    ASSERT_EQ(0u, words[i + 2]);
+
+    sampler.stop();
+    if (frequency > 0) {
+        sampler.start(frequency, window);
+    }
+}
+
+} // namespace dsn
+
+#endif // DSN_ENABLE_GPERF
@@ -874,6 +874,60 @@ static void file_utils_test_rename()
     EXPECT_FALSE(ret);
 }
 
+static void file_utils_test_copy()
+{
+    std::string path;
+    std::string path2;
+    int64_t sz, sz2;
+    bool ret;
+
+    path = "./file_utils_temp/b";
+    path2 = "./file_utils_temp/b_copy/";
+    ret = dsn::utils::filesystem::copy_directory(path, path2);
+    EXPECT_TRUE(ret);
+    ret = dsn::utils::filesystem::file_exists("./file_utils_temp/b_copy/c/d/2.txt");
+    EXPECT_TRUE(ret);
+    ret = dsn::utils::filesystem::file_size("./file_utils_temp/b/c/d/2.txt", sz);
+    EXPECT_TRUE(ret);
+    ret = dsn::utils::filesystem::file_size("./file_utils_temp/b_copy/c/d/2.txt", sz2);
+    EXPECT_TRUE(ret);
+    EXPECT_EQ(sz, sz2);
+
+    // dest exists
+    ret = dsn::utils::filesystem::copy_directory(path, path2);
+    EXPECT_FALSE(ret);
+
+    // src not exist
+    path = "./file_utils_temp/not_exist";
+    path2 = "./file_utils_temp/not_exist_copy";
+    ret = dsn::utils::filesystem::copy_directory(path, path2);
+    EXPECT_FALSE(ret);
+
+    // copy a single file, keeping the last write time
+    uint64_t copied = 0;
+    path = "./file_utils_temp/b/c/d/2.txt";
+    path2 = "./file_utils_temp/2_copy.txt";
+    EXPECT_FALSE(dsn::utils::filesystem::is_same_file_stat(path, path2));
+    ret = dsn::utils::filesystem::copy_file(path, path2, copied);
+    EXPECT_TRUE(ret);
+    EXPECT_EQ(sz, copied);
+    EXPECT_TRUE(dsn::utils::filesystem::is_same_file_stat(path, path2));
+
+    // src is changed after copied
+    {
+        std::ofstream f(path, std::ios::app);
+        f << "changed";
+    }
+    EXPECT_FALSE(dsn::utils::filesystem::is_same_file_stat(path, path2));
+    ret = dsn::utils::filesystem::copy_file(path, path2, copied);
+    EXPECT_TRUE(ret);
+    EXPECT_EQ(sz + 7, copied);
+    EXPECT_TRUE(dsn::utils::filesystem::is_same_file_stat(path, path2));
+
+    ret = dsn::utils::filesystem::copy_file("./file_utils_temp/not_exist", path2, copied);
+    EXPECT_FALSE(ret);
+}
+
 static void file_utils_test_remove()
 {
     std::string path;
@@ -914,6 +968,7 @@ TEST(core, file_utils)
     file_utils_test_path_exists();
     file_utils_test_get_paths();
     file_utils_test_rename();
+    file_utils_test_copy();
     file_utils_test_remove();
     file_utils_test_cleanup();
 }
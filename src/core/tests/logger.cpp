@@ -34,6 +34,7 @@
  */
 
 #include "../tools/common/simple_logger.h"
+#include "../tools/common/async_logger.h"
 #include <gtest/gtest.h>
 #include <dsn/utility/filesystem.h>
 
@@ -130,3 +131,49 @@ TEST(tools_common, simple_logger)
     clear_files(index);
     finish_test_dir();
 }
+
+TEST(tools_common, async_logger)
+{
+    prepare_test_dir();
+    const int thread_count = 4;
+    const int log_count = 1000;
+    async_logger *logger = new async_logger("./");
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([logger, i]() {
+            for (int j = 0; j < log_count; ++j)
+                log_print(logger, "test_print %d.%d", i, j);
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    logger->flush();
+    // the rings of the exited threads are freed
+    ASSERT_EQ(0u, logger->ring_count());
+    delete logger;
+
+    // all the records are written, and in order for each thread
+    std::vector<int> index;
+    get_log_file_index(index);
+    ASSERT_EQ(1u, index.size());
+    char file[256];
+    snprintf_p(file, 256, "log.%d.txt", index[0]);
+    FILE *fp = fopen(file, "r");
+    ASSERT_TRUE(fp != nullptr);
+    std::vector<int> next(thread_count, 0);
+    char line[1024];
+    int lines = 0;
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        const char *msg = strstr(line, "test_print ");
+        ASSERT_TRUE(msg != nullptr);
+        int i, j;
+        ASSERT_EQ(2, sscanf(msg, "test_print %d.%d", &i, &j));
+        ASSERT_EQ(next[i]++, j);
+        ++lines;
+    }
+    fclose(fp);
+    ASSERT_EQ(thread_count * log_count, lines);
+
+    clear_files(index);
+    finish_test_dir();
+}
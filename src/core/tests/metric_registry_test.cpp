@@ -0,0 +1,76 @@
+// Copyright (c) 2018, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/perf_counter/metric_registry.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace dsn {
+
+TEST(metric_registry, counter)
+{
+    metric_family *family =
+        metric_registry::instance().register_counter("test_counter", "a test counter", 2);
+    ASSERT_EQ(family,
+              metric_registry::instance().register_counter("test_counter", "a test counter"));
+
+    metric_series *s1 = family->get(metric_labels(1, 2));
+    ASSERT_EQ(s1, family->get(metric_labels(1, 2)));
+    metric_series *s2 = family->get(metric_labels(1, 3));
+    ASSERT_NE(s1, s2);
+    // beyond max_series
+    metric_series *overflow = family->get(metric_labels(1, 4));
+    ASSERT_TRUE(overflow->is_overflow());
+    ASSERT_EQ(overflow, family->get(metric_labels(2, 0)));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([s1, s2]() {
+            for (int j = 0; j < 10000; ++j) {
+                s1->increment();
+                s2->increment(2);
+            }
+        });
+    }
+    for (auto &t : threads)
+        t.join();
+    overflow->increment(5);
+
+    ASSERT_EQ(40000u, s1->snapshot()[0]);
+    ASSERT_EQ(80000u, s2->snapshot()[0]);
+
+    std::string text = metric_registry::instance().to_prometheus_text();
+    ASSERT_NE(std::string::npos, text.find("# TYPE test_counter counter\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("test_counter{app_id=\"1\",partition=\"2\"} 40000\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("test_counter{app_id=\"1\",partition=\"3\"} 80000\n"));
+    ASSERT_NE(std::string::npos, text.find("test_counter{overflow=\"true\"} 5\n"));
+}
+
+TEST(metric_registry, histogram)
+{
+    metric_family *family = metric_registry::instance().register_histogram(
+        "test_histogram", "a test histogram", {100, 10, 1000});
+    ASSERT_EQ(std::vector<uint64_t>({10, 100, 1000}), family->buckets());
+
+    metric_series *s = family->get(metric_labels(3));
+    s->observe(5);
+    s->observe(10);
+    s->observe(50);
+    s->observe(5000);
+    ASSERT_EQ(std::vector<uint64_t>({5065, 2, 1, 0, 1}), s->snapshot());
+
+    std::string text = metric_registry::instance().to_prometheus_text();
+    ASSERT_NE(std::string::npos, text.find("# TYPE test_histogram histogram\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("test_histogram_bucket{app_id=\"3\",le=\"10\"} 2\n"
+                        "test_histogram_bucket{app_id=\"3\",le=\"100\"} 3\n"
+                        "test_histogram_bucket{app_id=\"3\",le=\"1000\"} 3\n"
+                        "test_histogram_bucket{app_id=\"3\",le=\"+Inf\"} 4\n"
+                        "test_histogram_sum{app_id=\"3\"} 5065\n"
+                        "test_histogram_count{app_id=\"3\"} 4\n"));
+}
+
+} // namespace dsn
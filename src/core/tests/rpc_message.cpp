@@ -36,6 +36,7 @@
 #include <dsn/utility/crc.h>
 #include <dsn/utility/transient_memory.h>
 #include <dsn/tool-api/rpc_message.h>
+#include <dsn/cpp/rpc_stream.h>
 #include <gtest/gtest.h>
 
 using namespace ::dsn;
@@ -183,3 +184,46 @@ TEST(core, message_ex)
         request->release_ref();
     }
 }
+
+TEST(core, rpc_write_stream_append)
+{
+    std::string large(binary_writer::zero_copy_write_min_bytes, 'x');
+    blob large_bb = blob::create_from_bytes(large.data(), large.size());
+
+    message_ex *request = message_ex::create_request(RPC_CODE_FOR_TEST, 100, 1);
+    {
+        rpc_write_stream writer(request);
+        writer.write(1);
+        writer.write(large_bb);
+        writer.write(2);
+    }
+
+    // | header, 1, len | large | 2 |
+    ASSERT_EQ(3u, request->buffers.size());
+    ASSERT_EQ(large_bb.data(), request->buffers[1].data());
+    ASSERT_EQ(3 * sizeof(int) + large.size(), request->header->body_length);
+
+    // the buffers are sent as a scatter list
+    std::string wire;
+    for (const blob &bb : request->buffers) {
+        wire.append(bb.data(), bb.length());
+    }
+    message_ex *receive =
+        message_ex::create_receive_message(blob::create_from_bytes(wire.data(), wire.size()));
+    {
+        blob data;
+        rpc_read_stream reader(receive);
+        int value;
+        reader.read(value);
+        ASSERT_EQ(1, value);
+        reader.read(data);
+        ASSERT_EQ(large, data.to_string());
+        reader.read(value);
+        ASSERT_EQ(2, value);
+    }
+
+    receive->add_ref();
+    receive->release_ref();
+    request->add_ref();
+    request->release_ref();
+}
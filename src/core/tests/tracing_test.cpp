@@ -0,0 +1,82 @@
+// Copyright (c) 2018, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/tool-api/tracing.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace dsn {
+
+static int count_occurrences(const std::string &str, const std::string &sub)
+{
+    int count = 0;
+    for (size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1))
+        ++count;
+    return count;
+}
+
+TEST(tracing, sample)
+{
+    uint32_t old_rate = tracing::internal_use_only::sample_rate;
+
+    tracing::init(0, 0);
+    ASSERT_FALSE(tracing::is_sampled(0x1234));
+
+    tracing::init(1, 0);
+    ASSERT_TRUE(tracing::is_sampled(0x1234));
+    ASSERT_FALSE(tracing::is_sampled(0));
+
+    // the same decision for the same trace id
+    tracing::init(1000, 0);
+    int sampled = 0;
+    for (uint64_t id = 1; id <= 1000000; ++id) {
+        bool r = tracing::is_sampled(id * 0x9E3779B97F4A7C15ULL);
+        ASSERT_EQ(r, tracing::is_sampled(id * 0x9E3779B97F4A7C15ULL));
+        if (r)
+            ++sampled;
+    }
+    ASSERT_GT(sampled, 500);
+    ASSERT_LT(sampled, 1500);
+
+    tracing::init(old_rate, 0);
+}
+
+TEST(tracing, chrome_trace)
+{
+    uint32_t old_rate = tracing::internal_use_only::sample_rate;
+    tracing::init(1, 4);
+
+    const uint64_t trace_id = 0x5eed0000abcd0001ULL;
+    // a new thread gets a ring of 4 spans, which keeps only the latest ones
+    std::thread t([trace_id]() {
+        for (int i = 0; i < 6; ++i) {
+            tracing::add_span(
+                trace_id, "test.span", 1000, 3000, tracing::span_arg::number, (uint64_t)i);
+        }
+        {
+            tracing::scoped_span span(trace_id,
+                                      "test.scoped",
+                                      tracing::span_arg::address,
+                                      tracing::pack_address(rpc_address("127.0.0.1", 34801)));
+        }
+        // not sampled
+        tracing::scoped_span span(0, "test.not_sampled");
+    });
+    t.join();
+
+    std::string json = tracing::dump_chrome_trace(trace_id);
+    ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+    ASSERT_EQ(4, count_occurrences(json, "\"ph\":\"X\""));
+    ASSERT_EQ(3, count_occurrences(json, "\"name\":\"test.span\""));
+    ASSERT_EQ(0, count_occurrences(json, "\"arg\":2"));
+    ASSERT_EQ(1, count_occurrences(json, "\"arg\":5"));
+    ASSERT_EQ(1, count_occurrences(json, "\"arg\":\"127.0.0.1:34801\""));
+    ASSERT_EQ(3, count_occurrences(json, "\"ts\":1,\"dur\":2"));
+    ASSERT_EQ(0, count_occurrences(json, "test.not_sampled"));
+    ASSERT_EQ(std::string::npos, tracing::dump_chrome_trace(trace_id + 1).find("test.span"));
+
+    tracing::init(old_rate, 1024);
+}
+
+} // namespace dsn
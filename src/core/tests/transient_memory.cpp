@@ -26,11 +26,14 @@
 
 #include <dsn/utility/transient_memory.h>
 #include <gtest/gtest.h>
+#include <thread>
+#include <vector>
 
 using namespace ::dsn;
 
 namespace dsn {
 extern void tls_trans_mem_alloc(size_t min_size);
+extern size_t tls_trans_pinned_slab_count(const std::vector<void *> &objects);
 }
 
 TEST(core, transient_memory)
@@ -49,7 +52,7 @@ TEST(core, transient_memory)
     ASSERT_EQ(0xdeadbeef, tls_trans_memory.magic);
     ASSERT_EQ(10240u, tls_trans_memory.remain_bytes);
     ASSERT_EQ((void *)tls_trans_memory.block_ptr_buffer, (void *)tls_trans_memory.block);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)tls_trans_memory.block->get());
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(*tls_trans_memory.block)->data());
     ASSERT_TRUE(tls_trans_memory.committed);
 
     // malloc 100
@@ -61,13 +64,13 @@ TEST(core, transient_memory)
     tls_trans_mem_next(&ptr, &sz, 100);
     ASSERT_EQ((void *)tls_trans_memory.next, (void *)ptr);
     ASSERT_EQ(1024u, sz);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)tls_trans_memory.block->get());
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(*tls_trans_memory.block)->data());
     ASSERT_EQ(1024u, tls_trans_memory.remain_bytes);
     ASSERT_FALSE(tls_trans_memory.committed);
 
     // commit 100
     tls_trans_mem_commit(100);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(tls_trans_memory.block->get() + 100));
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)((*tls_trans_memory.block)->data() + 100));
     ASSERT_EQ(924u, tls_trans_memory.remain_bytes);
     ASSERT_TRUE(tls_trans_memory.committed);
 
@@ -75,13 +78,13 @@ TEST(core, transient_memory)
     tls_trans_mem_next(&ptr, &sz, 200);
     ASSERT_EQ((void *)tls_trans_memory.next, (void *)ptr);
     ASSERT_EQ(924u, sz);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(tls_trans_memory.block->get() + 100));
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)((*tls_trans_memory.block)->data() + 100));
     ASSERT_EQ(924u, tls_trans_memory.remain_bytes);
     ASSERT_FALSE(tls_trans_memory.committed);
 
     // commit 300
     tls_trans_mem_commit(300);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(tls_trans_memory.block->get() + 400));
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)((*tls_trans_memory.block)->data() + 400));
     ASSERT_EQ(624u, tls_trans_memory.remain_bytes);
     ASSERT_TRUE(tls_trans_memory.committed);
 
@@ -89,15 +92,83 @@ TEST(core, transient_memory)
     tls_trans_mem_next(&ptr, &sz, 10240);
     ASSERT_EQ((void *)tls_trans_memory.next, (void *)ptr);
     ASSERT_EQ(10240u, sz);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)tls_trans_memory.block->get());
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(*tls_trans_memory.block)->data());
     ASSERT_EQ(10240u, tls_trans_memory.remain_bytes);
     ASSERT_FALSE(tls_trans_memory.committed);
 
     // commit 0
     tls_trans_mem_commit(0);
-    ASSERT_EQ((void *)tls_trans_memory.next, (void *)(tls_trans_memory.block->get()));
+    ASSERT_EQ((void *)tls_trans_memory.next, (void *)((*tls_trans_memory.block)->data()));
     ASSERT_EQ(10240u, tls_trans_memory.remain_bytes);
     ASSERT_TRUE(tls_trans_memory.committed);
 
     tls_trans_mem_init(1024 * 1024); // restore
 }
+
+TEST(core, transient_memory_malloc)
+{
+    // the freed objects are reused by the same thread
+    void *p1 = tls_trans_malloc(100);
+    tls_trans_free(p1);
+    void *p2 = tls_trans_malloc(100);
+    ASSERT_EQ(p1, p2);
+
+    // different classes are in different slabs
+    void *p3 = tls_trans_malloc(1000);
+    ASSERT_NE(p2, p3);
+    memset(p3, 0, 1000);
+
+    // larger than the largest class
+    void *p4 = tls_trans_malloc(100000);
+    memset(p4, 0, 100000);
+
+    tls_trans_free(p2);
+    tls_trans_free(p3);
+    tls_trans_free(p4);
+}
+
+TEST(core, transient_memory_remote_free)
+{
+    const int count = 10000;
+    std::vector<void *> objects(count);
+    for (int i = 0; i < count; ++i) {
+        objects[i] = tls_trans_malloc(64);
+        memset(objects[i], i, 64);
+    }
+
+    // the objects of the retired slabs are pinned until freed. only the slabs of this
+    // test are checked, as the worker threads allocate from their own slabs meanwhile
+    ASSERT_GT(tls_trans_pinned_slab_count(objects), 0u);
+    ASSERT_GE(get_transient_memory_stats().slab_used_bytes, count * 64u);
+
+    std::thread t([&objects]() {
+        for (void *p : objects) {
+            tls_trans_free(p);
+        }
+    });
+    t.join();
+    ASSERT_EQ(0u, tls_trans_pinned_slab_count(objects));
+
+    // the objects freed by the other thread are reused
+    for (int i = 0; i < count; ++i) {
+        objects[i] = tls_trans_malloc(64);
+    }
+    for (void *p : objects) {
+        tls_trans_free(p);
+    }
+}
+
+TEST(core, transient_memory_pinned_block)
+{
+    tls_trans_mem_init(1024);
+    blob b = tls_trans_mem_alloc_blob(100);
+    uint64_t pinned = get_transient_memory_stats().pinned_block_count;
+
+    // b pins the retired block
+    tls_trans_mem_alloc(100);
+    ASSERT_EQ(pinned + 1, get_transient_memory_stats().pinned_block_count);
+    b = blob();
+    ASSERT_EQ(pinned, get_transient_memory_stats().pinned_block_count);
+
+    tls_trans_mem_init(1024 * 1024); // restore
+}
@@ -84,6 +84,49 @@ TEST(core, binary_io)
     EXPECT_TRUE(value3 == value);
 }
 
+TEST(core, binary_writer_append)
+{
+    std::string large(binary_writer::zero_copy_write_min_bytes, 'x');
+    blob large_bb = blob::create_from_bytes(large.data(), large.size());
+    blob small_bb = blob::create_from_bytes("abc", 3);
+
+    binary_writer writer;
+    writer.write(1);
+    writer.write(large_bb);
+    writer.write(small_bb);
+    writer.append(large_bb);
+    writer.append(blob());
+    writer.write(2);
+
+    // | 1, len | large | len, small | large | 2 |
+    const std::vector<blob> &buffers = writer.get_buffers();
+    ASSERT_EQ(5u, buffers.size());
+    ASSERT_EQ(large_bb.data(), buffers[1].data());
+    ASSERT_EQ(large_bb.data(), buffers[3].data());
+    ASSERT_EQ(2 * sizeof(int), buffers[0].length());
+    ASSERT_EQ(sizeof(int) + 3, buffers[2].length());
+    ASSERT_EQ(sizeof(int), buffers[4].length());
+    ASSERT_EQ(4 * sizeof(int) + 3 + 2 * large.size(), writer.total_size());
+
+    blob buf = writer.get_buffer();
+    ASSERT_EQ(writer.total_size(), buf.length());
+    binary_reader reader(buf);
+    int value;
+    blob bb;
+    reader.read(value);
+    ASSERT_EQ(1, value);
+    reader.read(bb);
+    ASSERT_EQ(large, bb.to_string());
+    reader.read(bb);
+    ASSERT_EQ("abc", bb.to_string());
+    std::string raw(large.size(), '\0');
+    reader.read(&raw[0], static_cast<int>(raw.size()));
+    ASSERT_EQ(large, raw);
+    reader.read(value);
+    ASSERT_EQ(2, value);
+    ASSERT_TRUE(reader.is_eof());
+}
+
 TEST(core, split_args)
 {
     std::string value = "a ,b, c ";
@@ -0,0 +1,453 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "async_logger.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <dsn/utility/filesystem.h>
+
+namespace dsn {
+namespace tools {
+
+// longer messages are truncated
+static const int MAX_MESSAGE_LENGTH = 4096;
+static const uint32_t RECORD_DATA = 1;
+static const uint32_t RECORD_PADDING = 2; // skip to the beginning of the ring
+
+struct log_record
+{
+    uint32_t size; // including the header and the message, aligned to 8 bytes
+    uint32_t kind;
+    uint64_t ts;
+    uint64_t task_id;
+    const char *file;
+    const char *function;
+    int32_t line;
+    int32_t tid;
+    int32_t worker_index; // -1 if not logged by a worker thread
+    int32_t level;
+    char node_name[32];
+    char pool_name[32];
+    uint32_t message_length;
+    uint32_t reserved;
+    // followed by the message
+
+    const char *message() const { return reinterpret_cast<const char *>(this + 1); }
+};
+
+struct async_logger::ring
+{
+    explicit ring(size_t cap)
+        : data(new char[cap]), capacity(cap), head(0), tail(0), retired(false)
+    {
+    }
+
+    // return a contiguous space of size bytes, or nullptr if the ring is full.
+    // called by the owner thread only
+    char *reserve(uint32_t size)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        size_t offset = h % capacity;
+        size_t contiguous = capacity - offset;
+        size_t need = size <= contiguous ? size : contiguous + size;
+        if (capacity - (h - t) < need)
+            return nullptr;
+
+        if (size > contiguous) {
+            log_record *padding = reinterpret_cast<log_record *>(data.get() + offset);
+            padding->size = static_cast<uint32_t>(contiguous);
+            padding->kind = RECORD_PADDING;
+            head.store(h + contiguous, std::memory_order_release);
+            offset = 0;
+        }
+        return data.get() + offset;
+    }
+
+    void commit(uint32_t size)
+    {
+        head.store(head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    std::unique_ptr<char[]> data;
+    const size_t capacity;
+    // the head is moved by the owner thread only, and the tail by the drain only
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    // set when the owner thread exits, the ring is freed once it is drained
+    std::atomic<bool> retired;
+};
+
+static std::atomic<uint64_t> s_next_logger_id(1);
+
+struct thread_ring_ref
+{
+    uint64_t logger_id = 0;
+    std::shared_ptr<async_logger::ring> ring;
+
+    void retire()
+    {
+        if (ring != nullptr) {
+            ring->retired.store(true, std::memory_order_release);
+            ring = nullptr;
+        }
+    }
+
+    ~thread_ring_ref() { retire(); }
+};
+static thread_local thread_ring_ref s_ring_ref;
+
+static int print_header(FILE *fp, const log_record &r)
+{
+    static char s_level_char[] = "IDWEF";
+
+    char str[24];
+    ::dsn::utils::time_ms_to_string(r.ts / 1000000, str);
+
+    int n = fprintf(fp, "%c%s (%" PRIu64 " %04x) ", s_level_char[r.level], str, r.ts, r.tid);
+    if (r.task_id) {
+        if (r.worker_index >= 0) {
+            n += fprintf(fp,
+                         "%6s.%7s%d.%016" PRIx64 ": ",
+                         r.node_name,
+                         r.pool_name,
+                         r.worker_index,
+                         r.task_id);
+        } else {
+            n += fprintf(fp,
+                         "%6s.%7s.%05d.%016" PRIx64 ": ",
+                         r.node_name,
+                         "io-thrd",
+                         r.tid,
+                         r.task_id);
+        }
+    } else {
+        if (r.worker_index >= 0) {
+            n += fprintf(fp, "%6s.%7s%u: ", r.node_name, r.pool_name, r.worker_index);
+        } else {
+            n += fprintf(fp, "%6s.%7s.%05d: ", r.node_name, "io-thrd", r.tid);
+        }
+    }
+    return n;
+}
+
+async_logger::async_logger(const char *log_dir) : logging_provider(log_dir)
+{
+    _log_dir = std::string(log_dir);
+    _id = s_next_logger_id++;
+    _start_index = 0;
+    _index = 1;
+    _file_size = 0;
+    _log = nullptr;
+    _stopped = false;
+
+    _short_header =
+        dsn_config_get_value_bool("tools.async_logger",
+                                  "short_header",
+                                  true,
+                                  "whether to use short header (excluding file/function etc.)");
+    _block_when_full = dsn_config_get_value_bool(
+        "tools.async_logger",
+        "block_when_full",
+        false,
+        "whether to wait rather than drop the log when the buffer of a thread is full");
+    _stderr_start_level = enum_from_string(
+        dsn_config_get_value_string(
+            "tools.async_logger",
+            "stderr_start_level",
+            enum_to_string(LOG_LEVEL_WARNING),
+            "copy log messages at or above this level to stderr in addition to logfiles"),
+        LOG_LEVEL_INVALID);
+    dassert(_stderr_start_level != LOG_LEVEL_INVALID,
+            "invalid [tools.async_logger] stderr_start_level specified");
+    _max_number_of_log_files_on_disk = dsn_config_get_value_uint64(
+        "tools.async_logger",
+        "max_number_of_log_files_on_disk",
+        20,
+        "max number of log files reserved on disk, older logs are auto deleted");
+    _max_log_file_size =
+        dsn_config_get_value_uint64(
+            "tools.async_logger", "max_log_file_size_mb", 64, "log file is rotated at this size") *
+        1024 * 1024;
+    _ring_capacity = dsn_config_get_value_uint64("tools.async_logger",
+                                                 "buffer_size_kb_per_thread",
+                                                 1024,
+                                                 "size of the log buffer of each thread") *
+                     1024;
+    // a message of the max length always fits
+    _ring_capacity = std::max(_ring_capacity, (size_t)MAX_MESSAGE_LENGTH * 4);
+    _drain_interval_ms = (uint32_t)dsn_config_get_value_uint64(
+        "tools.async_logger",
+        "drain_interval_ms",
+        10,
+        "every what period (ms) the buffers are checked when the logger is idle");
+
+    _dropped_count.init_global_counter("replica",
+                                       "server",
+                                       "async_logger.dropped.count",
+                                       COUNTER_TYPE_VOLATILE_NUMBER,
+                                       "log records dropped as the buffer of a thread is full");
+    _blocked_count.init_global_counter("replica",
+                                       "server",
+                                       "async_logger.blocked.count",
+                                       COUNTER_TYPE_VOLATILE_NUMBER,
+                                       "log records waited as the buffer of a thread is full");
+
+    // check existing log files, which are named like the simple_logger's
+    std::vector<std::string> sub_list;
+    if (!dsn::utils::filesystem::get_subfiles(_log_dir, sub_list, false)) {
+        dassert(false, "Fail to get subfiles in %s.", _log_dir.c_str());
+    }
+    for (auto &fpath : sub_list) {
+        auto &&name = dsn::utils::filesystem::get_file_name(fpath);
+        if (name.length() <= 8 || name.substr(0, 4) != "log.")
+            continue;
+
+        int index;
+        if (1 != sscanf(name.c_str(), "log.%d.txt", &index) || index <= 0)
+            continue;
+
+        if (index > _index)
+            _index = index;
+
+        if (_start_index == 0 || index < _start_index)
+            _start_index = index;
+    }
+    sub_list.clear();
+
+    if (_start_index == 0) {
+        _start_index = _index;
+    } else
+        ++_index;
+
+    create_log_file();
+    _drain_thread = std::thread(&async_logger::drain_thread, this);
+}
+
+async_logger::~async_logger(void)
+{
+    _stopped = true;
+    _wakeup.notify_one();
+    _drain_thread.join();
+
+    std::lock_guard<std::recursive_mutex> l(_drain_lock);
+    drain();
+    ::fclose(_log);
+}
+
+void async_logger::create_log_file()
+{
+    if (_log != nullptr)
+        ::fclose(_log);
+
+    _file_size = 0;
+
+    std::stringstream str;
+    str << _log_dir << "/log." << _index++ << ".txt";
+    _log = ::fopen(str.str().c_str(), "w+");
+
+    while (_index - _start_index > _max_number_of_log_files_on_disk) {
+        std::stringstream str2;
+        str2 << "log." << _start_index++ << ".txt";
+        auto dp = utils::filesystem::path_combine(_log_dir, str2.str());
+        if (::remove(dp.c_str()) != 0) {
+            printf("Failed to remove garbage log file %s\n", dp.c_str());
+            _start_index--;
+            break;
+        }
+    }
+}
+
+async_logger::ring *async_logger::get_ring()
+{
+    if (s_ring_ref.logger_id != _id) {
+        // the ring of a previous logger
+        s_ring_ref.retire();
+        s_ring_ref.ring = std::make_shared<ring>(_ring_capacity);
+        s_ring_ref.logger_id = _id;
+
+        std::lock_guard<std::mutex> l(_rings_lock);
+        _rings.push_back(s_ring_ref.ring);
+    }
+    return s_ring_ref.ring.get();
+}
+
+size_t async_logger::ring_count()
+{
+    std::lock_guard<std::mutex> l(_rings_lock);
+    return _rings.size();
+}
+
+void async_logger::dsn_logv(const char *file,
+                            const char *function,
+                            const int line,
+                            dsn_log_level_t log_level,
+                            const char *fmt,
+                            va_list args)
+{
+    static thread_local char s_message[MAX_MESSAGE_LENGTH];
+    int len = vsnprintf(s_message, sizeof(s_message), fmt, args);
+    if (len < 0)
+        len = 0;
+    else if (len >= MAX_MESSAGE_LENGTH)
+        len = MAX_MESSAGE_LENGTH - 1;
+    uint32_t size = (sizeof(log_record) + len + 7) & ~7u;
+
+    ring *rg = get_ring();
+    char *p = rg->reserve(size);
+    if (p == nullptr) {
+        if (!_block_when_full && log_level < LOG_LEVEL_ERROR) {
+            _dropped_count->increment();
+            return;
+        }
+        _blocked_count->increment();
+        do {
+            _wakeup.notify_one();
+            std::this_thread::yield();
+        } while ((p = rg->reserve(size)) == nullptr);
+    }
+
+    log_record *r = reinterpret_cast<log_record *>(p);
+    r->size = size;
+    r->kind = RECORD_DATA;
+    r->ts = ::dsn::tools::is_engine_ready() ? dsn_now_ns() : 0;
+    r->task_id = task::get_current_task_id();
+    r->file = file;
+    r->function = function;
+    r->line = line;
+    r->tid = ::dsn::utils::get_current_tid();
+    r->level = log_level;
+    const char *node_name = task::get_current_node_name();
+    strncpy(r->node_name, node_name ? node_name : "", sizeof(r->node_name) - 1);
+    r->node_name[sizeof(r->node_name) - 1] = '\0';
+    task_worker *worker = task::get_current_worker2();
+    if (worker != nullptr) {
+        r->worker_index = worker->index();
+        strncpy(r->pool_name, worker->pool_spec().name.c_str(), sizeof(r->pool_name) - 1);
+        r->pool_name[sizeof(r->pool_name) - 1] = '\0';
+    } else {
+        r->worker_index = -1;
+        r->pool_name[0] = '\0';
+    }
+    r->message_length = len;
+    memcpy(p + sizeof(log_record), s_message, len);
+    rg->commit(size);
+
+    // errors are written out at once as the process may be about to crash
+    if (log_level >= LOG_LEVEL_ERROR) {
+        flush();
+    }
+}
+
+void async_logger::flush()
+{
+    std::lock_guard<std::recursive_mutex> l(_drain_lock);
+    drain();
+    ::fflush(_log);
+    ::fflush(stdout);
+}
+
+void async_logger::drain_thread()
+{
+    while (!_stopped) {
+        int count;
+        {
+            std::lock_guard<std::recursive_mutex> l(_drain_lock);
+            count = drain();
+            if (count > 0)
+                ::fflush(_log);
+        }
+        if (count == 0) {
+            std::unique_lock<std::mutex> l(_wakeup_lock);
+            _wakeup.wait_for(l, std::chrono::milliseconds(_drain_interval_ms));
+        }
+    }
+}
+
+int async_logger::drain()
+{
+    std::vector<std::shared_ptr<ring>> rings;
+    {
+        std::lock_guard<std::mutex> l(_rings_lock);
+        rings = _rings;
+    }
+
+    int count = 0;
+    bool has_retired = false;
+    for (const std::shared_ptr<ring> &rg : rings) {
+        // nothing is written after the ring is retired, so it is empty once drained below
+        if (rg->retired.load(std::memory_order_acquire))
+            has_retired = true;
+        uint64_t t = rg->tail.load(std::memory_order_relaxed);
+        uint64_t h = rg->head.load(std::memory_order_acquire);
+        while (t < h) {
+            const log_record *r =
+                reinterpret_cast<const log_record *>(rg->data.get() + t % rg->capacity);
+            t += r->size;
+            if (r->kind == RECORD_PADDING)
+                continue;
+
+            int n = print_header(_log, *r);
+            if (!_short_header) {
+                n += fprintf(_log, "%s:%d:%s(): ", r->file, r->line, r->function);
+            }
+            n += fwrite(r->message(), 1, r->message_length, _log);
+            n += fwrite("\n", 1, 1, _log);
+            _file_size += n;
+
+            if (r->level >= _stderr_start_level) {
+                print_header(stdout, *r);
+                if (!_short_header) {
+                    printf("%s:%d:%s(): ", r->file, r->line, r->function);
+                }
+                printf("%.*s\n", (int)r->message_length, r->message());
+            }
+            ++count;
+
+            if (_file_size >= _max_log_file_size) {
+                create_log_file();
+            }
+        }
+        rg->tail.store(t, std::memory_order_release);
+    }
+
+    // free the rings of the exited threads
+    if (has_retired) {
+        std::lock_guard<std::mutex> l(_rings_lock);
+        _rings.erase(std::remove_if(_rings.begin(),
+                                    _rings.end(),
+                                    [](const std::shared_ptr<ring> &rg) {
+                                        return rg->retired.load(std::memory_order_acquire) &&
+                                               rg->tail.load(std::memory_order_relaxed) ==
+                                                   rg->head.load(std::memory_order_acquire);
+                                    }),
+                     _rings.end());
+    }
+    return count;
+}
+}
+}
@@ -0,0 +1,131 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     logger which hands the log records to a background thread through per-thread
+ *     lock-free ring buffers
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool_api.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsn {
+namespace tools {
+
+//
+// the logging threads never take a lock or touch the log file:
+//
+//  - each thread owns a single-producer single-consumer ring buffer, into which it
+//    copies a binary record: the header fields (level, time, thread, task, ...) and
+//    the formatted message. the arguments are formatted on the logging thread because
+//    the strings they point to may not outlive the call.
+//  - a background thread drains all the ring buffers, formats the headers and writes
+//    the records to "log.<index>.txt", which is rotated once it exceeds
+//    max_log_file_size_mb.
+//  - if a ring buffer is full, the record is dropped, or the logging thread waits for
+//    the background thread if block_when_full is set. errors and fatal records are
+//    never dropped, and are flushed to the file before dsn_logv returns.
+//
+// records from different threads may be written slightly out of order, the timestamp
+// in the header tells the real order.
+//
+class async_logger : public logging_provider
+{
+public:
+    async_logger(const char *log_dir);
+    virtual ~async_logger(void);
+
+    virtual void dsn_logv(const char *file,
+                          const char *function,
+                          const int line,
+                          dsn_log_level_t log_level,
+                          const char *fmt,
+                          va_list args);
+
+    // write all the buffered records to the file
+    virtual void flush();
+
+    // the ring buffers of the threads which have logged, the ring of a thread is
+    // freed after the thread exits and the records left are written
+    size_t ring_count();
+
+    struct ring;
+
+private:
+    ring *get_ring();
+    void drain_thread();
+    // return the number of records written, user should hold _drain_lock
+    int drain();
+    void create_log_file();
+
+private:
+    std::string _log_dir;
+    bool _short_header;
+    bool _block_when_full;
+    dsn_log_level_t _stderr_start_level;
+    int _max_number_of_log_files_on_disk;
+    uint64_t _max_log_file_size;
+    size_t _ring_capacity;
+    uint32_t _drain_interval_ms;
+
+    // identifies the logger in the thread local ring references,
+    // as the address may be reused by a later logger
+    uint64_t _id;
+    std::mutex _rings_lock;
+    std::vector<std::shared_ptr<ring>> _rings;
+
+    // protects the log file, recursive as flush() may be called in a signal handler
+    // when the drain thread crashes
+    std::recursive_mutex _drain_lock;
+    FILE *_log;
+    int _start_index;
+    int _index;
+    uint64_t _file_size;
+
+    std::mutex _wakeup_lock;
+    std::condition_variable _wakeup;
+    std::atomic<bool> _stopped;
+    std::thread _drain_thread;
+
+    perf_counter_wrapper _dropped_count;
+    perf_counter_wrapper _blocked_count;
+};
+}
+}
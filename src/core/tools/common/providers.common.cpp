@@ -41,6 +41,7 @@
 #include "simple_task_queue.h"
 #include "network.sim.h"
 #include "simple_logger.h"
+#include "async_logger.h"
 #include "empty_aio_provider.h"
 #include "dsn_message_parser.h"
 #include "thrift_message_parser.h"
@@ -54,6 +55,7 @@ void register_common_providers()
     register_component_provider<task_worker>("dsn::task_worker");
     register_component_provider<screen_logger>("dsn::tools::screen_logger");
     register_component_provider<simple_logger>("dsn::tools::simple_logger");
+    register_component_provider<async_logger>("dsn::tools::async_logger");
 
     register_std_lock_providers();
 
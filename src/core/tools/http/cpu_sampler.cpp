@@ -0,0 +1,231 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#ifdef DSN_ENABLE_GPERF
+
+#include "cpu_sampler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <dsn/tool-api/task.h>
+#include <gperftools/stacktrace.h>
+
+namespace dsn {
+
+static void sigprof_handler(int sig, siginfo_t *info, void *ucontext)
+{
+    int saved_errno = errno;
+    cpu_sampler::instance().on_sample(ucontext);
+    errno = saved_errno;
+}
+
+static uintptr_t get_pc(void *ucontext)
+{
+    auto uc = static_cast<ucontext_t *>(ucontext);
+#if defined(__x86_64__)
+    return static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__aarch64__)
+    return static_cast<uintptr_t>(uc->uc_mcontext.pc);
+#else
+    return 0;
+#endif
+}
+
+static uint64_t now_minute()
+{
+    return std::chrono::duration_cast<std::chrono::minutes>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+size_t cpu_sampler::stack_hash::operator()(const stack &s) const
+{
+    size_t h = std::hash<int>()(s.task_code);
+    for (uintptr_t pc : s.pcs) {
+        h ^= std::hash<uintptr_t>()(pc) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+cpu_sampler::cpu_sampler()
+    : _frequency(0),
+      _window_minutes(0),
+      _slots(new sample_slot[SLOT_COUNT]),
+      _write_index(0),
+      _read_index(0),
+      _stalled_index(UINT64_MAX),
+      _dropped_count(0),
+      _stopped(true)
+{
+    for (size_t i = 0; i < SLOT_COUNT; ++i) {
+        _slots[i].state.store(EMPTY, std::memory_order_relaxed);
+    }
+}
+
+cpu_sampler::~cpu_sampler() { stop(); }
+
+void cpu_sampler::start(int frequency, int window_minutes)
+{
+    if (frequency <= 0 || !_stopped) {
+        return;
+    }
+    _frequency = frequency;
+    _window_minutes = std::max(window_minutes, 1);
+    _stopped = false;
+    _aggregate_thread = std::thread(&cpu_sampler::aggregate_thread, this);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = sigprof_handler;
+    sa.sa_flags = SA_RESTART | SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) != 0) {
+        derror("failed to install the SIGPROF handler, err = %s", strerror(errno));
+        return;
+    }
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = std::max(1000000 / frequency, 1);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        derror("failed to set ITIMER_PROF, err = %s", strerror(errno));
+        return;
+    }
+    ddebug("cpu sampler started, frequency = %d, window_minutes = %d",
+           _frequency,
+           _window_minutes);
+}
+
+void cpu_sampler::stop()
+{
+    if (_stopped) {
+        return;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    // a pending SIGPROF would terminate the process with the default action
+    signal(SIGPROF, SIG_IGN);
+
+    {
+        std::lock_guard<std::mutex> l(_wakeup_lock);
+        _stopped = true;
+    }
+    _wakeup.notify_all();
+    _aggregate_thread.join();
+}
+
+void cpu_sampler::on_sample(void *ucontext)
+{
+    uint64_t index = _write_index.fetch_add(1, std::memory_order_relaxed);
+    sample_slot &slot = _slots[index % SLOT_COUNT];
+    int expected = EMPTY;
+    if (!slot.state.compare_exchange_strong(expected, WRITING, std::memory_order_acquire)) {
+        // the aggregate thread falls behind
+        _dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    task *t = tls_dsn.magic == 0xdeadbeef ? tls_dsn.current_task : nullptr;
+    slot.task_code = t != nullptr ? static_cast<int>(t->code()) : TASK_CODE_INVALID;
+
+    // the same as the cpu profiler of gperftools: the pc of the interrupted instruction
+    // is taken from the context, and the frames of the signal handler are skipped
+    int depth = 0;
+    uintptr_t pc = get_pc(ucontext);
+    if (pc != 0) {
+        slot.pcs[depth++] = pc;
+    }
+    int n = GetStackTraceWithContext(
+        reinterpret_cast<void **>(slot.pcs + depth), MAX_DEPTH - depth, 3, ucontext);
+    if (n > 0 && depth == 1 && slot.pcs[1] == pc) {
+        // the unwinder may have found the interrupted frame too
+        memmove(slot.pcs + 1, slot.pcs + 2, (n - 1) * sizeof(uintptr_t));
+        --n;
+    }
+    slot.depth = depth + std::max(n, 0);
+
+    slot.state.store(READY, std::memory_order_release);
+}
+
+void cpu_sampler::drain()
+{
+    uint64_t minute = now_minute();
+    while (!_window.empty() && _window.front().first + _window_minutes <= minute) {
+        _window.pop_front();
+    }
+    if (_window.empty() || _window.back().first != minute) {
+        _window.emplace_back(minute, stack_counts());
+    }
+    stack_counts &counts = _window.back().second;
+
+    uint64_t write_index = _write_index.load(std::memory_order_relaxed);
+    if (write_index - _read_index > SLOT_COUNT) {
+        // the slots before have been overwritten or dropped
+        _read_index = write_index - SLOT_COUNT;
+    }
+    while (_read_index < write_index) {
+        sample_slot &slot = _slots[_read_index % SLOT_COUNT];
+        if (slot.state.load(std::memory_order_acquire) != READY) {
+            // the sample is being written, or it was dropped as the slot was busy,
+            // which won't be ready ever, so skip it if it is still not ready next time
+            if (_stalled_index == _read_index) {
+                ++_read_index;
+                continue;
+            }
+            _stalled_index = _read_index;
+            break;
+        }
+
+        if (slot.depth > 0) {
+            stack s;
+            s.task_code = slot.task_code;
+            s.pcs.assign(slot.pcs, slot.pcs + slot.depth);
+            ++counts[s];
+        }
+        slot.state.store(EMPTY, std::memory_order_release);
+        ++_read_index;
+    }
+}
+
+void cpu_sampler::aggregate_thread()
+{
+    std::unique_lock<std::mutex> l(_wakeup_lock);
+    while (!_stopped) {
+        _wakeup.wait_for(l, std::chrono::seconds(1));
+        std::lock_guard<std::mutex> wl(_window_lock);
+        drain();
+    }
+}
+
+cpu_sampler::stack_counts cpu_sampler::get_samples(int minutes)
+{
+    std::lock_guard<std::mutex> l(_window_lock);
+    drain();
+
+    stack_counts result;
+    uint64_t minute = now_minute();
+    for (const auto &bucket : _window) {
+        if (bucket.first + minutes <= minute) {
+            continue;
+        }
+        for (const auto &kv : bucket.second) {
+            result[kv.first] += kv.second;
+        }
+    }
+    return result;
+}
+
+} // namespace dsn
+
+#endif // DSN_ENABLE_GPERF
@@ -0,0 +1,110 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#ifdef DSN_ENABLE_GPERF
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <dsn/utility/singleton.h>
+
+namespace dsn {
+
+// an always-on cpu profiler with a low sampling frequency.
+//
+// SIGPROF is raised by ITIMER_PROF at the frequency, and the handler records the stack
+// of the interrupted thread, with the code of the task running on it, into a lock-free
+// ring. a background thread aggregates the samples by minutes and keeps the last
+// window_minutes of them, so a cpu spike can be looked into after it happened.
+//
+// the handler only calls async-signal-safe functions: the stack is unwound by
+// gperftools, the same as its cpu profiler, which can't be used at the same time.
+class cpu_sampler : public utils::singleton<cpu_sampler>
+{
+public:
+    static const int MAX_DEPTH = 64;
+
+    struct stack
+    {
+        int task_code;
+        std::vector<uintptr_t> pcs; // the innermost first
+
+        bool operator==(const stack &r) const
+        {
+            return task_code == r.task_code && pcs == r.pcs;
+        }
+    };
+    struct stack_hash
+    {
+        size_t operator()(const stack &s) const;
+    };
+    typedef std::unordered_map<stack, uint64_t, stack_hash> stack_counts;
+
+    cpu_sampler();
+    ~cpu_sampler();
+
+    // frequency is the number of samples per cpu second, 0 to disable
+    void start(int frequency, int window_minutes);
+    void stop();
+
+    int frequency() const { return _frequency; }
+    uint64_t dropped_count() const { return _dropped_count.load(std::memory_order_relaxed); }
+
+    // the samples in the last minutes, including the samples not yet aggregated
+    stack_counts get_samples(int minutes);
+
+    // called in the signal handler
+    void on_sample(void *ucontext);
+
+private:
+    friend class cpu_sampler_test;
+
+    void aggregate_thread();
+    // user should hold _window_lock
+    void drain();
+
+    struct sample_slot
+    {
+        // EMPTY -> WRITING -> READY -> EMPTY
+        std::atomic<int> state;
+        int task_code;
+        int depth;
+        uintptr_t pcs[MAX_DEPTH];
+    };
+    static const int EMPTY = 0;
+    static const int WRITING = 1;
+    static const int READY = 2;
+    static const size_t SLOT_COUNT = 4096;
+
+    int _frequency;
+    int _window_minutes;
+
+    std::unique_ptr<sample_slot[]> _slots;
+    std::atomic<uint64_t> _write_index;
+    uint64_t _read_index;
+    // the index found not ready in the last drain, skipped if still not ready
+    uint64_t _stalled_index;
+    std::atomic<uint64_t> _dropped_count;
+
+    std::mutex _window_lock;
+    // (minute, samples) of the last minutes, the latest last
+    std::deque<std::pair<uint64_t, stack_counts>> _window;
+
+    std::mutex _wakeup_lock;
+    std::condition_variable _wakeup;
+    bool _stopped;
+    std::thread _aggregate_thread;
+};
+
+} // namespace dsn
+
+#endif // DSN_ENABLE_GPERF
@@ -9,6 +9,8 @@
 #include "http_message_parser.h"
 #include "root_http_service.h"
 #include "pprof_http_service.h"
+#include "tracing_http_service.h"
+#include "metrics_http_service.h"
 
 namespace dsn {
 
@@ -37,6 +39,8 @@ http_server::http_server() : serverlet<http_server>("http_server")
 
     // add builtin services
     add_service(new root_http_service());
+    add_service(new tracing_http_service());
+    add_service(new metrics_http_service());
 
 #ifdef DSN_ENABLE_GPERF
     add_service(new pprof_http_service());
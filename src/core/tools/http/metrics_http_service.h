@@ -0,0 +1,36 @@
+// Copyright (c) 2018, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/perf_counter/metric_registry.h>
+#include <dsn/tool-api/http_server.h>
+
+namespace dsn {
+
+class metrics_http_service : public http_service
+{
+public:
+    metrics_http_service()
+    {
+        // ip:port/metrics
+        register_handler("",
+                         std::bind(&metrics_http_service::prometheus_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2));
+    }
+
+    std::string path() const override { return "metrics"; }
+
+    // the labeled metrics in the prometheus text format
+    void prometheus_handler(const http_request &req, http_response &resp)
+    {
+        resp.body = metric_registry::instance().to_prometheus_text();
+        resp.content_type = "text/plain; version=0.0.4";
+        resp.status_code = http_status_code::ok;
+    }
+};
+
+} // namespace dsn
@@ -18,8 +18,10 @@
 
 #ifdef DSN_ENABLE_GPERF
 
+#include <cinttypes>
 #include <cstdlib>
 #include <chrono>
+#include <fstream>
 
 #include "pprof_http_service.h"
 
@@ -257,27 +259,31 @@ static void load_symbols()
     ddebug("Loaded all symbols in %zdms", tm.m_elapsed());
 }
 
+// return nullptr if the symbol of the address is unknown
+static const std::string *find_symbol(uintptr_t addr)
+{
+    symbol_map_t::const_iterator it = symbol_map.lower_bound(addr);
+    if (it == symbol_map.end() || it->first != addr) {
+        if (it == symbol_map.begin()) {
+            return nullptr;
+        }
+        --it;
+    }
+    return it->second.empty() ? nullptr : &it->second;
+}
+
 static void find_symbols(std::string *out, std::vector<uintptr_t> &addr_list)
 {
     char buf[32];
     for (size_t i = 0; i < addr_list.size(); ++i) {
         int len = snprintf(buf, sizeof(buf), "0x%08lx\t", addr_list[i]);
         out->append(buf, static_cast<size_t>(len));
-        symbol_map_t::const_iterator it = symbol_map.lower_bound(addr_list[i]);
-        if (it == symbol_map.end() || it->first != addr_list[i]) {
-            if (it != symbol_map.begin()) {
-                --it;
-            } else {
-                len = snprintf(buf, sizeof(buf), "0x%08lx\n", addr_list[i]);
-                out->append(buf, static_cast<size_t>(len));
-                continue;
-            }
-        }
-        if (it->second.empty()) {
+        const std::string *symbol = find_symbol(addr_list[i]);
+        if (symbol == nullptr) {
             len = snprintf(buf, sizeof(buf), "0x%08lx\n", addr_list[i]);
             out->append(buf, static_cast<size_t>(len));
         } else {
-            out->append(it->second);
+            out->append(*symbol);
             out->push_back('\n');
         }
     }
@@ -406,6 +412,111 @@ void pprof_http_service::growth_handler(const http_request &req, http_response &
     malloc_ext->GetHeapGrowthStacks(&resp.body);
 }
 
+//                                //
+// == ip:port/pprof/continuous == //
+//                                //
+
+int pprof_http_service::get_minutes(const http_request &req) const
+{
+    std::string url = req.full_url.to_string();
+    size_t pos = url.find("minutes=");
+    int32_t minutes = 0;
+    if (pos == std::string::npos) {
+        return _sampling_window_minutes;
+    }
+    pos += strlen("minutes=");
+    size_t end = url.find('&', pos);
+    if (!buf2int32(string_view(url.data() + pos,
+                               (end == std::string::npos ? url.size() : end) - pos),
+                   minutes) ||
+        minutes <= 0) {
+        return _sampling_window_minutes;
+    }
+    return std::min(minutes, _sampling_window_minutes);
+}
+
+static void append_word(std::string &out, uintptr_t word)
+{
+    out.append(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+void pprof_http_service::continuous_handler(const http_request &req, http_response &resp)
+{
+    cpu_sampler &sampler = cpu_sampler::instance();
+    if (sampler.frequency() <= 0) {
+        resp.status_code = http_status_code::not_found;
+        resp.body = "cpu sampler is disabled by [core] cpu_sampling_frequency";
+        return;
+    }
+    cpu_sampler::stack_counts samples = sampler.get_samples(get_minutes(req));
+
+    // the legacy cpu profile format, see https://github.com/gperftools/gperftools/blob/
+    // master/docs/cpuprofile-fileformat.html, the symbols are resolved by pprof/symbol
+    std::string &out = resp.body;
+    // header: count, words of the header, version, sampling period in us, padding
+    append_word(out, 0);
+    append_word(out, 3);
+    append_word(out, 0);
+    append_word(out, static_cast<uintptr_t>(1000000 / sampler.frequency()));
+    append_word(out, 0);
+    for (const auto &kv : samples) {
+        append_word(out, kv.second);
+        append_word(out, kv.first.pcs.size());
+        for (uintptr_t pc : kv.first.pcs) {
+            append_word(out, pc);
+        }
+    }
+    // trailer
+    append_word(out, 0);
+    append_word(out, 1);
+    append_word(out, 0);
+
+    std::ifstream maps("/proc/self/maps");
+    std::stringstream ss;
+    ss << maps.rdbuf();
+    out.append(ss.str());
+
+    resp.content_type = "application/octet-stream";
+    resp.status_code = http_status_code::ok;
+}
+
+//                                //
+// == ip:port/pprof/flamegraph == //
+//                                //
+
+void pprof_http_service::flamegraph_handler(const http_request &req, http_response &resp)
+{
+    cpu_sampler &sampler = cpu_sampler::instance();
+    if (sampler.frequency() <= 0) {
+        resp.status_code = http_status_code::not_found;
+        resp.body = "cpu sampler is disabled by [core] cpu_sampling_frequency";
+        return;
+    }
+    cpu_sampler::stack_counts samples = sampler.get_samples(get_minutes(req));
+    pthread_once(&s_load_symbolmap_once, load_symbols);
+
+    // one line per stack: "task_code;outermost;...;innermost count"
+    std::string &out = resp.body;
+    char buf[32];
+    for (const auto &kv : samples) {
+        out.append(task_code(kv.first.task_code).to_string());
+        for (auto it = kv.first.pcs.rbegin(); it != kv.first.pcs.rend(); ++it) {
+            out.push_back(';');
+            const std::string *symbol = find_symbol(*it);
+            if (symbol == nullptr) {
+                int len = snprintf(buf, sizeof(buf), "0x%08lx", *it);
+                out.append(buf, static_cast<size_t>(len));
+            } else {
+                out.append(*symbol);
+            }
+        }
+        int len = snprintf(buf, sizeof(buf), " %" PRIu64 "\n", kv.second);
+        out.append(buf, static_cast<size_t>(len));
+    }
+    resp.content_type = "text/plain";
+    resp.status_code = http_status_code::ok;
+}
+
 } // namespace dsn
 
 #endif // DSN_ENABLE_GPERF
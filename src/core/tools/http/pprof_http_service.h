@@ -7,6 +7,9 @@
 #ifdef DSN_ENABLE_GPERF
 
 #include <dsn/tool-api/http_server.h>
+#include <dsn/utility/config_api.h>
+
+#include "cpu_sampler.h"
 
 namespace dsn {
 
@@ -42,6 +45,32 @@ public:
                                    this,
                                    std::placeholders::_1,
                                    std::placeholders::_2));
+
+        // ip:port/pprof/continuous?minutes=N
+        register_handler("continuous",
+                         std::bind(&pprof_http_service::continuous_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2));
+
+        // ip:port/pprof/flamegraph?minutes=N
+        register_handler("flamegraph",
+                         std::bind(&pprof_http_service::flamegraph_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2));
+
+        _sampling_window_minutes = (int)dsn_config_get_value_uint64(
+            "core",
+            "cpu_sampling_window_minutes",
+            10,
+            "the minutes of the cpu samples kept for pprof/continuous and pprof/flamegraph");
+        int frequency = (int)dsn_config_get_value_uint64(
+            "core",
+            "cpu_sampling_frequency",
+            19,
+            "the cpu samples per second of the always-on cpu sampler, 0 to disable");
+        cpu_sampler::instance().start(frequency, _sampling_window_minutes);
     }
 
     std::string path() const override { return "pprof"; }
@@ -53,6 +82,21 @@ public:
     void cmdline_handler(const http_request &req, http_response &resp);
 
     void growth_handler(const http_request &req, http_response &resp);
+
+    // the cpu profile of the last minutes by the always-on sampler, in the format of
+    // the gperftools cpu profiler
+    void continuous_handler(const http_request &req, http_response &resp);
+
+    // the same samples as pprof/continuous, in the folded format of FlameGraph, with
+    // the task code as the root frame
+    void flamegraph_handler(const http_request &req, http_response &resp);
+
+private:
+    friend class cpu_sampler_test;
+
+    int get_minutes(const http_request &req) const;
+
+    int _sampling_window_minutes;
 };
 
 } // namespace dsn
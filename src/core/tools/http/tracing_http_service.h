@@ -0,0 +1,36 @@
+// Copyright (c) 2018, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/tool-api/http_server.h>
+#include <dsn/tool-api/tracing.h>
+
+namespace dsn {
+
+class tracing_http_service : public http_service
+{
+public:
+    tracing_http_service()
+    {
+        // ip:port/tracing/chrome
+        register_handler("chrome",
+                         std::bind(&tracing_http_service::chrome_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2));
+    }
+
+    std::string path() const override { return "tracing"; }
+
+    // the recent sampled spans of this process, in the chrome trace format
+    void chrome_handler(const http_request &req, http_response &resp)
+    {
+        resp.body = tracing::dump_chrome_trace();
+        resp.content_type = "application/json";
+        resp.status_code = http_status_code::ok;
+    }
+};
+
+} // namespace dsn
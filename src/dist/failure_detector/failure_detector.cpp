@@ -35,12 +35,91 @@
 
 #include <dsn/dist/failure_detector.h>
 #include <dsn/tool-api/command_manager.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <ctime>
 
 namespace dsn {
 namespace fd {
 
+// the intervals of beacon acks may be very stable, so a floor of the standard deviation
+// is needed to tolerate the occasional delays
+static const double PHI_ACCRUAL_MIN_STDDEV_MS = 100.0;
+// the lease is adapted only if there are enough samples
+static const size_t PHI_ACCRUAL_MIN_SAMPLES = 10;
+
+static double phi_of(double elapsed_ms, double mean, double stddev)
+{
+    // the logistic approximation of the normal cdf, which is also used by cassandra and akka
+    double y = (elapsed_ms - mean) / stddev;
+    double e = std::exp(-y * (1.5976 + 0.070566 * y * y));
+    if (elapsed_ms > mean)
+        return -std::log10(e / (1.0 + e));
+    else
+        return -std::log10(1.0 - 1.0 / (1.0 + e));
+}
+
+void phi_accrual_window::add(uint64_t interval_ms)
+{
+    double v = static_cast<double>(interval_ms);
+    _intervals.push_back(interval_ms);
+    _sum += v;
+    _square_sum += v * v;
+    if (_intervals.size() > _capacity) {
+        double front = static_cast<double>(_intervals.front());
+        _intervals.pop_front();
+        _sum -= front;
+        _square_sum -= front * front;
+    }
+}
+
+void phi_accrual_window::clear()
+{
+    _intervals.clear();
+    _sum = 0;
+    _square_sum = 0;
+}
+
+void phi_accrual_window::get_distribution(/*out*/ double &mean, /*out*/ double &stddev) const
+{
+    double n = static_cast<double>(_intervals.size());
+    mean = _sum / n;
+    double variance = _square_sum / n - mean * mean;
+    stddev = std::max(std::sqrt(std::max(variance, 0.0)), PHI_ACCRUAL_MIN_STDDEV_MS);
+}
+
+double phi_accrual_window::phi(uint64_t elapsed_ms) const
+{
+    if (_intervals.empty())
+        return 0.0;
+
+    double mean, stddev;
+    get_distribution(mean, stddev);
+    return phi_of(static_cast<double>(elapsed_ms), mean, stddev);
+}
+
+uint64_t phi_accrual_window::elapsed_for_phi(double threshold) const
+{
+    if (_intervals.empty())
+        return 0;
+
+    double mean, stddev;
+    get_distribution(mean, stddev);
+
+    // phi is monotonically increasing, and is far beyond any sane threshold at mean + 64 stddev
+    double low = 0.0;
+    double high = mean + 64 * stddev;
+    for (int i = 0; i < 64 && high - low > 0.5; ++i) {
+        double mid = (low + high) / 2;
+        if (phi_of(mid, mean, stddev) >= threshold)
+            high = mid;
+        else
+            low = mid;
+    }
+    return static_cast<uint64_t>(std::ceil(high));
+}
+
 failure_detector::failure_detector()
 {
     dsn::threadpool_code pool = task_spec::get(LPC_BEACON_CHECK.code())->pool_code;
@@ -54,6 +133,10 @@ failure_detector::failure_detector()
         "failure detector beacon fail count in the recent period");
 
     _is_started = false;
+
+    _phi_accrual_enabled = false;
+    _phi_threshold = 0;
+    _min_lease_milliseconds = 0;
 }
 
 void failure_detector::register_ctrl_commands()
@@ -73,13 +156,27 @@ error_code failure_detector::start(uint32_t check_interval_seconds,
                                    uint32_t grace_seconds,
                                    bool use_allow_list)
 {
-    _check_interval_milliseconds = check_interval_seconds * 1000;
-    _beacon_interval_milliseconds = beacon_interval_seconds * 1000;
+    return start_ms(check_interval_seconds * 1000,
+                    beacon_interval_seconds * 1000,
+                    lease_seconds * 1000,
+                    grace_seconds * 1000,
+                    use_allow_list);
+}
+
+error_code failure_detector::start_ms(uint32_t check_interval_ms,
+                                      uint32_t beacon_interval_ms,
+                                      uint32_t lease_ms,
+                                      uint32_t grace_ms,
+                                      bool use_allow_list)
+{
+    _check_interval_milliseconds = check_interval_ms;
+    _beacon_interval_milliseconds = beacon_interval_ms;
     // here we set beacon timeout less than beacon interval in order to switch master
     // immediately once the last beacon fails, to make failure detection more robust.
     _beacon_timeout_milliseconds = _beacon_interval_milliseconds * 2 / 3;
-    _lease_milliseconds = lease_seconds * 1000;
-    _grace_milliseconds = grace_seconds * 1000;
+    _lease_milliseconds = lease_ms;
+    _grace_milliseconds = grace_ms;
+    _min_lease_milliseconds = std::min(_min_lease_milliseconds, _lease_milliseconds);
 
     _use_allow_list = use_allow_list;
 
@@ -97,6 +194,14 @@ error_code failure_detector::start(uint32_t check_interval_seconds,
     return ERR_OK;
 }
 
+void failure_detector::enable_phi_accrual(double phi_threshold, uint32_t min_lease_ms)
+{
+    dassert(!_is_started, "phi-accrual should be enabled before FD is started");
+    _phi_accrual_enabled = true;
+    _phi_threshold = phi_threshold;
+    _min_lease_milliseconds = min_lease_ms;
+}
+
 error_code failure_detector::stop()
 {
     if (_is_started == false) {
@@ -132,7 +237,7 @@ void failure_detector::register_master(::dsn::rpc_address target)
 
     zauto_lock l(_lock);
 
-    master_record record(target, now);
+    master_record record(target, now, _lease_milliseconds);
 
     auto ret = _masters.insert(std::make_pair(target, record));
     if (ret.second) {
@@ -243,7 +348,7 @@ void failure_detector::check_all_records()
              */
             if (record.is_alive &&
                 now + _check_interval_milliseconds - record.last_send_time_for_beacon_with_ack >
-                    _lease_milliseconds) {
+                    record.lease_ms) {
                 expire.push_back(record.node);
                 record.is_alive = false;
 
@@ -275,7 +380,7 @@ void failure_detector::check_all_records()
             worker_record &record = itq->second;
 
             if (record.is_alive != false &&
-                now - record.last_beacon_recv_time > _grace_milliseconds) {
+                now - record.last_beacon_recv_time > get_grace_ms(record)) {
                 expire.push_back(record.node);
                 record.is_alive = false;
 
@@ -363,7 +468,7 @@ void failure_detector::on_ping_internal(const beacon_msg &beacon, /*out*/ beacon
         // create new entry for node
         worker_record record(node, now);
         record.is_alive = true;
-        _workers.insert(std::make_pair(node, record));
+        itr = _workers.insert(std::make_pair(node, record)).first;
 
         report(node, false, true);
         on_worker_connected(node);
@@ -373,11 +478,23 @@ void failure_detector::on_ping_internal(const beacon_msg &beacon, /*out*/ beacon
 
         if (itr->second.is_alive == false) {
             itr->second.is_alive = true;
+            // the worker may have restarted, whose beacons can't be compared with the old ones
+            itr->second.lease_beacon_time = 0;
 
             report(node, false, true);
             on_worker_connected(node);
         }
     }
+
+    if (beacon.__isset.lease_ms) {
+        worker_record &record = itr->second;
+        // the beacons may be delivered out of order
+        if (beacon.time > record.lease_beacon_time) {
+            record.lease_ms = static_cast<uint64_t>(beacon.lease_ms);
+            record.lease_beacon_time = beacon.time;
+        }
+        ack.__set_lease_ms(static_cast<int64_t>(record.lease_ms));
+    }
 }
 
 void failure_detector::on_ping(const beacon_msg &beacon, ::dsn::rpc_replier<beacon_ack> &reply)
@@ -456,8 +573,12 @@ bool failure_detector::end_ping_internal(::dsn::error_code err, const beacon_ack
     record.last_send_time_for_beacon_with_ack = beacon_send_time;
     record.rejected = false;
 
+    if (_phi_accrual_enabled) {
+        update_lease(record, ack);
+    }
+
     if (record.is_alive == false &&
-        now - record.last_send_time_for_beacon_with_ack <= _lease_milliseconds) {
+        now - record.last_send_time_for_beacon_with_ack <= record.lease_ms) {
         // report master connected
         report(node, true, true);
         itr->second.is_alive = true;
@@ -467,6 +588,123 @@ bool failure_detector::end_ping_internal(::dsn::error_code err, const beacon_ack
     return true;
 }
 
+void failure_detector::update_lease(master_record &record, const beacon_ack &ack)
+{
+    /*
+     * the caller of the update_lease should lock necessarily!!!
+     */
+    uint64_t beacon_time = static_cast<uint64_t>(ack.time);
+    if (ack.__isset.lease_ms && beacon_time >= record.announce_time) {
+        // the beacon carried the announced lease, which is now recorded by the master
+        record.lease_ms =
+            std::min(record.announced_lease_ms, static_cast<uint64_t>(ack.lease_ms));
+    }
+
+    // the intervals when the master is disconnected are not the jitter to tolerate
+    if (record.is_alive && record.last_acked_beacon_time != 0 &&
+        beacon_time > record.last_acked_beacon_time) {
+        record.ack_intervals.add(beacon_time - record.last_acked_beacon_time);
+    }
+    record.last_acked_beacon_time = beacon_time;
+
+    if (record.ack_intervals.size() < PHI_ACCRUAL_MIN_SAMPLES) {
+        return;
+    }
+
+    uint64_t lease = get_adapted_lease_ms(record.ack_intervals);
+
+    // small changes are ignored to keep the announced lease stable
+    if (lease * 10 >= record.announced_lease_ms * 9 &&
+        lease * 10 <= record.announced_lease_ms * 11) {
+        return;
+    }
+
+    ddebug("adapt lease of master[%s] from %" PRIu64 " ms to %" PRIu64 " ms, applied %" PRIu64
+           " ms",
+           record.node.to_string(),
+           record.announced_lease_ms,
+           lease,
+           std::min(lease, record.lease_ms));
+
+    // a shorter lease is applied immediately, but a longer one is applied only after the master
+    // has recorded it, see end_ping_internal
+    record.announced_lease_ms = lease;
+    record.announce_time = dsn_now_ms() + 1;
+    record.lease_ms = std::min(record.lease_ms, lease);
+}
+
+uint64_t failure_detector::get_adapted_lease_ms(const phi_accrual_window &intervals) const
+{
+    // check_all_records() expires the lease up to a check interval in advance, and the ack of
+    // a beacon may arrive up to a beacon timeout after it is sent
+    uint64_t lease = intervals.elapsed_for_phi(_phi_threshold) + _check_interval_milliseconds +
+                     _beacon_timeout_milliseconds;
+
+    // never shorter than the time between two checks across a beacon which is acked in time
+    uint64_t min_lease = static_cast<uint64_t>(_beacon_interval_milliseconds) +
+                         _check_interval_milliseconds;
+    min_lease = std::max(min_lease, static_cast<uint64_t>(_min_lease_milliseconds));
+    lease = std::max(lease, min_lease);
+    return std::min(lease, static_cast<uint64_t>(_lease_milliseconds));
+}
+
+uint64_t failure_detector::get_grace_ms(const worker_record &record) const
+{
+    if (record.lease_ms == 0) {
+        return _grace_milliseconds;
+    }
+
+    // keep the same margin between the lease and the grace
+    uint64_t margin =
+        _grace_milliseconds > _lease_milliseconds ? _grace_milliseconds - _lease_milliseconds : 0;
+    return record.lease_ms + margin;
+}
+
+uint32_t failure_detector::get_master_lease_ms(::dsn::rpc_address node) const
+{
+    zauto_lock l(_lock);
+    auto it = _masters.find(node);
+    return it != _masters.end() ? static_cast<uint32_t>(it->second.lease_ms) : 0;
+}
+
+uint32_t failure_detector::get_worker_grace_ms(::dsn::rpc_address node) const
+{
+    zauto_lock l(_lock);
+    auto it = _workers.find(node);
+    return it != _workers.end() ? static_cast<uint32_t>(get_grace_ms(it->second)) : 0;
+}
+
+void failure_detector::record_master_traffic(::dsn::rpc_address node, uint64_t send_time)
+{
+    zauto_lock l(_lock);
+    auto it = _masters.find(node);
+    // the master never counts the traffic of a worker it has declared dead,
+    // so a disconnected master must be reconnected by the beacons
+    if (it == _masters.end() || !it->second.is_alive) {
+        return;
+    }
+
+    if (is_time_greater_than(send_time, it->second.last_send_time_for_beacon_with_ack)) {
+        it->second.last_send_time_for_beacon_with_ack = send_time;
+    }
+}
+
+void failure_detector::record_worker_traffic(::dsn::rpc_address node)
+{
+    /*
+     * callers should use the fd::_lock necessarily
+     */
+    auto it = _workers.find(node);
+    if (it == _workers.end() || !it->second.is_alive) {
+        return;
+    }
+
+    uint64_t now = dsn_now_ms();
+    if (is_time_greater_than(now, it->second.last_beacon_recv_time)) {
+        it->second.last_beacon_recv_time = now;
+    }
+}
+
 bool failure_detector::unregister_master(::dsn::rpc_address node)
 {
     zauto_lock l(_lock);
@@ -556,6 +794,13 @@ void failure_detector::send_beacon(::dsn::rpc_address target, uint64_t time)
     beacon.from_addr = dsn_primary_address();
     beacon.to_addr = target;
     beacon.__set_start_time(static_cast<int64_t>(dsn::utils::process_start_millis()));
+    if (_phi_accrual_enabled) {
+        zauto_lock l(_lock);
+        auto it = _masters.find(target);
+        if (it != _masters.end()) {
+            beacon.__set_lease_ms(static_cast<int64_t>(it->second.announced_lease_ms));
+        }
+    }
 
     dinfo("send ping message, from[%s], to[%s], time[%" PRId64 "]",
           beacon.from_addr.to_string(),
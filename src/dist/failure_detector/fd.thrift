@@ -8,6 +8,7 @@ struct beacon_msg
     2: dsn.rpc_address from_addr;
     3: dsn.rpc_address to_addr;
     4: optional i64 start_time;
+    5: optional i64 lease_ms;
 }
 
 struct beacon_ack
@@ -17,6 +18,7 @@ struct beacon_ack
     3: dsn.rpc_address primary_node;
     4: bool is_master;
     5: bool allowed;
+    6: optional i64 lease_ms;
 }
 
 struct config_master_message
@@ -28,6 +28,12 @@ void beacon_msg::__set_start_time(const int64_t val)
     __isset.start_time = true;
 }
 
+void beacon_msg::__set_lease_ms(const int64_t val)
+{
+    this->lease_ms = val;
+    __isset.lease_ms = true;
+}
+
 uint32_t beacon_msg::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -79,6 +85,14 @@ uint32_t beacon_msg::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->lease_ms);
+                this->__isset.lease_ms = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -114,6 +128,11 @@ uint32_t beacon_msg::write(::apache::thrift::protocol::TProtocol *oprot) const
         xfer += oprot->writeI64(this->start_time);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.lease_ms) {
+        xfer += oprot->writeFieldBegin("lease_ms", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->lease_ms);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -126,6 +145,7 @@ void swap(beacon_msg &a, beacon_msg &b)
     swap(a.from_addr, b.from_addr);
     swap(a.to_addr, b.to_addr);
     swap(a.start_time, b.start_time);
+    swap(a.lease_ms, b.lease_ms);
     swap(a.__isset, b.__isset);
 }
 
@@ -135,6 +155,7 @@ beacon_msg::beacon_msg(const beacon_msg &other0)
     from_addr = other0.from_addr;
     to_addr = other0.to_addr;
     start_time = other0.start_time;
+    lease_ms = other0.lease_ms;
     __isset = other0.__isset;
 }
 beacon_msg::beacon_msg(beacon_msg &&other1)
@@ -143,6 +164,7 @@ beacon_msg::beacon_msg(beacon_msg &&other1)
     from_addr = std::move(other1.from_addr);
     to_addr = std::move(other1.to_addr);
     start_time = std::move(other1.start_time);
+    lease_ms = std::move(other1.lease_ms);
     __isset = std::move(other1.__isset);
 }
 beacon_msg &beacon_msg::operator=(const beacon_msg &other2)
@@ -151,6 +173,7 @@ beacon_msg &beacon_msg::operator=(const beacon_msg &other2)
     from_addr = other2.from_addr;
     to_addr = other2.to_addr;
     start_time = other2.start_time;
+    lease_ms = other2.lease_ms;
     __isset = other2.__isset;
     return *this;
 }
@@ -160,6 +183,7 @@ beacon_msg &beacon_msg::operator=(beacon_msg &&other3)
     from_addr = std::move(other3.from_addr);
     to_addr = std::move(other3.to_addr);
     start_time = std::move(other3.start_time);
+    lease_ms = std::move(other3.lease_ms);
     __isset = std::move(other3.__isset);
     return *this;
 }
@@ -175,6 +199,9 @@ void beacon_msg::printTo(std::ostream &out) const
     out << ", "
         << "start_time=";
     (__isset.start_time ? (out << to_string(start_time)) : (out << "<null>"));
+    out << ", "
+        << "lease_ms=";
+    (__isset.lease_ms ? (out << to_string(lease_ms)) : (out << "<null>"));
     out << ")";
 }
 
@@ -190,6 +217,12 @@ void beacon_ack::__set_is_master(const bool val) { this->is_master = val; }
 
 void beacon_ack::__set_allowed(const bool val) { this->allowed = val; }
 
+void beacon_ack::__set_lease_ms(const int64_t val)
+{
+    this->lease_ms = val;
+    __isset.lease_ms = true;
+}
+
 uint32_t beacon_ack::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -249,6 +282,14 @@ uint32_t beacon_ack::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 6:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->lease_ms);
+                this->__isset.lease_ms = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -287,6 +328,11 @@ uint32_t beacon_ack::write(::apache::thrift::protocol::TProtocol *oprot) const
     xfer += oprot->writeBool(this->allowed);
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.lease_ms) {
+        xfer += oprot->writeFieldBegin("lease_ms", ::apache::thrift::protocol::T_I64, 6);
+        xfer += oprot->writeI64(this->lease_ms);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -300,6 +346,7 @@ void swap(beacon_ack &a, beacon_ack &b)
     swap(a.primary_node, b.primary_node);
     swap(a.is_master, b.is_master);
     swap(a.allowed, b.allowed);
+    swap(a.lease_ms, b.lease_ms);
     swap(a.__isset, b.__isset);
 }
 
@@ -310,6 +357,7 @@ beacon_ack::beacon_ack(const beacon_ack &other4)
     primary_node = other4.primary_node;
     is_master = other4.is_master;
     allowed = other4.allowed;
+    lease_ms = other4.lease_ms;
     __isset = other4.__isset;
 }
 beacon_ack::beacon_ack(beacon_ack &&other5)
@@ -319,6 +367,7 @@ beacon_ack::beacon_ack(beacon_ack &&other5)
     primary_node = std::move(other5.primary_node);
     is_master = std::move(other5.is_master);
     allowed = std::move(other5.allowed);
+    lease_ms = std::move(other5.lease_ms);
     __isset = std::move(other5.__isset);
 }
 beacon_ack &beacon_ack::operator=(const beacon_ack &other6)
@@ -328,6 +377,7 @@ beacon_ack &beacon_ack::operator=(const beacon_ack &other6)
     primary_node = other6.primary_node;
     is_master = other6.is_master;
     allowed = other6.allowed;
+    lease_ms = other6.lease_ms;
     __isset = other6.__isset;
     return *this;
 }
@@ -338,6 +388,7 @@ beacon_ack &beacon_ack::operator=(beacon_ack &&other7)
     primary_node = std::move(other7.primary_node);
     is_master = std::move(other7.is_master);
     allowed = std::move(other7.allowed);
+    lease_ms = std::move(other7.lease_ms);
     __isset = std::move(other7.__isset);
     return *this;
 }
@@ -354,6 +405,9 @@ void beacon_ack::printTo(std::ostream &out) const
         << "is_master=" << to_string(is_master);
     out << ", "
         << "allowed=" << to_string(allowed);
+    out << ", "
+        << "lease_ms=";
+    (__isset.lease_ms ? (out << to_string(lease_ms)) : (out << "<null>"));
     out << ")";
 }
 
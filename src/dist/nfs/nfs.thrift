@@ -36,6 +36,9 @@ struct get_file_size_response
     1: i32 error;
     2: list<string> file_list;
     3: list<i64> size_list;
+    // the modification time of the files in nanoseconds, to tell whether
+    // a file is changed since the last interrupted copy
+    4: optional list<i64> mtime_list;
 }
 
 service nfs
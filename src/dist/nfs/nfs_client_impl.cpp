@@ -32,7 +32,9 @@
  *     xxxx-xx-xx, author, first version
  *     xxxx-xx-xx, author, fix bug about xxx
  */
+#include <sys/stat.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/crc.h>
 #include <queue>
 #include "nfs_client_impl.h"
 
@@ -45,12 +47,23 @@ nfs_client_impl::nfs_client_impl(nfs_opts &opts)
       _concurrent_local_write_count(0),
       _buffered_local_write_count(0),
       _copy_requests_low(_opts.max_file_copy_request_count_per_file),
-      _high_priority_remaining_time(_opts.high_priority_speed_rate)
+      _high_priority_remaining_time(_opts.high_priority_speed_rate),
+      _node_throttle(_opts.max_copy_rate_megabytes_per_node << 20)
 {
     _recent_copy_data_size.init_app_counter("eon.nfs_client",
                                             "recent_copy_data_size",
                                             COUNTER_TYPE_VOLATILE_NUMBER,
                                             "nfs client copy data size in the recent period");
+    _recent_copy_skip_data_size.init_app_counter(
+        "eon.nfs_client",
+        "recent_copy_skip_data_size",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "nfs client data size skipped by resuming copy in the recent period");
+    _recent_copy_throttling_delay_count.init_app_counter(
+        "eon.nfs_client",
+        "recent_copy_throttling_delay_count",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "nfs client copy request count delayed by rate limit in the recent period");
     _recent_copy_fail_count.init_app_counter(
         "eon.nfs_client",
         "recent_copy_fail_count",
@@ -114,6 +127,8 @@ void nfs_client_impl::end_get_file_size(::dsn::error_code err,
         return;
     }
 
+    ureq->disk_throttle = get_disk_throttle(ureq->file_size_req.dst_dir);
+
     std::deque<copy_request_ex_ptr> copy_requests;
     ureq->file_contexts.resize(resp.size_list.size());
     for (size_t i = 0; i < resp.size_list.size(); i++) // file list
@@ -121,6 +136,19 @@ void nfs_client_impl::end_get_file_size(::dsn::error_code err,
         file_context_ptr filec(new file_context(ureq, resp.file_list[i], resp.size_list[i]));
         ureq->file_contexts[i] = filec;
 
+        if (_opts.enable_copy_resume) {
+            std::string file_path = dsn::utils::filesystem::path_combine(
+                ureq->file_size_req.dst_dir, filec->file_name);
+            std::string path = dsn::utils::filesystem::remove_file_name(file_path.c_str());
+            // the remote of an old version doesn't report the mtime, then the manifest
+            // is always reset as the remote file can't be identified
+            int64_t mtime = i < resp.mtime_list.size() ? resp.mtime_list[i] : 0;
+            filec->resumable =
+                dsn::utils::filesystem::create_directory(path) &&
+                filec->manifest.open(
+                    file_path, filec->file_size, mtime, _opts.nfs_copy_block_bytes);
+        }
+
         // init copy requests
         uint64_t size = resp.size_list[i];
         uint64_t req_offset = 0;
@@ -136,6 +164,9 @@ void nfs_client_impl::end_get_file_size(::dsn::error_code err,
             req->offset = req_offset;
             req->size = req_size;
             req->is_last = (size <= req_size);
+            if (filec->resumable) {
+                req->verify_local = filec->manifest.get_recorded_crc(req->index, req->recorded_crc);
+            }
 
             filec->copy_requests.push_back(req);
             copy_requests.push_back(req);
@@ -213,39 +244,10 @@ void nfs_client_impl::continue_copy()
             }
         }
 
-        {
-            zauto_lock l(req->lock);
-            const user_request_ptr &ureq = req->file_ctx->user_req;
-            if (req->is_valid) {
-                copy_request copy_req;
-                copy_req.source = ureq->file_size_req.source;
-                copy_req.file_name = req->file_ctx->file_name;
-                copy_req.offset = req->offset;
-                copy_req.size = req->size;
-                copy_req.dst_dir = ureq->file_size_req.dst_dir;
-                copy_req.source_dir = ureq->file_size_req.source_dir;
-                copy_req.overwrite = ureq->file_size_req.overwrite;
-                copy_req.is_last = req->is_last;
-                req->remote_copy_task = copy(copy_req,
-                                             [=](error_code err, copy_response &&resp) {
-                                                 end_copy(err, std::move(resp), req);
-                                                 // reset task to release memory quickly.
-                                                 // should do this after end_copy() done.
-                                                 if (req->is_ready_for_write) {
-                                                     ::dsn::task_ptr tsk;
-                                                     zauto_lock l(req->lock);
-                                                     tsk = std::move(req->remote_copy_task);
-                                                 }
-                                             },
-                                             std::chrono::milliseconds(_opts.rpc_timeout_ms),
-                                             0,
-                                             0,
-                                             0,
-                                             req->file_ctx->user_req->file_size_req.source);
-            } else {
-                --ureq->concurrent_copy_count;
-                --_concurrent_copy_request_count;
-            }
+        if (req->verify_local) {
+            verify_local_chunk(req);
+        } else {
+            throttle_remote_copy(req);
         }
 
         if (++_concurrent_copy_request_count > _opts.max_concurrent_remote_copy_requests) {
@@ -257,6 +259,71 @@ void nfs_client_impl::continue_copy()
     }
 }
 
+void nfs_client_impl::throttle_remote_copy(const copy_request_ex_ptr &reqc)
+{
+    uint64_t delay_ms = _node_throttle.consume(reqc->size);
+    token_bucket *disk_throttle = reqc->file_ctx->user_req->disk_throttle;
+    if (disk_throttle != nullptr) {
+        delay_ms = std::max(delay_ms, disk_throttle->consume(reqc->size));
+    }
+
+    if (delay_ms == 0) {
+        send_remote_copy(reqc);
+    } else {
+        _recent_copy_throttling_delay_count->increment();
+        tasking::enqueue(LPC_NFS_COPY_THROTTLING_DELAY,
+                         &_tracker,
+                         [this, reqc]() { send_remote_copy(reqc); },
+                         0,
+                         std::chrono::milliseconds(delay_ms));
+    }
+}
+
+void nfs_client_impl::send_remote_copy(const copy_request_ex_ptr &req)
+{
+    zauto_lock l(req->lock);
+    const user_request_ptr &ureq = req->file_ctx->user_req;
+    if (req->is_valid) {
+        copy_request copy_req;
+        copy_req.source = ureq->file_size_req.source;
+        copy_req.file_name = req->file_ctx->file_name;
+        copy_req.offset = req->offset;
+        copy_req.size = req->size;
+        copy_req.dst_dir = ureq->file_size_req.dst_dir;
+        copy_req.source_dir = ureq->file_size_req.source_dir;
+        copy_req.overwrite = ureq->file_size_req.overwrite;
+        copy_req.is_last = req->is_last;
+        req->remote_copy_task = copy(copy_req,
+                                     [=](error_code err, copy_response &&resp) {
+                                         end_copy(err, std::move(resp), req);
+                                         // reset task to release memory quickly.
+                                         // should do this after end_copy() done.
+                                         if (req->is_ready_for_write) {
+                                             ::dsn::task_ptr tsk;
+                                             zauto_lock l(req->lock);
+                                             tsk = std::move(req->remote_copy_task);
+                                         }
+                                     },
+                                     std::chrono::milliseconds(_opts.rpc_timeout_ms),
+                                     0,
+                                     0,
+                                     0,
+                                     req->file_ctx->user_req->file_size_req.source);
+    } else {
+        --ureq->concurrent_copy_count;
+        --_concurrent_copy_request_count;
+    }
+}
+
+void nfs_client_impl::put_back_copy_request(const copy_request_ex_ptr &reqc)
+{
+    zauto_lock l(_copy_requests_lock);
+    if (reqc->file_ctx->user_req->high_priority)
+        _copy_requests_high.push_front(reqc);
+    else
+        _copy_requests_low.push_retry(reqc);
+}
+
 void nfs_client_impl::end_copy(::dsn::error_code err,
                                const copy_response &resp,
                                const copy_request_ex_ptr &reqc)
@@ -287,11 +354,7 @@ void nfs_client_impl::end_copy(::dsn::error_code err,
                 reqc->retry_count--;
 
                 // put back into copy request queue
-                zauto_lock l(_copy_requests_lock);
-                if (fc->user_req->high_priority)
-                    _copy_requests_high.push_front(reqc);
-                else
-                    _copy_requests_low.push_retry(reqc);
+                put_back_copy_request(reqc);
             } else {
                 derror("{nfs_service} remote copy failed, source = %s, dir = %s, file = %s, "
                        "err = %s, retry_count = %d",
@@ -310,29 +373,18 @@ void nfs_client_impl::end_copy(::dsn::error_code err,
         _recent_copy_data_size->add(resp.size);
 
         reqc->response = resp;
+        if (fc->resumable) {
+            reqc->response_crc =
+                dsn::utils::crc32_calc(resp.file_content.data(), resp.file_content.length(), 0);
+        }
         reqc->is_ready_for_write = true;
 
-        // prepare write requests
-        std::deque<copy_request_ex_ptr> new_writes;
+        // chunks are written at their own offsets, so there is no need to wait for the
+        // preceding chunks, which lets multiple copy streams of a large file run in parallel.
         {
-            zauto_lock l(fc->user_req->user_req_lock);
-            if (!fc->user_req->is_finished && fc->current_write_index == reqc->index - 1) {
-                for (int i = reqc->index; i < (int)(fc->copy_requests.size()); i++) {
-                    if (fc->copy_requests[i]->is_ready_for_write) {
-                        fc->current_write_index++;
-                        new_writes.push_back(fc->copy_requests[i]);
-                    } else {
-                        break;
-                    }
-                }
-            }
-        }
-
-        // put write requests into queue
-        if (!new_writes.empty()) {
             zauto_lock l(_local_writes_lock);
-            _local_writes.insert(_local_writes.end(), new_writes.begin(), new_writes.end());
-            _buffered_local_write_count += new_writes.size();
+            _local_writes.push_back(reqc);
+            ++_buffered_local_write_count;
         }
     }
 
@@ -340,6 +392,119 @@ void nfs_client_impl::end_copy(::dsn::error_code err,
     continue_write();
 }
 
+void nfs_client_impl::verify_local_chunk(const copy_request_ex_ptr &reqc)
+{
+    const file_context_ptr &fc = reqc->file_ctx;
+    {
+        zauto_lock l(reqc->lock);
+        if (!reqc->is_valid) {
+            --fc->user_req->concurrent_copy_count;
+            --_concurrent_copy_request_count;
+            return;
+        }
+    }
+
+    if (!open_local_file(fc)) {
+        // the local file is unavailable, copy the chunk from remote
+        reqc->verify_local = false;
+        throttle_remote_copy(reqc);
+        return;
+    }
+
+    reqc->local_content = blob(dsn::utils::make_shared_array<char>(reqc->size), reqc->size);
+    file::read(fc->file_holder->file_handle,
+               const_cast<char *>(reqc->local_content.data()),
+               reqc->size,
+               reqc->offset,
+               LPC_NFS_READ,
+               &_tracker,
+               [this, reqc](error_code err, size_t sz) { end_verify_local_chunk(err, sz, reqc); });
+}
+
+void nfs_client_impl::end_verify_local_chunk(error_code err,
+                                             size_t sz,
+                                             const copy_request_ex_ptr &reqc)
+{
+    --_concurrent_copy_request_count;
+    --reqc->file_ctx->user_req->concurrent_copy_count;
+
+    const file_context_ptr &fc = reqc->file_ctx;
+    bool verified = (err == ERR_OK && sz == reqc->size &&
+                     dsn::utils::crc32_calc(reqc->local_content.data(), sz, 0) ==
+                         reqc->recorded_crc);
+    reqc->local_content = blob();
+    reqc->verify_local = false;
+
+    if (!verified) {
+        dwarn("{nfs_service} verify local chunk failed, copy it from remote, dir = %s, "
+              "file = %s, offset = %" PRIu64 ", err = %s",
+              fc->user_req->file_size_req.dst_dir.c_str(),
+              fc->file_name.c_str(),
+              reqc->offset,
+              err.to_string());
+        put_back_copy_request(reqc);
+    } else {
+        _recent_copy_skip_data_size->add(sz);
+        if (finish_segment(fc)) {
+            handle_completion(fc->user_req, ERR_OK);
+        }
+    }
+
+    continue_copy();
+}
+
+bool nfs_client_impl::open_local_file(const file_context_ptr &fc)
+{
+    if (fc->file_holder->file_handle) {
+        return true;
+    }
+
+    std::string file_path =
+        dsn::utils::filesystem::path_combine(fc->user_req->file_size_req.dst_dir, fc->file_name);
+    std::string path = dsn::utils::filesystem::remove_file_name(file_path.c_str());
+    if (!dsn::utils::filesystem::create_directory(path)) {
+        dassert(false, "create directory %s failed", path.c_str());
+    }
+
+    // double check
+    zauto_lock l(fc->user_req->user_req_lock);
+    if (!fc->file_holder->file_handle) {
+        fc->file_holder->file_handle =
+            file::open(file_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
+    }
+    if (!fc->file_holder->file_handle) {
+        derror("open file %s failed", file_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool nfs_client_impl::finish_segment(const file_context_ptr &fc)
+{
+    bool completed = false;
+    bool file_done = false;
+    {
+        file_wrapper_ptr temp_holder;
+        zauto_lock l(fc->user_req->user_req_lock);
+        if (!fc->user_req->is_finished &&
+            ++fc->finished_segments == (int)fc->copy_requests.size()) {
+            // release file to make it closed immediately after write done.
+            // we use temp_holder to make file closing out of lock.
+            temp_holder = std::move(fc->file_holder);
+            file_done = true;
+
+            if (++fc->user_req->finished_files == (int)fc->user_req->file_contexts.size()) {
+                completed = true;
+            }
+        }
+    }
+
+    if (file_done && fc->resumable) {
+        fc->manifest.remove();
+    }
+    return completed;
+}
+
 void nfs_client_impl::continue_write()
 {
     // check write quota
@@ -383,25 +548,8 @@ void nfs_client_impl::continue_write()
 
     // real write
     const file_context_ptr &fc = reqc->file_ctx;
-    std::string file_path =
-        dsn::utils::filesystem::path_combine(fc->user_req->file_size_req.dst_dir, fc->file_name);
-    std::string path = dsn::utils::filesystem::remove_file_name(file_path.c_str());
-    if (!dsn::utils::filesystem::create_directory(path)) {
-        dassert(false, "create directory %s failed", path.c_str());
-    }
-
-    if (!fc->file_holder->file_handle) {
-        // double check
-        zauto_lock l(fc->user_req->user_req_lock);
-        if (!fc->file_holder->file_handle) {
-            fc->file_holder->file_handle =
-                file::open(file_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
-        }
-    }
-
-    if (!fc->file_holder->file_handle) {
+    if (!open_local_file(fc)) {
         --_concurrent_local_write_count;
-        derror("open file %s failed", file_path.c_str());
         handle_completion(fc->user_req, ERR_FILE_OPERATION_FAILED);
     } else {
         zauto_lock l(reqc->lock);
@@ -450,18 +598,10 @@ void nfs_client_impl::end_write(error_code err, size_t sz, const copy_request_ex
     } else {
         _recent_write_data_size->add(sz);
 
-        file_wrapper_ptr temp_holder;
-        zauto_lock l(fc->user_req->user_req_lock);
-        if (!fc->user_req->is_finished &&
-            ++fc->finished_segments == (int)fc->copy_requests.size()) {
-            // release file to make it closed immediately after write done.
-            // we use temp_holder to make file closing out of lock.
-            temp_holder = std::move(fc->file_holder);
-
-            if (++fc->user_req->finished_files == (int)fc->user_req->file_contexts.size()) {
-                completed = true;
-            }
+        if (fc->resumable) {
+            fc->manifest.append(reqc->index, reqc->response_crc);
         }
+        completed = finish_segment(fc);
     }
 
     if (completed) {
@@ -502,5 +642,33 @@ void nfs_client_impl::handle_completion(const user_request_ptr &req, error_code
     // notify aio_task
     req->nfs_task->enqueue(err, err == ERR_OK ? total_size : 0);
 }
+
+token_bucket *nfs_client_impl::get_disk_throttle(const std::string &dir)
+{
+    if (_opts.max_copy_rate_megabytes_per_disk == 0) {
+        return nullptr;
+    }
+
+    // the destination dir may not be created yet, so we find the device of its nearest
+    // existing ancestor
+    std::string path = dir;
+    struct stat st;
+    while (::stat(path.c_str(), &st) != 0) {
+        std::string parent = dsn::utils::filesystem::remove_file_name(path);
+        if (parent.empty() || parent == path) {
+            dwarn("{nfs_service} can't find the device of %s, disk rate is not limited",
+                  dir.c_str());
+            return nullptr;
+        }
+        path = std::move(parent);
+    }
+
+    zauto_lock l(_disk_throttles_lock);
+    std::unique_ptr<token_bucket> &throttle = _disk_throttles[static_cast<uint64_t>(st.st_dev)];
+    if (throttle == nullptr) {
+        throttle.reset(new token_bucket(_opts.max_copy_rate_megabytes_per_disk << 20));
+    }
+    return throttle.get();
+}
 }
 }
@@ -35,12 +35,15 @@
 #pragma once
 #include <vector>
 #include <deque>
+#include <unordered_map>
 #include <dsn/tool-api/task_tracker.h>
 #include <dsn/tool-api/zlocks.h>
+#include <dsn/utility/token_bucket.h>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/dist/nfs_node.h>
 
 #include "nfs_client.h"
+#include "nfs_copy_manifest.h"
 
 namespace dsn {
 namespace service {
@@ -59,6 +62,10 @@ struct nfs_opts
     int max_retry_count_per_copy_request;
     int64_t rpc_timeout_ms;
 
+    bool enable_copy_resume;
+    uint64_t max_copy_rate_megabytes_per_node;
+    uint64_t max_copy_rate_megabytes_per_disk;
+
     void init()
     {
         nfs_copy_block_bytes =
@@ -104,6 +111,23 @@ struct nfs_opts
                                              10000,
                                              "rpc timeout in milliseconds for nfs copy, "
                                              "0 means use default timeout of rpc engine");
+        enable_copy_resume =
+            dsn_config_get_value_bool("nfs",
+                                      "enable_copy_resume",
+                                      true,
+                                      "whether to keep a per-file manifest on nfs client, so "
+                                      "an interrupted copy only fetches the missing chunks");
+        max_copy_rate_megabytes_per_node = dsn_config_get_value_uint64(
+            "nfs",
+            "max_copy_rate_megabytes_per_node",
+            0,
+            "max copy rate (MB/s) of all remote copies on nfs client, 0 means unlimited");
+        max_copy_rate_megabytes_per_disk = dsn_config_get_value_uint64(
+            "nfs",
+            "max_copy_rate_megabytes_per_disk",
+            0,
+            "max copy rate (MB/s) of remote copies into the same disk on nfs client, "
+            "0 means unlimited");
     }
 };
 
@@ -142,11 +166,16 @@ public:
         uint32_t size;
         bool is_last;
         copy_response response;
+        uint32_t response_crc;
         ::dsn::task_ptr remote_copy_task;
         ::dsn::task_ptr local_write_task;
         bool is_ready_for_write;
         bool is_valid;
         int retry_count;
+        // the chunk is recorded in the manifest, verify the local data before copying it
+        bool verify_local;
+        uint32_t recorded_crc;
+        blob local_content;
         zlock lock; // to protect is_valid
 
         copy_request_ex(const file_context_ptr &file, int idx, int try_count)
@@ -156,9 +185,12 @@ public:
             offset = 0;
             size = 0;
             is_last = false;
+            response_crc = 0;
             is_ready_for_write = false;
             is_valid = true;
             retry_count = try_count;
+            verify_local = false;
+            recorded_crc = 0;
         }
     };
 
@@ -170,18 +202,20 @@ public:
         uint64_t file_size;
 
         file_wrapper_ptr file_holder;
-        int current_write_index;
         int finished_segments;
         std::vector<copy_request_ex_ptr> copy_requests;
 
+        bool resumable;
+        nfs_copy_manifest manifest;
+
         file_context(const user_request_ptr &req, const std::string &file_nm, uint64_t sz)
         {
             user_req = req;
             file_name = file_nm;
             file_size = sz;
             file_holder = new file_wrapper();
-            current_write_index = -1;
             finished_segments = 0;
+            resumable = false;
         }
     };
 
@@ -192,6 +226,7 @@ public:
         bool high_priority;
         int low_queue_index;
         get_file_size_request file_size_req;
+        token_bucket *disk_throttle; // shared by copies into the same disk
         ::dsn::ref_ptr<aio_task> nfs_task;
         std::atomic<int> finished_files;
         std::atomic<int> concurrent_copy_count;
@@ -203,6 +238,7 @@ public:
         {
             high_priority = false;
             low_queue_index = -1;
+            disk_throttle = nullptr;
             finished_files = 0;
             concurrent_copy_count = 0;
             is_finished = false;
@@ -300,15 +336,34 @@ private:
 
     void continue_copy();
 
+    // throttled by node and disk copy rate, the request is sent after a delay if necessary
+    void throttle_remote_copy(const copy_request_ex_ptr &reqc);
+
+    void send_remote_copy(const copy_request_ex_ptr &reqc);
+
     void
     end_copy(::dsn::error_code err, const copy_response &resp, const copy_request_ex_ptr &reqc);
 
+    // read the chunk recorded in manifest from local file and check its crc
+    void verify_local_chunk(const copy_request_ex_ptr &reqc);
+
+    void end_verify_local_chunk(error_code err, size_t sz, const copy_request_ex_ptr &reqc);
+
+    void put_back_copy_request(const copy_request_ex_ptr &reqc);
+
+    bool open_local_file(const file_context_ptr &fc);
+
+    // returns true if all files of the user request are done
+    bool finish_segment(const file_context_ptr &fc);
+
     void continue_write();
 
     void end_write(error_code err, size_t sz, const copy_request_ex_ptr &reqc);
 
     void handle_completion(const user_request_ptr &req, error_code err);
 
+    token_bucket *get_disk_throttle(const std::string &dir);
+
 private:
     nfs_opts &_opts;
 
@@ -327,7 +382,14 @@ private:
     zlock _local_writes_lock;
     std::deque<copy_request_ex_ptr> _local_writes;
 
+    token_bucket _node_throttle;
+    zlock _disk_throttles_lock;
+    // device id -> token bucket for copies into this device
+    std::unordered_map<uint64_t, std::unique_ptr<token_bucket>> _disk_throttles;
+
     perf_counter_wrapper _recent_copy_data_size;
+    perf_counter_wrapper _recent_copy_skip_data_size;
+    perf_counter_wrapper _recent_copy_throttling_delay_count;
     perf_counter_wrapper _recent_copy_fail_count;
     perf_counter_wrapper _recent_write_data_size;
     perf_counter_wrapper _recent_write_fail_count;
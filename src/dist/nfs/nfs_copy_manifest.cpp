@@ -0,0 +1,183 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dsn/c/api_utilities.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/safe_strerror_posix.h>
+
+#include "nfs_copy_manifest.h"
+
+namespace dsn {
+namespace service {
+
+static const uint32_t MANIFEST_MAGIC = 0xdeadbeef;
+static const uint32_t MANIFEST_VERSION = 2;
+
+#pragma pack(push, 4)
+struct manifest_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t file_size;
+    int64_t remote_mtime;
+    uint32_t block_size;
+};
+
+struct manifest_record
+{
+    int32_t chunk_index;
+    uint32_t crc;
+};
+#pragma pack(pop)
+
+bool nfs_copy_manifest::open(const std::string &file_path,
+                             uint64_t file_size,
+                             int64_t remote_mtime,
+                             uint32_t block_size)
+{
+    close();
+    _path = manifest_path(file_path);
+    _file_size = file_size;
+    _remote_mtime = remote_mtime;
+    _block_size = block_size;
+    _recorded.clear();
+
+    if (utils::filesystem::file_exists(_path) && load()) {
+        _fd = ::open(_path.c_str(), O_WRONLY | O_APPEND, 0666);
+        if (_fd >= 0) {
+            ddebug("nfs: resume copy of %s with manifest, %d chunks recorded",
+                   file_path.c_str(),
+                   recorded_count());
+            return true;
+        }
+    }
+
+    _recorded.clear();
+    return reset();
+}
+
+bool nfs_copy_manifest::load()
+{
+    int fd = ::open(_path.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        dwarn("nfs: open manifest %s failed, err = %s",
+              _path.c_str(),
+              utils::safe_strerror(errno).c_str());
+        return false;
+    }
+
+    bool matched = false;
+    manifest_header hdr;
+    if (::read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == MANIFEST_MAGIC &&
+        hdr.version == MANIFEST_VERSION && hdr.file_size == _file_size &&
+        _remote_mtime != 0 && hdr.remote_mtime == _remote_mtime &&
+        hdr.block_size == _block_size) {
+        matched = true;
+        manifest_record rec;
+        // a torn record at the tail (crash during append) is simply ignored
+        while (::read(fd, &rec, sizeof(rec)) == sizeof(rec)) {
+            _recorded[rec.chunk_index] = rec.crc;
+        }
+    }
+    ::close(fd);
+
+    if (!matched) {
+        ddebug("nfs: manifest %s doesn't match the remote file, reset it", _path.c_str());
+    }
+    return matched;
+}
+
+bool nfs_copy_manifest::reset()
+{
+    _fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+    if (_fd < 0) {
+        derror("nfs: create manifest %s failed, err = %s",
+               _path.c_str(),
+               utils::safe_strerror(errno).c_str());
+        return false;
+    }
+
+    manifest_header hdr;
+    hdr.magic = MANIFEST_MAGIC;
+    hdr.version = MANIFEST_VERSION;
+    hdr.file_size = _file_size;
+    hdr.remote_mtime = _remote_mtime;
+    hdr.block_size = _block_size;
+    if (::write(_fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+        derror("nfs: write manifest %s failed, err = %s",
+               _path.c_str(),
+               utils::safe_strerror(errno).c_str());
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool nfs_copy_manifest::get_recorded_crc(int chunk_index, /*out*/ uint32_t &crc) const
+{
+    auto it = _recorded.find(chunk_index);
+    if (it == _recorded.end())
+        return false;
+    crc = it->second;
+    return true;
+}
+
+bool nfs_copy_manifest::append(int chunk_index, uint32_t crc)
+{
+    if (_fd < 0)
+        return false;
+
+    manifest_record rec;
+    rec.chunk_index = chunk_index;
+    rec.crc = crc;
+    if (::write(_fd, &rec, sizeof(rec)) != sizeof(rec)) {
+        dwarn("nfs: append manifest %s failed, err = %s",
+              _path.c_str(),
+              utils::safe_strerror(errno).c_str());
+        return false;
+    }
+    return true;
+}
+
+void nfs_copy_manifest::close()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void nfs_copy_manifest::remove()
+{
+    close();
+    if (!_path.empty() && !utils::filesystem::remove_path(_path)) {
+        dwarn("nfs: remove manifest %s failed", _path.c_str());
+    }
+}
+}
+}
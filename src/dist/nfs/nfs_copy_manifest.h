@@ -0,0 +1,104 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     per-file copy manifest on nfs client, used to resume an interrupted copy
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+namespace dsn {
+namespace service {
+
+//
+// a manifest sits beside the destination file as "<file>.nfs_manifest" while the file
+// is being copied. it records the crc32 of every chunk which has been written to the
+// local file successfully, in an append-only binary format:
+//
+//   header: | magic(4) | version(4) | file_size(8) | remote_mtime(8) | block_size(4) |
+//   record: | chunk_index(4) | crc32(4) |
+//
+// if the copy is interrupted, the next copy of the same file (same size, modification
+// time on the remote and block size) loads the manifest, re-verifies the recorded chunks
+// against the local data and only fetches the missing ones from the remote. the manifest
+// is removed when the file is completely copied.
+//
+class nfs_copy_manifest
+{
+public:
+    static const char *suffix() { return ".nfs_manifest"; }
+    static std::string manifest_path(const std::string &file_path)
+    {
+        return file_path + suffix();
+    }
+
+    nfs_copy_manifest() : _fd(-1), _file_size(0), _remote_mtime(0), _block_size(0) {}
+    ~nfs_copy_manifest() { close(); }
+
+    // open the manifest for file_path, loading the recorded chunks if the existing
+    // manifest matches file_size, remote_mtime and block_size, or resetting it otherwise.
+    // remote_mtime is 0 if unknown, with which the manifest is never matched.
+    // returns false if the manifest can't be created.
+    bool open(const std::string &file_path,
+              uint64_t file_size,
+              int64_t remote_mtime,
+              uint32_t block_size);
+
+    // recorded crc of chunk_index, returns false if the chunk is not recorded
+    bool get_recorded_crc(int chunk_index, /*out*/ uint32_t &crc) const;
+
+    int recorded_count() const { return static_cast<int>(_recorded.size()); }
+
+    // append a record, thread safe as each record is written by a single O_APPEND write
+    bool append(int chunk_index, uint32_t crc);
+
+    void close();
+
+    // close and remove the manifest file, called once the whole file is copied
+    void remove();
+
+private:
+    bool load();
+    bool reset();
+
+private:
+    std::string _path;
+    int _fd;
+    uint64_t _file_size;
+    int64_t _remote_mtime;
+    uint32_t _block_size;
+    std::unordered_map<int, uint32_t> _recorded;
+};
+}
+}
@@ -152,10 +152,16 @@ void nfs_service_impl::internal_read_callback(error_code err, size_t sz, callbac
     resp.offset = cp.offset;
     resp.size = cp.size;
 
+    // file_content is appended to the response message by reference
     cp.replier(resp);
 }
 
 // RPC_NFS_NEW_NFS_GET_FILE_SIZE
+static int64_t get_mtime_ns(const struct stat &st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
 void nfs_service_impl::on_get_file_size(
     const ::dsn::service::get_file_size_request &request,
     ::dsn::rpc_replier<::dsn::service::get_file_size_response> &reply)
@@ -179,14 +185,15 @@ void nfs_service_impl::on_get_file_size(
                 for (auto &fpath : file_list) {
                     // TODO: using uint64 instead as file ma
                     // Done
-                    int64_t sz;
-                    if (!dsn::utils::filesystem::file_size(fpath, sz)) {
+                    struct stat st;
+                    if (0 != ::stat(fpath.c_str(), &st)) {
                         derror("{nfs_service} get size of file %s failed", fpath.c_str());
                         err = ERR_FILE_OPERATION_FAILED;
                         break;
                     }
 
-                    resp.size_list.push_back((uint64_t)sz);
+                    resp.size_list.push_back((uint64_t)st.st_size);
+                    resp.mtime_list.push_back(get_mtime_ns(st));
                     resp.file_list.push_back(
                         fpath.substr(request.source_dir.length(), fpath.length() - 1));
                 }
@@ -213,6 +220,7 @@ void nfs_service_impl::on_get_file_size(
             uint64_t size = st.st_size;
 
             resp.size_list.push_back(size);
+            resp.mtime_list.push_back(get_mtime_ns(st));
             resp.file_list.push_back((folder + request.file_list[i])
                                          .substr(request.source_dir.length(),
                                                  (folder + request.file_list[i]).length() - 1));
@@ -220,6 +228,7 @@ void nfs_service_impl::on_get_file_size(
     }
 
     resp.error = err;
+    resp.__isset.mtime_list = true;
     reply(resp);
 }
 
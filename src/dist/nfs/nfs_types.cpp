@@ -629,6 +629,12 @@ void get_file_size_response::__set_size_list(const std::vector<int64_t> &val)
     this->size_list = val;
 }
 
+void get_file_size_response::__set_mtime_list(const std::vector<int64_t> &val)
+{
+    this->mtime_list = val;
+    __isset.mtime_list = true;
+}
+
 uint32_t get_file_size_response::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -694,6 +700,25 @@ uint32_t get_file_size_response::read(::apache::thrift::protocol::TProtocol *ipr
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->mtime_list.clear();
+                    uint32_t _size34;
+                    ::apache::thrift::protocol::TType _etype37;
+                    xfer += iprot->readListBegin(_etype37, _size34);
+                    this->mtime_list.resize(_size34);
+                    uint32_t _i38;
+                    for (_i38 = 0; _i38 < _size34; ++_i38) {
+                        xfer += iprot->readI64(this->mtime_list[_i38]);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.mtime_list = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -740,6 +765,20 @@ uint32_t get_file_size_response::write(::apache::thrift::protocol::TProtocol *op
     }
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.mtime_list) {
+        xfer += oprot->writeFieldBegin("mtime_list", ::apache::thrift::protocol::T_LIST, 4);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_I64,
+                                          static_cast<uint32_t>(this->mtime_list.size()));
+            std::vector<int64_t>::const_iterator _iter39;
+            for (_iter39 = this->mtime_list.begin(); _iter39 != this->mtime_list.end();
+                 ++_iter39) {
+                xfer += oprot->writeI64((*_iter39));
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -751,6 +790,7 @@ void swap(get_file_size_response &a, get_file_size_response &b)
     swap(a.error, b.error);
     swap(a.file_list, b.file_list);
     swap(a.size_list, b.size_list);
+    swap(a.mtime_list, b.mtime_list);
     swap(a.__isset, b.__isset);
 }
 
@@ -759,6 +799,7 @@ get_file_size_response::get_file_size_response(const get_file_size_response &oth
     error = other30.error;
     file_list = other30.file_list;
     size_list = other30.size_list;
+    mtime_list = other30.mtime_list;
     __isset = other30.__isset;
 }
 get_file_size_response::get_file_size_response(get_file_size_response &&other31)
@@ -766,6 +807,7 @@ get_file_size_response::get_file_size_response(get_file_size_response &&other31)
     error = std::move(other31.error);
     file_list = std::move(other31.file_list);
     size_list = std::move(other31.size_list);
+    mtime_list = std::move(other31.mtime_list);
     __isset = std::move(other31.__isset);
 }
 get_file_size_response &get_file_size_response::operator=(const get_file_size_response &other32)
@@ -773,6 +815,7 @@ get_file_size_response &get_file_size_response::operator=(const get_file_size_re
     error = other32.error;
     file_list = other32.file_list;
     size_list = other32.size_list;
+    mtime_list = other32.mtime_list;
     __isset = other32.__isset;
     return *this;
 }
@@ -781,6 +824,7 @@ get_file_size_response &get_file_size_response::operator=(get_file_size_response
     error = std::move(other33.error);
     file_list = std::move(other33.file_list);
     size_list = std::move(other33.size_list);
+    mtime_list = std::move(other33.mtime_list);
     __isset = std::move(other33.__isset);
     return *this;
 }
@@ -793,6 +837,9 @@ void get_file_size_response::printTo(std::ostream &out) const
         << "file_list=" << to_string(file_list);
     out << ", "
         << "size_list=" << to_string(size_list);
+    out << ", "
+        << "mtime_list=";
+    (__isset.mtime_list ? (out << to_string(mtime_list)) : (out << "<null>"));
     out << ")";
 }
 }
@@ -268,10 +268,14 @@ inline std::ostream &operator<<(std::ostream &out, const get_file_size_request &
 
 typedef struct _get_file_size_response__isset
 {
-    _get_file_size_response__isset() : error(false), file_list(false), size_list(false) {}
+    _get_file_size_response__isset()
+        : error(false), file_list(false), size_list(false), mtime_list(false)
+    {
+    }
     bool error : 1;
     bool file_list : 1;
     bool size_list : 1;
+    bool mtime_list : 1;
 } _get_file_size_response__isset;
 
 class get_file_size_response
@@ -287,6 +291,7 @@ public:
     int32_t error;
     std::vector<std::string> file_list;
     std::vector<int64_t> size_list;
+    std::vector<int64_t> mtime_list;
 
     _get_file_size_response__isset __isset;
 
@@ -296,6 +301,8 @@ public:
 
     void __set_size_list(const std::vector<int64_t> &val);
 
+    void __set_mtime_list(const std::vector<int64_t> &val);
+
     bool operator==(const get_file_size_response &rhs) const
     {
         if (!(error == rhs.error))
@@ -304,6 +311,10 @@ public:
             return false;
         if (!(size_list == rhs.size_list))
             return false;
+        if (__isset.mtime_list != rhs.__isset.mtime_list)
+            return false;
+        else if (__isset.mtime_list && !(mtime_list == rhs.mtime_list))
+            return false;
         return true;
     }
     bool operator!=(const get_file_size_response &rhs) const { return !(*this == rhs); }
@@ -2,10 +2,17 @@
 
 #include <dsn/service_api_c.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/crc.h>
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/async_calls.h>
 #include <dsn/dist/nfs_node.h>
 
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "dist/nfs/nfs_copy_manifest.h"
+
 using namespace dsn;
 
 DEFINE_TASK_CODE_AIO(LPC_AIO_TEST_NFS, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
@@ -58,6 +65,9 @@ TEST(nfs, basic)
 
         ASSERT_TRUE(utils::filesystem::file_exists("nfs_test_dir/nfs_test_file1"));
         ASSERT_TRUE(utils::filesystem::file_exists("nfs_test_dir/nfs_test_file2"));
+        // manifests are removed once files are completely copied
+        ASSERT_FALSE(utils::filesystem::file_exists("nfs_test_dir/nfs_test_file1.nfs_manifest"));
+        ASSERT_FALSE(utils::filesystem::file_exists("nfs_test_dir/nfs_test_file2.nfs_manifest"));
 
         int64_t sz1, sz2;
         ASSERT_TRUE(utils::filesystem::file_size("nfs_test_file1", sz1));
@@ -142,6 +152,151 @@ TEST(nfs, basic)
     }
 }
 
+TEST(nfs, copy_manifest)
+{
+    const std::string file_path = "nfs_test_manifest_file";
+    const std::string manifest_path = service::nfs_copy_manifest::manifest_path(file_path);
+    utils::filesystem::remove_path(manifest_path);
+
+    uint32_t crc = 0;
+    {
+        service::nfs_copy_manifest m;
+        ASSERT_TRUE(m.open(file_path, 10000, 12345, 4096));
+        ASSERT_EQ(0, m.recorded_count());
+        ASSERT_TRUE(m.append(0, 100));
+        ASSERT_TRUE(m.append(2, 300));
+    }
+    ASSERT_TRUE(utils::filesystem::file_exists(manifest_path));
+
+    {
+        // reopen with the same file, the recorded chunks are loaded
+        service::nfs_copy_manifest m;
+        ASSERT_TRUE(m.open(file_path, 10000, 12345, 4096));
+        ASSERT_EQ(2, m.recorded_count());
+        ASSERT_TRUE(m.get_recorded_crc(0, crc));
+        ASSERT_EQ(100, crc);
+        ASSERT_FALSE(m.get_recorded_crc(1, crc));
+        ASSERT_TRUE(m.get_recorded_crc(2, crc));
+        ASSERT_EQ(300, crc);
+    }
+
+    {
+        // the remote file is changed but keeps its size, the manifest is reset
+        service::nfs_copy_manifest m;
+        ASSERT_TRUE(m.open(file_path, 10000, 23456, 4096));
+        ASSERT_EQ(0, m.recorded_count());
+        ASSERT_TRUE(m.append(0, 100));
+    }
+
+    {
+        // the remote file can't be identified, the manifest is reset
+        service::nfs_copy_manifest m;
+        ASSERT_TRUE(m.open(file_path, 10000, 0, 4096));
+        ASSERT_EQ(0, m.recorded_count());
+    }
+
+    {
+        // the remote file is changed, the manifest is reset
+        service::nfs_copy_manifest m;
+        ASSERT_TRUE(m.open(file_path, 20000, 12345, 4096));
+        ASSERT_EQ(0, m.recorded_count());
+        ASSERT_FALSE(m.get_recorded_crc(0, crc));
+
+        m.remove();
+        ASSERT_FALSE(utils::filesystem::file_exists(manifest_path));
+    }
+}
+
+static std::string read_file(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static void write_file(const std::string &path, const std::string &content)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+// leave a copy of nfs_test_file1 as interrupted, with chunk 0 recorded in the manifest
+// against the given remote mtime. chunk 0 holds garbage locally, which is only kept by
+// the resumed copy if the manifest is reused.
+static void make_interrupted_copy(const std::string &dst_file,
+                                  const std::string &garbage,
+                                  int64_t remote_mtime)
+{
+    write_file(dst_file, garbage);
+    uint32_t crc = utils::crc32_calc(garbage.data(), garbage.size(), 0);
+    service::nfs_copy_manifest m;
+    ASSERT_TRUE(m.open(dst_file, garbage.size(), remote_mtime, 4 * 1024 * 1024));
+    ASSERT_TRUE(m.append(0, crc));
+}
+
+static void copy_nfs_test_file1(nfs_node *nfs, const std::string &dst_dir)
+{
+    aio_result r;
+    std::vector<std::string> files{"nfs_test_file1"};
+    dsn::aio_task_ptr t = nfs->copy_remote_files(dsn::rpc_address("localhost", 20101),
+                                                 ".",
+                                                 files,
+                                                 dst_dir,
+                                                 false,
+                                                 false,
+                                                 LPC_AIO_TEST_NFS,
+                                                 nullptr,
+                                                 [&r](dsn::error_code err, size_t sz) {
+                                                     r.err = err;
+                                                     r.sz = sz;
+                                                 },
+                                                 0);
+    ASSERT_NE(nullptr, t);
+    ASSERT_TRUE(t->wait(20000));
+    ASSERT_EQ(ERR_OK, r.err);
+}
+
+TEST(nfs, copy_resume)
+{
+    std::unique_ptr<dsn::nfs_node> nfs(dsn::nfs_node::create());
+    nfs->start();
+
+    const std::string dst_dir = "nfs_test_resume_dir";
+    const std::string dst_file = dst_dir + "/nfs_test_file1";
+    utils::filesystem::remove_path(dst_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(dst_dir));
+
+    std::string source = read_file("nfs_test_file1");
+    ASSERT_FALSE(source.empty());
+    std::string garbage(source.size(), 'x');
+
+    struct stat st;
+    ASSERT_EQ(0, ::stat("nfs_test_file1", &st));
+    int64_t mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+    {
+        // the remote file is the same, the recorded chunk is not copied again
+        make_interrupted_copy(dst_file, garbage, mtime);
+        copy_nfs_test_file1(nfs.get(), dst_dir);
+        ASSERT_EQ(garbage, read_file(dst_file));
+        ASSERT_FALSE(utils::filesystem::file_exists(
+            service::nfs_copy_manifest::manifest_path(dst_file)));
+    }
+
+    {
+        // the remote file is changed in place with the same size, the manifest is
+        // discarded and the whole file is copied
+        make_interrupted_copy(dst_file, garbage, mtime - 1);
+        copy_nfs_test_file1(nfs.get(), dst_dir);
+        ASSERT_EQ(source, read_file(dst_file));
+        ASSERT_FALSE(utils::filesystem::file_exists(
+            service::nfs_copy_manifest::manifest_path(dst_file)));
+    }
+
+    utils::filesystem::remove_path(dst_dir);
+}
+
 GTEST_API_ int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
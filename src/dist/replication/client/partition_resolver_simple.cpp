@@ -36,7 +36,8 @@ partition_resolver_simple::partition_resolver_simple(rpc_address meta_server, co
     : partition_resolver(meta_server, app_name),
       _app_id(-1),
       _app_partition_count(-1),
-      _app_is_stateful(true)
+      _app_is_stateful(true),
+      _config_subscribed(false)
 {
 }
 
@@ -283,33 +284,7 @@ void partition_resolver_simple::query_config_reply(error_code err,
             _app_partition_count = resp.partition_count;
             _app_is_stateful = resp.is_stateful;
 
-            for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it) {
-                auto &new_config = *it;
-
-                dinfo("%s.client: query config reply, gpid = %d.%d, ballot = %" PRId64
-                      ", primary = %s",
-                      _app_name.c_str(),
-                      new_config.pid.get_app_id(),
-                      new_config.pid.get_partition_index(),
-                      new_config.ballot,
-                      new_config.primary.to_string());
-
-                auto it2 = _config_cache.find(new_config.pid.get_partition_index());
-                if (it2 == _config_cache.end()) {
-                    std::unique_ptr<partition_info> pi(new partition_info);
-                    pi->timeout_count = 0;
-                    pi->config = new_config;
-                    _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
-                } else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else if (!_app_is_stateful) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else {
-                    // nothing to do
-                }
-            }
+            update_config_cache(resp.partitions);
         } else if (resp.err == ERR_OBJECT_NOT_FOUND) {
             derror("%s.client: query config reply, gpid = %d.%d, err = %s",
                    _app_name.c_str(),
@@ -335,6 +310,13 @@ void partition_resolver_simple::query_config_reply(error_code err,
                err.to_string());
     }
 
+    if (client_err == ERR_OK && err == ERR_OK && _app_is_stateful) {
+        bool expected = false;
+        if (_config_subscribed.compare_exchange_strong(expected, true)) {
+            subscribe_config();
+        }
+    }
+
     // get specific or all partition update
     if (partition_index != -1) {
         partition_context *pc = nullptr;
@@ -385,6 +367,119 @@ void partition_resolver_simple::query_config_reply(error_code err,
     }
 }
 
+void partition_resolver_simple::update_config_cache(
+    const std::vector<partition_configuration> &configs)
+{
+    for (auto it = configs.begin(); it != configs.end(); ++it) {
+        auto &new_config = *it;
+
+        dinfo("%s.client: update config, gpid = %d.%d, ballot = %" PRId64 ", primary = %s",
+              _app_name.c_str(),
+              new_config.pid.get_app_id(),
+              new_config.pid.get_partition_index(),
+              new_config.ballot,
+              new_config.primary.to_string());
+
+        auto it2 = _config_cache.find(new_config.pid.get_partition_index());
+        if (it2 == _config_cache.end()) {
+            std::unique_ptr<partition_info> pi(new partition_info);
+            pi->timeout_count = 0;
+            pi->config = new_config;
+            _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
+        } else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot) {
+            it2->second->timeout_count = 0;
+            it2->second->config = new_config;
+        } else if (!_app_is_stateful) {
+            it2->second->timeout_count = 0;
+            it2->second->config = new_config;
+        } else {
+            // nothing to do
+        }
+    }
+}
+
+DEFINE_TASK_CODE_RPC(RPC_CM_SUBSCRIBE_PARTITION_CONFIG, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+// meta server holds the subscription for at most config_subscription_wait_ms (30s by default)
+static const int SUBSCRIBE_CONFIG_TIMEOUT_MS = 60000;
+
+void partition_resolver_simple::subscribe_config()
+{
+    configuration_query_by_index_request req;
+    req.app_name = _app_name;
+    req.__isset.known_ballots = true;
+    {
+        zauto_read_lock l(_config_lock);
+        // -1 for the partitions not in cache, so that they are always returned
+        req.known_ballots.resize(_app_partition_count, -1);
+        for (auto &kv : _config_cache) {
+            if (kv.first >= 0 && kv.first < _app_partition_count) {
+                req.known_ballots[kv.first] = kv.second->config.ballot;
+            }
+        }
+    }
+
+    auto msg = dsn::message_ex::create_request(RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+                                               SUBSCRIBE_CONFIG_TIMEOUT_MS);
+    marshall(msg, req);
+    rpc::call(_meta_server,
+              msg,
+              &_tracker,
+              [this](error_code err, dsn::message_ex *req, dsn::message_ex *resp) {
+                  subscribe_config_reply(err, resp);
+              });
+}
+
+void partition_resolver_simple::subscribe_config_reply(error_code err, dsn::message_ex *response)
+{
+    if (err == ERR_OK) {
+        configuration_query_by_index_response resp;
+        unmarshall(response, resp);
+        err = resp.err;
+        if (err == ERR_OK) {
+            zauto_write_lock l(_config_lock);
+            if (resp.app_id != _app_id || resp.partition_count != _app_partition_count) {
+                // the app is recreated, let the normal query path find it out
+                derror("%s.client: app changed during config subscription, local vs remote: "
+                       "%d.%d vs %d.%d, stop subscribing",
+                       _app_name.c_str(),
+                       _app_id,
+                       _app_partition_count,
+                       resp.app_id,
+                       resp.partition_count);
+                // subscribe again after the next successful query
+                _config_subscribed.store(false);
+                return;
+            }
+            update_config_cache(resp.partitions);
+        }
+    }
+
+    if (err == ERR_OK) {
+        subscribe_config();
+    } else if (err == ERR_HANDLER_NOT_FOUND) {
+        // an old meta server which doesn't support subscription, keep on querying on failure,
+        // and try to subscribe again after the next successful query, which may be served by
+        // an upgraded meta server
+        dwarn("%s.client: config subscription isn't supported by meta server", _app_name.c_str());
+        _config_subscribed.store(false);
+    } else if (err == ERR_OBJECT_NOT_FOUND) {
+        // the app is removed, subscribe again after it's found by a query
+        derror("%s.client: app not found during config subscription, stop subscribing",
+               _app_name.c_str());
+        _config_subscribed.store(false);
+    } else {
+        dwarn("%s.client: config subscription failed, err = %s, retry later",
+              _app_name.c_str(),
+              err.to_string());
+        tasking::enqueue(LPC_REPLICATION_DELAY_QUERY_CONFIG,
+                         &_tracker,
+                         [this]() { subscribe_config(); },
+                         0,
+                         std::chrono::seconds(1));
+    }
+}
+
 void partition_resolver_simple::handle_pending_requests(std::deque<request_context_ptr> &reqs,
                                                         error_code err)
 {
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <dsn/tool-api/task_tracker.h>
+#include <atomic>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/service_api_c.h>
 #include <dsn/cpp/serialization_helper/dsn.layer2_types.h>
@@ -94,6 +95,9 @@ private:
     std::deque<request_context_ptr> _pending_requests_before_partition_count_unknown;
     task_ptr _query_config_task;
 
+    // long-poll subscription of the whole app config, started once the app is known
+    std::atomic<bool> _config_subscribed;
+
     dsn::task_tracker _tracker;
 
 private:
@@ -119,6 +123,11 @@ private:
                             dsn::message_ex *request,
                             dsn::message_ex *response,
                             int partition_index);
+    // merge configs into _config_cache, _config_lock must be held
+    void update_config_cache(const std::vector<partition_configuration> &configs);
+
+    void subscribe_config();
+    void subscribe_config_reply(error_code err, dsn::message_ex *response);
 };
 } // namespace replication
 } // namespace dsn
@@ -36,6 +36,7 @@
 #include <dsn/utility/utils.h>
 #include <dsn/utility/filesystem.h>
 #include <thread>
+#include <algorithm>
 
 namespace dsn {
 namespace replication {
@@ -73,26 +74,71 @@ unsigned dir_node::remove(const gpid &pid)
     return iter->second.erase(pid);
 }
 
-void dir_node::update_disk_stat()
+dir_node::disk_stat dir_node::sample_disk_stat() const
 {
+    disk_stat st;
+    st.capacity_mb = disk_capacity_mb;
+    st.available_mb = disk_available_mb;
+    st.available_ratio = disk_available_ratio;
+    st.io_util = disk_io_util;
+    st.io_ticks_ms = last_io_ticks_ms;
+    st.io_stat_time_ms = last_io_stat_time_ms;
+
     dsn::utils::filesystem::disk_space_info info;
     if (dsn::utils::filesystem::get_disk_space_info(full_dir, info)) {
-        disk_capacity_mb = info.capacity / 1024 / 1024;
-        disk_available_mb = info.available / 1024 / 1024;
-        disk_available_ratio =
-            disk_capacity_mb == 0 ? 0 : disk_available_mb * 100 / disk_capacity_mb;
-        ddebug("update disk space succeed: dir = %s, capacity_mb = %" PRId64
-               ", available_mb = %" PRId64 ", available_ratio = %" PRId64 "%%",
-               full_dir.c_str(),
-               disk_capacity_mb,
-               disk_available_mb,
-               disk_available_ratio);
+        st.capacity_mb = info.capacity / 1024 / 1024;
+        st.available_mb = info.available / 1024 / 1024;
+        st.available_ratio = st.capacity_mb == 0 ? 0 : st.available_mb * 100 / st.capacity_mb;
     } else {
         derror("update disk space failed: dir = %s", full_dir.c_str());
     }
+
+    uint64_t io_ticks_ms = 0;
+    uint64_t now_ms = dsn_now_ms();
+    if (dsn::utils::filesystem::get_disk_io_ticks(full_dir, io_ticks_ms)) {
+        if (last_io_stat_time_ms != 0 && now_ms > last_io_stat_time_ms &&
+            io_ticks_ms >= last_io_ticks_ms) {
+            st.io_util = std::min<int64_t>(
+                100, (io_ticks_ms - last_io_ticks_ms) * 100 / (now_ms - last_io_stat_time_ms));
+        }
+        st.io_ticks_ms = io_ticks_ms;
+        st.io_stat_time_ms = now_ms;
+    } else {
+        st.io_util = -1;
+    }
+
+    ddebug("update disk stat succeed: dir = %s, capacity_mb = %" PRId64
+           ", available_mb = %" PRId64 ", available_ratio = %" PRId64
+           "%%, io_util = %" PRId64 "%%",
+           full_dir.c_str(),
+           st.capacity_mb,
+           st.available_mb,
+           st.available_ratio,
+           st.io_util);
+    return st;
+}
+
+void dir_node::set_disk_stat(const disk_stat &st)
+{
+    disk_capacity_mb = st.capacity_mb;
+    disk_available_mb = st.available_mb;
+    disk_available_ratio = st.available_ratio;
+    disk_io_util = st.io_util;
+    last_io_ticks_ms = st.io_ticks_ms;
+    last_io_stat_time_ms = st.io_stat_time_ms;
+}
+
+bool dir_node::is_healthy_for_placement(int64_t min_available_ratio, int64_t max_io_util) const
+{
+    if (disk_capacity_mb > 0 && disk_available_ratio < min_available_ratio)
+        return false;
+    if (disk_io_util >= 0 && disk_io_util > max_io_util)
+        return false;
+    return true;
 }
 
 fs_manager::fs_manager(bool for_test)
+    : _placement_min_available_ratio(0), _placement_max_io_util(100)
 {
     if (!for_test) {
         _counter_capacity_total_mb.init_app_counter("eon.replica_stub",
@@ -115,9 +161,20 @@ fs_manager::fs_manager(bool for_test)
                                                       "disk.available.max.ratio",
                                                       COUNTER_TYPE_NUMBER,
                                                       "maximal disk available ratio in all disks");
+        _counter_io_util_max.init_app_counter("eon.replica_stub",
+                                              "disk.io.util.max",
+                                              COUNTER_TYPE_NUMBER,
+                                              "maximal io utilization percentage in all disks");
     }
 }
 
+void fs_manager::set_placement_limits(int64_t min_available_ratio, int64_t max_io_util)
+{
+    zauto_write_lock l(_lock);
+    _placement_min_available_ratio = min_available_ratio;
+    _placement_max_io_util = max_io_util;
+}
+
 dir_node *fs_manager::get_dir_node(const std::string &subdir)
 {
     std::string norm_subdir;
@@ -171,6 +228,17 @@ dsn::error_code fs_manager::get_disk_tag(const std::string &dir, std::string &ta
     }
 }
 
+dsn::error_code fs_manager::get_dir_by_tag(const std::string &tag, std::string &dir)
+{
+    for (auto &n : _dir_nodes) {
+        if (n->tag == tag) {
+            dir = n->full_dir;
+            return dsn::ERR_OK;
+        }
+    }
+    return dsn::ERR_OBJECT_NOT_FOUND;
+}
+
 void fs_manager::add_replica(const gpid &pid, const std::string &pid_dir)
 {
     dir_node *n = get_dir_node(pid_dir);
@@ -208,38 +276,63 @@ void fs_manager::allocate_dir(const gpid &pid, const std::string &type, /*out*/
     zauto_write_lock l(_lock);
 
     dir_node *selected = nullptr;
-
+    bool selected_healthy = false;
     unsigned least_app_replicas_count = 0;
     unsigned least_total_replicas_count = 0;
 
+    // prefer healthy disks, then the one with least replicas of the app (to spread an app
+    // over the disks), then the one with most free space, then the least busy one, and
+    // finally the one with least replicas totally
     for (auto &n : _dir_nodes) {
         dassert(!n->has(pid),
                 "gpid(%d.%d) already in dir_node(%s)",
                 pid.get_app_id(),
                 pid.get_partition_index(),
                 n->tag.c_str());
+        bool healthy =
+            n->is_healthy_for_placement(_placement_min_available_ratio, _placement_max_io_util);
         unsigned app_replicas = n->replicas_count(pid.get_app_id());
         unsigned total_replicas = n->replicas_count();
 
-        if (selected == nullptr || least_app_replicas_count > app_replicas) {
-            least_app_replicas_count = app_replicas;
-            least_total_replicas_count = total_replicas;
+        bool better = false;
+        if (selected == nullptr || healthy != selected_healthy) {
+            better = (selected == nullptr || healthy);
+        } else if (app_replicas != least_app_replicas_count) {
+            better = app_replicas < least_app_replicas_count;
+        } else if (n->disk_available_mb != selected->disk_available_mb) {
+            better = n->disk_available_mb > selected->disk_available_mb;
+        } else if (n->disk_io_util != selected->disk_io_util) {
+            better = n->disk_io_util < selected->disk_io_util;
+        } else {
+            better = total_replicas < least_total_replicas_count;
+        }
+
+        if (better) {
             selected = n.get();
-        } else if (least_app_replicas_count == app_replicas &&
-                   least_total_replicas_count > total_replicas) {
+            selected_healthy = healthy;
+            least_app_replicas_count = app_replicas;
             least_total_replicas_count = total_replicas;
-            selected = n.get();
         }
     }
 
-    ddebug(
-        "%s: put pid(%d.%d) to dir(%s), which has %u replicas of current app, %u replicas totally",
-        dsn_primary_address().to_string(),
-        pid.get_app_id(),
-        pid.get_partition_index(),
-        selected->tag.c_str(),
-        least_app_replicas_count,
-        least_total_replicas_count);
+    if (!selected_healthy) {
+        dwarn("%s: all disks are nearly full or saturated, put pid(%d.%d) to dir(%s) anyway",
+              dsn_primary_address().to_string(),
+              pid.get_app_id(),
+              pid.get_partition_index(),
+              selected->tag.c_str());
+    }
+
+    ddebug("%s: put pid(%d.%d) to dir(%s), which has %u replicas of current app, %u replicas "
+           "totally, available_mb = %" PRId64 ", io_util = %" PRId64 "%%",
+           dsn_primary_address().to_string(),
+           pid.get_app_id(),
+           pid.get_partition_index(),
+           selected->tag.c_str(),
+           least_app_replicas_count,
+           least_total_replicas_count,
+           selected->disk_available_mb,
+           selected->disk_io_util);
 
     selected->holding_replicas[pid.get_app_id()].emplace(pid);
     dir = utils::filesystem::path_combine(selected->full_dir, buffer);
@@ -284,8 +377,21 @@ void fs_manager::update_disk_stat()
     int64_t available_total_ratio = 0;
     int64_t available_min_ratio = 100;
     int64_t available_max_ratio = 0;
+    int64_t io_util_max = -1;
+
+    // the nodes are never removed, and only modified here, so they can be sampled without
+    // the lock, then the stats of all nodes are published at once
+    std::vector<dir_node::disk_stat> stats;
+    stats.reserve(_dir_nodes.size());
     for (auto &n : _dir_nodes) {
-        n->update_disk_stat();
+        stats.push_back(n->sample_disk_stat());
+    }
+
+    zauto_write_lock l(_lock);
+    for (size_t i = 0; i < _dir_nodes.size(); ++i) {
+        auto &n = _dir_nodes[i];
+        n->set_disk_stat(stats[i]);
+        io_util_max = std::max(io_util_max, n->disk_io_util);
         capacity_total_mb += n->disk_capacity_mb;
         available_total_mb += n->disk_available_mb;
         if (n->disk_available_ratio < available_min_ratio)
@@ -297,18 +403,21 @@ void fs_manager::update_disk_stat()
         capacity_total_mb == 0 ? 0 : available_total_mb * 100 / capacity_total_mb;
     ddebug("update disk space succeed: disk_count = %d, capacity_total_mb = %" PRId64
            ", available_total_mb = %" PRId64 ", available_total_ratio = %" PRId64
-           "%%, available_min_ratio = %" PRId64 "%%, available_max_ratio = %" PRId64 "%%",
+           "%%, available_min_ratio = %" PRId64 "%%, available_max_ratio = %" PRId64
+           "%%, io_util_max = %" PRId64 "%%",
            (int)_dir_nodes.size(),
            capacity_total_mb,
            available_total_mb,
            available_total_ratio,
            available_min_ratio,
-           available_max_ratio);
+           available_max_ratio,
+           io_util_max);
     _counter_capacity_total_mb->set(capacity_total_mb);
     _counter_available_total_mb->set(available_total_mb);
     _counter_available_total_ratio->set(available_total_ratio);
     _counter_available_min_ratio->set(available_min_ratio);
     _counter_available_max_ratio->set(available_max_ratio);
+    _counter_io_util_max->set(io_util_max < 0 ? 0 : io_util_max);
 }
 }
 }
@@ -51,6 +51,11 @@ public:
     int64_t disk_capacity_mb;
     int64_t disk_available_mb;
     int64_t disk_available_ratio;
+    // percentage of time the device was busy doing I/O since last update,
+    // -1 if unknown (e.g. not on linux, or the device is not a block device)
+    int64_t disk_io_util;
+    uint64_t last_io_ticks_ms;
+    uint64_t last_io_stat_time_ms;
     std::map<app_id, std::set<gpid>> holding_replicas;
 
 public:
@@ -59,14 +64,33 @@ public:
           full_dir(dir_),
           disk_capacity_mb(0),
           disk_available_mb(0),
-          disk_available_ratio(0)
+          disk_available_ratio(0),
+          disk_io_util(-1),
+          last_io_ticks_ms(0),
+          last_io_stat_time_ms(0)
     {
     }
     unsigned replicas_count(app_id id) const;
     unsigned replicas_count() const;
     bool has(const dsn::gpid &pid) const;
     unsigned remove(const dsn::gpid &pid);
-    void update_disk_stat();
+
+    struct disk_stat
+    {
+        int64_t capacity_mb;
+        int64_t available_mb;
+        int64_t available_ratio;
+        int64_t io_util;
+        uint64_t io_ticks_ms;
+        uint64_t io_stat_time_ms;
+    };
+    // sample the stat of the disk, which does I/O, so the lock of fs_manager shouldn't be
+    // held. the node is not modified, the result should be applied with set_disk_stat().
+    disk_stat sample_disk_stat() const;
+    void set_disk_stat(const disk_stat &st);
+    // a disk is not preferred for new replicas if it's nearly full or saturated.
+    // unknown stats (e.g. in test) are considered healthy.
+    bool is_healthy_for_placement(int64_t min_available_ratio, int64_t max_io_util) const;
 };
 
 class fs_manager
@@ -81,16 +105,25 @@ public:
                                const std::vector<std::string> &tags,
                                bool for_test);
 
+    // disks with available ratio below min_available_ratio or io util above max_io_util
+    // are avoided when allocating dirs for new replicas
+    void set_placement_limits(int64_t min_available_ratio, int64_t max_io_util);
+
     dsn::error_code get_disk_tag(const std::string &dir, /*out*/ std::string &tag);
+    dsn::error_code get_dir_by_tag(const std::string &tag, /*out*/ std::string &dir);
     void allocate_dir(const dsn::gpid &pid,
                       const std::string &type,
                       /*out*/ std::string &dir);
     void add_replica(const dsn::gpid &pid, const std::string &pid_dir);
     void remove_replica(const dsn::gpid &pid);
+    // func is called with the read lock held, so the nodes are a consistent snapshot
     bool for_each_dir_node(const std::function<bool(const dir_node &)> &func) const;
+    // not reentrant, should only be called by a single thread
     void update_disk_stat();
 
 private:
+    friend class fs_manager_test;
+
     dir_node *get_dir_node(const std::string &subdir);
 
     // when visit the tag/storage of the _dir_nodes map, there's no need to protect by the lock.
@@ -98,11 +131,15 @@ private:
     mutable zrwlock_nr _lock;
     std::vector<std::unique_ptr<dir_node>> _dir_nodes;
 
+    int64_t _placement_min_available_ratio;
+    int64_t _placement_max_io_util;
+
     perf_counter_wrapper _counter_capacity_total_mb;
     perf_counter_wrapper _counter_available_total_mb;
     perf_counter_wrapper _counter_available_total_ratio;
     perf_counter_wrapper _counter_available_min_ratio;
     perf_counter_wrapper _counter_available_max_ratio;
+    perf_counter_wrapper _counter_io_util_max;
 };
 }
 }
@@ -58,6 +58,7 @@ replication_options::replication_options()
     staleness_for_commit = 10;
     max_mutation_count_in_prepare_list = 110;
     mutation_2pc_min_replica_count = 2;
+    primary_handover_timeout_ms = 3000;
 
     group_check_disabled = false;
     group_check_interval_ms = 10000;
@@ -75,12 +76,19 @@ replication_options::replication_options()
 
     disk_stat_disabled = false;
     disk_stat_interval_seconds = 600;
+    disk_min_available_ratio_for_placement = 10;
+    disk_max_io_util_for_placement = 90;
 
     fd_disabled = false;
     fd_check_interval_seconds = 2;
     fd_beacon_interval_seconds = 3;
     fd_lease_seconds = 9;
     fd_grace_seconds = 10;
+    fd_check_interval_ms = fd_check_interval_seconds * 1000;
+    fd_beacon_interval_ms = fd_beacon_interval_seconds * 1000;
+    fd_phi_accrual_enabled = false;
+    fd_phi_threshold = 8.0;
+    fd_min_lease_ms = 2000;
 
     log_private_file_size_mb = 32;
     log_private_batch_buffer_kb = 512;
@@ -95,9 +103,11 @@ replication_options::replication_options()
     log_shared_force_flush = false;
     log_shared_pending_size_throttling_threshold_kb = 0;
     log_shared_pending_size_throttling_delay_ms = 0;
+    log_task_code_dictionary_enabled = false;
 
     config_sync_disabled = false;
     config_sync_interval_ms = 30000;
+    config_sync_full_interval_ms = 300000;
 
     lb_interval_ms = 10000;
 
@@ -308,6 +318,12 @@ void replication_options::initialize()
         "mutation_2pc_min_replica_count",
         mutation_2pc_min_replica_count,
         "minimum number of alive replicas under which write is allowed");
+    primary_handover_timeout_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "primary_handover_timeout_ms",
+        primary_handover_timeout_ms,
+        "how long (ms) a primary waits for the secondaries to catch up before giving up "
+        "the handover to a secondary");
 
     group_check_disabled = dsn_config_get_value_bool("replication",
                                                      "group_check_disabled",
@@ -373,6 +389,18 @@ void replication_options::initialize()
                                          "disk_stat_interval_seconds",
                                          disk_stat_interval_seconds,
                                          "every what period (ms) we do disk stat");
+    disk_min_available_ratio_for_placement =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "disk_min_available_ratio_for_placement",
+                                         disk_min_available_ratio_for_placement,
+                                         "new replicas are not placed on the disk whose available "
+                                         "ratio(%) is below this, unless all disks are");
+    disk_max_io_util_for_placement =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "disk_max_io_util_for_placement",
+                                         disk_max_io_util_for_placement,
+                                         "new replicas are not placed on the disk whose io "
+                                         "utilization(%) is above this, unless all disks are");
 
     fd_disabled = dsn_config_get_value_bool(
         "replication", "fd_disabled", fd_disabled, "whether to disable failure detection");
@@ -396,6 +424,33 @@ void replication_options::initialize()
         "fd_grace_seconds",
         fd_grace_seconds,
         "grace (seconds) assigned to remote FD slaves (grace > lease)");
+    fd_check_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "fd_check_interval_ms",
+        fd_check_interval_seconds * 1000,
+        "every this period(ms) the FD will check healthness of remote peers, "
+        "overrides fd_check_interval_seconds for sub-second checks");
+    fd_beacon_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "fd_beacon_interval_ms",
+        fd_beacon_interval_seconds * 1000,
+        "every this period(ms) the FD sends beacon message to remote peers, "
+        "overrides fd_beacon_interval_seconds for sub-second beacons");
+    fd_phi_accrual_enabled =
+        dsn_config_get_value_bool("replication",
+                                  "fd_phi_accrual_enabled",
+                                  fd_phi_accrual_enabled,
+                                  "whether the lease got from FD master adapts to the jitter of "
+                                  "the beacons, between fd_min_lease_ms and fd_lease_seconds");
+    fd_phi_threshold = dsn_config_get_value_double(
+        "replication",
+        "fd_phi_threshold",
+        fd_phi_threshold,
+        "the lease expires when the phi of the beacon acks reaches this value");
+    fd_min_lease_ms = (int)dsn_config_get_value_uint64("replication",
+                                                       "fd_min_lease_ms",
+                                                       fd_min_lease_ms,
+                                                       "minimal lease (ms) with phi-accrual");
 
     log_private_file_size_mb =
         (int)dsn_config_get_value_uint64("replication",
@@ -459,6 +514,13 @@ void replication_options::initialize()
                                          "log_shared_pending_size_throttling_delay_ms",
                                          log_shared_pending_size_throttling_delay_ms,
                                          "log_shared_pending_size_throttling_delay_ms");
+    log_task_code_dictionary_enabled = dsn_config_get_value_bool(
+        "replication",
+        "log_task_code_dictionary_enabled",
+        log_task_code_dictionary_enabled,
+        "whether to write the task codes to the logs as numbers, with a dictionary in the "
+        "file header. the logs can't be read by the replica servers before, so enable it "
+        "only after all the replica servers are upgraded");
 
     config_sync_disabled = dsn_config_get_value_bool(
         "replication",
@@ -470,6 +532,12 @@ void replication_options::initialize()
         "config_sync_interval_ms",
         config_sync_interval_ms,
         "every this period(ms) the replica syncs replica configuration with the meta server");
+    config_sync_full_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "config_sync_full_interval_ms",
+        config_sync_full_interval_ms,
+        "config sync only reports the replicas changed since the last acknowledged sync, "
+        "except that every this period(ms) all the replicas are reported");
 
     lb_interval_ms = (int)dsn_config_get_value_uint64(
         "replication",
@@ -62,6 +62,7 @@ public:
     int32_t staleness_for_commit;
     int32_t max_mutation_count_in_prepare_list;
     int32_t mutation_2pc_min_replica_count;
+    int32_t primary_handover_timeout_ms;
 
     bool group_check_disabled;
     int32_t group_check_interval_ms;
@@ -79,12 +80,19 @@ public:
 
     bool disk_stat_disabled;
     int32_t disk_stat_interval_seconds;
+    int32_t disk_min_available_ratio_for_placement;
+    int32_t disk_max_io_util_for_placement;
 
     bool fd_disabled;
     int32_t fd_check_interval_seconds;
     int32_t fd_beacon_interval_seconds;
     int32_t fd_lease_seconds;
     int32_t fd_grace_seconds;
+    int32_t fd_check_interval_ms;
+    int32_t fd_beacon_interval_ms;
+    bool fd_phi_accrual_enabled;
+    double fd_phi_threshold;
+    int32_t fd_min_lease_ms;
 
     int32_t log_private_file_size_mb;
     int32_t log_private_batch_buffer_kb;
@@ -99,9 +107,11 @@ public:
     bool log_shared_force_flush;
     int32_t log_shared_pending_size_throttling_threshold_kb;
     int32_t log_shared_pending_size_throttling_delay_ms;
+    bool log_task_code_dictionary_enabled;
 
     bool config_sync_disabled;
     int32_t config_sync_interval_ms;
+    int32_t config_sync_full_interval_ms;
 
     int32_t lb_interval_ms;
 
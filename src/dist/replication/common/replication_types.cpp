@@ -73,7 +73,8 @@ int _kconfig_typeValues[] = {config_type::CT_INVALID,
                              config_type::CT_REMOVE,
                              config_type::CT_ADD_SECONDARY_FOR_LB,
                              config_type::CT_PRIMARY_FORCE_UPDATE_BALLOT,
-                             config_type::CT_DROP_PARTITION};
+                             config_type::CT_DROP_PARTITION,
+                             config_type::CT_HANDOVER_PRIMARY};
 const char *_kconfig_typeNames[] = {"CT_INVALID",
                                     "CT_ASSIGN_PRIMARY",
                                     "CT_UPGRADE_TO_PRIMARY",
@@ -84,9 +85,10 @@ const char *_kconfig_typeNames[] = {"CT_INVALID",
                                     "CT_REMOVE",
                                     "CT_ADD_SECONDARY_FOR_LB",
                                     "CT_PRIMARY_FORCE_UPDATE_BALLOT",
-                                    "CT_DROP_PARTITION"};
+                                    "CT_DROP_PARTITION",
+                                    "CT_HANDOVER_PRIMARY"};
 const std::map<int, const char *> _config_type_VALUES_TO_NAMES(
-    ::apache::thrift::TEnumIterator(11, _kconfig_typeValues, _kconfig_typeNames),
+    ::apache::thrift::TEnumIterator(12, _kconfig_typeValues, _kconfig_typeNames),
     ::apache::thrift::TEnumIterator(-1, NULL, NULL));
 
 int _knode_statusValues[] = {
@@ -3356,6 +3358,18 @@ void configuration_query_by_node_request::__set_info(const replica_server_info &
     __isset.info = true;
 }
 
+void configuration_query_by_node_request::__set_sync_version(const int64_t val)
+{
+    this->sync_version = val;
+    __isset.sync_version = true;
+}
+
+void configuration_query_by_node_request::__set_base_sync_version(const int64_t val)
+{
+    this->base_sync_version = val;
+    __isset.base_sync_version = true;
+}
+
 uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3410,6 +3424,22 @@ uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::T
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->sync_version);
+                this->__isset.sync_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->base_sync_version);
+                this->__isset.base_sync_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3452,6 +3482,16 @@ configuration_query_by_node_request::write(::apache::thrift::protocol::TProtocol
         xfer += this->info.write(oprot);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.sync_version) {
+        xfer += oprot->writeFieldBegin("sync_version", ::apache::thrift::protocol::T_I64, 4);
+        xfer += oprot->writeI64(this->sync_version);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.base_sync_version) {
+        xfer += oprot->writeFieldBegin("base_sync_version", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->base_sync_version);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3463,6 +3503,8 @@ void swap(configuration_query_by_node_request &a, configuration_query_by_node_re
     swap(a.node, b.node);
     swap(a.stored_replicas, b.stored_replicas);
     swap(a.info, b.info);
+    swap(a.sync_version, b.sync_version);
+    swap(a.base_sync_version, b.base_sync_version);
     swap(a.__isset, b.__isset);
 }
 
@@ -3472,6 +3514,8 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = other108.node;
     stored_replicas = other108.stored_replicas;
     info = other108.info;
+    sync_version = other108.sync_version;
+    base_sync_version = other108.base_sync_version;
     __isset = other108.__isset;
 }
 configuration_query_by_node_request::configuration_query_by_node_request(
@@ -3480,6 +3524,8 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = std::move(other109.node);
     stored_replicas = std::move(other109.stored_replicas);
     info = std::move(other109.info);
+    sync_version = std::move(other109.sync_version);
+    base_sync_version = std::move(other109.base_sync_version);
     __isset = std::move(other109.__isset);
 }
 configuration_query_by_node_request &configuration_query_by_node_request::
@@ -3488,6 +3534,8 @@ operator=(const configuration_query_by_node_request &other110)
     node = other110.node;
     stored_replicas = other110.stored_replicas;
     info = other110.info;
+    sync_version = other110.sync_version;
+    base_sync_version = other110.base_sync_version;
     __isset = other110.__isset;
     return *this;
 }
@@ -3497,6 +3545,8 @@ operator=(configuration_query_by_node_request &&other111)
     node = std::move(other111.node);
     stored_replicas = std::move(other111.stored_replicas);
     info = std::move(other111.info);
+    sync_version = std::move(other111.sync_version);
+    base_sync_version = std::move(other111.base_sync_version);
     __isset = std::move(other111.__isset);
     return *this;
 }
@@ -3511,6 +3561,12 @@ void configuration_query_by_node_request::printTo(std::ostream &out) const
     out << ", "
         << "info=";
     (__isset.info ? (out << to_string(info)) : (out << "<null>"));
+    out << ", "
+        << "sync_version=";
+    (__isset.sync_version ? (out << to_string(sync_version)) : (out << "<null>"));
+    out << ", "
+        << "base_sync_version=";
+    (__isset.base_sync_version ? (out << to_string(base_sync_version)) : (out << "<null>"));
     out << ")";
 }
 
@@ -3533,6 +3589,12 @@ void configuration_query_by_node_response::__set_gc_replicas(const std::vector<r
     __isset.gc_replicas = true;
 }
 
+void configuration_query_by_node_response::__set_need_full_sync(const bool val)
+{
+    this->need_full_sync = val;
+    __isset.need_full_sync = true;
+}
+
 uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3598,6 +3660,14 @@ uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_BOOL) {
+                xfer += iprot->readBool(this->need_full_sync);
+                this->__isset.need_full_sync = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3647,6 +3717,11 @@ configuration_query_by_node_response::write(::apache::thrift::protocol::TProtoco
         }
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.need_full_sync) {
+        xfer += oprot->writeFieldBegin("need_full_sync", ::apache::thrift::protocol::T_BOOL, 4);
+        xfer += oprot->writeBool(this->need_full_sync);
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3658,6 +3733,7 @@ void swap(configuration_query_by_node_response &a, configuration_query_by_node_r
     swap(a.err, b.err);
     swap(a.partitions, b.partitions);
     swap(a.gc_replicas, b.gc_replicas);
+    swap(a.need_full_sync, b.need_full_sync);
     swap(a.__isset, b.__isset);
 }
 
@@ -3667,6 +3743,7 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = other124.err;
     partitions = other124.partitions;
     gc_replicas = other124.gc_replicas;
+    need_full_sync = other124.need_full_sync;
     __isset = other124.__isset;
 }
 configuration_query_by_node_response::configuration_query_by_node_response(
@@ -3675,6 +3752,7 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = std::move(other125.err);
     partitions = std::move(other125.partitions);
     gc_replicas = std::move(other125.gc_replicas);
+    need_full_sync = std::move(other125.need_full_sync);
     __isset = std::move(other125.__isset);
 }
 configuration_query_by_node_response &configuration_query_by_node_response::
@@ -3683,6 +3761,7 @@ operator=(const configuration_query_by_node_response &other126)
     err = other126.err;
     partitions = other126.partitions;
     gc_replicas = other126.gc_replicas;
+    need_full_sync = other126.need_full_sync;
     __isset = other126.__isset;
     return *this;
 }
@@ -3692,6 +3771,7 @@ operator=(configuration_query_by_node_response &&other127)
     err = std::move(other127.err);
     partitions = std::move(other127.partitions);
     gc_replicas = std::move(other127.gc_replicas);
+    need_full_sync = std::move(other127.need_full_sync);
     __isset = std::move(other127.__isset);
     return *this;
 }
@@ -3705,6 +3785,150 @@ void configuration_query_by_node_response::printTo(std::ostream &out) const
     out << ", "
         << "gc_replicas=";
     (__isset.gc_replicas ? (out << to_string(gc_replicas)) : (out << "<null>"));
+    out << ", "
+        << "need_full_sync=";
+    (__isset.need_full_sync ? (out << to_string(need_full_sync)) : (out << "<null>"));
+    out << ")";
+}
+
+meta_standby_push_request::~meta_standby_push_request() throw() {}
+
+void meta_standby_push_request::__set_sequence(const int64_t val) { this->sequence = val; }
+
+void meta_standby_push_request::__set_partitions(
+    const std::vector<::dsn::partition_configuration> &val)
+{
+    this->partitions = val;
+}
+
+uint32_t meta_standby_push_request::read(::apache::thrift::protocol::TProtocol *iprot)
+{
+
+    apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
+    uint32_t xfer = 0;
+    std::string fname;
+    ::apache::thrift::protocol::TType ftype;
+    int16_t fid;
+
+    xfer += iprot->readStructBegin(fname);
+
+    using ::apache::thrift::protocol::TProtocolException;
+
+    while (true) {
+        xfer += iprot->readFieldBegin(fname, ftype, fid);
+        if (ftype == ::apache::thrift::protocol::T_STOP) {
+            break;
+        }
+        switch (fid) {
+        case 1:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->sequence);
+                this->__isset.sequence = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 2:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->partitions.clear();
+                    uint32_t _size570;
+                    ::apache::thrift::protocol::TType _etype573;
+                    xfer += iprot->readListBegin(_etype573, _size570);
+                    this->partitions.resize(_size570);
+                    uint32_t _i574;
+                    for (_i574 = 0; _i574 < _size570; ++_i574) {
+                        xfer += this->partitions[_i574].read(iprot);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.partitions = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        default:
+            xfer += iprot->skip(ftype);
+            break;
+        }
+        xfer += iprot->readFieldEnd();
+    }
+
+    xfer += iprot->readStructEnd();
+
+    return xfer;
+}
+
+uint32_t meta_standby_push_request::write(::apache::thrift::protocol::TProtocol *oprot) const
+{
+    uint32_t xfer = 0;
+    apache::thrift::protocol::TOutputRecursionTracker tracker(*oprot);
+    xfer += oprot->writeStructBegin("meta_standby_push_request");
+
+    xfer += oprot->writeFieldBegin("sequence", ::apache::thrift::protocol::T_I64, 1);
+    xfer += oprot->writeI64(this->sequence);
+    xfer += oprot->writeFieldEnd();
+
+    xfer += oprot->writeFieldBegin("partitions", ::apache::thrift::protocol::T_LIST, 2);
+    {
+        xfer += oprot->writeListBegin(::apache::thrift::protocol::T_STRUCT,
+                                      static_cast<uint32_t>(this->partitions.size()));
+        std::vector<::dsn::partition_configuration>::const_iterator _iter575;
+        for (_iter575 = this->partitions.begin(); _iter575 != this->partitions.end(); ++_iter575) {
+            xfer += (*_iter575).write(oprot);
+        }
+        xfer += oprot->writeListEnd();
+    }
+    xfer += oprot->writeFieldEnd();
+
+    xfer += oprot->writeFieldStop();
+    xfer += oprot->writeStructEnd();
+    return xfer;
+}
+
+void swap(meta_standby_push_request &a, meta_standby_push_request &b)
+{
+    using ::std::swap;
+    swap(a.sequence, b.sequence);
+    swap(a.partitions, b.partitions);
+    swap(a.__isset, b.__isset);
+}
+
+meta_standby_push_request::meta_standby_push_request(const meta_standby_push_request &other576)
+{
+    sequence = other576.sequence;
+    partitions = other576.partitions;
+    __isset = other576.__isset;
+}
+meta_standby_push_request::meta_standby_push_request(meta_standby_push_request &&other577)
+{
+    sequence = std::move(other577.sequence);
+    partitions = std::move(other577.partitions);
+    __isset = std::move(other577.__isset);
+}
+meta_standby_push_request &meta_standby_push_request::
+operator=(const meta_standby_push_request &other578)
+{
+    sequence = other578.sequence;
+    partitions = other578.partitions;
+    __isset = other578.__isset;
+    return *this;
+}
+meta_standby_push_request &meta_standby_push_request::
+operator=(meta_standby_push_request &&other579)
+{
+    sequence = std::move(other579.sequence);
+    partitions = std::move(other579.partitions);
+    __isset = std::move(other579.__isset);
+    return *this;
+}
+void meta_standby_push_request::printTo(std::ostream &out) const
+{
+    using ::apache::thrift::to_string;
+    out << "meta_standby_push_request(";
+    out << "sequence=" << to_string(sequence);
+    out << ", "
+        << "partitions=" << to_string(partitions);
     out << ")";
 }
 
@@ -6480,6 +6704,30 @@ void replica_info::__set_app_type(const std::string &val) { this->app_type = val
 
 void replica_info::__set_disk_tag(const std::string &val) { this->disk_tag = val; }
 
+void replica_info::__set_read_qps(const int64_t val)
+{
+    this->read_qps = val;
+    __isset.read_qps = true;
+}
+
+void replica_info::__set_write_qps(const int64_t val)
+{
+    this->write_qps = val;
+    __isset.write_qps = true;
+}
+
+void replica_info::__set_read_bytes_per_second(const int64_t val)
+{
+    this->read_bytes_per_second = val;
+    __isset.read_bytes_per_second = true;
+}
+
+void replica_info::__set_write_bytes_per_second(const int64_t val)
+{
+    this->write_bytes_per_second = val;
+    __isset.write_bytes_per_second = true;
+}
+
 uint32_t replica_info::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -6565,6 +6813,38 @@ uint32_t replica_info::read(::apache::thrift::protocol::TProtocol *iprot)
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 9:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->read_qps);
+                this->__isset.read_qps = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 10:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->write_qps);
+                this->__isset.write_qps = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 11:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->read_bytes_per_second);
+                this->__isset.read_bytes_per_second = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 12:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->write_bytes_per_second);
+                this->__isset.write_bytes_per_second = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -6615,6 +6895,29 @@ uint32_t replica_info::write(::apache::thrift::protocol::TProtocol *oprot) const
     xfer += oprot->writeString(this->disk_tag);
     xfer += oprot->writeFieldEnd();
 
+    if (this->__isset.read_qps) {
+        xfer += oprot->writeFieldBegin("read_qps", ::apache::thrift::protocol::T_I64, 9);
+        xfer += oprot->writeI64(this->read_qps);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.write_qps) {
+        xfer += oprot->writeFieldBegin("write_qps", ::apache::thrift::protocol::T_I64, 10);
+        xfer += oprot->writeI64(this->write_qps);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.read_bytes_per_second) {
+        xfer += oprot->writeFieldBegin(
+            "read_bytes_per_second", ::apache::thrift::protocol::T_I64, 11);
+        xfer += oprot->writeI64(this->read_bytes_per_second);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.write_bytes_per_second) {
+        xfer += oprot->writeFieldBegin(
+            "write_bytes_per_second", ::apache::thrift::protocol::T_I64, 12);
+        xfer += oprot->writeI64(this->write_bytes_per_second);
+        xfer += oprot->writeFieldEnd();
+    }
+
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -6631,6 +6934,10 @@ void swap(replica_info &a, replica_info &b)
     swap(a.last_durable_decree, b.last_durable_decree);
     swap(a.app_type, b.app_type);
     swap(a.disk_tag, b.disk_tag);
+    swap(a.read_qps, b.read_qps);
+    swap(a.write_qps, b.write_qps);
+    swap(a.read_bytes_per_second, b.read_bytes_per_second);
+    swap(a.write_bytes_per_second, b.write_bytes_per_second);
     swap(a.__isset, b.__isset);
 }
 
@@ -6644,6 +6951,10 @@ replica_info::replica_info(const replica_info &other257)
     last_durable_decree = other257.last_durable_decree;
     app_type = other257.app_type;
     disk_tag = other257.disk_tag;
+    read_qps = other257.read_qps;
+    write_qps = other257.write_qps;
+    read_bytes_per_second = other257.read_bytes_per_second;
+    write_bytes_per_second = other257.write_bytes_per_second;
     __isset = other257.__isset;
 }
 replica_info::replica_info(replica_info &&other258)
@@ -6656,6 +6967,10 @@ replica_info::replica_info(replica_info &&other258)
     last_durable_decree = std::move(other258.last_durable_decree);
     app_type = std::move(other258.app_type);
     disk_tag = std::move(other258.disk_tag);
+    read_qps = std::move(other258.read_qps);
+    write_qps = std::move(other258.write_qps);
+    read_bytes_per_second = std::move(other258.read_bytes_per_second);
+    write_bytes_per_second = std::move(other258.write_bytes_per_second);
     __isset = std::move(other258.__isset);
 }
 replica_info &replica_info::operator=(const replica_info &other259)
@@ -6668,6 +6983,10 @@ replica_info &replica_info::operator=(const replica_info &other259)
     last_durable_decree = other259.last_durable_decree;
     app_type = other259.app_type;
     disk_tag = other259.disk_tag;
+    read_qps = other259.read_qps;
+    write_qps = other259.write_qps;
+    read_bytes_per_second = other259.read_bytes_per_second;
+    write_bytes_per_second = other259.write_bytes_per_second;
     __isset = other259.__isset;
     return *this;
 }
@@ -6681,6 +7000,10 @@ replica_info &replica_info::operator=(replica_info &&other260)
     last_durable_decree = std::move(other260.last_durable_decree);
     app_type = std::move(other260.app_type);
     disk_tag = std::move(other260.disk_tag);
+    read_qps = std::move(other260.read_qps);
+    write_qps = std::move(other260.write_qps);
+    read_bytes_per_second = std::move(other260.read_bytes_per_second);
+    write_bytes_per_second = std::move(other260.write_bytes_per_second);
     __isset = std::move(other260.__isset);
     return *this;
 }
@@ -6703,6 +7026,20 @@ void replica_info::printTo(std::ostream &out) const
         << "app_type=" << to_string(app_type);
     out << ", "
         << "disk_tag=" << to_string(disk_tag);
+    out << ", "
+        << "read_qps=";
+    (__isset.read_qps ? (out << to_string(read_qps)) : (out << "<null>"));
+    out << ", "
+        << "write_qps=";
+    (__isset.write_qps ? (out << to_string(write_qps)) : (out << "<null>"));
+    out << ", "
+        << "read_bytes_per_second=";
+    (__isset.read_bytes_per_second ? (out << to_string(read_bytes_per_second))
+                                   : (out << "<null>"));
+    out << ", "
+        << "write_bytes_per_second=";
+    (__isset.write_bytes_per_second ? (out << to_string(write_bytes_per_second))
+                                    : (out << "<null>"));
     out << ")";
 }
 
@@ -0,0 +1,134 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include "dist/replication/common/fs_manager.h"
+
+namespace dsn {
+namespace replication {
+
+class fs_manager_test : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        _manager.initialize({"/data/ssd1", "/data/ssd2", "/data/ssd3"},
+                            {"ssd1", "ssd2", "ssd3"},
+                            true);
+    }
+
+    dir_node *node(int index) { return _manager._dir_nodes[index].get(); }
+
+    void set_disk_stat(int index, int64_t available_mb, int64_t io_util)
+    {
+        dir_node *n = node(index);
+        n->disk_capacity_mb = 1000;
+        n->disk_available_mb = available_mb;
+        n->disk_available_ratio = available_mb * 100 / n->disk_capacity_mb;
+        n->disk_io_util = io_util;
+    }
+
+    std::string allocate(const gpid &pid)
+    {
+        std::string dir;
+        _manager.allocate_dir(pid, "test", dir);
+        std::string tag;
+        _manager.get_disk_tag(dir, tag);
+        return tag;
+    }
+
+    fs_manager _manager{true};
+};
+
+TEST_F(fs_manager_test, allocate_dir_without_disk_stat)
+{
+    // spread replicas over the disks when disk stat is unknown
+    ASSERT_EQ("ssd1", allocate(gpid(1, 0)));
+    ASSERT_EQ("ssd2", allocate(gpid(1, 1)));
+    ASSERT_EQ("ssd3", allocate(gpid(1, 2)));
+    ASSERT_EQ("ssd1", allocate(gpid(1, 3)));
+}
+
+TEST_F(fs_manager_test, allocate_dir_by_available_space)
+{
+    set_disk_stat(0, 300, 10);
+    set_disk_stat(1, 800, 10);
+    set_disk_stat(2, 500, 10);
+
+    ASSERT_EQ("ssd2", allocate(gpid(1, 0)));
+    // replicas of an app are still spread over the disks
+    ASSERT_EQ("ssd3", allocate(gpid(1, 1)));
+    ASSERT_EQ("ssd2", allocate(gpid(2, 0)));
+}
+
+TEST_F(fs_manager_test, allocate_dir_avoid_unhealthy_disk)
+{
+    _manager.set_placement_limits(10, 90);
+
+    // nearly full
+    set_disk_stat(0, 50, 10);
+    // saturated
+    set_disk_stat(1, 800, 95);
+    set_disk_stat(2, 200, 10);
+    ASSERT_FALSE(node(0)->is_healthy_for_placement(10, 90));
+    ASSERT_FALSE(node(1)->is_healthy_for_placement(10, 90));
+    ASSERT_TRUE(node(2)->is_healthy_for_placement(10, 90));
+
+    ASSERT_EQ("ssd3", allocate(gpid(1, 0)));
+    ASSERT_EQ("ssd3", allocate(gpid(1, 1)));
+
+    // choose the best one if all disks are unhealthy
+    set_disk_stat(2, 10, 10);
+    ASSERT_EQ("ssd2", allocate(gpid(1, 2)));
+}
+
+TEST_F(fs_manager_test, get_dir_by_tag)
+{
+    std::string dir;
+    ASSERT_EQ(ERR_OK, _manager.get_dir_by_tag("ssd2", dir));
+    ASSERT_EQ("/data/ssd2", dir);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, _manager.get_dir_by_tag("ssd4", dir));
+}
+
+TEST_F(fs_manager_test, sample_disk_stat)
+{
+    dir_node n("local", ".");
+    dir_node::disk_stat st = n.sample_disk_stat();
+    ASSERT_GT(st.capacity_mb, 0);
+    ASSERT_LE(st.available_ratio, 100);
+    // the node is only modified when the stat is published
+    ASSERT_EQ(0, n.disk_capacity_mb);
+
+    n.set_disk_stat(st);
+    ASSERT_EQ(st.capacity_mb, n.disk_capacity_mb);
+    ASSERT_EQ(st.available_mb, n.disk_available_mb);
+    ASSERT_EQ(st.available_ratio, n.disk_available_ratio);
+    ASSERT_EQ(st.io_util, n.disk_io_util);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -52,6 +52,7 @@ mutation::mutation()
     _appro_data_bytes = sizeof(mutation_header);
     _create_ts_ns = dsn_now_ns();
     _tid = ++s_tid;
+    _trace_id = 0;
 }
 
 mutation::~mutation()
@@ -87,6 +88,7 @@ void mutation::copy_from(mutation_ptr &old)
     client_requests = old->client_requests;
     _appro_data_bytes = old->_appro_data_bytes;
     _create_ts_ns = old->_create_ts_ns;
+    _trace_id = old->_trace_id;
 
     for (auto &r : client_requests) {
         if (r != nullptr) {
@@ -125,14 +127,18 @@ void mutation::add_client_request(task_code code, dsn::message_ex *request)
             (dsn_msg_serialize_format)request->header->context.u.serialize_format;
         request->add_ref(); // released on dctor
 
-        void *ptr;
-        size_t size;
-        bool r = request->read_next(&ptr, &size);
+        // a batched mutation is traced if any of its requests is sampled
+        if (_trace_id == 0 ||
+            (!tracing::is_sampled(_trace_id) && tracing::is_sampled(request->header->trace_id)))
+            _trace_id = request->header->trace_id;
+
+        // referencing the request buffer, so it can be appended to the prepare messages and
+        // the log without copying
+        bool r = request->read_next(update.data);
         dassert(r, "payload is not present");
         request->read_commit(0); // so we can re-read the request buffer in replicated app
-        update.data.assign((char *)ptr, 0, (int)size);
 
-        _appro_data_bytes += sizeof(int) + (int)size; // data size
+        _appro_data_bytes += sizeof(int) + (int)update.data.length(); // data size
     } else {
         update.code = RPC_REPLICATION_WRITE_EMPTY;
         _appro_data_bytes += sizeof(int); // empty data size
@@ -143,54 +149,93 @@ void mutation::add_client_request(task_code code, dsn::message_ex *request)
     dassert(client_requests.size() == data.updates.size(), "size must be equal");
 }
 
-void mutation::write_to(std::function<void(const blob &)> inserter) const
+namespace {
+struct log_task_code_table
 {
-    binary_writer writer(1024);
-    write_mutation_header(writer, data.header);
-    writer.write_pod(static_cast<int>(data.updates.size()));
-    for (const mutation_update &update : data.updates) {
-        // write task_code as string to make it cross-process compatible.
-        // avoid memory copy, equal to writer.write(std::string)
-        const char *cstr = update.code.to_string();
-        int len = static_cast<int>(strlen(cstr));
-        writer.write_pod(len);
-        if (len > 0)
-            writer.write(cstr, len);
+    log_task_code_table()
+    {
+        // the codes of the client writes, which are registered at startup
+        int max = task_code::max();
+        is_log_code.resize(max + 1, false);
+        for (int i = 0; i <= max; i++) {
+            task_spec *spec = task_spec::get(i);
+            if (i == RPC_REPLICATION_WRITE_EMPTY ||
+                (spec != nullptr && spec->type == TASK_TYPE_RPC_REQUEST)) {
+                codes.emplace_back(i);
+                is_log_code[i] = true;
+            }
+        }
+    }
 
-        writer.write_pod(static_cast<int>(update.serialization_type));
+    std::vector<task_code> codes;
+    std::vector<bool> is_log_code;
+};
 
-        writer.write_pod(static_cast<int>(update.data.length()));
-    }
-    inserter(writer.get_buffer());
-    for (const mutation_update &update : data.updates) {
-        inserter(update.data);
+const log_task_code_table &get_log_task_code_table()
+{
+    static log_task_code_table table;
+    return table;
+}
+}
+
+/*static*/ const std::vector<task_code> &mutation::log_task_codes()
+{
+    return get_log_task_code_table().codes;
+}
+
+void mutation::write_to(std::function<void(const blob &)> inserter, bool log_codes) const
+{
+    binary_writer writer(1024);
+    write_to_internal(writer, log_codes);
+    for (const blob &bb : writer.get_buffers()) {
+        inserter(bb);
     }
 }
 
 void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
 {
+    write_to_internal(writer, false);
+}
+
+void mutation::write_to_internal(binary_writer &writer, bool log_codes) const
+{
+    const std::vector<bool> &is_log_code = get_log_task_code_table().is_log_code;
+
     write_mutation_header(writer, data.header);
     writer.write_pod(static_cast<int>(data.updates.size()));
     for (const mutation_update &update : data.updates) {
-        // write task_code as string to make it cross-process compatible.
-        // avoid memory copy, equal to writer.write(std::string)
-        const char *cstr = update.code.to_string();
-        int len = static_cast<int>(strlen(cstr));
-        writer.write_pod(len);
-        if (len > 0)
-            writer.write(cstr, len);
+        int code = update.code.code();
+        if (log_codes && code < static_cast<int>(is_log_code.size()) && is_log_code[code]) {
+            // negative so that it is distinguished from the length of a name
+            writer.write_pod(-1 - code);
+        } else {
+            // write task_code as string to make it cross-process compatible.
+            // avoid memory copy, equal to writer.write(std::string)
+            const char *cstr = update.code.to_string();
+            int len = static_cast<int>(strlen(cstr));
+            writer.write_pod(len);
+            if (len > 0)
+                writer.write(cstr, len);
+        }
 
         writer.write_pod(static_cast<int>(update.serialization_type));
 
         writer.write_pod(static_cast<int>(update.data.length()));
     }
-    // TODO(qinzuoyan): directly append buffer to message to avoid memory copy
+    // large update data are appended as segments by reference, which are sent or written
+    // to the log as a scatter list
     for (const mutation_update &update : data.updates) {
-        writer.write(update.data.data(), update.data.length());
+        const blob &bb = update.data;
+        if (bb.length() >= binary_writer::zero_copy_write_min_bytes && bb.buffer_ptr() != nullptr)
+            writer.append(bb);
+        else if (bb.length() > 0)
+            writer.write(bb.data(), bb.length());
     }
 }
 
-/*static*/ mutation_ptr mutation::read_from(binary_reader &reader, dsn::message_ex *from)
+/*static*/ mutation_ptr mutation::read_from(binary_reader &reader,
+                                            dsn::message_ex *from,
+                                            const std::vector<task_code> *log_codes)
 {
     mutation_ptr mu(new mutation());
     read_mutation_header(reader, mu->data.header);
@@ -200,10 +245,25 @@ void mutation::write_to(binary_writer &writer, dsn::message_ex * /*to*/) const
     mu->data.updates.resize(size);
     std::vector<int> lengths(size, 0);
     for (int i = 0; i < size; ++i) {
-        std::string name;
-        reader.read(name);
-        ::dsn::task_code code = dsn::task_code::try_get(name, TASK_CODE_INVALID);
-        dassert(code != TASK_CODE_INVALID, "invalid mutation task code: %s", name.c_str());
+        int len;
+        reader.read_pod(len);
+        ::dsn::task_code code;
+        if (len < 0) {
+            int log_code = -1 - len;
+            dassert(log_codes != nullptr && log_code < static_cast<int>(log_codes->size()),
+                    "unknown mutation task code in the log: %d",
+                    log_code);
+            code = (*log_codes)[log_code];
+            dassert(code != TASK_CODE_INVALID,
+                    "invalid mutation task code in the log: %d",
+                    log_code);
+        } else {
+            std::string name(len, '\0');
+            if (len > 0)
+                reader.read(&name[0], len);
+            code = dsn::task_code::try_get(name, TASK_CODE_INVALID);
+            dassert(code != TASK_CODE_INVALID, "invalid mutation task code: %s", name.c_str());
+        }
         mu->data.updates[i].code = code;
 
         int type;
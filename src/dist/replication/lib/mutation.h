@@ -39,6 +39,7 @@
 #include <list>
 #include <atomic>
 #include <dsn/utility/link.h>
+#include <dsn/tool-api/tracing.h>
 
 #ifndef __linux__
 #pragma warning(disable : 4201)
@@ -48,6 +49,19 @@ namespace dsn {
 namespace replication {
 
 class mutation;
+
+// timestamps of the write phases on the primary in nanoseconds, 0 if the phase is not
+// reached. a write is received when the mutation is created, and the client requests are
+// replied while the mutation is being applied.
+struct write_phase_timestamps
+{
+    uint64_t prepared_ns = 0;
+    uint64_t logged_ns = 0;
+    // acks of the secondaries and the potential secondaries
+    std::vector<std::pair<::dsn::rpc_address, uint64_t>> acked_ns;
+    uint64_t committed_ns = 0;
+    uint64_t applied_ns = 0;
+};
 typedef dsn::ref_ptr<mutation> mutation_ptr;
 
 // mutation is the 2pc unit of PacificA, which wraps one or more client requests and add
@@ -84,12 +98,15 @@ public:
         return dsn_now_ms() + gap_ms >= _prepare_ts_ms + timeout_ms;
     }
     uint64_t create_ts_ns() const { return _create_ts_ns; }
+    // trace id of the rpcs, see dsn/tool-api/tracing.h
+    uint64_t trace_id() const { return _trace_id; }
     ballot get_ballot() const { return data.header.ballot; }
     decree get_decree() const { return data.header.decree; }
 
     // state change
     void set_id(ballot b, decree c);
     void set_timestamp(int64_t timestamp) { data.header.timestamp = timestamp; }
+    void set_trace_id(uint64_t trace_id) { _trace_id = trace_id; }
     void add_client_request(task_code code, dsn::message_ex *request);
     void copy_from(mutation_ptr &old);
     void set_logged()
@@ -122,9 +139,18 @@ public:
     // because:
     //   - the private log may be transfered to other node with different program
     //   - the private/shared log may be replayed by different program when server restart
-    void write_to(std::function<void(const blob &)> inserter) const;
+    //
+    // except that with log_codes set, the log records the codes in log_task_codes() as
+    // numbers, whose names are kept in the header of each log file, and log_codes of
+    // read_from() maps them to the codes of this process.
+    void write_to(std::function<void(const blob &)> inserter, bool log_codes) const; // to the log
     void write_to(binary_writer &writer, dsn::message_ex *to) const;
-    static mutation_ptr read_from(binary_reader &reader, dsn::message_ex *from);
+    static mutation_ptr read_from(binary_reader &reader,
+                                  dsn::message_ex *from,
+                                  const std::vector<task_code> *log_codes = nullptr);
+
+    // the codes which may be written to the log as numbers, taken at the first use
+    static const std::vector<task_code> &log_task_codes();
 
     static void write_mutation_header(binary_writer &writer, const mutation_header &header);
     static void read_mutation_header(binary_reader &reader, mutation_header &header);
@@ -135,9 +161,16 @@ public:
     // user requests
     std::vector<dsn::message_ex *> client_requests;
 
+    // for the latency breakdown of the writes, only set on the primary
+    write_phase_timestamps phase_ts;
+
     // used by pending mutation queue only
     mutation *next;
 
+private:
+    // log_codes: write the codes in log_task_codes() as numbers
+    void write_to_internal(binary_writer &writer, bool log_codes) const;
+
 private:
     union
     {
@@ -158,6 +191,7 @@ private:
     int _appro_data_bytes;
     uint64_t _create_ts_ns; // for profiling
     uint64_t _tid;          // trace id, unique in process
+    uint64_t _trace_id;     // taken from the client requests, or the prepare request
     static std::atomic<uint64_t> s_tid;
 };
 
@@ -78,7 +78,7 @@ namespace replication {
 
     // write mutation to pending buffer
     mu->data.header.log_offset = _pending_write_start_offset + _pending_write->size();
-    mu->write_to([this](blob bb) { _pending_write->add(bb); });
+    mu->write_to([this](blob bb) { _pending_write->add(bb); }, _log_task_codes);
 
     // update meta
     update_max_decree(mu->data.header.pid, d);
@@ -260,7 +260,7 @@ mutation_log_private::mutation_log_private(const std::string &dir,
 
     // write mutation to pending buffer
     mu->data.header.log_offset = _pending_write_start_offset + _pending_write->size();
-    mu->write_to([this](blob bb) { _pending_write->add(bb); });
+    mu->write_to([this](blob bb) { _pending_write->add(bb); }, _log_task_codes);
 
     // update meta
     _pending_write_max_commit =
@@ -468,6 +468,7 @@ mutation_log::mutation_log(const std::string &dir, int32_t max_log_file_mb, gpid
     _min_log_file_size_in_bytes = _max_log_file_size_in_bytes / 10;
     _owner_replica = r;
     _private_gpid = gpid;
+    _log_task_codes = false;
 
     if (r) {
         dassert(_private_gpid == r->get_gpid(),
@@ -764,9 +765,9 @@ error_code mutation_log::create_new_log_file()
         replica_log_info_map ds;
         ds[_private_gpid] =
             replica_log_info(_private_log_info.max_decree, _private_log_info.valid_start_offset);
-        header_len = logf->write_file_header(temp_writer, ds);
+        header_len = logf->write_file_header(temp_writer, ds, _log_task_codes);
     } else {
-        header_len = logf->write_file_header(temp_writer, _shared_log_info_map);
+        header_len = logf->write_file_header(temp_writer, _shared_log_info_map, _log_task_codes);
     }
 
     log_block *blk = logf->prepare_log_block();
@@ -882,7 +883,7 @@ std::pair<log_file_ptr, int64_t> mutation_log::mark_new_offset(size_t size,
     while (true) {
         while (!reader->is_eof()) {
             auto old_size = reader->get_remaining_size();
-            mutation_ptr mu = mutation::read_from(*reader, nullptr);
+            mutation_ptr mu = mutation::read_from(*reader, nullptr, &log->log_codes());
             dassert(nullptr != mu, "");
             mu->set_logged();
 
@@ -2046,6 +2047,7 @@ log_file::log_file(
     _index = index;
     _crc32 = 0;
     _last_write_time = 0;
+    _log_codes_size = 0;
     memset(&_header, 0, sizeof(_header));
 
     if (is_read) {
@@ -2225,7 +2227,8 @@ int log_file::read_file_header(binary_reader &reader)
     /*
      * the log file header structure:
      *   log_file_header +
-     *   count + count * (gpid + replica_log_info)
+     *   count + count * (gpid + replica_log_info) +
+     *   count + count * (code + name)  // since version 0x2
      */
     reader.read_pod(_header);
 
@@ -2241,6 +2244,27 @@ int log_file::read_file_header(binary_reader &reader)
         _previous_log_max_decrees[gpid] = info;
     }
 
+    _log_codes.clear();
+    _log_codes_size = 0;
+    if (_header.version >= 0x2) {
+        reader.read(count);
+        _log_codes_size += sizeof(count);
+        for (int i = 0; i < count; i++) {
+            int code;
+            std::string name;
+            reader.read(code);
+            reader.read(name);
+            _log_codes_size += sizeof(code) + sizeof(int) + name.length();
+
+            // bounded in case of corrupted data
+            if (code >= 0 && code < 0x10000) {
+                if (code >= static_cast<int>(_log_codes.size()))
+                    _log_codes.resize(code + 1, TASK_CODE_INVALID);
+                _log_codes[code] = task_code::try_get(name, TASK_CODE_INVALID);
+            }
+        }
+    }
+
     return get_file_header_size();
 }
 
@@ -2248,25 +2272,30 @@ int log_file::get_file_header_size() const
 {
     int count = static_cast<int>(_previous_log_max_decrees.size());
     return static_cast<int>(sizeof(log_file_header) + sizeof(count) +
-                            (sizeof(gpid) + sizeof(replica_log_info)) * count);
+                            (sizeof(gpid) + sizeof(replica_log_info)) * count) +
+           _log_codes_size;
 }
 
 bool log_file::is_right_header() const
 {
-    return _header.magic == 0xdeadbeef && _header.start_global_offset == _start_offset;
+    return _header.magic == 0xdeadbeef && _header.version >= 0x1 && _header.version <= 0x2 &&
+           _header.start_global_offset == _start_offset;
 }
 
-int log_file::write_file_header(binary_writer &writer, const replica_log_info_map &init_max_decrees)
+int log_file::write_file_header(binary_writer &writer,
+                                const replica_log_info_map &init_max_decrees,
+                                bool log_codes)
 {
     /*
      * the log file header structure:
      *   log_file_header +
-     *   count + count * (gpid + replica_log_info)
+     *   count + count * (gpid + replica_log_info) +
+     *   count + count * (code + name)  // since version 0x2
      */
     _previous_log_max_decrees = init_max_decrees;
 
     _header.magic = 0xdeadbeef;
-    _header.version = 0x1;
+    _header.version = log_codes ? 0x2 : 0x1;
     _header.start_global_offset = start_offset();
 
     writer.write_pod(_header);
@@ -2278,6 +2307,21 @@ int log_file::write_file_header(binary_writer &writer, const replica_log_info_ma
         writer.write_pod(kv.second);
     }
 
+    _log_codes_size = 0;
+    if (!log_codes)
+        return get_file_header_size();
+
+    // the codes written as numbers by mutation::write_to()
+    int start_size = writer.total_size();
+    const std::vector<task_code> &codes = mutation::log_task_codes();
+    count = static_cast<int>(codes.size());
+    writer.write(count);
+    for (task_code code : codes) {
+        writer.write(code.code());
+        writer.write(std::string(code.to_string()));
+    }
+    _log_codes_size = writer.total_size() - start_size;
+
     return get_file_header_size();
 }
 } // namespace replication
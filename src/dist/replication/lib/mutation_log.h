@@ -85,7 +85,7 @@ struct log_block_header
 struct log_file_header
 {
     int32_t magic;   // 0xdeadbeef
-    int32_t version; // current 0x1
+    int32_t version; // 0x1, or 0x2 which is followed by the task code dictionary
     int64_t
         start_global_offset; // start offset in the global space, equals to the file name's postfix
 };
@@ -198,6 +198,11 @@ public:
     // thread safe
     void set_valid_start_offset_on_open(gpid gpid, int64_t valid_start_offset);
 
+    // write the task codes as numbers with a dictionary in the file header (version 0x2),
+    // which can't be read by the binaries before, so it is enabled only after all the
+    // replica servers are upgraded. should be called before open
+    void set_log_task_codes(bool enabled) { _log_task_codes = enabled; }
+
     // when create a new replica, need to reset current max decree
     // returns current global end offset, needs to be remebered by caller for gc usage
     // thread safe
@@ -347,6 +352,7 @@ protected:
     int64_t _max_log_file_size_in_bytes;
     int64_t _min_log_file_size_in_bytes;
     bool _force_flush;
+    bool _log_task_codes;
 
     dsn::task_tracker _tracker;
 
@@ -614,11 +620,17 @@ public:
     decree previous_log_max_decree(const gpid &pid);
     // file header
     log_file_header &header() { return _header; }
+    // maps the task codes written as numbers in this file to the codes of this process,
+    // TASK_CODE_INVALID if the name is not registered
+    const std::vector<task_code> &log_codes() const { return _log_codes; }
 
     // read file header from reader, return byte count consumed
     int read_file_header(binary_reader &reader);
-    // write file header to writer, return byte count written
-    int write_file_header(binary_writer &writer, const replica_log_info_map &init_max_decrees);
+    // write file header to writer, return byte count written.
+    // log_codes: write the task code dictionary, see mutation::write_to()
+    int write_file_header(binary_writer &writer,
+                          const replica_log_info_map &init_max_decrees,
+                          bool log_codes = false);
     // get serialized size of current file header
     int get_file_header_size() const;
     // if the file header is valid
@@ -650,6 +662,11 @@ private:
     // for read, the value is read from file header.
     // for write, the value is set by write_file_header().
     replica_log_info_map _previous_log_max_decrees;
+
+    // read from the file header of version 0x2
+    std::vector<task_code> _log_codes;
+    // serialized size of the task code dictionary in the file header
+    int _log_codes_size;
 };
 } // namespace replication
 } // namespace dsn
@@ -75,6 +75,25 @@ replica::replica(
     _counter_recent_write_throttling_reject_count.init_app_counter(
         "eon.replica", counter_str.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, counter_str.c_str());
 
+    // queue: received -> prepared, log: prepared -> logged,
+    // prepare.ack: prepared -> acked by the slowest secondary,
+    // commit.wait: max(logged, acked) -> committed, apply: committed -> applied and replied
+    std::pair<perf_counter_wrapper *, const char *> phase_counters[] = {
+        {&_counter_write_queue_latency, "queue"},
+        {&_counter_write_log_latency, "log"},
+        {&_counter_write_prepare_ack_latency, "prepare.ack"},
+        {&_counter_write_commit_wait_latency, "commit.wait"},
+        {&_counter_write_apply_latency, "apply"},
+        {&_counter_write_total_latency, "total"},
+    };
+    for (auto &phase : phase_counters) {
+        counter_str = fmt::format("write.{}.latency(ns)@{}", phase.second, gpid.get_app_id());
+        phase.first->init_app_counter("eon.replica",
+                                      counter_str.c_str(),
+                                      COUNTER_TYPE_NUMBER_PERCENTILES,
+                                      counter_str.c_str());
+    }
+
     if (need_restore) {
         // add an extra env for restore
         _extra_envs.insert(
@@ -164,7 +183,12 @@ void replica::on_client_read(task_code code, dsn::message_ex *request)
     }
 
     dassert(_app != nullptr, "");
+    _load_meter.on_read(request->header->body_length);
+    uint64_t start_ns = dsn_now_ns();
     _app->on_request(request);
+    _stub->_metric_read_latency_us
+        ->get(metric_labels(get_gpid().get_app_id(), get_gpid().get_partition_index(), code))
+        ->observe((dsn_now_ns() - start_ns) / 1000);
 }
 
 void replica::response_client_read(dsn::message_ex *request, error_code error)
@@ -253,6 +277,8 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     error_code err = ERR_OK;
     decree d = mu->data.header.decree;
+    bool traced = tracing::is_sampled(mu->trace_id());
+    uint64_t start_ns = dsn_now_ns();
 
     switch (status()) {
     case partition_status::PS_INACTIVE:
@@ -272,7 +298,9 @@ void replica::execute_mutation(mutation_ptr &mu)
                 "app commit: %" PRId64 ", mutation decree: %" PRId64 "",
                 _app->last_committed_decree(),
                 d);
+        mu->phase_ts.committed_ns = start_ns;
         err = _app->apply_mutation(mu);
+        mu->phase_ts.applied_ns = dsn_now_ns();
     } break;
 
     case partition_status::PS_SECONDARY:
@@ -326,11 +354,32 @@ void replica::execute_mutation(mutation_ptr &mu)
     dinfo(
         "TwoPhaseCommit, %s: mutation %s committed, err = %s", name(), mu->name(), err.to_string());
 
+    if (traced) {
+        uint64_t now_ns = dsn_now_ns();
+        tracing::add_span(
+            mu->trace_id(), "replica.commit", start_ns, now_ns, tracing::span_arg::number, d);
+        // the client requests are replied by the app when the mutation is applied
+        if (status() == partition_status::PS_PRIMARY && !mu->client_requests.empty()) {
+            tracing::add_span(mu->trace_id(),
+                              "replica.client_write",
+                              mu->create_ts_ns(),
+                              now_ns,
+                              tracing::span_arg::number,
+                              d);
+        }
+    }
+
     if (err != ERR_OK) {
         handle_local_failure(err);
     }
 
     if (status() == partition_status::PS_PRIMARY) {
+        record_write_latency(mu);
+        if (!_primary_states.handover_node.is_invalid()) {
+            try_finish_primary_handover();
+            return;
+        }
+
         mutation_ptr next = _primary_states.write_queue.check_possible_work(
             static_cast<int>(_prepare_list->max_decree() - d));
 
@@ -340,6 +389,43 @@ void replica::execute_mutation(mutation_ptr &mu)
     }
 }
 
+void replica::record_write_latency(const mutation_ptr &mu)
+{
+    const write_phase_timestamps &ts = mu->phase_ts;
+    // skip the empty writes, and the mutations not prepared by this primary
+    if (mu->client_requests.empty() || mu->client_requests.front() == nullptr ||
+        ts.prepared_ns == 0 || ts.logged_ns == 0 || ts.applied_ns == 0)
+        return;
+
+    uint64_t received_ns = mu->create_ts_ns();
+    uint64_t ready_ns = ts.logged_ns;
+    _counter_write_queue_latency->set(ts.prepared_ns - received_ns);
+    _counter_write_log_latency->set(ts.logged_ns - ts.prepared_ns);
+    if (!ts.acked_ns.empty()) {
+        uint64_t last_acked_ns = 0;
+        for (const auto &ack : ts.acked_ns) {
+            last_acked_ns = std::max(last_acked_ns, ack.second);
+        }
+        _counter_write_prepare_ack_latency->set(last_acked_ns - ts.prepared_ns);
+        ready_ns = std::max(ready_ns, last_acked_ns);
+    }
+    // ready_ns may be later if the mutation is committed by a later one
+    _counter_write_commit_wait_latency->set(ts.committed_ns > ready_ns ? ts.committed_ns - ready_ns
+                                                                        : 0);
+    _counter_write_apply_latency->set(ts.applied_ns - ts.committed_ns);
+    _counter_write_total_latency->set(ts.applied_ns - received_ns);
+
+    uint64_t total_us = (ts.applied_ns - received_ns) / 1000;
+    for (const mutation_update &update : mu->data.updates) {
+        _stub->_metric_write_latency_us
+            ->get(metric_labels(
+                get_gpid().get_app_id(), get_gpid().get_partition_index(), update.code))
+            ->observe(total_us);
+    }
+
+    _stub->_slowest_writes.add(*mu);
+}
+
 mutation_ptr replica::new_mutation(decree decree)
 {
     mutation_ptr mu(new mutation());
@@ -55,6 +55,7 @@
 #include "prepare_list.h"
 #include "replica_context.h"
 #include "throttling_controller.h"
+#include "replica_load_meter.h"
 
 namespace dsn {
 namespace replication {
@@ -138,6 +139,7 @@ public:
     const app_info *get_app_info() const { return &_app_info; }
     decree max_prepared_decree() const { return _prepare_list->max_decree(); }
     decree last_committed_decree() const { return _prepare_list->last_committed_decree(); }
+    replica_load_meter &load_meter() { return _load_meter; }
     decree last_prepared_decree() const;
     decree last_durable_decree() const;
     decree last_flushed_decree() const;
@@ -163,6 +165,8 @@ private:
     void response_client_read(dsn::message_ex *request, error_code error);
     void response_client_write(dsn::message_ex *request, error_code error);
     void execute_mutation(mutation_ptr &mu);
+    // update the latency counters of the write phases with a mutation applied on the primary
+    void record_write_latency(const mutation_ptr &mu);
     mutation_ptr new_mutation(decree decree);
 
     // initialization
@@ -179,7 +183,10 @@ private:
                               const mutation_ptr &mu,
                               int timeout_milliseconds,
                               int64_t learn_signature = invalid_signature);
-    void on_append_log_completed(mutation_ptr &mu, error_code err, size_t size);
+    void on_append_log_completed(mutation_ptr &mu,
+                                 uint64_t append_ts_ns,
+                                 error_code err,
+                                 size_t size);
     void on_prepare_reply(std::pair<mutation_ptr, partition_status::type> pr,
                           error_code err,
                           dsn::message_ex *request,
@@ -219,6 +226,11 @@ private:
     void upgrade_to_secondary_on_primary(::dsn::rpc_address node);
     void downgrade_to_secondary_on_primary(configuration_update_request &proposal);
     void downgrade_to_inactive_on_primary(configuration_update_request &proposal);
+    void handover_primary(configuration_update_request &proposal);
+    // called on the primary during a handover when a mutation is committed, the handover
+    // is proposed to meta server once all the prepared mutations are committed
+    void try_finish_primary_handover();
+    void abort_primary_handover();
     void remove(configuration_update_request &proposal);
     void update_configuration_on_meta_server(config_type::type type,
                                              ::dsn::rpc_address node,
@@ -378,11 +390,19 @@ private:
     bool _is_initializing;       // when initializing, switching to primary need to update ballot
     bool _deny_client_write;     // if deny all write requests
     throttling_controller _write_throttling_controller;
+    replica_load_meter _load_meter;
 
     // perf counters
     perf_counter_wrapper _counter_private_log_size;
     perf_counter_wrapper _counter_recent_write_throttling_delay_count;
     perf_counter_wrapper _counter_recent_write_throttling_reject_count;
+    // latency of the write phases on the primary, shared by the replicas of the same app
+    perf_counter_wrapper _counter_write_queue_latency;
+    perf_counter_wrapper _counter_write_log_latency;
+    perf_counter_wrapper _counter_write_prepare_ack_latency;
+    perf_counter_wrapper _counter_write_commit_wait_latency;
+    perf_counter_wrapper _counter_write_apply_latency;
+    perf_counter_wrapper _counter_write_total_latency;
 
     dsn::task_tracker _tracker;
     // the thread access checker
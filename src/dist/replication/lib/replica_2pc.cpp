@@ -45,6 +45,7 @@ namespace replication {
 void replica::on_client_write(task_code code, dsn::message_ex *request, bool ignore_throttling)
 {
     _checker.only_one_thread_access();
+    tracing::scoped_span span(request->header->trace_id, "replica.on_client_write");
 
     if (_deny_client_write) {
         // Do not relay any message to the peer client to let it timeout, it's OK coz some users
@@ -59,7 +60,7 @@ void replica::on_client_write(task_code code, dsn::message_ex *request, bool ign
         return;
     }
 
-    if (partition_status::PS_PRIMARY != status()) {
+    if (partition_status::PS_PRIMARY != status() || !_primary_states.handover_node.is_invalid()) {
         response_client_write(request, ERR_INVALID_STATE);
         return;
     }
@@ -102,6 +103,7 @@ void replica::on_client_write(task_code code, dsn::message_ex *request, bool ign
     }
 
     dinfo("%s: got write request from %s", name(), request->header->from_address.to_string());
+    _load_meter.on_write(request->header->body_length);
     auto mu = _primary_states.write_queue.add_work(code, request, this);
     if (mu) {
         init_prepare(mu, false);
@@ -114,6 +116,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
             "invalid partition_status, status = %s",
             enum_to_string(status()));
 
+    tracing::scoped_span span(mu->trace_id(), "replica.init_prepare");
     error_code err = ERR_OK;
     uint8_t count = 0;
     mu->data.header.last_committed_decree = last_committed_decree();
@@ -162,6 +165,9 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
     if (err != ERR_OK) {
         goto ErrOut;
     }
+    if (!reconciliation) {
+        mu->phase_ts.prepared_ns = dsn_now_ns();
+    }
 
     // remote prepare
     mu->set_prepare_ts();
@@ -201,6 +207,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation)
                                              std::bind(&replica::on_append_log_completed,
                                                        this,
                                                        mu,
+                                                       dsn_now_ns(),
                                                        std::placeholders::_1,
                                                        std::placeholders::_2),
                                              get_gpid().thread_hash(),
@@ -240,6 +247,8 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
 {
     dsn::message_ex *msg = dsn::message_ex::create_request(
         RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
+    // the secondaries trace the mutation together with the client requests
+    msg->header->trace_id = mu->trace_id();
     replica_configuration rconfig;
     _primary_states.get_replica_config(status, rconfig, learn_signature);
 
@@ -250,11 +259,20 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
         mu->write_to(writer, msg);
     }
 
+    uint64_t start_ns = tracing::is_sampled(mu->trace_id()) ? dsn_now_ns() : 0;
     mu->remote_tasks()[addr] =
         rpc::call(addr,
                   msg,
                   &_tracker,
                   [=](error_code err, dsn::message_ex *request, dsn::message_ex *reply) {
+                      if (start_ns != 0) {
+                          tracing::add_span(mu->trace_id(),
+                                            "replica.prepare_rpc",
+                                            start_ns,
+                                            dsn_now_ns(),
+                                            tracing::span_arg::address,
+                                            tracing::pack_address(addr));
+                      }
                       on_prepare_reply(std::make_pair(mu, rconfig.status), err, request, reply);
                   },
                   get_gpid().thread_hash());
@@ -293,6 +311,8 @@ void replica::on_prepare(dsn::message_ex *request)
         unmarshall(reader, rconfig, DSF_THRIFT_BINARY);
         mu = mutation::read_from(reader, request);
     }
+    mu->set_trace_id(request->header->trace_id);
+    tracing::scoped_span span(mu->trace_id(), "replica.on_prepare");
 
     decree decree = mu->data.header.decree;
 
@@ -430,16 +450,29 @@ void replica::on_prepare(dsn::message_ex *request)
                                          std::bind(&replica::on_append_log_completed,
                                                    this,
                                                    mu,
+                                                   dsn_now_ns(),
                                                    std::placeholders::_1,
                                                    std::placeholders::_2),
                                          get_gpid().thread_hash());
     dassert(nullptr != mu->log_task(), "");
 }
 
-void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t size)
+void replica::on_append_log_completed(mutation_ptr &mu,
+                                      uint64_t append_ts_ns,
+                                      error_code err,
+                                      size_t size)
 {
     _checker.only_one_thread_access();
 
+    if (tracing::is_sampled(mu->trace_id())) {
+        tracing::add_span(mu->trace_id(),
+                          "replica.log_append",
+                          append_ts_ns,
+                          dsn_now_ns(),
+                          tracing::span_arg::number,
+                          mu->get_decree());
+    }
+
     dinfo("%s: append shared log completed for mutation %s, size = %u, err = %s",
           name(),
           mu->name(),
@@ -460,6 +493,9 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
         switch (status()) {
         case partition_status::PS_PRIMARY:
             if (err == ERR_OK) {
+                if (mu->phase_ts.prepared_ns != 0) {
+                    mu->phase_ts.logged_ns = dsn_now_ns();
+                }
                 do_possible_commit_on_primary(mu);
             } else {
                 handle_local_failure(err);
@@ -556,6 +592,10 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
                 resp.decree,
                 mu->data.header.decree);
 
+        if (mu->phase_ts.prepared_ns != 0) {
+            mu->phase_ts.acked_ns.emplace_back(node, dsn_now_ns());
+        }
+
         switch (target_status) {
         case partition_status::PS_SECONDARY:
             dassert(_primary_states.check_exist(node, partition_status::PS_SECONDARY),
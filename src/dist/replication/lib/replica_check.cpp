@@ -120,7 +120,7 @@ void replica::broadcast_group_check()
     }
 
     // send empty prepare when necessary
-    if (!_options->empty_write_disabled &&
+    if (!_options->empty_write_disabled && _primary_states.handover_node.is_invalid() &&
         dsn_now_ms() >= _primary_states.last_prepare_ts_ms + _options->group_check_interval_ms) {
         mutation_ptr mu = new_mutation(invalid_decree);
         mu->add_client_request(RPC_REPLICATION_WRITE_EMPTY, nullptr);
@@ -70,6 +70,17 @@ void replica::on_config_proposal(configuration_update_request &proposal)
     if (proposal.config.ballot > get_ballot()) {
         if (!update_configuration(proposal.config)) {
             // is closing or update failed
+            if (proposal.type == config_type::CT_HANDOVER_PRIMARY &&
+                proposal.node == _stub->_primary_address &&
+                status() == partition_status::PS_SECONDARY) {
+                // the new primary is already recorded on meta server, retry shortly rather
+                // than waiting for the next config sync, e.g. after the checkpoint finishes
+                tasking::enqueue(LPC_DELAY_UPDATE_CONFIG,
+                                 &_tracker,
+                                 [this, proposal]() mutable { on_config_proposal(proposal); },
+                                 get_gpid().thread_hash(),
+                                 std::chrono::milliseconds(100));
+            }
             return;
         }
     }
@@ -89,6 +100,9 @@ void replica::on_config_proposal(configuration_update_request &proposal)
     case config_type::CT_DOWNGRADE_TO_INACTIVE:
         downgrade_to_inactive_on_primary(proposal);
         break;
+    case config_type::CT_HANDOVER_PRIMARY:
+        handover_primary(proposal);
+        break;
     case config_type::CT_REMOVE:
         remove(proposal);
         break;
@@ -286,6 +300,101 @@ void replica::downgrade_to_inactive_on_primary(configuration_update_request &pro
         config_type::CT_DOWNGRADE_TO_INACTIVE, proposal.node, proposal.config);
 }
 
+// on the old primary, target is the old primary and node is the secondary to take over;
+// on the new primary, the configuration is already updated with the proposal
+void replica::handover_primary(configuration_update_request &proposal)
+{
+    if (proposal.node == _stub->_primary_address) {
+        if (status() == partition_status::PS_PRIMARY && proposal.config.ballot == get_ballot()) {
+            _primary_states.last_prepare_decree_on_new_primary = _prepare_list->max_decree();
+        }
+        return;
+    }
+
+    if (proposal.config.ballot != get_ballot() || status() != partition_status::PS_PRIMARY)
+        return;
+
+    if (!_primary_states.handover_node.is_invalid()) {
+        dinfo("%s: primary handover to %s on the way, skip the incoming proposal",
+              name(),
+              _primary_states.handover_node.to_string());
+        return;
+    }
+
+    if (!_primary_states.check_exist(proposal.node, partition_status::PS_SECONDARY)) {
+        dwarn("%s: ignore primary handover proposal as %s is not a secondary",
+              name(),
+              proposal.node.to_string());
+        return;
+    }
+
+    ddebug("%s: start primary handover to %s, last_committed_decree = %" PRId64
+           ", max_prepared_decree = %" PRId64,
+           name(),
+           proposal.node.to_string(),
+           last_committed_decree(),
+           max_prepared_decree());
+
+    // no new mutations are started from now on, the clients retry on the new primary
+    _primary_states.handover_node = proposal.node;
+    std::vector<mutation_ptr> queued;
+    _primary_states.write_queue.clear(queued);
+    for (auto &m : queued) {
+        for (auto &r : m->client_requests) {
+            response_client_write(r, ERR_INVALID_STATE);
+        }
+    }
+
+    _primary_states.handover_timeout_task =
+        tasking::enqueue(LPC_PRIMARY_HANDOVER_TIMEOUT,
+                         &_tracker,
+                         [this]() { abort_primary_handover(); },
+                         get_gpid().thread_hash(),
+                         std::chrono::milliseconds(_options->primary_handover_timeout_ms));
+
+    try_finish_primary_handover();
+}
+
+void replica::try_finish_primary_handover()
+{
+    // the prepared mutations are acked by all the secondaries once they are committed,
+    // so the new primary has all of them in its prepare list
+    if (last_committed_decree() < max_prepared_decree())
+        return;
+
+    ::dsn::rpc_address node = _primary_states.handover_node;
+    _primary_states.handover_node.set_invalid();
+    if (_primary_states.handover_timeout_task != nullptr) {
+        _primary_states.handover_timeout_task->cancel(false);
+        _primary_states.handover_timeout_task = nullptr;
+    }
+
+    partition_configuration new_config = _primary_states.membership;
+    replica_helper::remove_node(node, new_config.secondaries);
+    new_config.secondaries.push_back(new_config.primary);
+    new_config.primary = node;
+
+    update_configuration_on_meta_server(config_type::CT_HANDOVER_PRIMARY, node, new_config);
+}
+
+void replica::abort_primary_handover()
+{
+    _checker.only_one_thread_access();
+
+    _primary_states.handover_timeout_task = nullptr;
+    if (status() != partition_status::PS_PRIMARY || _primary_states.handover_node.is_invalid())
+        return;
+
+    dwarn("%s: abort primary handover to %s as the mutations are not committed in %d ms, "
+          "last_committed_decree = %" PRId64 ", max_prepared_decree = %" PRId64,
+          name(),
+          _primary_states.handover_node.to_string(),
+          _options->primary_handover_timeout_ms,
+          last_committed_decree(),
+          max_prepared_decree());
+    _primary_states.handover_node.set_invalid();
+}
+
 void replica::remove(configuration_update_request &proposal)
 {
     if (proposal.config.ballot != get_ballot() || status() != partition_status::PS_PRIMARY)
@@ -509,6 +618,7 @@ void replica::on_update_configuration_on_meta_server_reply(
         case config_type::CT_DOWNGRADE_TO_SECONDARY:
         case config_type::CT_DOWNGRADE_TO_INACTIVE:
         case config_type::CT_UPGRADE_TO_SECONDARY:
+        case config_type::CT_HANDOVER_PRIMARY:
             break;
         case config_type::CT_REMOVE:
             if (req->node != _stub->_primary_address) {
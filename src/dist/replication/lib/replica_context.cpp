@@ -88,6 +88,10 @@ void primary_context::cleanup(bool clean_pending_mutations)
     // clean up reconfiguration
     CLEANUP_TASK_ALWAYS(reconfiguration_task)
 
+    // clean up primary handover
+    CLEANUP_TASK_ALWAYS(handover_timeout_task)
+    handover_node.set_invalid();
+
     // clean up checkpoint
     CLEANUP_TASK_ALWAYS(checkpoint_task)
 
@@ -97,7 +101,8 @@ void primary_context::cleanup(bool clean_pending_mutations)
 bool primary_context::is_cleaned()
 {
     return nullptr == group_check_task && nullptr == reconfiguration_task &&
-           nullptr == checkpoint_task && group_check_pending_replies.empty();
+           nullptr == checkpoint_task && nullptr == handover_timeout_task &&
+           group_check_pending_replies.empty();
 }
 
 void primary_context::do_cleanup_pending_mutations(bool clean_pending_mutations)
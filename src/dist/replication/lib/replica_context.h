@@ -107,6 +107,11 @@ public:
     // (possibly true on old primary) before opening read service
     decree last_prepare_decree_on_new_primary;
 
+    // the secondary which is going to take over, valid during a primary handover in which
+    // new writes are rejected until all the prepared mutations are committed
+    ::dsn::rpc_address handover_node;
+    dsn::task_ptr handover_timeout_task;
+
     // copy checkpoint from secondaries ptr
     dsn::task_ptr checkpoint_task;
 
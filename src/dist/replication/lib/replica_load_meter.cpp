@@ -0,0 +1,76 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <dsn/utility/utils.h>
+#include <dsn/dist/replication/replication_types.h>
+
+#include "replica_load_meter.h"
+
+namespace dsn {
+namespace replication {
+
+replica_load_meter::replica_load_meter()
+    : _read_count(0),
+      _read_bytes(0),
+      _write_count(0),
+      _write_bytes(0),
+      _last_report_ns(utils::get_current_physical_time_ns()),
+      _last_read_count(0),
+      _last_read_bytes(0),
+      _last_write_count(0),
+      _last_write_bytes(0)
+{
+}
+
+void replica_load_meter::report_load(/*out*/ replica_info &info)
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+    uint64_t read_count = _read_count.load(std::memory_order_relaxed);
+    uint64_t read_bytes = _read_bytes.load(std::memory_order_relaxed);
+    uint64_t write_count = _write_count.load(std::memory_order_relaxed);
+    uint64_t write_bytes = _write_bytes.load(std::memory_order_relaxed);
+    uint64_t now = utils::get_current_physical_time_ns();
+
+    // at least 1ms to avoid the rates to be inflated by two reports issued back to back
+    uint64_t elapsed_ms = std::max<uint64_t>((now - _last_report_ns) / 1000000, 1);
+    auto rate = [elapsed_ms](uint64_t current, uint64_t last) {
+        return static_cast<int64_t>((current - last) * 1000 / elapsed_ms);
+    };
+
+    info.__set_read_qps(rate(read_count, _last_read_count));
+    info.__set_write_qps(rate(write_count, _last_write_count));
+    info.__set_read_bytes_per_second(rate(read_bytes, _last_read_bytes));
+    info.__set_write_bytes_per_second(rate(write_bytes, _last_write_bytes));
+
+    _last_report_ns = now;
+    _last_read_count = read_count;
+    _last_read_bytes = read_bytes;
+    _last_write_count = write_count;
+    _last_write_bytes = write_bytes;
+}
+}
+}
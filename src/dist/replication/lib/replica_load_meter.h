@@ -0,0 +1,77 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <dsn/utility/synchronize.h>
+
+namespace dsn {
+namespace replication {
+
+class replica_info;
+
+// counts the client requests served by a replica, and turns them into per-second rates
+// which are reported to meta server by config sync for load-aware balancing.
+//
+// on_read()/on_write() are lock-free and may be called concurrently, report_load() is
+// called once every config sync and computes the rates since its last call.
+class replica_load_meter
+{
+public:
+    replica_load_meter();
+
+    void on_read(uint64_t bytes)
+    {
+        _read_count.fetch_add(1, std::memory_order_relaxed);
+        _read_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void on_write(uint64_t bytes)
+    {
+        _write_count.fetch_add(1, std::memory_order_relaxed);
+        _write_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // fill the load fields of info with the rates since the last report
+    void report_load(/*out*/ replica_info &info);
+
+private:
+    std::atomic<uint64_t> _read_count;
+    std::atomic<uint64_t> _read_bytes;
+    std::atomic<uint64_t> _write_count;
+    std::atomic<uint64_t> _write_bytes;
+
+    utils::ex_lock_nr_spin _lock;
+    uint64_t _last_report_ns;
+    uint64_t _last_read_count;
+    uint64_t _last_read_bytes;
+    uint64_t _last_write_count;
+    uint64_t _last_write_bytes;
+};
+}
+}
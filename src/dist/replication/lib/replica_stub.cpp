@@ -44,13 +44,21 @@
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/dist/replication/replication_app_base.h>
 #include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdlib>
 #include <deque>
+#include <sstream>
+#include <set>
 
 namespace dsn {
 namespace replication {
 
 bool replica_stub::s_not_exit_on_log_failure = false;
 
+// the number of the slowest writes kept for the command "slowest-writes"
+static const int SLOWEST_WRITE_COUNT = 100;
+
 replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
                            bool is_long_subscriber /* = true*/)
     : serverlet("replica_stub"),
@@ -62,18 +70,25 @@ replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
       _query_compact_command(nullptr),
       _query_app_envs_command(nullptr),
       _useless_dir_reserve_seconds_command(nullptr),
+      _query_disk_info_command(nullptr),
+      _migrate_replica_disk_command(nullptr),
+      _slowest_writes_command(nullptr),
       _deny_client(false),
       _verbose_client_log(false),
       _verbose_commit_log(false),
       _gc_disk_error_replica_interval_seconds(3600),
       _gc_disk_garbage_replica_interval_seconds(3600),
       _learn_app_concurrent_count(0),
+      _slowest_writes(SLOWEST_WRITE_COUNT),
       _fs_manager(false)
 {
     _replica_state_subscriber = subscriber;
     _is_long_subscriber = is_long_subscriber;
     _failure_detector = nullptr;
     _state = NS_Disconnected;
+    _config_sync_version = 0;
+    _acked_config_sync_version = 0;
+    _last_full_config_sync_ms = 0;
     _log = nullptr;
     _primary_address_str[0] = '\0';
     install_perf_counters();
@@ -83,6 +98,15 @@ replica_stub::~replica_stub(void) { close(); }
 
 void replica_stub::install_perf_counters()
 {
+    _metric_read_latency_us = metric_registry::instance().register_histogram(
+        "replica_read_latency_us",
+        "time to serve the read requests on the primaries",
+        metric_registry::latency_us_buckets());
+    _metric_write_latency_us = metric_registry::instance().register_histogram(
+        "replica_write_latency_us",
+        "time from receiving the write requests to applying them on the primaries",
+        metric_registry::latency_us_buckets());
+
     _counter_replicas_count.init_app_counter(
         "eon.replica_stub", "replica(Count)", COUNTER_TYPE_NUMBER, "# in replica_stub._replicas");
     _counter_replicas_opening_count.init_app_counter("eon.replica_stub",
@@ -343,6 +367,8 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
 
     {
         dsn::error_code err;
+        _fs_manager.set_placement_limits(_options.disk_min_available_ratio_for_placement,
+                                         _options.disk_max_io_util_for_placement);
         err = _fs_manager.initialize(_options.data_dirs, _options.data_dir_tags, false);
         dassert(err == dsn::ERR_OK, "initialize fs manager failed, err(%s)", err.to_string());
     }
@@ -351,6 +377,7 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
                                    _options.log_shared_file_size_mb,
                                    _options.log_shared_force_flush,
                                    &_counter_shared_log_recent_write_size);
+    _log->set_log_task_codes(_options.log_task_code_dictionary_enabled);
     ddebug("slog_dir = %s", _options.slog_dir.c_str());
 
     // init rps
@@ -481,6 +508,7 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
                                        _options.log_shared_file_size_mb,
                                        _options.log_shared_force_flush,
                                        &_counter_shared_log_recent_write_size);
+        _log->set_log_task_codes(_options.log_task_code_dictionary_enabled);
         auto lerr = _log->open(nullptr, [this](error_code err) { this->handle_log_failure(err); });
         dassert(lerr == ERR_OK, "restart log service must succeed");
     }
@@ -632,10 +660,14 @@ void replica_stub::initialize_start()
             [this]() { this->on_meta_server_disconnected(); },
             [this]() { this->on_meta_server_connected(); });
 
-        auto err = _failure_detector->start(_options.fd_check_interval_seconds,
-                                            _options.fd_beacon_interval_seconds,
-                                            _options.fd_lease_seconds,
-                                            _options.fd_grace_seconds);
+        if (_options.fd_phi_accrual_enabled) {
+            _failure_detector->enable_phi_accrual(_options.fd_phi_threshold,
+                                                  _options.fd_min_lease_ms);
+        }
+        auto err = _failure_detector->start_ms(_options.fd_check_interval_ms,
+                                               _options.fd_beacon_interval_ms,
+                                               _options.fd_lease_seconds * 1000,
+                                               _options.fd_grace_seconds * 1000);
         dassert(err == ERR_OK, "FD start failed, err = %s", err.to_string());
 
         _failure_detector->register_master(_failure_detector->current_server_contact());
@@ -1044,6 +1076,7 @@ void replica_stub::get_local_replicas(std::vector<replica_info> &replicas)
         replica_ptr &rep = pairs.second;
         replica_info info;
         get_replica_info(info, rep);
+        rep->load_meter().report_load(info);
         replicas.push_back(std::move(info));
     }
 
@@ -1056,6 +1089,35 @@ void replica_stub::get_local_replicas(std::vector<replica_info> &replicas)
     }
 }
 
+// whether the replica should be reported again in an incremental config sync
+static bool is_replica_info_changed(const replica_info &synced, const replica_info &current)
+{
+    if (synced.ballot != current.ballot || synced.status != current.status ||
+        synced.disk_tag != current.disk_tag || synced.app_type != current.app_type)
+        return true;
+
+    // meta server only cares about the decrees of the replicas it doesn't serve,
+    // which are candidates of the dropped list
+    if (current.status != partition_status::PS_PRIMARY &&
+        current.status != partition_status::PS_SECONDARY &&
+        (synced.last_committed_decree != current.last_committed_decree ||
+         synced.last_prepared_decree != current.last_prepared_decree ||
+         synced.last_durable_decree != current.last_durable_decree))
+        return true;
+
+    // the load is only re-reported when it changes notably
+    if (synced.__isset.read_qps != current.__isset.read_qps)
+        return true;
+    if (current.__isset.read_qps) {
+        int64_t synced_load = synced.read_qps + synced.write_qps;
+        int64_t current_load = current.read_qps + current.write_qps;
+        int64_t diff = std::abs(current_load - synced_load);
+        if (diff > std::max<int64_t>(synced_load / 5, 10))
+            return true;
+    }
+    return false;
+}
+
 // run in THREAD_POOL_META_SERVER
 // assert(_state_lock.locked())
 void replica_stub::query_configuration_by_node()
@@ -1070,26 +1132,55 @@ void replica_stub::query_configuration_by_node()
 
     dsn::message_ex *msg = dsn::message_ex::create_request(RPC_CM_CONFIG_SYNC);
 
-    configuration_query_by_node_request req;
-    req.node = _primary_address;
+    auto req = std::make_shared<configuration_query_by_node_request>();
+    req->node = _primary_address;
+
+    std::vector<replica_info> replicas;
+    get_local_replicas(replicas);
 
-    // TODO: send stored replicas may cost network, we shouldn't config the frequency
-    get_local_replicas(req.stored_replicas);
-    req.__isset.stored_replicas = true;
+    uint64_t now_ms = dsn_now_ms();
+    bool full_sync = (_acked_config_sync_version == 0 ||
+                      now_ms >= _last_full_config_sync_ms + _options.config_sync_full_interval_ms);
+    req->__set_sync_version(++_config_sync_version);
+    if (full_sync) {
+        req->stored_replicas = std::move(replicas);
+        _last_full_config_sync_ms = now_ms;
+    } else {
+        req->__set_base_sync_version(_acked_config_sync_version);
+        std::unordered_set<gpid> local_pids;
+        for (replica_info &info : replicas) {
+            local_pids.insert(info.pid);
+            auto it = _synced_replicas.find(info.pid);
+            if (it == _synced_replicas.end() || is_replica_info_changed(it->second, info))
+                req->stored_replicas.push_back(std::move(info));
+        }
+        // replicas removed locally needn't be reported, but should be resent if they come back
+        for (auto it = _synced_replicas.begin(); it != _synced_replicas.end();) {
+            if (local_pids.find(it->first) == local_pids.end())
+                it = _synced_replicas.erase(it);
+            else
+                ++it;
+        }
+    }
+    req->__isset.stored_replicas = true;
 
-    ::dsn::marshall(msg, req);
+    ::dsn::marshall(msg, *req);
 
-    ddebug("send query node partitions request to meta server, stored_replicas_count = %d",
-           (int)req.stored_replicas.size());
+    ddebug("send query node partitions request to meta server, sync_version = %" PRId64
+           ", base_sync_version = %" PRId64 ", stored_replicas_count = %d",
+           req->sync_version,
+           full_sync ? 0 : req->base_sync_version,
+           (int)req->stored_replicas.size());
 
     rpc_address target(_failure_detector->get_servers());
-    _config_query_task =
-        rpc::call(target,
-                  msg,
-                  &_tracker,
-                  [this](error_code err, dsn::message_ex *request, dsn::message_ex *resp) {
-                      on_node_query_reply(err, request, resp);
-                  });
+    uint64_t send_time = dsn_now_ms();
+    _config_query_task = rpc::call(
+        target,
+        msg,
+        &_tracker,
+        [this, req, send_time](error_code err, dsn::message_ex *request, dsn::message_ex *resp) {
+            on_node_query_reply(err, req, send_time, resp);
+        });
 }
 
 void replica_stub::on_meta_server_connected()
@@ -1107,12 +1198,24 @@ void replica_stub::on_meta_server_connected()
 }
 
 // run in THREAD_POOL_META_SERVER
-void replica_stub::on_node_query_reply(error_code err,
-                                       dsn::message_ex *request,
-                                       dsn::message_ex *response)
+void replica_stub::on_node_query_reply(
+    error_code err,
+    const std::shared_ptr<configuration_query_by_node_request> &req,
+    uint64_t send_time,
+    dsn::message_ex *response)
 {
     ddebug("query node partitions replied, err = %s", err.to_string());
 
+    configuration_query_by_node_response resp;
+    if (err == ERR_OK) {
+        ::dsn::unmarshall(response, resp);
+        // the leader has counted the request as a beacon, see meta_service::on_config_sync.
+        // it's recorded out of _state_lock, as FD calls back with its lock held
+        if (resp.err == ERR_OK) {
+            _failure_detector->record_master_traffic(response->header->from_address, send_time);
+        }
+    }
+
     zauto_lock l(_state_lock);
     _config_query_task = nullptr;
     if (err != ERR_OK) {
@@ -1128,9 +1231,6 @@ void replica_stub::on_node_query_reply(error_code err,
         if (_state != NS_Connected)
             return;
 
-        configuration_query_by_node_response resp;
-        ::dsn::unmarshall(response, resp);
-
         if (resp.err == ERR_BUSY) {
             int delay_ms = 500;
             ddebug("resend query node partitions request after %d ms for resp.err = ERR_BUSY",
@@ -1151,6 +1251,28 @@ void replica_stub::on_node_query_reply(error_code err,
             return;
         }
 
+        if (resp.__isset.need_full_sync && resp.need_full_sync) {
+            // meta server lost the base of the incremental sync, e.g. it has failed over,
+            // so a full sync is sent right away
+            ddebug("meta server requires a full config sync, sync_version = %" PRId64,
+                   req->sync_version);
+            _acked_config_sync_version = 0;
+            _synced_replicas.clear();
+            _config_query_task = tasking::enqueue(LPC_QUERY_CONFIGURATION_ALL,
+                                                  &_tracker,
+                                                  [this]() {
+                                                      zauto_lock l(_state_lock);
+                                                      _config_query_task = nullptr;
+                                                      this->query_configuration_by_node();
+                                                  });
+        } else {
+            if (!req->__isset.base_sync_version)
+                _synced_replicas.clear();
+            for (const replica_info &info : req->stored_replicas)
+                _synced_replicas[info.pid] = info;
+            _acked_config_sync_version = req->sync_version;
+        }
+
         ddebug("process query node partitions response for resp.err = ERR_OK, "
                "partitions_count(%d), gc_replicas_count(%d)",
                (int)resp.partitions.size(),
@@ -1294,6 +1416,9 @@ void replica_stub::on_meta_server_disconnected()
         return;
 
     _state = NS_Disconnected;
+    // the meta server may change when reconnected, so the next sync must be a full one
+    _acked_config_sync_version = 0;
+    _synced_replicas.clear();
 
     replicas rs;
     {
@@ -1594,10 +1719,20 @@ void replica_stub::on_disk_stat()
         }
         sub_list.insert(sub_list.end(), tmp_list.begin(), tmp_list.end());
     }
+    std::set<std::string> migrating_dirs;
+    {
+        zauto_read_lock l(_replicas_lock);
+        for (const auto &kv : _disk_migrating_replicas) {
+            migrating_dirs.insert(dsn::utils::filesystem::get_file_name(kv.second->tmp_dir));
+        }
+    }
     int error_replica_dir_count = 0;
     int garbage_replica_dir_count = 0;
     for (auto &fpath : sub_list) {
         auto name = dsn::utils::filesystem::get_file_name(fpath);
+        if (migrating_dirs.count(name) != 0) {
+            continue;
+        }
         // don't delete ".bak" directory because it is backed by administrator.
         if (name.length() >= 4 && (name.substr(name.length() - 4) == ".err" ||
                                    name.substr(name.length() - 4) == ".gar")) {
@@ -1839,12 +1974,35 @@ void replica_stub::close_replica(replica_ptr r)
 
     r->close();
 
+    std::shared_ptr<disk_migration> migration;
+    {
+        zauto_write_lock l(_replicas_lock);
+        auto it = _disk_migrating_replicas.find(id);
+        if (it != _disk_migrating_replicas.end()) {
+            if (it->second->status == disk_migration::COPIED) {
+                it->second->status = disk_migration::MOVING;
+                migration = it->second;
+            } else if (it->second->status == disk_migration::COPYING) {
+                // the copy task cleans it up
+                it->second->status = disk_migration::CANCELLED;
+            }
+        }
+    }
+    bool migrated = false;
+    if (migration != nullptr) {
+        migrated = migrate_replica_dir(id, migration);
+        end_migrate_replica_disk(id, migration, disk_migration::MOVING);
+    }
+
     {
         zauto_write_lock l(_replicas_lock);
         auto find = _closing_replicas.find(id);
         dassert(find != _closing_replicas.end(),
                 "replica %s is not in _closing_replicas",
                 name.c_str());
+        if (migrated) {
+            std::get<3>(find->second).disk_tag = migration->target_tag;
+        }
         _closed_replicas.emplace(
             id, std::make_pair(std::get<2>(find->second), std::get<3>(find->second)));
         _closing_replicas.erase(find);
@@ -2016,6 +2174,54 @@ void replica_stub::open_service()
             }
             return result;
         });
+
+    _query_disk_info_command = dsn::command_manager::instance().register_app_command(
+        {"query-disk-info"},
+        "query-disk-info",
+        "query-disk-info - query capacity, io utilization and replica count of all data dirs",
+        [this](const std::vector<std::string> &args) { return query_disk_info(); });
+
+    _migrate_replica_disk_command = dsn::command_manager::instance().register_app_command(
+        {"migrate-replica-disk"},
+        "migrate-replica-disk <app_id.partition_id> <target_disk_tag>",
+        "migrate-replica-disk - move a secondary replica to another data dir of this node, "
+        "the replica is closed during the move and learns the missed mutations after reopened",
+        [this](const std::vector<std::string> &args) {
+            if (args.size() != 2) {
+                return std::string("invalid arguments");
+            }
+            gpid id;
+            if (!id.parse_from(args[0].c_str())) {
+                return std::string("invalid arguments");
+            }
+            std::string target_tag = args[1];
+            return exec_command_on_replica(
+                {args[0]}, false, [this, target_tag](const replica_ptr &rep) {
+                    return begin_migrate_replica_disk(rep, target_tag);
+                });
+        });
+
+    _slowest_writes_command = dsn::command_manager::instance().register_app_command(
+        {"slowest-writes"},
+        "slowest-writes [count] [reset]",
+        "slowest-writes - dump the slowest writes on the primaries of this node since the "
+        "last reset with the time of each phase, reset to clear them after the dump",
+        [this](const std::vector<std::string> &args) {
+            int count = SLOWEST_WRITE_COUNT;
+            bool reset = false;
+            for (const std::string &arg : args) {
+                if (arg == "reset") {
+                    reset = true;
+                } else if (!dsn::buf2int32(arg, count) || count <= 0) {
+                    return std::string("ERR: invalid arguments");
+                }
+            }
+            std::string result = _slowest_writes.dump(count);
+            if (reset) {
+                _slowest_writes.reset();
+            }
+            return result;
+        });
 }
 
 std::string
@@ -2141,6 +2347,9 @@ void replica_stub::close()
     dsn::command_manager::instance().deregister_command(_query_compact_command);
     dsn::command_manager::instance().deregister_command(_query_app_envs_command);
     dsn::command_manager::instance().deregister_command(_useless_dir_reserve_seconds_command);
+    dsn::command_manager::instance().deregister_command(_query_disk_info_command);
+    dsn::command_manager::instance().deregister_command(_migrate_replica_disk_command);
+    dsn::command_manager::instance().deregister_command(_slowest_writes_command);
 
     _kill_partition_command = nullptr;
     _deny_client_command = nullptr;
@@ -2150,6 +2359,9 @@ void replica_stub::close()
     _query_compact_command = nullptr;
     _query_app_envs_command = nullptr;
     _useless_dir_reserve_seconds_command = nullptr;
+    _query_disk_info_command = nullptr;
+    _migrate_replica_disk_command = nullptr;
+    _slowest_writes_command = nullptr;
 
     if (_config_sync_timer_task != nullptr) {
         _config_sync_timer_task->cancel(true);
@@ -2221,6 +2433,328 @@ void replica_stub::close()
     }
 }
 
+std::string replica_stub::begin_migrate_replica_disk(const replica_ptr &rep,
+                                                     const std::string &target_tag)
+{
+    if (rep->status() != partition_status::PS_SECONDARY) {
+        return std::string("only secondary can be migrated, move the primary away first");
+    }
+
+    std::string target_root;
+    if (_fs_manager.get_dir_by_tag(target_tag, target_root) != ERR_OK) {
+        return std::string("disk tag not found: ") + target_tag;
+    }
+
+    std::string origin_tag;
+    if (_fs_manager.get_disk_tag(rep->dir(), origin_tag) == ERR_OK && origin_tag == target_tag) {
+        return std::string("already on disk ") + target_tag;
+    }
+
+    std::shared_ptr<disk_migration> m = std::make_shared<disk_migration>();
+    m->target_tag = target_tag;
+    m->origin_dir = rep->dir();
+    m->target_dir = utils::filesystem::path_combine(
+        target_root, utils::filesystem::get_file_name(m->origin_dir));
+    // named as garbage, so that an interrupted migration is ignored when loading replicas
+    // and removed by the disk gc later
+    char tmp_dir[1024];
+    sprintf(tmp_dir, "%s.%" PRIu64 ".migrate.gar", m->target_dir.c_str(), dsn_now_us());
+    m->tmp_dir = tmp_dir;
+    m->start_ms = dsn_now_ms();
+    {
+        zauto_write_lock l(_replicas_lock);
+        if (!_disk_migrating_replicas.emplace(rep->get_gpid(), m).second) {
+            return std::string("already under migration");
+        }
+    }
+
+    ddebug("%s: start to migrate replica from disk %s to %s",
+           rep->name(),
+           origin_tag.c_str(),
+           target_tag.c_str());
+
+    // the dir is copied while the replica keeps serving, see copy_migrating_replica_dir
+    gpid id = rep->get_gpid();
+    tasking::enqueue(
+        LPC_MIGRATE_REPLICA_DISK, &_tracker, [this, id]() { copy_migrating_replica_dir(id); });
+    return std::string("migrating to ") + target_tag + ", see query-disk-info for the progress";
+}
+
+bool replica_stub::end_migrate_replica_disk(gpid id,
+                                            const std::shared_ptr<disk_migration> &m,
+                                            disk_migration::status_type expected)
+{
+    {
+        zauto_write_lock l(_replicas_lock);
+        auto it = _disk_migrating_replicas.find(id);
+        if (it == _disk_migrating_replicas.end() || it->second != m || m->status != expected) {
+            return false;
+        }
+        _disk_migrating_replicas.erase(it);
+    }
+    // the dir is removed after the migration is removed, so it's not removed by the disk
+    // gc while being written
+    utils::filesystem::remove_path(m->tmp_dir);
+    return true;
+}
+
+void replica_stub::cancel_migrate_replica_disk(gpid id, const std::shared_ptr<disk_migration> &m)
+{
+    {
+        zauto_write_lock l(_replicas_lock);
+        if (m->status == disk_migration::COPYING) {
+            m->status = disk_migration::CANCELLED;
+        }
+    }
+    end_migrate_replica_disk(id, m, disk_migration::CANCELLED);
+}
+
+// copy the files listed at the first step, and at most MIGRATE_STEP_BYTES in each step,
+// so the long pool is not occupied by a single migration. the files changed or created
+// after copied are copied again after the replica is closed, see migrate_replica_dir.
+void replica_stub::copy_migrating_replica_dir(gpid id)
+{
+    static const uint64_t MIGRATE_STEP_BYTES = 64 * 1024 * 1024;
+
+    std::shared_ptr<disk_migration> m;
+    {
+        zauto_read_lock l(_replicas_lock);
+        auto it = _disk_migrating_replicas.find(id);
+        if (it == _disk_migrating_replicas.end()) {
+            return;
+        }
+        m = it->second;
+    }
+    if (end_migrate_replica_disk(id, m, disk_migration::CANCELLED)) {
+        ddebug("%s: migration to disk %s is cancelled", id.to_string(), m->target_tag.c_str());
+        return;
+    }
+
+    if (m->next_file == 0) {
+        if (!utils::filesystem::get_subfiles(m->origin_dir, m->files, true)) {
+            derror("%s: migrate replica dir failed: list files of %s failed",
+                   id.to_string(),
+                   m->origin_dir.c_str());
+            cancel_migrate_replica_disk(id, m);
+            return;
+        }
+        uint64_t total = 0;
+        for (const std::string &f : m->files) {
+            int64_t sz = 0;
+            if (utils::filesystem::file_size(f, sz)) {
+                total += sz;
+            }
+        }
+        m->total_bytes.store(total);
+    }
+
+    uint64_t step_bytes = 0;
+    for (; m->next_file < m->files.size() && step_bytes < MIGRATE_STEP_BYTES; ++m->next_file) {
+        const std::string &src = m->files[m->next_file];
+        std::string dest = m->tmp_dir + src.substr(m->origin_dir.length());
+        uint64_t copied = 0;
+        if (!utils::filesystem::create_directory(utils::filesystem::remove_file_name(dest)) ||
+            !utils::filesystem::copy_file(src, dest, copied)) {
+            if (!utils::filesystem::file_exists(src)) {
+                // removed by the app after listed
+                continue;
+            }
+            derror("%s: migrate replica dir failed: copy %s to %s failed",
+                   id.to_string(),
+                   src.c_str(),
+                   dest.c_str());
+            cancel_migrate_replica_disk(id, m);
+            return;
+        }
+        step_bytes += copied;
+        m->copied_bytes.fetch_add(copied);
+    }
+
+    if (m->next_file < m->files.size()) {
+        tasking::enqueue(
+            LPC_MIGRATE_REPLICA_DISK, &_tracker, [this, id]() { copy_migrating_replica_dir(id); });
+        return;
+    }
+
+    {
+        zauto_write_lock l(_replicas_lock);
+        if (m->status == disk_migration::COPYING) {
+            m->status = disk_migration::COPIED;
+        }
+    }
+    if (end_migrate_replica_disk(id, m, disk_migration::CANCELLED)) {
+        return;
+    }
+    ddebug("%s: finish to copy replica dir %s to %s, copied_mb = %" PRIu64
+           ", time_used_ms = %" PRIu64 ", close the replica to finish the migration",
+           id.to_string(),
+           m->origin_dir.c_str(),
+           m->tmp_dir.c_str(),
+           m->copied_bytes.load() >> 20,
+           dsn_now_ms() - m->start_ms);
+
+    replica_ptr rep = get_replica(id);
+    if (rep == nullptr) {
+        // being closed, the migration is finished or cancelled in close_replica
+        return;
+    }
+    tasking::enqueue(LPC_REPLICATION_COMMON,
+                     rep->tracker(),
+                     [this, rep, m]() {
+                         if (rep->status() == partition_status::PS_SECONDARY) {
+                             // close the replica as if it met a local failure, the dir is
+                             // moved when closing (see close_replica). then the primary
+                             // removes it from the group and the meta server adds it back as
+                             // a learner, which loads the moved dir and only learns the
+                             // mutations missed during the move
+                             rep->update_local_configuration_with_no_ballot_change(
+                                 partition_status::PS_ERROR);
+                         } else if (rep->status() == partition_status::PS_PRIMARY ||
+                                    rep->status() == partition_status::PS_POTENTIAL_SECONDARY) {
+                             dwarn("%s: cancel migration to disk %s as the replica is %s now",
+                                   rep->name(),
+                                   m->target_tag.c_str(),
+                                   enum_to_string(rep->status()));
+                             end_migrate_replica_disk(
+                                 rep->get_gpid(), m, disk_migration::COPIED);
+                         }
+                     },
+                     id.thread_hash());
+}
+
+bool replica_stub::migrate_replica_dir(gpid id, const std::shared_ptr<disk_migration> &m)
+{
+    uint64_t start_ms = dsn_now_ms();
+    if (!utils::filesystem::directory_exists(m->origin_dir) ||
+        !utils::filesystem::directory_exists(m->tmp_dir)) {
+        derror("%s: migrate replica dir %s to %s failed, dir not found",
+               id.to_string(),
+               m->origin_dir.c_str(),
+               m->tmp_dir.c_str());
+        return false;
+    }
+
+    // the replica is closed, so copy the files changed since the background copy, and
+    // remove the files which are removed since
+    uint64_t delta_bytes = 0;
+    std::vector<std::string> files;
+    if (!utils::filesystem::get_subfiles(m->origin_dir, files, true)) {
+        derror("%s: migrate replica dir failed: list files of %s failed",
+               id.to_string(),
+               m->origin_dir.c_str());
+        return false;
+    }
+    for (const std::string &src : files) {
+        std::string dest = m->tmp_dir + src.substr(m->origin_dir.length());
+        if (utils::filesystem::is_same_file_stat(src, dest)) {
+            continue;
+        }
+        uint64_t copied = 0;
+        if (!utils::filesystem::create_directory(utils::filesystem::remove_file_name(dest)) ||
+            !utils::filesystem::copy_file(src, dest, copied)) {
+            derror("%s: migrate replica dir failed: copy %s to %s failed",
+                   id.to_string(),
+                   src.c_str(),
+                   dest.c_str());
+            return false;
+        }
+        delta_bytes += copied;
+    }
+    std::vector<std::string> copied_paths;
+    if (!utils::filesystem::get_subpaths(m->tmp_dir, copied_paths, true)) {
+        derror("%s: migrate replica dir failed: list files of %s failed",
+               id.to_string(),
+               m->tmp_dir.c_str());
+        return false;
+    }
+    for (const std::string &dest : copied_paths) {
+        std::string src = m->origin_dir + dest.substr(m->tmp_dir.length());
+        if (!utils::filesystem::path_exists(src) && utils::filesystem::path_exists(dest) &&
+            !utils::filesystem::remove_path(dest)) {
+            derror(
+                "%s: migrate replica dir failed: remove %s failed", id.to_string(), dest.c_str());
+            return false;
+        }
+    }
+
+    // there must be only one dir for a replica, so move the origin away first
+    char garbage_dir[1024];
+    sprintf(garbage_dir, "%s.%" PRIu64 ".gar", m->origin_dir.c_str(), dsn_now_us());
+    if (!utils::filesystem::rename_path(m->origin_dir, garbage_dir)) {
+        derror("%s: migrate replica dir failed: move %s to %s failed",
+               id.to_string(),
+               m->origin_dir.c_str(),
+               garbage_dir);
+        return false;
+    }
+    if (!utils::filesystem::rename_path(m->tmp_dir, m->target_dir)) {
+        derror("%s: migrate replica dir failed: move %s to %s failed, move origin back",
+               id.to_string(),
+               m->tmp_dir.c_str(),
+               m->target_dir.c_str());
+        bool ret = utils::filesystem::rename_path(garbage_dir, m->origin_dir);
+        dassert(ret,
+                "%s: move %s back to %s failed",
+                id.to_string(),
+                garbage_dir,
+                m->origin_dir.c_str());
+        return false;
+    }
+
+    {
+        zauto_write_lock l(_replicas_lock);
+        _fs_manager.remove_replica(id);
+        _fs_manager.add_replica(id, m->target_dir);
+    }
+    dwarn("%s: {replica_dir_op} succeed to migrate replica dir from %s to %s, origin dir is "
+          "moved to %s, copied_mb = %" PRIu64 ", delta_mb = %" PRIu64
+          ", offline_time_used_ms = %" PRIu64 ", time_used_ms = %" PRIu64,
+          id.to_string(),
+          m->origin_dir.c_str(),
+          m->target_dir.c_str(),
+          garbage_dir,
+          m->copied_bytes.load() >> 20,
+          delta_bytes >> 20,
+          dsn_now_ms() - start_ms,
+          dsn_now_ms() - m->start_ms);
+    return true;
+}
+
+std::string replica_stub::query_disk_info()
+{
+    std::stringstream ss;
+    _fs_manager.for_each_dir_node([&ss](const dir_node &n) {
+        ss << n.tag << ": dir = " << n.full_dir << ", capacity_mb = " << n.disk_capacity_mb
+           << ", available_mb = " << n.disk_available_mb
+           << ", available_ratio = " << n.disk_available_ratio << "%, io_util = ";
+        if (n.disk_io_util < 0) {
+            ss << "unknown";
+        } else {
+            ss << n.disk_io_util << "%";
+        }
+        ss << ", replica_count = " << n.replicas_count() << std::endl;
+        return true;
+    });
+
+    zauto_read_lock l(_replicas_lock);
+    for (const auto &kv : _disk_migrating_replicas) {
+        const disk_migration &m = *kv.second;
+        ss << "migrating " << kv.first.to_string() << " to " << m.target_tag << ": ";
+        if (m.status == disk_migration::COPYING) {
+            ss << "copying, " << (m.copied_bytes.load() >> 20) << "/"
+               << (m.total_bytes.load() >> 20) << " MB";
+        } else if (m.status == disk_migration::COPIED) {
+            ss << "copied, waiting for the replica to be closed";
+        } else if (m.status == disk_migration::MOVING) {
+            ss << "copying the changed files";
+        } else {
+            ss << "cancelled";
+        }
+        ss << ", time_used_ms = " << dsn_now_ms() - m.start_ms << std::endl;
+    }
+    return ss.str();
+}
+
 std::string replica_stub::get_replica_dir(const char *app_type, gpid id, bool create_new)
 {
     char buffer[256];
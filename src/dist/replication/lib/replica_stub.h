@@ -32,9 +32,12 @@
 //   replica_stub(singleton) --> replica --> replication_app_base
 //
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <tuple>
 #include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/perf_counter/metric_registry.h>
 #include <dsn/dist/failure_detector_multimaster.h>
 #include <dsn/dist/nfs_node.h>
 #include <dsn/dist/cli/cli.server.h>
@@ -43,6 +46,7 @@
 #include "dist/replication/common/fs_manager.h"
 #include "dist/replication/common/block_service_manager.h"
 #include "replica.h"
+#include "write_latency_tracker.h"
 
 namespace dsn {
 namespace replication {
@@ -172,7 +176,10 @@ private:
     void initialize_start();
     void query_configuration_by_node();
     void on_meta_server_disconnected_scatter(replica_stub_ptr this_, gpid id);
-    void on_node_query_reply(error_code err, dsn::message_ex *request, dsn::message_ex *response);
+    void on_node_query_reply(error_code err,
+                             const std::shared_ptr<configuration_query_by_node_request> &req,
+                             uint64_t send_time,
+                             dsn::message_ex *response);
     void on_node_query_reply_scatter(replica_stub_ptr this_,
                                      const configuration_update_request &config);
     void on_node_query_reply_scatter2(replica_stub_ptr this_, gpid id);
@@ -199,6 +206,57 @@ private:
     replica_life_cycle get_replica_life_cycle(gpid id);
     void on_gc_replica(replica_stub_ptr this_, gpid id);
 
+    // a replica whose dir is being moved to another disk
+    struct disk_migration
+    {
+        // COPYING -> COPIED -> MOVING (when the replica is closed) -> removed
+        // COPYING -> CANCELLED (when the replica is closed or failed) -> removed
+        enum status_type
+        {
+            COPYING,
+            COPIED,
+            MOVING,
+            CANCELLED
+        };
+
+        std::string target_tag;
+        std::string origin_dir;
+        std::string target_dir;
+        std::string tmp_dir;
+        uint64_t start_ms;
+        // protected by _replicas_lock
+        status_type status;
+
+        // only accessed by the copy task
+        std::vector<std::string> files;
+        size_t next_file;
+
+        // for the progress
+        std::atomic<uint64_t> total_bytes;
+        std::atomic<uint64_t> copied_bytes;
+
+        disk_migration()
+            : start_ms(0), status(COPYING), next_file(0), total_bytes(0), copied_bytes(0)
+        {
+        }
+    };
+
+    // intra-node disk balance: move a secondary replica's dir to the disk of target_tag.
+    // the dir is copied in LPC_MIGRATE_REPLICA_DISK while the replica keeps serving, then
+    // the replica is closed, and only the files changed since are copied when closing.
+    // should be called in the replica's thread, returns the result message.
+    std::string begin_migrate_replica_disk(const replica_ptr &rep, const std::string &target_tag);
+    void copy_migrating_replica_dir(gpid id);
+    // called when closing a replica whose dir is copied, before it's put into
+    // _closed_replicas so that it can't be reopened until the dir is moved
+    bool migrate_replica_dir(gpid id, const std::shared_ptr<disk_migration> &m);
+    // remove the migration and its temporary dir if it's still in the expected status
+    bool end_migrate_replica_disk(gpid id,
+                                  const std::shared_ptr<disk_migration> &m,
+                                  disk_migration::status_type expected);
+    void cancel_migrate_replica_disk(gpid id, const std::shared_ptr<disk_migration> &m);
+    std::string query_disk_info();
+
     void response_client(gpid id,
                          bool is_read,
                          dsn::message_ex *request,
@@ -224,6 +282,7 @@ private:
     opening_replicas _opening_replicas;
     closing_replicas _closing_replicas;
     closed_replicas _closed_replicas;
+    std::map<gpid, std::shared_ptr<disk_migration>> _disk_migrating_replicas;
 
     mutation_log_ptr _log;
     ::dsn::rpc_address _primary_address;
@@ -238,6 +297,15 @@ private:
     replica_state_subscriber _replica_state_subscriber;
     bool _is_long_subscriber;
 
+    // incremental config sync, protected by _state_lock.
+    // _synced_replicas are the replica infos meta server has acknowledged, only the replicas
+    // changed from them are sent in an incremental sync based on _acked_config_sync_version,
+    // which is reset to 0 to force a full sync.
+    std::unordered_map<gpid, replica_info> _synced_replicas;
+    int64_t _config_sync_version;
+    int64_t _acked_config_sync_version;
+    uint64_t _last_full_config_sync_ms;
+
     // temproal states
     ::dsn::task_ptr _config_query_task;
     ::dsn::task_ptr _config_sync_timer_task;
@@ -253,6 +321,9 @@ private:
     dsn_handle_t _query_compact_command;
     dsn_handle_t _query_app_envs_command;
     dsn_handle_t _useless_dir_reserve_seconds_command;
+    dsn_handle_t _query_disk_info_command;
+    dsn_handle_t _migrate_replica_disk_command;
+    dsn_handle_t _slowest_writes_command;
 
     bool _deny_client;
     bool _verbose_client_log;
@@ -264,6 +335,9 @@ private:
     // too simple, it do not support priority.
     std::atomic_int _learn_app_concurrent_count;
 
+    // the slowest writes on the primaries of this node
+    write_latency_tracker _slowest_writes;
+
     // handle all the data dirs
     fs_manager _fs_manager;
 
@@ -277,6 +351,11 @@ private:
     // cli service
     std::unique_ptr<dsn::cli_service> _cli_service;
 
+    // latency of the client requests on the primaries by app_id, partition and task_code,
+    // the qps is the rate of the count
+    metric_family *_metric_read_latency_us;
+    metric_family *_metric_write_latency_us;
+
     // performance counters
     perf_counter_wrapper _counter_replicas_count;
     perf_counter_wrapper _counter_replicas_opening_count;
@@ -0,0 +1,132 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "write_latency_tracker.h"
+
+namespace dsn {
+namespace replication {
+
+static bool slower(const write_latency_record &a, const write_latency_record &b)
+{
+    return a.total_ns() > b.total_ns();
+}
+
+std::string write_latency_record::to_string() const
+{
+    auto offset_us = [this](uint64_t ts_ns) {
+        return ts_ns == 0 ? std::string("none")
+                          : "+" + std::to_string((ts_ns - received_ns) / 1000) + "us";
+    };
+
+    std::stringstream ss;
+    ss << pid << " decree=" << d << " requests=" << request_count
+       << " total=" << total_ns() / 1000 << "us:"
+       << " prepared=" << offset_us(phase_ts.prepared_ns)
+       << " logged=" << offset_us(phase_ts.logged_ns);
+    for (const auto &ack : phase_ts.acked_ns) {
+        ss << " acked(" << ack.first.to_string() << ")=" << offset_us(ack.second);
+    }
+    ss << " committed=" << offset_us(phase_ts.committed_ns)
+       << " applied=" << offset_us(phase_ts.applied_ns);
+    return ss.str();
+}
+
+write_latency_tracker::write_latency_tracker(int capacity)
+    : _capacity(std::max(capacity, 1)), _threshold_ns(0)
+{
+}
+
+void write_latency_tracker::add(const mutation &mu)
+{
+    uint64_t total_ns = mu.phase_ts.applied_ns - mu.create_ts_ns();
+    if (total_ns <= _threshold_ns.load(std::memory_order_relaxed))
+        return;
+
+    write_latency_record record;
+    record.pid = mu.data.header.pid;
+    record.d = mu.data.header.decree;
+    record.request_count = static_cast<int>(mu.client_requests.size());
+    record.received_ns = mu.create_ts_ns();
+    record.phase_ts = mu.phase_ts;
+    add(std::move(record));
+}
+
+void write_latency_tracker::add(write_latency_record &&record)
+{
+    uint64_t total_ns = record.total_ns();
+    if (total_ns <= _threshold_ns.load(std::memory_order_relaxed))
+        return;
+
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+    if (_records.size() == _capacity) {
+        // may be raised by others after the check above
+        if (total_ns <= _records.front().total_ns())
+            return;
+        std::pop_heap(_records.begin(), _records.end(), slower);
+        _records.back() = std::move(record);
+    } else {
+        _records.push_back(std::move(record));
+    }
+    std::push_heap(_records.begin(), _records.end(), slower);
+
+    if (_records.size() == _capacity) {
+        _threshold_ns.store(_records.front().total_ns(), std::memory_order_relaxed);
+    }
+}
+
+std::string write_latency_tracker::dump(int count)
+{
+    std::vector<write_latency_record> records;
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+        records = _records;
+    }
+    std::sort(records.begin(), records.end(), slower);
+    if (count >= 0 && records.size() > static_cast<size_t>(count)) {
+        records.resize(count);
+    }
+
+    if (records.empty()) {
+        return "no write recorded";
+    }
+    std::stringstream ss;
+    for (const write_latency_record &record : records) {
+        ss << record.to_string() << std::endl;
+    }
+    return ss.str();
+}
+
+void write_latency_tracker::reset()
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+    _records.clear();
+    _threshold_ns.store(0, std::memory_order_relaxed);
+}
+}
+}
@@ -0,0 +1,84 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <dsn/tool-api/gpid.h>
+#include <dsn/utility/synchronize.h>
+#include <dsn/dist/replication/replication_other_types.h>
+
+#include "mutation.h"
+
+namespace dsn {
+namespace replication {
+
+// a write on the primary with the timestamps of its phases
+struct write_latency_record
+{
+    gpid pid;
+    decree d;
+    int request_count;
+    uint64_t received_ns;
+    write_phase_timestamps phase_ts;
+
+    uint64_t total_ns() const { return phase_ts.applied_ns - received_ns; }
+    // e.g. "1.3 decree=100 requests=2 total=2300us: prepared=+20us logged=+1500us
+    // acked(10.0.0.2:34801)=+900us committed=+1600us applied=+2300us"
+    std::string to_string() const;
+};
+
+// keeps the slowest writes applied on the primaries of this node since the last reset,
+// which are dumped by the remote command "slowest-writes".
+//
+// add() is called concurrently by the replicas, it only takes the lock if the write is
+// slower than the fastest one kept.
+class write_latency_tracker
+{
+public:
+    explicit write_latency_tracker(int capacity);
+
+    // mu should have been applied on the primary
+    void add(const mutation &mu);
+    void add(write_latency_record &&record);
+
+    // the slowest count writes, the slowest first
+    std::string dump(int count);
+    void reset();
+
+private:
+    const size_t _capacity;
+    // total_ns of the fastest write kept once full
+    std::atomic<uint64_t> _threshold_ns;
+
+    utils::ex_lock_nr_spin _lock;
+    // a min heap on total_ns
+    std::vector<write_latency_record> _records;
+};
+}
+}
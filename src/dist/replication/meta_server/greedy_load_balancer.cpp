@@ -41,6 +41,7 @@
 #include <dsn/utility/math.h>
 #include "greedy_load_balancer.h"
 #include "meta_data.h"
+#include "min_cost_max_flow.h"
 
 namespace dsn {
 namespace replication {
@@ -50,16 +51,30 @@ greedy_load_balancer::greedy_load_balancer(meta_service *_svc)
       _ctrl_balancer_in_turn(nullptr),
       _ctrl_only_primary_balancer(nullptr),
       _ctrl_only_move_primary(nullptr),
+      _ctrl_primary_load_balancer(nullptr),
       _get_balance_operation_count(nullptr)
 {
     if (_svc != nullptr) {
-        _balancer_in_turn = _svc->get_meta_options()._lb_opts.balancer_in_turn;
-        _only_primary_balancer = _svc->get_meta_options()._lb_opts.only_primary_balancer;
-        _only_move_primary = _svc->get_meta_options()._lb_opts.only_move_primary;
+        const lb_suboptions &opts = _svc->get_meta_options()._lb_opts;
+        _balancer_in_turn = opts.balancer_in_turn;
+        _only_primary_balancer = opts.only_primary_balancer;
+        _only_move_primary = opts.only_move_primary;
+        _primary_load_balancer = opts.primary_load_balancer;
+        _load_balancer_imbalance_percentage = opts.load_balancer_imbalance_percentage;
+        _load_balancer_min_node_load = opts.load_balancer_min_node_load;
+        _max_load_balance_moves = opts.max_load_balance_moves;
+        _load_balancer_cooldown_seconds = opts.load_balancer_cooldown_seconds;
+        _load_balancer_bytes_per_request = opts.load_balancer_bytes_per_request;
     } else {
         _balancer_in_turn = false;
         _only_primary_balancer = false;
         _only_move_primary = false;
+        _primary_load_balancer = false;
+        _load_balancer_imbalance_percentage = 20;
+        _load_balancer_min_node_load = 1000;
+        _max_load_balance_moves = 4;
+        _load_balancer_cooldown_seconds = 600;
+        _load_balancer_bytes_per_request = 4096;
     }
 
     ::memset(t_operation_counters, 0, sizeof(t_operation_counters));
@@ -91,6 +106,7 @@ greedy_load_balancer::~greedy_load_balancer()
     UNREGISTER_VALID_HANDLER(_ctrl_balancer_in_turn);
     UNREGISTER_VALID_HANDLER(_ctrl_only_primary_balancer);
     UNREGISTER_VALID_HANDLER(_ctrl_only_move_primary);
+    UNREGISTER_VALID_HANDLER(_ctrl_primary_load_balancer);
     UNREGISTER_VALID_HANDLER(_get_balance_operation_count);
 }
 
@@ -124,6 +140,15 @@ void greedy_load_balancer::register_ctrl_commands()
             return remote_command_set_bool_flag(_only_move_primary, "lb.only_move_primary", args);
         });
 
+    _ctrl_primary_load_balancer = dsn::command_manager::instance().register_app_command(
+        {"lb.primary_load_balancer"},
+        "lb.primary_load_balancer <true|false>",
+        "control whether balance the primaries by the reported load",
+        [this](const std::vector<std::string> &args) {
+            return remote_command_set_bool_flag(
+                _primary_load_balancer, "lb.primary_load_balancer", args);
+        });
+
     _get_balance_operation_count = dsn::command_manager::instance().register_app_command(
         {"lb.get_balance_operation_count"},
         "lb.get_balance_operation_count [total | move_pri | copy_pri | copy_sec | detail]",
@@ -136,6 +161,7 @@ void greedy_load_balancer::unregister_ctrl_commands()
     UNREGISTER_VALID_HANDLER(_ctrl_balancer_in_turn);
     UNREGISTER_VALID_HANDLER(_ctrl_only_primary_balancer);
     UNREGISTER_VALID_HANDLER(_ctrl_only_move_primary);
+    UNREGISTER_VALID_HANDLER(_ctrl_primary_load_balancer);
     UNREGISTER_VALID_HANDLER(_get_balance_operation_count);
 
     simple_load_balancer::unregister_ctrl_commands();
@@ -586,140 +612,118 @@ bool greedy_load_balancer::calc_disk_load(app_id id,
     }
 }
 
+// the network of primary balancer for an app:
+//   source(0) -> nodes(1..t_alive_nodes) -> partitions -> nodes -> sink(t_alive_nodes + 1)
+//
+// a unit of flow on "node u -> partition p -> node v" means to move the primary of p
+// from u to v, where v is a secondary of p. the capacity of "u -> p" is 1, so every
+// partition will be moved at most once, and the flows can be applied at the same time.
+// a unit of flow may pass through several partitions, such as "u -> p -> v -> q -> w",
+// which moves p from u to v and q from v to w, so the moves may outnumber the flow.
+//
+// every move costs MOVE_COST, and a little more if it makes the disks of u and v more
+// unbalanced, so the min-cost max-flow moves as few primaries as possible, and prefers to
+// move primaries from busy disks to idle disks.
 bool greedy_load_balancer::move_primary_based_on_flow_per_app(const std::shared_ptr<app_state> &app,
-                                                              const std::vector<int> &prev,
-                                                              const std::vector<int> &flow)
+                                                              int replicas_low,
+                                                              bool no_lower_nodes,
+                                                              /*out*/ int &moved)
 {
-    int graph_nodes = prev.size();
-    int current = prev[graph_nodes - 1];
+    static const int64_t MOVE_COST = 1 << 16;
+    static const int64_t MAX_DISK_COST = 1000;
+
+    moved = 0;
+    const node_mapper &nodes = *(t_global_view->nodes);
 
     // used to calculate the primary disk loads of each server.
     // disk_load[disk_tag] means how many primaies on this "disk_tag".
     // IF disk_load.find(disk_tag) == disk_load.end(), means 0
-    disk_load loads[2];
-    disk_load *prev_load = &loads[0];
-    disk_load *current_load = &loads[1];
-
-    if (!calc_disk_load(app->app_id, address_vec[current], true, *current_load)) {
-        dwarn("stop move primary as some replica infos aren't collected, node(%s), app(%s)",
-              address_vec[current].to_string(),
-              app->get_logname());
-        return false;
-    }
-
-    migration_list ml_this_turn;
-    while (prev[current] != 0) {
-        rpc_address from = address_vec[prev[current]];
-        rpc_address to = address_vec[current];
-
-        if (!calc_disk_load(app->app_id, from, true, *prev_load)) {
+    std::vector<disk_load> loads(t_alive_nodes + 1);
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        if (!calc_disk_load(app->app_id, iter->first, true, loads[address_id[iter->first]])) {
             dwarn("stop move primary as some replica infos aren't collected, node(%s), app(%s)",
-                  from.to_string(),
+                  iter->first.to_string(),
                   app->get_logname());
             return false;
         }
+    }
 
-        const node_state &ns = t_global_view->nodes->find(from)->second;
-        std::list<dsn::gpid> potential_moving;
-        int potential_moving_size = 0;
-        ns.for_each_primary(app->app_id, [&](const gpid &pid) {
-            const partition_configuration &pc = app->partitions[pid.get_partition_index()];
-            if (is_secondary(pc, to)) {
-                potential_moving.push_back(pid);
-                potential_moving_size++;
-            }
-            return true;
-        });
+    struct move_candidate
+    {
+        gpid pid;
+        int to;
+        int edge;
+    };
+    std::vector<move_candidate> candidates;
 
-        int plan_moving = flow[graph_nodes - 1];
-        dassert(plan_moving <= potential_moving_size,
-                "from(%s) to(%s) plan(%d), can_move(%d)",
-                from.to_string(),
-                to.to_string(),
-                plan_moving,
-                potential_moving_size);
-
-        while (plan_moving > 0) {
-            std::list<dsn::gpid>::iterator selected = potential_moving.end();
-            int selected_score = std::numeric_limits<int>::min();
-
-            for (std::list<dsn::gpid>::iterator it = potential_moving.begin();
-                 it != potential_moving.end();
-                 ++it) {
-                const config_context &cc = app->helpers->contexts[it->get_partition_index()];
-                int score =
-                    (*prev_load)[get_disk_tag(from, *it)] - (*current_load)[get_disk_tag(to, *it)];
-                if (score > selected_score) {
-                    selected_score = score;
-                    selected = it;
-                }
-            }
+    int sink = t_alive_nodes + 1;
+    min_cost_max_flow network(t_alive_nodes + 2 + app->partition_count);
+    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
+        int from = address_id[iter->first];
+        const node_state &ns = iter->second;
 
-            dassert(selected != potential_moving.end(),
-                    "can't find gpid to move from(%s) to(%s)",
-                    from.to_string(),
-                    to.to_string());
-            const partition_configuration &pc = app->partitions[selected->get_partition_index()];
-            auto balancer_result = ml_this_turn.emplace(
-                *selected, generate_balancer_request(pc, balance_type::move_primary, from, to));
-            dassert(balancer_result.second,
-                    "gpid(%d.%d) already inserted as an action",
-                    (*selected).get_app_id(),
-                    (*selected).get_partition_index());
-
-            --(*prev_load)[get_disk_tag(from, *selected)];
-            ++(*current_load)[get_disk_tag(to, *selected)];
-            potential_moving.erase(selected);
-            --plan_moving;
+        int c = ns.primary_count(app->app_id);
+        int source_capacity = c > replicas_low ? c - replicas_low : 0;
+        int sink_capacity = c < replicas_low ? replicas_low - c : 0;
+        // all nodes have at least replicas_low primaries, then only the nodes with more than
+        // replicas_high primaries need to move out, and the nodes with replicas_low can take one
+        if (no_lower_nodes) {
+            if (source_capacity > 0)
+                --source_capacity;
+            else
+                ++sink_capacity;
         }
+        if (source_capacity > 0)
+            network.add_edge(0, from, source_capacity, 0);
+        if (sink_capacity > 0)
+            network.add_edge(from, sink, sink_capacity, 0);
 
-        current = prev[current];
-        std::swap(current_load, prev_load);
+        disk_load &from_load = loads[from];
+        ns.for_each_primary(app->app_id, [&, this](const gpid &pid) {
+            const partition_configuration &pc = app->partitions[pid.get_partition_index()];
+            int partition_node = sink + 1 + pid.get_partition_index();
+            int64_t from_cost =
+                MAX_DISK_COST - std::min<int64_t>(from_load[get_disk_tag(pc.primary, pid)],
+                                                  MAX_DISK_COST);
+            network.add_edge(from, partition_node, 1, MOVE_COST + from_cost);
+
+            for (auto &target : pc.secondaries) {
+                auto i = address_id.find(target);
+                dassert(i != address_id.end(),
+                        "invalid secondary address, address = %s",
+                        target.to_string());
+                int64_t to_cost =
+                    std::min<int64_t>(loads[i->second][get_disk_tag(target, pid)], MAX_DISK_COST);
+                int edge = network.add_edge(partition_node, i->second, 1, to_cost);
+                candidates.push_back(move_candidate{pid, i->second, edge});
+            }
+            return true;
+        });
     }
 
-    for (auto &kv : ml_this_turn) {
-        auto r = t_migration_result->emplace(kv.first, kv.second);
+    int64_t cost = 0;
+    int flow = network.solve(0, sink, cost);
+    dinfo("%s: %d primaries are flew, cost = %" PRId64, app->get_logname(), flow, cost);
+
+    for (const move_candidate &c : candidates) {
+        if (network.flow(c.edge) == 0)
+            continue;
+        const partition_configuration &pc = app->partitions[c.pid.get_partition_index()];
+        auto r = t_migration_result->emplace(
+            c.pid,
+            generate_balancer_request(
+                pc, balance_type::move_primary, pc.primary, address_vec[c.to]));
         dassert(r.second,
                 "gpid(%d.%d) already inserted as an action",
-                kv.first.get_app_id(),
-                kv.first.get_partition_index());
+                c.pid.get_app_id(),
+                c.pid.get_partition_index());
+        ++moved;
     }
+    dassert(moved >= flow, "moved(%d) vs flow(%d)", moved, flow);
     return true;
 }
 
-// shortest path based on dijstra, to find an augmenting path
-void greedy_load_balancer::shortest_path(std::vector<bool> &visit,
-                                         std::vector<int> &flow,
-                                         std::vector<int> &prev,
-                                         std::vector<std::vector<int>> &network)
-{
-    int pos, max_value;
-    flow[0] = INT_MAX;
-
-    int graph_nodes = network.size();
-    while (!visit[graph_nodes - 1]) {
-        pos = -1, max_value = 0;
-        for (int i = 0; i != graph_nodes; ++i) {
-            if (visit[i] == false && flow[i] > max_value) {
-                pos = i;
-                max_value = flow[i];
-            }
-        }
-
-        if (pos == -1)
-            break;
-
-        visit[pos] = true;
-        for (int i = 0; i != graph_nodes; ++i) {
-            if (!visit[i] && std::min(flow[pos], network[pos][i]) > flow[i]) {
-                flow[i] = std::min(flow[pos], network[pos][i]);
-                prev[i] = pos;
-            }
-        }
-    }
-}
-
-// load balancer based on ford-fulkerson
+// load balancer based on min-cost max-flow
 bool greedy_load_balancer::primary_balancer_per_app(const std::shared_ptr<app_state> &app)
 {
     dassert(t_alive_nodes > 2, "too few alive nodes will lead to freeze");
@@ -742,49 +746,14 @@ bool greedy_load_balancer::primary_balancer_per_app(const std::shared_ptr<app_st
         return true;
     }
 
-    size_t graph_nodes = t_alive_nodes + 2;
-    std::vector<std::vector<int>> network(graph_nodes, std::vector<int>(graph_nodes, 0));
-
-    // make graph
-    for (auto iter = nodes.begin(); iter != nodes.end(); ++iter) {
-        int from = address_id[iter->first];
-        const node_state &ns = iter->second;
-        int c = ns.primary_count(app->app_id);
-        if (c > replicas_low)
-            network[0][from] = c - replicas_low;
-        else
-            network[from][graph_nodes - 1] = replicas_low - c;
-
-        ns.for_each_primary(app->app_id, [&, this](const gpid &pid) {
-            const partition_configuration &pc = app->partitions[pid.get_partition_index()];
-            for (auto &target : pc.secondaries) {
-                auto i = address_id.find(target);
-                dassert(i != address_id.end(),
-                        "invalid secondary address, address = %s",
-                        target.to_string());
-                network[from][i->second]++;
-            }
-            return true;
-        });
-    }
-
-    if (higher_count > 0 && lower_count == 0) {
-        for (int i = 0; i != graph_nodes; ++i) {
-            if (network[0][i] > 0)
-                --network[0][i];
-            else
-                ++network[i][graph_nodes - 1];
-        }
-    }
     dinfo("%s: start to move primary", app->get_logname());
-    std::vector<bool> visit(graph_nodes, false);
-    std::vector<int> flow(graph_nodes, 0);
-    std::vector<int> prev(graph_nodes, -1);
+    int moved = 0;
+    if (!move_primary_based_on_flow_per_app(app, replicas_low, lower_count == 0, moved))
+        return false;
 
-    shortest_path(visit, flow, prev, network);
     // we can't make the server load more balanced
     // by moving primaries to secondaries
-    if (!visit[graph_nodes - 1] || flow[graph_nodes - 1] == 0) {
+    if (moved == 0) {
         if (!_only_move_primary) {
             return copy_primary_per_app(app, lower_count != 0, replicas_low);
         } else {
@@ -792,9 +761,7 @@ bool greedy_load_balancer::primary_balancer_per_app(const std::shared_ptr<app_st
             return true;
         }
     }
-
-    dinfo("%u primaries are flew", flow[graph_nodes - 1]);
-    return move_primary_based_on_flow_per_app(app, prev, flow);
+    return true;
 }
 
 bool greedy_load_balancer::primary_balancer_globally()
@@ -934,6 +901,210 @@ bool greedy_load_balancer::all_replica_infos_collected(const node_state &ns)
     });
 }
 
+int64_t greedy_load_balancer::partition_load(const config_context &cc) const
+{
+    // only the primary receives client requests, but we take the max of all serving
+    // replicas, so that the load isn't lost after a primary is moved and before the new
+    // primary reports
+    int64_t result = 0;
+    for (const serving_replica &r : cc.serving) {
+        int64_t load = r.read_qps + r.write_qps;
+        if (_load_balancer_bytes_per_request > 0) {
+            load += (r.read_bytes_per_second + r.write_bytes_per_second) /
+                    static_cast<int64_t>(_load_balancer_bytes_per_request);
+        }
+        result = std::max(result, load);
+    }
+    return result;
+}
+
+bool greedy_load_balancer::can_load_balance(const dsn::gpid &pid, uint64_t now_ms) const
+{
+    if (t_migration_result->find(pid) != t_migration_result->end())
+        return false;
+    auto iter = _load_moved_time_ms.find(pid);
+    return iter == _load_moved_time_ms.end() ||
+           iter->second + _load_balancer_cooldown_seconds * 1000 <= now_ms;
+}
+
+void greedy_load_balancer::primary_load_balancer()
+{
+    for (auto &kv : *(t_global_view->nodes)) {
+        if (!all_replica_infos_collected(kv.second)) {
+            return;
+        }
+    }
+
+    const app_mapper &apps = *(t_global_view->apps);
+    uint64_t now_ms = dsn_now_ms();
+
+    // forget the partitions which have passed the cooldown period
+    for (auto iter = _load_moved_time_ms.begin(); iter != _load_moved_time_ms.end();) {
+        if (iter->second + _load_balancer_cooldown_seconds * 1000 <= now_ms)
+            iter = _load_moved_time_ms.erase(iter);
+        else
+            ++iter;
+    }
+
+    // node id -> primaries on it, and the sum of their load
+    std::vector<std::vector<dsn::gpid>> node_primaries(t_alive_nodes + 1);
+    std::vector<int64_t> node_load(t_alive_nodes + 1, 0);
+    std::unordered_map<dsn::gpid, int64_t> primary_load;
+    int64_t total_load = 0;
+    for (const auto &kv : apps) {
+        const std::shared_ptr<app_state> &app = kv.second;
+        if (app->status != app_status::AS_AVAILABLE)
+            continue;
+        for (int i = 0; i < app->partition_count; ++i) {
+            const partition_configuration &pc = app->partitions[i];
+            auto iter = address_id.find(pc.primary);
+            if (iter == address_id.end())
+                continue;
+            int64_t load = partition_load(app->helpers->contexts[i]);
+            node_primaries[iter->second].push_back(pc.pid);
+            node_load[iter->second] += load;
+            primary_load[pc.pid] = load;
+            total_load += load;
+        }
+    }
+    if (total_load == 0) {
+        dinfo("no load is reported, skip load balancer");
+        return;
+    }
+
+    int64_t average = total_load / t_alive_nodes;
+    int64_t threshold = average * (100 + _load_balancer_imbalance_percentage) / 100;
+    // a decision should lower the load of the hottest node by at least half of the
+    // tolerated imbalance, or else it's not worth the data movement
+    int64_t min_gain = std::max<int64_t>(average * _load_balancer_imbalance_percentage / 200, 1);
+
+    int moves = 0;
+    while (moves + 2 <= _max_load_balance_moves) {
+        int hot = 1;
+        for (int i = 2; i <= t_alive_nodes; ++i) {
+            if (node_load[i] > node_load[hot])
+                hot = i;
+        }
+        if (node_load[hot] <= threshold ||
+            node_load[hot] < static_cast<int64_t>(_load_balancer_min_node_load)) {
+            dinfo("primary load is balanced, max(%" PRId64 "), average(%" PRId64 ")",
+                  node_load[hot],
+                  average);
+            break;
+        }
+
+        std::vector<dsn::gpid> &hot_primaries = node_primaries[hot];
+        std::sort(hot_primaries.begin(),
+                  hot_primaries.end(),
+                  [&primary_load](const dsn::gpid &l, const dsn::gpid &r) {
+                      return primary_load[l] > primary_load[r];
+                  });
+
+        // the best decision: a hot primary on the hottest node, and a partner primary of the
+        // same app on the target node, which are swapped by move_primary or copy_primary
+        dsn::gpid hot_pid, partner_pid;
+        int target = 0;
+        int64_t best_peak = node_load[hot] - min_gain + 1;
+        balance_type type = balance_type::move_primary;
+
+        auto try_target = [&](const dsn::gpid &pid, int to, bool copy) {
+            int64_t load = primary_load[pid];
+            const rpc_address &hot_addr = address_vec[hot];
+            for (const dsn::gpid &partner : node_primaries[to]) {
+                if (partner.get_app_id() != pid.get_app_id() || primary_load[partner] >= load ||
+                    !can_load_balance(partner, now_ms))
+                    continue;
+                const std::shared_ptr<app_state> &app = apps.find(partner.get_app_id())->second;
+                const partition_configuration &ppc = app->partitions[partner.get_partition_index()];
+                if (copy ? is_member(ppc, hot_addr) : !is_secondary(ppc, hot_addr))
+                    continue;
+
+                int64_t delta = load - primary_load[partner];
+                int64_t peak = std::max(node_load[hot] - delta, node_load[to] + delta);
+                if (peak < best_peak) {
+                    best_peak = peak;
+                    hot_pid = pid;
+                    partner_pid = partner;
+                    target = to;
+                    type = copy ? balance_type::copy_primary : balance_type::move_primary;
+                }
+            }
+        };
+
+        for (const dsn::gpid &pid : hot_primaries) {
+            if (primary_load[pid] < min_gain)
+                break;
+            if (!can_load_balance(pid, now_ms))
+                continue;
+
+            const partition_configuration &pc =
+                apps.find(pid.get_app_id())->second->partitions[pid.get_partition_index()];
+            // prefer to move the primary to a secondary, which needs no data copy
+            for (const rpc_address &sec : pc.secondaries) {
+                auto iter = address_id.find(sec);
+                if (iter != address_id.end())
+                    try_target(pid, iter->second, false);
+            }
+            if (target == 0 && !_only_move_primary) {
+                for (int i = 1; i <= t_alive_nodes; ++i) {
+                    if (!is_member(pc, address_vec[i]))
+                        try_target(pid, i, true);
+                }
+            }
+            if (target != 0)
+                break;
+        }
+
+        if (target == 0) {
+            ddebug("can't find a decision to lower the load of %s, load(%" PRId64
+                   "), average(%" PRId64 ")",
+                   address_vec[hot].to_string(),
+                   node_load[hot],
+                   average);
+            break;
+        }
+
+        ddebug("load balancer: swap %d.%d(load %" PRId64 ") on %s(load %" PRId64
+               ") with %d.%d(load %" PRId64 ") on %s(load %" PRId64 ")",
+               hot_pid.get_app_id(),
+               hot_pid.get_partition_index(),
+               primary_load[hot_pid],
+               address_vec[hot].to_string(),
+               node_load[hot],
+               partner_pid.get_app_id(),
+               partner_pid.get_partition_index(),
+               primary_load[partner_pid],
+               address_vec[target].to_string(),
+               node_load[target]);
+
+        const std::shared_ptr<app_state> &app = apps.find(hot_pid.get_app_id())->second;
+        t_migration_result->emplace(
+            hot_pid,
+            generate_balancer_request(app->partitions[hot_pid.get_partition_index()],
+                                      type,
+                                      address_vec[hot],
+                                      address_vec[target]));
+        t_migration_result->emplace(
+            partner_pid,
+            generate_balancer_request(app->partitions[partner_pid.get_partition_index()],
+                                      type,
+                                      address_vec[target],
+                                      address_vec[hot]));
+        _load_moved_time_ms[hot_pid] = now_ms;
+        _load_moved_time_ms[partner_pid] = now_ms;
+
+        int64_t delta = primary_load[hot_pid] - primary_load[partner_pid];
+        node_load[hot] -= delta;
+        node_load[target] += delta;
+        std::replace(hot_primaries.begin(), hot_primaries.end(), hot_pid, partner_pid);
+        std::replace(node_primaries[target].begin(),
+                     node_primaries[target].end(),
+                     partner_pid,
+                     hot_pid);
+        moves += 2;
+    }
+}
+
 void greedy_load_balancer::greedy_balancer(const bool balance_checker)
 {
     const app_mapper &apps = *t_global_view->apps;
@@ -1026,6 +1197,9 @@ bool greedy_load_balancer::balance(meta_view view, migration_list &list)
     t_migration_result->clear();
 
     greedy_balancer(false);
+    if (t_migration_result->empty() && _primary_load_balancer) {
+        primary_load_balancer();
+    }
     return !t_migration_result->empty();
 }
 
@@ -26,7 +26,7 @@
 
 /*
  * Description:
- *     A greedy load balancer based on Dijkstra & Ford-Fulkerson
+ *     A greedy load balancer based on min-cost max-flow
  *
  * Revision history:
  *     2016-02-03, Weijie Sun, first version
@@ -37,6 +37,8 @@
 #include <functional>
 #include "server_load_balancer.h"
 
+class meta_service_test_app;
+
 namespace dsn {
 namespace replication {
 
@@ -91,10 +93,21 @@ private:
     bool _balancer_in_turn;
     bool _only_primary_balancer;
     bool _only_move_primary;
+    bool _primary_load_balancer;
+    uint64_t _load_balancer_imbalance_percentage;
+    uint64_t _load_balancer_min_node_load;
+    int32_t _max_load_balance_moves;
+    uint64_t _load_balancer_cooldown_seconds;
+    uint64_t _load_balancer_bytes_per_request;
+
+    // gpid -> the last time(ms) it was moved by the load balancer, a partition isn't moved
+    // again within the cooldown period, so that we won't jitter on the stale reported load
+    std::unordered_map<dsn::gpid, uint64_t> _load_moved_time_ms;
 
     dsn_handle_t _ctrl_balancer_in_turn;
     dsn_handle_t _ctrl_only_primary_balancer;
     dsn_handle_t _ctrl_only_move_primary;
+    dsn_handle_t _ctrl_primary_load_balancer;
     dsn_handle_t _get_balance_operation_count;
 
     // perf counters
@@ -105,10 +118,6 @@ private:
 
 private:
     void number_nodes(const node_mapper &nodes);
-    void shortest_path(std::vector<bool> &visit,
-                       std::vector<int> &flow,
-                       std::vector<int> &prev,
-                       std::vector<std::vector<int>> &network);
 
     // balance decision generators. All these functions try to make balance decisions
     // and store them to t_migration_result.
@@ -119,8 +128,9 @@ private:
     // when return false, it means generators refuse to make decision coz
     // they think they need more informations.
     bool move_primary_based_on_flow_per_app(const std::shared_ptr<app_state> &app,
-                                            const std::vector<int> &prev,
-                                            const std::vector<int> &flow);
+                                            int replicas_low,
+                                            bool no_lower_nodes,
+                                            /*out*/ int &moved);
     bool copy_primary_per_app(const std::shared_ptr<app_state> &app,
                               bool still_have_less_than_average,
                               int replicas_low);
@@ -132,6 +142,14 @@ private:
 
     void greedy_balancer(const bool balance_checker);
 
+    // load-aware balancer, which tries to even out the load(qps & bytes) of primaries
+    // reported by replica servers. it only works when the count-based balancers are
+    // satisfied, and swaps the primaries of the same app between two nodes, so the
+    // primary/partition counts of each app keep unchanged.
+    int64_t partition_load(const config_context &cc) const;
+    bool can_load_balance(const dsn::gpid &pid, uint64_t now_ms) const;
+    void primary_load_balancer();
+
     bool all_replica_infos_collected(const node_state &ns);
     // using t_global_view to get disk_tag of node's pid
     const std::string &get_disk_tag(const dsn::rpc_address &node, const dsn::gpid &pid);
@@ -149,6 +167,8 @@ private:
                               const balance_type &type,
                               const rpc_address &from,
                               const rpc_address &to);
+
+    friend class ::meta_service_test_app;
 };
 }
 }
@@ -348,7 +348,15 @@ void config_context::collect_serving_replica(const rpc_address &node, const repl
         iter->disk_tag = info.disk_tag;
         iter->storage_mb = 0;
     } else {
-        serving.emplace_back(serving_replica{node, 0, info.disk_tag});
+        iter = serving.emplace(serving.end(), serving_replica{node, 0, info.disk_tag});
+    }
+
+    // replica servers of old version don't report the load
+    if (info.__isset.read_qps) {
+        iter->read_qps = info.read_qps;
+        iter->write_qps = info.write_qps;
+        iter->read_bytes_per_second = info.read_bytes_per_second;
+        iter->write_bytes_per_second = info.write_bytes_per_second;
     }
 }
 
@@ -402,7 +410,11 @@ std::shared_ptr<app_state> app_state::create(const app_info &info)
 }
 
 node_state::node_state()
-    : total_primaries(0), total_partitions(0), is_alive(false), has_collected_replicas(false)
+    : total_primaries(0),
+      total_partitions(0),
+      is_alive(false),
+      has_collected_replicas(false),
+      config_sync_version(0)
 {
 }
 
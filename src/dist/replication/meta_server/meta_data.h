@@ -180,6 +180,12 @@ struct serving_replica
     // TODO: report the storage size of replica
     int64_t storage_mb;
     std::string disk_tag;
+    // load reported by the replica in the latest config sync, only the replica
+    // serving as primary receives client requests, so others are usually 0
+    int64_t read_qps;
+    int64_t write_qps;
+    int64_t read_bytes_per_second;
+    int64_t write_bytes_per_second;
 };
 
 class config_context
@@ -358,6 +364,8 @@ private:
     // status
     bool is_alive;
     bool has_collected_replicas;
+    // version of the last config sync from the node, the base of its next incremental sync
+    int64_t config_sync_version;
     dsn::rpc_address address;
 
     const partition_set *get_partitions(app_id id, bool only_primary) const;
@@ -382,6 +390,8 @@ public:
     void set_alive(bool alive) { is_alive = alive; }
     bool has_collected() { return has_collected_replicas; }
     void set_replicas_collect_flag(bool has_collected) { has_collected_replicas = has_collected; }
+    int64_t last_config_sync_version() const { return config_sync_version; }
+    void set_config_sync_version(int64_t version) { config_sync_version = version; }
     dsn::rpc_address addr() const { return address; }
     void set_addr(const dsn::rpc_address &addr) { address = addr; }
 
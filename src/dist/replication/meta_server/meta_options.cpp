@@ -115,6 +115,59 @@ void meta_options::initialize()
         10,
         "add secondary max count for one node when flow control enabled");
 
+    config_subscription_wait_ms =
+        dsn_config_get_value_uint64("meta_server",
+                                    "config_subscription_wait_ms",
+                                    30000,
+                                    "how long a configuration subscription is held if "
+                                    "nothing changes");
+    max_config_subscriptions = dsn_config_get_value_uint64(
+        "meta_server",
+        "max_config_subscriptions",
+        100000,
+        "max count of held configuration subscriptions, others are replied immediately");
+
+    config_sync_batch_linger_ms =
+        dsn_config_get_value_uint64("meta_server",
+                                    "config_sync_batch_linger_ms",
+                                    5,
+                                    "how long a partition configuration update waits to be "
+                                    "written to remote storage together with others, 0 to "
+                                    "write every update separately");
+    config_sync_batch_max_size =
+        dsn_config_get_value_uint64("meta_server",
+                                    "config_sync_batch_max_size",
+                                    100,
+                                    "max count of partition configuration updates written to "
+                                    "remote storage in one transaction");
+
+    remote_storage_read_concurrency =
+        (int32_t)dsn_config_get_value_uint64("meta_server",
+                                             "remote_storage_read_concurrency",
+                                             1000,
+                                             "max count of outstanding reads when loading apps "
+                                             "from remote storage, 0 for unlimited");
+    standby_snapshot_interval_seconds =
+        dsn_config_get_value_uint64("meta_server",
+                                    "standby_snapshot_interval_seconds",
+                                    120,
+                                    "every this period a standby meta server refreshes its "
+                                    "snapshot of the partition configurations, which speeds up "
+                                    "taking over the leadership, 0 to disable");
+    standby_push_interval_ms =
+        dsn_config_get_value_uint64("meta_server",
+                                    "standby_push_interval_ms",
+                                    100,
+                                    "every this period the leader meta server pushes the updated "
+                                    "partition configurations to the standby meta servers, 0 to "
+                                    "disable, then the standby ones don't serve queries");
+    standby_query_max_staleness_ms =
+        dsn_config_get_value_uint64("meta_server",
+                                    "standby_query_max_staleness_ms",
+                                    1000,
+                                    "a standby meta server serves configuration queries only if "
+                                    "it has got a push from the leader within this period");
+
     /// failure detector options
     _fd_opts.distributed_lock_service_type =
         dsn_config_get_value_string("meta_server",
@@ -161,6 +214,41 @@ void meta_options::initialize()
     _lb_opts.only_move_primary = dsn_config_get_value_bool(
         "meta_server", "only_move_primary", false, "only try to make the primary balanced by move");
 
+    _lb_opts.primary_load_balancer =
+        dsn_config_get_value_bool("meta_server",
+                                  "primary_load_balancer",
+                                  false,
+                                  "balance the primaries by the qps/bytes reported by replica "
+                                  "servers after the replica counts are balanced");
+    _lb_opts.load_balancer_imbalance_percentage =
+        dsn_config_get_value_uint64("meta_server",
+                                    "load_balancer_imbalance_percentage",
+                                    20,
+                                    "load balancer only acts when the hottest node exceeds the "
+                                    "average load by this percentage");
+    _lb_opts.load_balancer_min_node_load =
+        dsn_config_get_value_uint64("meta_server",
+                                    "load_balancer_min_node_load",
+                                    1000,
+                                    "load balancer ignores nodes whose load is below this value");
+    _lb_opts.max_load_balance_moves = (int32_t)dsn_config_get_value_uint64(
+        "meta_server",
+        "max_load_balance_moves",
+        4,
+        "max partitions moved by load balancer in one balance round");
+    _lb_opts.load_balancer_cooldown_seconds =
+        dsn_config_get_value_uint64("meta_server",
+                                    "load_balancer_cooldown_seconds",
+                                    600,
+                                    "a partition moved by load balancer won't be moved again "
+                                    "by it during this period");
+    _lb_opts.load_balancer_bytes_per_request =
+        dsn_config_get_value_uint64("meta_server",
+                                    "load_balancer_bytes_per_request",
+                                    4096,
+                                    "load of a partition is qps + bytes_per_second / this value, "
+                                    "0 means to ignore the bytes");
+
     cold_backup_disabled = dsn_config_get_value_bool(
         "meta_server", "cold_backup_disabled", true, "whether to disable cold backup");
 
@@ -60,6 +60,13 @@ public:
     bool balancer_in_turn;
     bool only_primary_balancer;
     bool only_move_primary;
+
+    bool primary_load_balancer;
+    uint64_t load_balancer_imbalance_percentage;
+    uint64_t load_balancer_min_node_load;
+    int32_t max_load_balance_moves;
+    uint64_t load_balancer_cooldown_seconds;
+    uint64_t load_balancer_bytes_per_request;
 };
 
 class meta_options
@@ -78,6 +85,17 @@ public:
     bool add_secondary_enable_flow_control;
     int32_t add_secondary_max_count_for_one_node;
 
+    uint64_t config_subscription_wait_ms;
+    int32_t max_config_subscriptions;
+
+    uint64_t config_sync_batch_linger_ms;
+    int32_t config_sync_batch_max_size;
+
+    int32_t remote_storage_read_concurrency;
+    uint64_t standby_snapshot_interval_seconds;
+    uint64_t standby_push_interval_ms;
+    uint64_t standby_query_max_staleness_ms;
+
     fd_suboptions _fd_opts;
     lb_suboptions _lb_opts;
 
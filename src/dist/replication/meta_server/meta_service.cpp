@@ -237,6 +237,14 @@ void meta_service::start_service()
                            server_state::sStateHash,
                            std::chrono::milliseconds(_opts.lb_interval_ms));
 
+    if (_meta_opts.standby_push_interval_ms > 0 && _opts.meta_servers.size() > 1) {
+        tasking::enqueue_timer(
+            LPC_META_STANDBY_PUSH,
+            nullptr,
+            std::bind(&server_state::push_to_standby_meta_servers, _state.get()),
+            std::chrono::milliseconds(_meta_opts.standby_push_interval_ms));
+    }
+
     if (!_meta_opts.cold_backup_disabled) {
         ddebug("start backup service");
         tasking::enqueue(LPC_DEFAULT_CALLBACK,
@@ -263,11 +271,11 @@ error_code meta_service::start()
         _failure_detector->set_allow_list(_meta_opts.replica_white_list);
     _failure_detector->register_ctrl_commands();
 
-    err = _failure_detector->start(_opts.fd_check_interval_seconds,
-                                   _opts.fd_beacon_interval_seconds,
-                                   _opts.fd_lease_seconds,
-                                   _opts.fd_grace_seconds,
-                                   _meta_opts.enable_white_list);
+    err = _failure_detector->start_ms(_opts.fd_check_interval_ms,
+                                      _opts.fd_beacon_interval_ms,
+                                      _opts.fd_lease_seconds * 1000,
+                                      _opts.fd_grace_seconds * 1000,
+                                      _meta_opts.enable_white_list);
 
     dreturn_not_ok_logged(err, "start failure_detector failed, err = %s", err.to_string());
     ddebug("meta service failure detector is successfully started %s",
@@ -282,11 +290,30 @@ error_code meta_service::start()
     _cli_service = std::move(dsn::cli_service::create_service());
     _cli_service->open_service();
 
+    // initialize the server_state
+    _state->initialize(this, meta_options::concat_path_unix_style(_cluster_root, "apps"));
+
+    // keep a snapshot of the partition configurations warm while standby
+    task_ptr standby_snapshot_timer;
+    if (_meta_opts.standby_snapshot_interval_seconds > 0) {
+        standby_snapshot_timer = tasking::enqueue_timer(
+            LPC_META_STANDBY_SNAPSHOT,
+            nullptr,
+            std::bind(&server_state::refresh_standby_snapshot, _state.get()),
+            std::chrono::seconds(_meta_opts.standby_snapshot_interval_seconds));
+    }
+
     _failure_detector->acquire_leader_lock();
     dassert(_failure_detector->get_leader(nullptr), "must be primary at this point");
     ddebug("%s got the primary lock, start to recover server state from remote storage",
            dsn_primary_address().to_string());
 
+    // don't wait for a running refresh, which is ignored once the state is loaded
+    if (standby_snapshot_timer != nullptr) {
+        standby_snapshot_timer->cancel(false);
+        standby_snapshot_timer = nullptr;
+    }
+
     // initialize the load balancer
     server_load_balancer *balancer = utils::factory_store<server_load_balancer>::create(
         _meta_opts._lb_opts.server_load_balancer_type.c_str(), PROVIDER_TYPE_MAIN, this);
@@ -305,8 +332,6 @@ error_code meta_service::start()
             [](backup_service *bs) { return std::make_shared<policy_context>(bs); });
     }
 
-    // initialize the server_state
-    _state->initialize(this, meta_options::concat_path_unix_style(_cluster_root, "apps"));
     while ((err = _state->initialize_data_structure()) != ERR_OK) {
         if (err == ERR_OBJECT_NOT_FOUND && _meta_opts.recover_from_replica_server) {
             ddebug("can't find apps from remote storage, and "
@@ -336,6 +361,10 @@ void meta_service::register_rpc_handlers()
     register_rpc_handler(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX,
                          "query_configuration_by_index",
                          &meta_service::on_query_configuration_by_index);
+    register_rpc_handler(RPC_CM_SUBSCRIBE_PARTITION_CONFIG,
+                         "subscribe_configuration",
+                         &meta_service::on_subscribe_configuration);
+    register_rpc_handler(RPC_CM_STANDBY_PUSH, "standby_push", &meta_service::on_standby_push);
     register_rpc_handler(RPC_CM_UPDATE_PARTITION_CONFIGURATION,
                          "update_configuration",
                          &meta_service::on_update_configuration);
@@ -546,18 +575,16 @@ void meta_service::on_query_configuration_by_node(dsn::message_ex *msg)
     reply(msg, response);
 }
 
-void meta_service::on_query_configuration_by_index(dsn::message_ex *msg)
+bool meta_service::check_status_for_query_configuration(dsn::message_ex *msg)
 {
-    configuration_query_by_index_response response;
-
     // here we do not use RPC_CHECK_STATUS macro, but specially handle it
     // to response forward address.
-    dinfo("rpc %s called", __FUNCTION__);
     rpc_address forward_address;
     int result = check_leader(msg, &forward_address);
     if (result == 0)
-        return;
+        return false;
     if (result == -1 || !_started) {
+        configuration_query_by_index_response response;
         if (result == -1) {
             response.err = ERR_FORWARD_TO_OTHERS;
             if (!forward_address.is_invalid()) {
@@ -572,15 +599,73 @@ void meta_service::on_query_configuration_by_index(dsn::message_ex *msg)
         }
         ddebug("reject request with %s", response.err.to_string());
         reply(msg, response);
-        return;
+        return false;
     }
+    return true;
+}
+
+void meta_service::on_query_configuration_by_index(dsn::message_ex *msg)
+{
+    configuration_query_by_index_response response;
+    dinfo("rpc %s called", __FUNCTION__);
 
+    // a standby meta server serves the query itself if its state is up to date, the request
+    // is read from a copy as it may be forwarded to the leader otherwise
     configuration_query_by_index_request request;
+    if (!_failure_detector->get_leader(nullptr)) {
+        dsn::message_ex *copied = msg->copy(true, true);
+        copied->add_ref();
+        dsn::unmarshall(copied, request);
+        copied->release_ref();
+        if (_state->query_standby_configuration(request, response)) {
+            reply(msg, response);
+            return;
+        }
+    }
+
+    if (!check_status_for_query_configuration(msg))
+        return;
+
     dsn::unmarshall(msg, request);
+
+    // after a failover lots of clients query the same configuration at the same time,
+    // reply them with the shared pre-serialized response if possible
+    blob data;
+    if (_state->get_cached_query_response(
+            request, (dsn_msg_serialize_format)msg->header->context.u.serialize_format, data)) {
+        dsn::message_ex *resp = msg->create_response();
+        resp->write_append(data);
+        dsn_rpc_reply(resp);
+        return;
+    }
+
     _state->query_configuration_by_index(request, response);
     reply(msg, response);
 }
 
+void meta_service::on_subscribe_configuration(dsn::message_ex *msg)
+{
+    dinfo("rpc %s called", __FUNCTION__);
+    if (!check_status_for_query_configuration(msg))
+        return;
+
+    configuration_query_by_index_request request;
+    dsn::unmarshall(msg, request);
+    _state->subscribe_configuration(msg, request);
+}
+
+// leader meta server => standby meta server
+void meta_service::on_standby_push(dsn::message_ex *req)
+{
+    dsn::rpc_address leader;
+    if (_failure_detector->get_leader(&leader) || req->header->from_address != leader)
+        return;
+
+    meta_standby_push_request request;
+    dsn::unmarshall(req, request);
+    _state->on_standby_push(req->header->from_address, request);
+}
+
 // partition sever => meta sever
 // as get stale configuration is not allowed for partition server, we need to dispatch it to the
 // meta state thread pool
@@ -597,6 +682,8 @@ void meta_service::on_config_sync(dsn::message_ex *req)
         // AFTER the node dead is dispatch
         // AFTER the node dead event
         zauto_lock l(_failure_detector->_lock);
+        // the config sync is also counted as a beacon, see replica_stub::on_node_query_reply
+        _failure_detector->record_worker_traffic(req->header->from_address);
         req->add_ref();
         tasking::enqueue(LPC_META_STATE_HIGH,
                          nullptr,
@@ -135,6 +135,9 @@ private:
     // query partition configuration
     void on_query_configuration_by_node(dsn::message_ex *req);
     void on_query_configuration_by_index(dsn::message_ex *req);
+    // long-poll of configuration changes of an app, see server_state::subscribe_configuration
+    void on_subscribe_configuration(dsn::message_ex *req);
+    void on_standby_push(dsn::message_ex *req);
 
     // partition server => meta server
     void on_config_sync(dsn::message_ex *req);
@@ -176,6 +179,9 @@ private:
     //  -1. meta isn't leader, and rpc-msg can't forward to others
     // if return -1 and `forward_address' != nullptr, then return leader by `forward_address'.
     int check_leader(dsn::message_ex *req, dsn::rpc_address *forward_address);
+    // returns false if the configuration query can't be served by this meta server, in which
+    // case the rejection with the forward address has been replied
+    bool check_status_for_query_configuration(dsn::message_ex *req);
     error_code remote_storage_initialize();
     bool check_freeze() const;
 
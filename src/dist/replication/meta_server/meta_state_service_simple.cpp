@@ -38,6 +38,7 @@
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/async_calls.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/crc.h>
 
 #include <stack>
 #include <utility>
@@ -82,25 +83,33 @@ void meta_state_service_simple::write_log(blob &&log_blob,
                                           task_ptr task)
 {
     _log_lock.lock();
+    if (_log_compaction_threshold > 0 && !_snapshot_in_progress &&
+        _offset - _log_start_offset >= _log_compaction_threshold) {
+        start_snapshot();
+    }
+    disk_file *log = _log;
     uint64_t log_offset = _offset;
+    uint64_t file_offset = _offset - _log_start_offset;
     _offset += log_blob.length();
-    auto continuation_task = std::unique_ptr<operation>(new operation(false, [=](bool log_succeed) {
-        dassert(log_succeed, "we cannot handle logging failure now");
-        __err_cb_bind_and_enqueue(task, internal_operation(), 0);
-    }));
+    auto continuation_task = std::unique_ptr<operation>(
+        new operation(false, _offset, [=](bool log_succeed) {
+            dassert(log_succeed, "we cannot handle logging failure now");
+            __err_cb_bind_and_enqueue(task, internal_operation(), 0);
+        }));
     auto continuation_task_ptr = continuation_task.get();
     _task_queue.emplace(move(continuation_task));
     _log_lock.unlock();
 
-    file::write(_log,
+    file::write(log,
                 log_blob.data(),
                 log_blob.length(),
-                log_offset,
+                file_offset,
                 LPC_META_STATE_SERVICE_SIMPLE_INTERNAL,
                 &_tracker,
                 [=](error_code err, size_t bytes) {
                     dassert(err == ERR_OK && bytes == log_blob.length(),
-                            "we cannot handle logging failure now");
+                            "we cannot handle logging failure now, offset = %" PRIu64,
+                            log_offset);
                     _log_lock.lock();
                     continuation_task_ptr->done = true;
                     while (!_task_queue.empty()) {
@@ -108,12 +117,140 @@ void meta_state_service_simple::write_log(blob &&log_blob,
                             break;
                         }
                         _task_queue.front()->cb(true);
+                        _applied_offset = _task_queue.front()->end_offset;
                         _task_queue.pop();
                     }
+                    while (!_retired_logs.empty() &&
+                           _retired_logs.front().first <= _applied_offset) {
+                        file::close(_retired_logs.front().second);
+                        _retired_logs.pop_front();
+                    }
                     _log_lock.unlock();
                 });
 }
 
+std::string meta_state_service_simple::log_segment_path(uint64_t start_offset) const
+{
+    std::string path = utils::filesystem::path_combine(_work_dir, "meta_state_service.log");
+    if (start_offset == 0)
+        return path;
+    return path + "." + std::to_string(start_offset);
+}
+
+std::string meta_state_service_simple::snapshot_path() const
+{
+    return utils::filesystem::path_combine(_work_dir, "meta_state_service.snapshot");
+}
+
+void meta_state_service_simple::start_snapshot()
+{
+    std::string path = log_segment_path(_offset);
+    disk_file *new_log = file::open(path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
+    if (!new_log) {
+        derror("open file failed: %s, keep on using the current log segment", path.c_str());
+        return;
+    }
+    _retired_logs.emplace_back(_offset, _log);
+    _log = new_log;
+    _log_start_offset = _offset;
+    _log_segments[_offset] = path;
+
+    // the tree is only changed with _log_lock held, so it's exactly the state of the log
+    // before _applied_offset now. only the references are taken here, the dump is done
+    // in background so that the writers are not blocked by the disk io
+    auto nodes = std::make_shared<std::vector<std::pair<std::string, blob>>>();
+    uint64_t snapshot_offset = _applied_offset;
+    {
+        zauto_lock _(_state_lock);
+        nodes->reserve(_quick_map.size());
+        std::stack<std::pair<std::string, state_node *>> stack;
+        stack.emplace("/", &_root);
+        while (!stack.empty()) {
+            auto top = std::move(stack.top());
+            stack.pop();
+            // parents are always dumped before their children
+            nodes->emplace_back(top.first, top.second->data);
+            for (auto &child : top.second->children) {
+                stack.emplace(top.first == "/" ? top.first + child.first
+                                               : top.first + "/" + child.first,
+                              child.second);
+            }
+        }
+    }
+
+    _snapshot_in_progress = true;
+    ddebug("start meta state snapshot, log_offset = %" PRIu64 ", node_count = %d",
+           snapshot_offset,
+           static_cast<int>(nodes->size()));
+    tasking::enqueue(LPC_META_STATE_SERVICE_SIMPLE_SNAPSHOT,
+                     &_tracker,
+                     [this, snapshot_offset, nodes]() { write_snapshot(snapshot_offset, nodes); });
+}
+
+void meta_state_service_simple::write_snapshot(
+    uint64_t log_offset, std::shared_ptr<std::vector<std::pair<std::string, blob>>> nodes)
+{
+    binary_writer writer;
+    for (const auto &node : *nodes) {
+        writer.write(node.first);
+        writer.write(node.second);
+    }
+    blob body = writer.get_buffer();
+
+    snapshot_header header;
+    header.log_offset = log_offset;
+    header.node_count = nodes->size();
+    header.body_size = body.length();
+    header.body_crc = utils::crc32_calc(body.data(), body.length(), 0);
+
+    std::string path = snapshot_path();
+    std::string tmp_path = path + ".tmp";
+    bool succeed = false;
+    if (FILE *fd = fopen(tmp_path.c_str(), "wb")) {
+        succeed = fwrite(&header, sizeof(header), 1, fd) == 1 &&
+                  (body.length() == 0 || fwrite(body.data(), body.length(), 1, fd) == 1) &&
+                  fflush(fd) == 0 && fsync(fileno(fd)) == 0;
+        fclose(fd);
+    }
+    if (succeed) {
+        succeed = utils::filesystem::rename_path(tmp_path, path);
+    }
+
+    if (succeed) {
+        ddebug("meta state snapshot done, log_offset = %" PRIu64 ", size = %d",
+               log_offset,
+               body.length());
+        remove_obsolete_log_segments(log_offset);
+    } else {
+        derror("write meta state snapshot %s failed, the log is kept", tmp_path.c_str());
+    }
+
+    zauto_lock l(_log_lock);
+    _snapshot_in_progress = false;
+}
+
+void meta_state_service_simple::remove_obsolete_log_segments(uint64_t snapshot_offset)
+{
+    std::vector<std::string> obsolete;
+    {
+        zauto_lock l(_log_lock);
+        // a segment is obsolete if the next one starts before the snapshot offset,
+        // which also means it's closed as the log before snapshot offset is applied
+        while (_log_segments.size() > 1 &&
+               std::next(_log_segments.begin())->first <= snapshot_offset) {
+            obsolete.push_back(std::move(_log_segments.begin()->second));
+            _log_segments.erase(_log_segments.begin());
+        }
+    }
+    for (const auto &path : obsolete) {
+        if (!utils::filesystem::remove_path(path)) {
+            dwarn("remove obsolete log segment %s failed", path.c_str());
+        } else {
+            ddebug("obsolete log segment %s removed", path.c_str());
+        }
+    }
+}
+
 error_code meta_state_service_simple::create_node_internal(const std::string &node,
                                                            const blob &value)
 {
@@ -230,64 +367,197 @@ error_code meta_state_service_simple::apply_transaction(
     return ERR_OK;
 }
 
+uint64_t meta_state_service_simple::replay_log_segment(const std::string &path,
+                                                       uint64_t start_offset,
+                                                       uint64_t skip_offset)
+{
+    uint64_t offset = start_offset;
+    FILE *fd = fopen(path.c_str(), "rb");
+    if (fd == nullptr) {
+        derror("open log segment %s failed", path.c_str());
+        return offset;
+    }
+
+    for (;;) {
+        log_header header;
+        if (fread(&header, sizeof(log_header), 1, fd) != 1) {
+            break;
+        }
+        if (header.magic != log_header::default_magic) {
+            break;
+        }
+        std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
+        if (fread(buffer.get(), header.size, 1, fd) != 1) {
+            break;
+        }
+        uint64_t entry_offset = offset;
+        offset += sizeof(header) + header.size;
+        // already in the snapshot
+        if (entry_offset < skip_offset) {
+            continue;
+        }
+
+        binary_reader reader(blob(buffer, (int)header.size));
+        int op_type;
+        reader.read(op_type);
+
+        switch (static_cast<operation_type>(op_type)) {
+        case operation_type::create_node: {
+            std::string node;
+            blob data;
+            create_node_log::parse(reader, node, data);
+            create_node_internal(node, data);
+            break;
+        }
+        case operation_type::delete_node: {
+            std::string node;
+            bool recursively_delete;
+            delete_node_log::parse(reader, node, recursively_delete);
+            delete_node_internal(node, recursively_delete);
+            break;
+        }
+        case operation_type::set_data: {
+            std::string node;
+            blob data;
+            set_data_log::parse(reader, node, data);
+            set_data_internal(node, data);
+            break;
+        }
+        default:
+            // The log is complete but its content is modified by cosmic ray. This is
+            // unacceptable
+            dassert(false, "meta state server log corrupted");
+        }
+    }
+    fclose(fd);
+    return offset;
+}
+
+error_code meta_state_service_simple::load_snapshot(/*out*/ uint64_t &log_offset)
+{
+    std::string path = snapshot_path();
+    int64_t file_size = 0;
+    if (!utils::filesystem::file_size(path, file_size) ||
+        file_size < static_cast<int64_t>(sizeof(snapshot_header))) {
+        derror("invalid meta state snapshot %s", path.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+
+    std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(file_size));
+    FILE *fd = fopen(path.c_str(), "rb");
+    if (fd == nullptr) {
+        derror("open meta state snapshot %s failed", path.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    bool read_ok = fread(buffer.get(), file_size, 1, fd) == 1;
+    fclose(fd);
+
+    snapshot_header header;
+    memcpy(&header, buffer.get(), sizeof(header));
+    const char *body = buffer.get() + sizeof(header);
+    if (!read_ok || header.magic != snapshot_header::default_magic ||
+        header.version != snapshot_header::default_version ||
+        header.body_size != file_size - sizeof(header) ||
+        header.body_crc != utils::crc32_calc(body, header.body_size, 0)) {
+        derror("meta state snapshot %s corrupted", path.c_str());
+        return ERR_CORRUPTION;
+    }
+
+    binary_reader reader(blob(buffer, sizeof(header), static_cast<unsigned int>(header.body_size)));
+    for (uint64_t i = 0; i < header.node_count; ++i) {
+        std::string node;
+        blob data;
+        reader.read(node);
+        reader.read(data);
+        // copy the data out, so that the snapshot buffer is not held by the tree
+        data = blob::create_from_bytes(data.data(), data.length());
+        error_code err =
+            (node == "/") ? set_data_internal(node, data) : create_node_internal(node, data);
+        dassert(err == ERR_OK,
+                "load node %s from snapshot failed: %s",
+                node.c_str(),
+                err.to_string());
+    }
+
+    log_offset = header.log_offset;
+    ddebug("meta state snapshot loaded, log_offset = %" PRIu64 ", node_count = %" PRIu64,
+           header.log_offset,
+           header.node_count);
+    return ERR_OK;
+}
+
 error_code meta_state_service_simple::initialize(const std::vector<std::string> &args)
 {
-    const char *work_dir =
-        args.empty() ? service_app::current_service_app_info().data_dir.c_str() : args[0].c_str();
-
-    _offset = 0;
-    std::string log_path = dsn::utils::filesystem::path_combine(work_dir, "meta_state_service.log");
-    if (utils::filesystem::file_exists(log_path)) {
-        if (FILE *fd = fopen(log_path.c_str(), "rb")) {
-            for (;;) {
-                log_header header;
-                if (fread(&header, sizeof(log_header), 1, fd) != 1) {
-                    break;
-                }
-                if (header.magic != log_header::default_magic) {
-                    break;
-                }
-                std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
-                if (fread(buffer.get(), header.size, 1, fd) != 1) {
-                    break;
-                }
-                _offset += sizeof(header) + header.size;
-                binary_reader reader(blob(buffer, (int)header.size));
-                int op_type;
-                reader.read(op_type);
-
-                switch (static_cast<operation_type>(op_type)) {
-                case operation_type::create_node: {
-                    std::string node;
-                    blob data;
-                    create_node_log::parse(reader, node, data);
-                    create_node_internal(node, data);
-                    break;
-                }
-                case operation_type::delete_node: {
-                    std::string node;
-                    bool recursively_delete;
-                    delete_node_log::parse(reader, node, recursively_delete);
-                    delete_node_internal(node, recursively_delete);
-                    break;
-                }
-                case operation_type::set_data: {
-                    std::string node;
-                    blob data;
-                    set_data_log::parse(reader, node, data);
-                    set_data_internal(node, data);
-                    break;
-                }
-                default:
-                    // The log is complete but its content is modified by cosmic ray. This is
-                    // unacceptable
-                    dassert(false, "meta state server log corrupted");
-                }
+    _work_dir = args.empty() ? service_app::current_service_app_info().data_dir : args[0];
+    _log_compaction_threshold =
+        dsn_config_get_value_uint64("meta_state_service_simple",
+                                    "log_compaction_threshold_kb",
+                                    65536,
+                                    "start a new log segment and snapshot the state when the "
+                                    "current log segment exceeds this size, 0 to disable") *
+        1024;
+
+    uint64_t snapshot_offset = 0;
+    if (utils::filesystem::file_exists(snapshot_path())) {
+        error_code err = load_snapshot(snapshot_offset);
+        if (err != ERR_OK) {
+            return err;
+        }
+    }
+
+    // collect the log segments
+    std::vector<std::string> files;
+    if (!utils::filesystem::get_subfiles(_work_dir, files, false)) {
+        derror("list %s failed", _work_dir.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    const std::string log_name = "meta_state_service.log";
+    _log_segments.clear();
+    for (const std::string &file : files) {
+        std::string name = utils::filesystem::get_file_name(file);
+        if (name == log_name) {
+            _log_segments[0] = log_segment_path(0);
+        } else if (name.compare(0, log_name.length() + 1, log_name + ".") == 0) {
+            std::string suffix = name.substr(log_name.length() + 1);
+            if (!suffix.empty() && suffix.find_first_not_of("0123456789") == std::string::npos) {
+                uint64_t start = std::stoull(suffix);
+                _log_segments[start] = log_segment_path(start);
             }
-            fclose(fd);
         }
     }
 
+    if (!_log_segments.empty() && _log_segments.begin()->first > snapshot_offset) {
+        derror("log before offset %" PRIu64 " is missing, snapshot offset = %" PRIu64,
+               _log_segments.begin()->first,
+               snapshot_offset);
+        return ERR_INCONSISTENT_STATE;
+    }
+
+    // replay the log after the snapshot
+    _offset = _log_segments.empty() ? snapshot_offset : _log_segments.begin()->first;
+    for (auto it = _log_segments.begin(); it != _log_segments.end();) {
+        if (it->first != _offset) {
+            // the log after a hole is never acknowledged, as the operations are
+            // acknowledged in order
+            dwarn("log segment %s doesn't start at the end of the previous one (%" PRIu64
+                  "), remove it",
+                  it->second.c_str(),
+                  _offset);
+            utils::filesystem::remove_path(it->second);
+            it = _log_segments.erase(it);
+            continue;
+        }
+        _offset = replay_log_segment(it->second, it->first, snapshot_offset);
+        ++it;
+    }
+    _offset = std::max(_offset, snapshot_offset);
+    _applied_offset = _offset;
+
+    if (_log_segments.empty()) {
+        _log_segments[_offset] = log_segment_path(_offset);
+    }
+    _log_start_offset = _log_segments.rbegin()->first;
+    std::string log_path = _log_segments.rbegin()->second;
     _log = file::open(log_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
     if (!_log) {
         derror("open file failed: %s", log_path.c_str());
@@ -504,7 +774,12 @@ task_ptr meta_state_service_simple::get_children(const std::string &node,
 meta_state_service_simple::~meta_state_service_simple()
 {
     _tracker.cancel_outstanding_tasks();
-    file::close(_log);
+    for (auto &retired : _retired_logs) {
+        file::close(retired.second);
+    }
+    if (_log != nullptr) {
+        file::close(_log);
+    }
 }
 }
 }
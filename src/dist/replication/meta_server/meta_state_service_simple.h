@@ -34,6 +34,8 @@
  */
 
 #include <queue>
+#include <deque>
+#include <map>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/dist/meta_state_service.h>
 #include "dist/replication/common/replication_common.h"
@@ -43,7 +45,17 @@ namespace dist {
 DEFINE_TASK_CODE_AIO(LPC_META_STATE_SERVICE_SIMPLE_INTERNAL,
                      TASK_PRIORITY_HIGH,
                      THREAD_POOL_DEFAULT);
-
+DEFINE_TASK_CODE(LPC_META_STATE_SERVICE_SIMPLE_SNAPSHOT, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+//
+// all the operations are appended to a log, which is split into segments named
+// "meta_state_service.log[.<start_offset>]" by their logical start offset. when the
+// current segment grows beyond log_compaction_threshold_kb, a new segment is started and
+// the tree is dumped into "meta_state_service.snapshot" in background. the segments which
+// are totally covered by the snapshot are removed after that.
+//
+// on startup the snapshot is loaded and the log after the snapshot offset is replayed.
+//
 class meta_state_service_simple : public meta_state_service
 {
 public:
@@ -52,7 +64,11 @@ public:
           _quick_map({std::make_pair("/", &_root)}),
           _log_lock(true),
           _log(nullptr),
-          _offset(0)
+          _offset(0),
+          _log_start_offset(0),
+          _applied_offset(0),
+          _log_compaction_threshold(0),
+          _snapshot_in_progress(false)
     {
     }
 
@@ -107,8 +123,12 @@ private:
     struct operation
     {
         bool done;
+        uint64_t end_offset;
         std::function<void(bool)> cb;
-        operation(bool done, std::function<void(bool)> &&cb) : done(done), cb(move(cb)) {}
+        operation(bool done, uint64_t end_offset, std::function<void(bool)> &&cb)
+            : done(done), end_offset(end_offset), cb(move(cb))
+        {
+        }
     };
 
 #pragma pack(push, 1)
@@ -119,6 +139,27 @@ private:
         static const int default_magic = 0xdeadbeef;
         log_header() : magic(default_magic), size(0) {}
     };
+
+    struct snapshot_header
+    {
+        int magic;
+        int version;
+        uint64_t log_offset; // the snapshot contains all the log before this offset
+        uint64_t node_count;
+        uint64_t body_size;
+        uint32_t body_crc;
+        static const int default_magic = 0x736e6170;
+        static const int default_version = 1;
+        snapshot_header()
+            : magic(default_magic),
+              version(default_version),
+              log_offset(0),
+              node_count(0),
+              body_size(0),
+              body_crc(0)
+        {
+        }
+    };
 #pragma pack(pop)
 
     struct state_node
@@ -251,6 +292,19 @@ private:
     error_code
     apply_transaction(const std::shared_ptr<meta_state_service::transaction_entries> &t_entries);
 
+    std::string log_segment_path(uint64_t start_offset) const;
+    std::string snapshot_path() const;
+    // replay the log entries at or after skip_offset, returns the end offset of the valid log
+    uint64_t
+    replay_log_segment(const std::string &path, uint64_t start_offset, uint64_t skip_offset);
+    error_code load_snapshot(/*out*/ uint64_t &log_offset);
+
+    // start a new log segment and dump the tree in background, _log_lock must be held
+    void start_snapshot();
+    void write_snapshot(uint64_t log_offset,
+                        std::shared_ptr<std::vector<std::pair<std::string, blob>>> nodes);
+    void remove_obsolete_log_segments(uint64_t snapshot_offset);
+
     typedef std::unordered_map<std::string, state_node *> quick_map;
 
     zlock _queue_lock;
@@ -262,7 +316,16 @@ private:
 
     zlock _log_lock;
     disk_file *_log;
-    uint64_t _offset;
+    uint64_t _offset; // logical offset of the whole log
+
+    std::string _work_dir;
+    uint64_t _log_start_offset; // logical start offset of _log
+    uint64_t _applied_offset;   // the log before this offset is applied to the tree
+    uint64_t _log_compaction_threshold;
+    bool _snapshot_in_progress;
+    std::map<uint64_t, std::string> _log_segments; // start offset => path
+    // <end_offset, file>, closed once all the writes to it are done
+    std::deque<std::pair<uint64_t, disk_file *>> _retired_logs;
 
     dsn::task_tracker _tracker;
 };
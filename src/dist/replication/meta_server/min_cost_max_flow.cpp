@@ -0,0 +1,125 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <dsn/c/api_utilities.h>
+
+#include "min_cost_max_flow.h"
+
+namespace dsn {
+namespace replication {
+
+min_cost_max_flow::min_cost_max_flow(int node_count) : _head(node_count, -1) {}
+
+int min_cost_max_flow::add_edge(int from, int to, int capacity, int64_t cost)
+{
+    dassert(from >= 0 && from < node_count() && to >= 0 && to < node_count(),
+            "invalid edge %d -> %d, node_count = %d",
+            from,
+            to,
+            node_count());
+    dassert(capacity >= 0 && cost >= 0,
+            "invalid capacity(%d) or cost(%" PRId64 ")",
+            capacity,
+            cost);
+
+    int id = static_cast<int>(_edges.size());
+    _edges.push_back(edge{to, _head[from], capacity, cost});
+    _head[from] = id;
+    _edges.push_back(edge{from, _head[to], 0, -cost});
+    _head[to] = id + 1;
+    return id;
+}
+
+int min_cost_max_flow::solve(int source, int sink, /*out*/ int64_t &total_cost)
+{
+    const int64_t inf = std::numeric_limits<int64_t>::max();
+    int n = node_count();
+    int total_flow = 0;
+    total_cost = 0;
+
+    // the costs are non-negative at first, so the potentials can start from 0.
+    // the reduced cost "cost(u, v) + potential[u] - potential[v]" of every edge with residual
+    // capacity keeps non-negative after each round, which makes Dijkstra work.
+    std::vector<int64_t> potential(n, 0);
+    std::vector<int64_t> dist(n);
+    std::vector<int> prev_edge(n);
+
+    typedef std::pair<int64_t, int> dist_node;
+    std::priority_queue<dist_node, std::vector<dist_node>, std::greater<dist_node>> q;
+
+    while (true) {
+        std::fill(dist.begin(), dist.end(), inf);
+        std::fill(prev_edge.begin(), prev_edge.end(), -1);
+        dist[source] = 0;
+        q.emplace(0, source);
+        while (!q.empty()) {
+            dist_node top = q.top();
+            q.pop();
+            int u = top.second;
+            if (top.first > dist[u])
+                continue;
+            for (int i = _head[u]; i != -1; i = _edges[i].next) {
+                const edge &e = _edges[i];
+                if (e.capacity == 0)
+                    continue;
+                int64_t d = dist[u] + e.cost + potential[u] - potential[e.to];
+                if (d < dist[e.to]) {
+                    dist[e.to] = d;
+                    prev_edge[e.to] = i;
+                    q.emplace(d, e.to);
+                }
+            }
+        }
+
+        if (dist[sink] == inf)
+            break;
+
+        // nodes unreachable now will never be reachable, so their potentials don't matter
+        for (int i = 0; i < n; ++i) {
+            if (dist[i] != inf)
+                potential[i] += dist[i];
+        }
+
+        int augment = std::numeric_limits<int>::max();
+        for (int v = sink; v != source; v = _edges[prev_edge[v] ^ 1].to) {
+            augment = std::min(augment, _edges[prev_edge[v]].capacity);
+        }
+        for (int v = sink; v != source; v = _edges[prev_edge[v] ^ 1].to) {
+            _edges[prev_edge[v]].capacity -= augment;
+            _edges[prev_edge[v] ^ 1].capacity += augment;
+        }
+
+        total_flow += augment;
+        total_cost += static_cast<int64_t>(augment) * (potential[sink] - potential[source]);
+    }
+    return total_flow;
+}
+}
+}
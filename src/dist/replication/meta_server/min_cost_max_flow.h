@@ -0,0 +1,82 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     min-cost max-flow on a sparse graph, used by the greedy load balancer
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace dsn {
+namespace replication {
+
+//
+// successive shortest paths with potentials: every round finds the cheapest augmenting path
+// by Dijkstra on the reduced costs, so it costs O(F * E * log(V)) in total, where F is the max
+// flow. the graph is stored as adjacency lists, so sparse graphs are cheap.
+//
+// all edge costs must be non-negative.
+//
+class min_cost_max_flow
+{
+public:
+    explicit min_cost_max_flow(int node_count);
+
+    // add a directed edge, return an id with which the flow on the edge can be queried
+    int add_edge(int from, int to, int capacity, int64_t cost);
+
+    // return the max flow from source to sink, whose total cost is minimal among all the
+    // max flows
+    int solve(int source, int sink, /*out*/ int64_t &total_cost);
+
+    // flow on the edge after solve
+    int flow(int edge_id) const { return _edges[edge_id ^ 1].capacity; }
+
+    int node_count() const { return static_cast<int>(_head.size()); }
+
+private:
+    struct edge
+    {
+        int to;
+        int next;
+        int capacity;
+        int64_t cost;
+    };
+
+    // an edge and its reverse edge are adjacent, so the reverse of edge i is i^1
+    std::vector<edge> _edges;
+    std::vector<int> _head;
+};
+}
+}
@@ -379,6 +379,9 @@ bool simple_load_balancer::from_proposals(meta_view &view,
     case config_type::CT_DOWNGRADE_TO_SECONDARY:
         is_action_valid = (action.target == action.node && is_primary(pc, action.target));
         break;
+    case config_type::CT_HANDOVER_PRIMARY:
+        is_action_valid = (is_primary(pc, action.target) && is_secondary(pc, action.node));
+        break;
     default:
         is_action_valid = false;
         break;
@@ -41,7 +41,11 @@
 #include <dsn/tool-api/async_calls.h>
 #include <sstream>
 #include <cinttypes>
+#include <cstring>
 #include <string>
+#include <deque>
+#include <limits>
+#include <atomic>
 #include <boost/lexical_cast.hpp>
 
 #include "server_state.h"
@@ -59,17 +63,34 @@ static const char *unlock_state = "unlock";
 
 server_state::server_state()
     : _meta_svc(nullptr),
+      _standby_snapshot_used(false),
+      _standby_refreshing(false),
+      _standby_consistent(false),
+      _standby_push_lost_in_refresh(false),
+      _standby_pushes_in_refresh_count(0),
+      _standby_push_sequence(0),
+      _standby_last_push_ms(0),
+      _last_standby_push_sequence(0),
       _add_secondary_enable_flow_control(false),
       _add_secondary_max_count_for_one_node(0),
       _cli_dump_handle(nullptr),
       _ctrl_add_secondary_enable_flow_control(nullptr),
-      _ctrl_add_secondary_max_count_for_one_node(nullptr)
+      _ctrl_add_secondary_max_count_for_one_node(nullptr),
+      _ctrl_drain_node(nullptr),
+      _next_config_subscription_id(0),
+      _config_subscription_count(0)
 {
 }
 
 server_state::~server_state()
 {
     _tracker.cancel_outstanding_tasks();
+    for (auto &kv : _config_subscriptions) {
+        for (auto &sub : kv.second) {
+            sub.second.msg->release_ref();
+        }
+    }
+    _config_subscriptions.clear();
     if (_cli_dump_handle != nullptr) {
         dsn::command_manager::instance().deregister_command(_cli_dump_handle);
         _cli_dump_handle = nullptr;
@@ -84,6 +105,10 @@ server_state::~server_state()
             _ctrl_add_secondary_max_count_for_one_node);
         _ctrl_add_secondary_max_count_for_one_node = nullptr;
     }
+    if (_ctrl_drain_node != nullptr) {
+        dsn::command_manager::instance().deregister_command(_ctrl_drain_node);
+        _ctrl_drain_node = nullptr;
+    }
 }
 
 void server_state::register_cli_commands()
@@ -148,6 +173,26 @@ void server_state::register_cli_commands()
                 return result;
             });
     dassert(_ctrl_add_secondary_max_count_for_one_node, "register cli handler failed");
+
+    _ctrl_drain_node = dsn::command_manager::instance().register_app_command(
+        {"lb.drain_node"},
+        "lb.drain_node [ip:port [true|false]]",
+        "move all the primaries off a node before it is restarted, or stop doing so; "
+        "list the draining nodes and their primary counts if no node is given",
+        [this](const std::vector<std::string> &args) {
+            if (args.empty()) {
+                return query_draining_nodes();
+            }
+            rpc_address node;
+            bool draining = true;
+            if (args.size() > 2 || !node.from_string_ipv4(args[0].c_str()) ||
+                (args.size() == 2 && !dsn::buf2bool(args[1], draining))) {
+                return std::string("ERR: invalid arguments");
+            }
+            set_node_draining(node, draining);
+            return std::string("OK");
+        });
+    dassert(_ctrl_drain_node, "register cli handler failed");
 }
 
 void server_state::initialize(meta_service *meta_svc, const std::string &apps_root)
@@ -179,6 +224,25 @@ void server_state::initialize(meta_service *meta_svc, const std::string &apps_ro
                                               "healthy_partition_count",
                                               COUNTER_TYPE_NUMBER,
                                               "current healthy partition count");
+    _recent_config_sync_batch_count.init_app_counter(
+        "eon.server_state",
+        "recent_config_sync_batch_count",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "partition configuration sync transactions which contain more than one partition");
+    _held_config_subscriptions.init_app_counter("eon.server_state",
+                                                "held_config_subscription_count",
+                                                COUNTER_TYPE_NUMBER,
+                                                "current held configuration subscription count");
+    _recent_query_config_cache_hit_count.init_app_counter(
+        "eon.server_state",
+        "recent_query_config_cache_hit_count",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "query config count served by the cached response in the recent period");
+    _recent_query_config_cache_miss_count.init_app_counter(
+        "eon.server_state",
+        "recent_query_config_cache_miss_count",
+        COUNTER_TYPE_VOLATILE_NUMBER,
+        "query config count which rebuilds the cached response in the recent period");
     _recent_update_config_count.init_app_counter("eon.server_state",
                                                  "recent_update_config_count",
                                                  COUNTER_TYPE_VOLATILE_NUMBER,
@@ -239,6 +303,7 @@ void server_state::transition_staging_state(std::shared_ptr<app_state> &app)
     } while (0)
 
     app_status::type old_status = app->status;
+    invalidate_app_view(app->app_name);
     if (app->status == app_status::AS_CREATING) {
         app->status = app_status::AS_AVAILABLE;
         configuration_create_app_response resp;
@@ -469,6 +534,7 @@ error_code server_state::initialize_default_apps()
 // caller should ensure all apps are in staging: creating, dropping
 error_code server_state::sync_apps_to_remote_storage()
 {
+    invalidate_all_app_views();
     _exist_apps.clear();
     for (auto &kv_pair : _all_apps) {
         if (kv_pair.second->status == app_status::AS_CREATING) {
@@ -553,98 +619,192 @@ error_code server_state::sync_apps_to_remote_storage()
     }
 }
 
+static bool is_same_blob(const blob &b1, const blob &b2)
+{
+    return b1.length() == b2.length() &&
+           (b1.length() == 0 || memcmp(b1.data(), b2.data(), b1.length()) == 0);
+}
+
+error_code server_state::read_apps_from_remote_storage(const app_node_callback &on_app,
+                                                       const partition_node_callback &on_partition)
+{
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
+    const int max_outstanding_reads = _meta_svc->get_meta_options().remote_storage_read_concurrency;
+    dsn::task_tracker tracker;
+
+    // reads beyond max_outstanding_reads are queued, and issued once an outstanding one completes
+    zlock reads_lock;
+    int outstanding_reads = 0;
+    std::deque<std::pair<std::string, dist::err_value_callback>> pending_reads;
+    std::function<void(const std::string &, const dist::err_value_callback &)> issue_read;
+    issue_read = [&](const std::string &path, const dist::err_value_callback &cb) {
+        storage->get_data(path,
+                          LPC_META_CALLBACK,
+                          [&, cb](error_code ec, const blob &value) {
+                              cb(ec, value);
+                              std::pair<std::string, dist::err_value_callback> next;
+                              {
+                                  zauto_lock l(reads_lock);
+                                  if (pending_reads.empty()) {
+                                      --outstanding_reads;
+                                      return;
+                                  }
+                                  next = std::move(pending_reads.front());
+                                  pending_reads.pop_front();
+                              }
+                              issue_read(next.first, next.second);
+                          },
+                          &tracker);
+    };
+    auto read_node = [&](const std::string &path, dist::err_value_callback &&cb) {
+        {
+            zauto_lock l(reads_lock);
+            if (max_outstanding_reads > 0 && outstanding_reads >= max_outstanding_reads) {
+                pending_reads.emplace_back(path, std::move(cb));
+                return;
+            }
+            ++outstanding_reads;
+        }
+        issue_read(path, cb);
+    };
+
+    error_code err;
+    std::vector<std::string> apps;
+    storage
+        ->get_children(_apps_root,
+                       LPC_META_CALLBACK,
+                       [&err, &apps](error_code ec, const std::vector<std::string> &children) {
+                           err = ec;
+                           if (ec == ERR_OK)
+                               apps = children;
+                       })
+        ->wait();
+    if (err != ERR_OK) {
+        derror("get app list from meta state service failed, path = %s, err = %s",
+               _apps_root.c_str(),
+               err.to_string());
+        return err;
+    }
+
+    for (const std::string &appid_str : apps) {
+        std::string app_path = _apps_root + "/" + appid_str;
+        read_node(app_path, [&, app_path](error_code ec, const blob &value) {
+            int partition_count = on_app(ec, app_path, value);
+            // all the partitions are queued at once, so reads of different apps are pipelined
+            for (int i = 0; i < partition_count; i++) {
+                read_node(app_path + "/" + boost::lexical_cast<std::string>(i),
+                          [&on_partition, app_path, i](error_code ec, const blob &value) {
+                              on_partition(ec, app_path, i, value);
+                          });
+            }
+        });
+    }
+    tracker.wait_outstanding_tasks();
+    return ERR_OK;
+}
+
 dsn::error_code server_state::sync_apps_from_remote_storage()
 {
+    invalidate_all_app_views();
     dsn::error_code err;
-    dsn::task_tracker tracker;
+    uint64_t start_ms = dsn_now_ms();
 
-    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
-    auto sync_partition = [this, storage, &err, &tracker](
-        std::shared_ptr<app_state> &app, int partition_id, const std::string &partition_path) {
-        storage->get_data(
-            partition_path,
-            LPC_META_CALLBACK,
-            [this, app, partition_id, partition_path, &err](error_code ec,
-                                                            const blob &value) mutable {
-                if (ec == ERR_OK) {
-                    partition_configuration pc;
-                    dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
-
-                    dassert(pc.pid.get_app_id() == app->app_id &&
-                                pc.pid.get_partition_index() == partition_id,
-                            "invalid partition config");
-                    {
-                        zauto_write_lock l(_lock);
-                        app->partitions[partition_id] = pc;
-                        for (const dsn::rpc_address &addr : pc.last_drops) {
-                            app->helpers->contexts[partition_id].record_drop_history(addr);
-                        }
+    standby_app_map standby_snapshot = take_standby_snapshot();
+    std::atomic<int> unchanged_partition_count(0);
+    std::atomic<int> partition_count(0);
 
-                        if (app->status == app_status::AS_CREATING &&
-                            (pc.partition_flags & pc_flags::dropped) != 0) {
-                            recall_partition(app, partition_id);
-                        } else if (app->status == app_status::AS_DROPPING &&
-                                   (pc.partition_flags & pc_flags::dropped) == 0) {
-                            drop_partition(app, partition_id);
-                        } else
-                            process_one_partition(app);
-                    }
-                } else if (ec == ERR_OBJECT_NOT_FOUND) {
-                    dwarn("partition node %s not exist on remote storage, may half create before",
-                          partition_path.c_str());
-                    init_app_partition_node(app, partition_id, nullptr);
-                } else {
-                    derror("get partition node failed, reason(%s)", ec.to_string());
-                    err = ec;
-                }
-            },
-            &tracker);
+    // app path -> app, protected by _lock
+    std::unordered_map<std::string, std::shared_ptr<app_state>> path_apps;
+
+    auto sync_app = [&](error_code ec, const std::string &app_path, const blob &value) {
+        if (ec != ERR_OK) {
+            derror("get app info from meta state service failed, path = %s, err = %s",
+                   app_path.c_str(),
+                   ec.to_string());
+            err = ec;
+            return 0;
+        }
+
+        app_info info;
+        dassert(dsn::json::json_forwarder<app_info>::decode(value, info), "invalid json data");
+        std::shared_ptr<app_state> app = app_state::create(info);
+        {
+            zauto_write_lock l(_lock);
+            path_apps.emplace(app_path, app);
+            _all_apps.emplace(app->app_id, app);
+            if (app->status == app_status::AS_AVAILABLE) {
+                app->status = app_status::AS_CREATING;
+                _exist_apps.emplace(app->app_name, app);
+            } else if (app->status == app_status::AS_DROPPED) {
+                app->status = app_status::AS_DROPPING;
+            } else {
+                dassert(false,
+                        "invalid status(%s) for app(%s) in remote storage",
+                        enum_to_string(app->status),
+                        app->get_logname());
+            }
+        }
+        return app->partition_count;
     };
 
-    auto sync_app = [&](const std::string &app_path) {
-        storage->get_data(
-            app_path,
-            LPC_META_CALLBACK,
-            [this, app_path, &err, &sync_partition](error_code ec, const blob &value) {
-                if (ec == ERR_OK) {
-                    app_info info;
-                    dassert(dsn::json::json_forwarder<app_info>::decode(value, info),
-                            "invalid json data");
-                    std::shared_ptr<app_state> app = app_state::create(info);
-                    {
-                        zauto_write_lock l(_lock);
-                        _all_apps.emplace(app->app_id, app);
-                        if (app->status == app_status::AS_AVAILABLE) {
-                            app->status = app_status::AS_CREATING;
-                            _exist_apps.emplace(app->app_name, app);
-                        } else if (app->status == app_status::AS_DROPPED) {
-                            app->status = app_status::AS_DROPPING;
-                        } else {
-                            dassert(false,
-                                    "invalid status(%s) for app(%s) in remote storage",
-                                    enum_to_string(app->status),
-                                    app->get_logname());
-                        }
-                    }
+    auto sync_partition = [&](error_code ec,
+                              const std::string &app_path,
+                              int partition_id,
+                              const blob &value) {
+        std::string partition_path =
+            app_path + "/" + boost::lexical_cast<std::string>(partition_id);
+        std::shared_ptr<app_state> app;
+        {
+            zauto_read_lock l(_lock);
+            app = path_apps.find(app_path)->second;
+        }
 
-                    for (int i = 0; i < app->partition_count; i++) {
-                        std::string partition_path =
-                            app_path + "/" + boost::lexical_cast<std::string>(i);
-                        sync_partition(app, i, partition_path);
-                    }
-                } else {
-                    derror("get app info from meta state service failed, path = %s, err = %s",
-                           app_path.c_str(),
-                           ec.to_string());
-                    err = ec;
+        if (ec == ERR_OK) {
+            ++partition_count;
+            partition_configuration pc;
+            auto iter = standby_snapshot.find(app->app_id);
+            if (iter != standby_snapshot.end() &&
+                iter->second->view->partition_count == app->partition_count &&
+                is_same_blob(iter->second->partition_data[partition_id], value)) {
+                ++unchanged_partition_count;
+                pc = *iter->second->view->partitions[partition_id];
+            } else {
+                dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
+            }
+
+            dassert(pc.pid.get_app_id() == app->app_id &&
+                        pc.pid.get_partition_index() == partition_id,
+                    "invalid partition config");
+            {
+                zauto_write_lock l(_lock);
+                app->partitions[partition_id] = pc;
+                for (const dsn::rpc_address &addr : pc.last_drops) {
+                    app->helpers->contexts[partition_id].record_drop_history(addr);
                 }
-            },
-            &tracker);
+
+                if (app->status == app_status::AS_CREATING &&
+                    (pc.partition_flags & pc_flags::dropped) != 0) {
+                    recall_partition(app, partition_id);
+                } else if (app->status == app_status::AS_DROPPING &&
+                           (pc.partition_flags & pc_flags::dropped) == 0) {
+                    drop_partition(app, partition_id);
+                } else
+                    process_one_partition(app);
+            }
+        } else if (ec == ERR_OBJECT_NOT_FOUND) {
+            dwarn("partition node %s not exist on remote storage, may half create before",
+                  partition_path.c_str());
+            init_app_partition_node(app, partition_id, nullptr);
+        } else {
+            derror("get partition node failed, reason(%s)", ec.to_string());
+            err = ec;
+        }
     };
 
     _all_apps.clear();
     _exist_apps.clear();
 
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
     std::string transaction_state;
     storage
         ->get_data(_apps_root,
@@ -664,23 +824,15 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
             "invalid transaction state(%s)",
             transaction_state.c_str());
 
-    storage->get_children(
-        _apps_root,
-        LPC_META_CALLBACK,
-        [&](error_code ec, const std::vector<std::string> &apps) {
-            if (ec == ERR_OK) {
-                for (const auto &appid_str : apps) {
-                    sync_app(_apps_root + "/" + appid_str);
-                }
-            } else {
-                derror("get app list from meta state service failed, path = %s, err = %s",
-                       _apps_root.c_str(),
-                       ec.to_string());
-                err = ec;
-            }
-        },
-        &tracker);
-    tracker.wait_outstanding_tasks();
+    error_code read_err = read_apps_from_remote_storage(sync_app, sync_partition);
+    if (read_err != ERR_OK)
+        err = read_err;
+    ddebug("sync apps from remote storage done, err = %s, %d partitions (%d unchanged since the "
+           "standby snapshot), time_used = %" PRIu64 " ms",
+           err.to_string(),
+           partition_count.load(),
+           unchanged_partition_count.load(),
+           dsn_now_ms() - start_ms);
     if (err == ERR_OK) {
         return _all_apps.empty() ? ERR_OBJECT_NOT_FOUND : ERR_OK;
     }
@@ -786,8 +938,11 @@ void server_state::on_config_sync(dsn::message_ex *msg)
 
     bool reject_this_request = false;
     response.__isset.gc_replicas = false;
-    ddebug("got config sync request from %s, stored_replicas_count(%d)",
+    ddebug("got config sync request from %s, sync_version(%" PRId64 "), base_sync_version(%" PRId64
+           "), stored_replicas_count(%d)",
            request.node.to_string(),
+           request.__isset.sync_version ? request.sync_version : 0,
+           request.__isset.base_sync_version ? request.base_sync_version : 0,
            (int)request.stored_replicas.size());
 
     {
@@ -827,10 +982,27 @@ void server_state::on_config_sync(dsn::message_ex *msg)
             }
         }
 
+        // an incremental sync only carries the replicas changed since its base, which must be
+        // the last sync we've got from the node; otherwise (e.g., the node has been considered
+        // dead, or this meta server has just taken over) the node is asked for a full sync.
+        // the replicas carried are still handled, as they are up to date anyway
+        if (!reject_this_request && request.__isset.base_sync_version &&
+            (ns == nullptr || !ns->has_collected() ||
+             ns->last_config_sync_version() != request.base_sync_version)) {
+            ddebug("node(%s) sent an incremental config sync based on version %" PRId64
+                   ", which is unknown, ask for a full sync",
+                   request.node.to_string(),
+                   request.base_sync_version);
+            response.__set_need_full_sync(true);
+        }
+
         // handle the stored replicas & the gc replicas
         if (!reject_this_request && request.__isset.stored_replicas) {
-            if (ns != nullptr)
+            if (ns != nullptr && !response.__isset.need_full_sync) {
                 ns->set_replicas_collect_flag(true);
+                if (request.__isset.sync_version)
+                    ns->set_config_sync_version(request.sync_version);
+            }
             std::vector<replica_info> &replicas = request.stored_replicas;
             meta_function_level::type level = _meta_svc->get_function_level();
             // if the node serve the replica on the meta server, then we ignore it
@@ -910,6 +1082,7 @@ void server_state::on_config_sync(dsn::message_ex *msg)
     if (reject_this_request) {
         response.err = ERR_BUSY;
         response.partitions.clear();
+        response.__isset.need_full_sync = false;
     }
     ddebug("send config sync response to %s, err(%s), partitions_count(%d), gc_replicas_count(%d)",
            request.node.to_string(),
@@ -932,37 +1105,318 @@ bool server_state::query_configuration_by_gpid(dsn::gpid id,
     return false;
 }
 
-void server_state::query_configuration_by_index(
-    const configuration_query_by_index_request &request,
-    /*out*/ configuration_query_by_index_response &response)
+server_state::app_view_ptr server_state::get_app_view(const std::string &app_name) const
 {
-    zauto_read_lock l(_lock);
-    auto iter = _exist_apps.find(request.app_name.c_str());
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_app_views_lock);
+    auto iter = _app_views.find(app_name);
+    return iter == _app_views.end() ? nullptr : iter->second;
+}
+
+server_state::app_view_ptr server_state::get_app_view_unlocked(const std::string &app_name,
+                                                               /*out*/ error_code &err)
+{
+    auto iter = _exist_apps.find(app_name);
     if (iter == _exist_apps.end()) {
-        response.err = ERR_OBJECT_NOT_FOUND;
-        return;
+        err = ERR_OBJECT_NOT_FOUND;
+        return nullptr;
     }
 
     std::shared_ptr<app_state> &app = iter->second;
     if (app->status != app_status::AS_AVAILABLE) {
         dassert(app->status == app_status::AS_CREATING || app->status == app_status::AS_DROPPING,
                 "invalid status in exist app");
-        response.err =
-            (app->status == app_status::AS_CREATING ? ERR_BUSY_CREATING : ERR_BUSY_DROPPING);
+        err = (app->status == app_status::AS_CREATING ? ERR_BUSY_CREATING : ERR_BUSY_DROPPING);
+        return nullptr;
+    }
+
+    err = ERR_OK;
+    app_view_ptr view = get_app_view(app_name);
+    if (view != nullptr)
+        return view;
+
+    // concurrent readers may build the same view, which is harmless
+    std::shared_ptr<app_view> new_view = std::make_shared<app_view>();
+    new_view->app_id = app->app_id;
+    new_view->partition_count = app->partition_count;
+    new_view->is_stateful = app->is_stateful;
+    new_view->ballot_sum = 0;
+    new_view->partitions.reserve(app->partitions.size());
+    for (const partition_configuration &pc : app->partitions) {
+        new_view->partitions.emplace_back(std::make_shared<const partition_configuration>(pc));
+        new_view->ballot_sum += pc.ballot;
+    }
+
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_app_views_lock);
+    _app_views[app_name] = new_view;
+    return new_view;
+}
+
+void server_state::update_app_view(const app_state &app, int partition_index)
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_app_views_lock);
+    auto iter = _app_views.find(app.app_name);
+    if (iter == _app_views.end())
         return;
+    if (app.status != app_status::AS_AVAILABLE || iter->second->app_id != app.app_id) {
+        _app_views.erase(iter);
+        return;
+    }
+
+    std::shared_ptr<app_view> new_view = std::make_shared<app_view>(*iter->second);
+    const partition_configuration &pc = app.partitions[partition_index];
+    new_view->ballot_sum += pc.ballot - new_view->partitions[partition_index]->ballot;
+    new_view->partitions[partition_index] = std::make_shared<const partition_configuration>(pc);
+    iter->second = std::move(new_view);
+}
+
+void server_state::invalidate_app_view(const std::string &app_name)
+{
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_app_views_lock);
+        _app_views.erase(app_name);
+    }
+    force_standby_reload();
+}
+
+void server_state::erase_query_cache(const std::string &app_name)
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_query_cache_lock);
+    auto it = _query_cache.lower_bound(query_cache_key(
+        app_name, std::numeric_limits<int32_t>::min(), std::numeric_limits<int>::min()));
+    while (it != _query_cache.end() && std::get<0>(it->first) == app_name) {
+        it = _query_cache.erase(it);
+    }
+}
+
+void server_state::invalidate_all_app_views()
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_app_views_lock);
+    _app_views.clear();
+}
+
+void server_state::query_configuration_by_index(
+    const configuration_query_by_index_request &request,
+    /*out*/ configuration_query_by_index_response &response)
+{
+    app_view_ptr view = get_app_view(request.app_name);
+    if (view == nullptr) {
+        zauto_read_lock l(_lock);
+        view = get_app_view_unlocked(request.app_name, response.err);
+        if (view == nullptr)
+            return;
+    }
+    fill_query_response(*view, request, response);
+}
+
+void server_state::query_configuration_by_index_unlocked(
+    const configuration_query_by_index_request &request,
+    /*out*/ configuration_query_by_index_response &response)
+{
+    app_view_ptr view = get_app_view_unlocked(request.app_name, response.err);
+    if (view != nullptr) {
+        fill_query_response(*view, request, response);
+    }
+}
+
+void server_state::fill_query_response(const app_view &view,
+                                       const configuration_query_by_index_request &request,
+                                       /*out*/ configuration_query_by_index_response &response)
+{
+    response.err = ERR_OK;
+    response.app_id = view.app_id;
+    response.partition_count = view.partition_count;
+    response.is_stateful = view.is_stateful;
+
+    // ballots of stateless apps don't change with the configuration, so the known ballots
+    // are ignored for them
+    bool use_known_ballots = request.__isset.known_ballots && view.is_stateful;
+    if (!request.partition_indices.empty()) {
+        if (use_known_ballots && request.known_ballots.size() != request.partition_indices.size())
+            use_known_ballots = false;
+        bool valid_index = false;
+        for (size_t i = 0; i < request.partition_indices.size(); ++i) {
+            int32_t index = request.partition_indices[i];
+            if (index < 0 || index >= view.partitions.size())
+                continue;
+            valid_index = true;
+            if (use_known_ballots && request.known_ballots[i] == view.partitions[index]->ballot)
+                continue;
+            response.partitions.push_back(*view.partitions[index]);
+        }
+        if (valid_index)
+            return;
+    }
+
+    bool delta = use_known_ballots && request.known_ballots.size() == view.partitions.size();
+    if (!delta)
+        response.partitions.reserve(view.partitions.size());
+    // delta response: only the partitions changed since the client knows
+    for (size_t i = 0; i < view.partitions.size(); ++i) {
+        if (!delta || request.known_ballots[i] != view.partitions[i]->ballot)
+            response.partitions.push_back(*view.partitions[i]);
     }
+}
+
+bool server_state::get_cached_query_response(const configuration_query_by_index_request &request,
+                                             dsn_msg_serialize_format fmt,
+                                             /*out*/ blob &data)
+{
+    if (request.__isset.known_ballots || request.partition_indices.size() > 1)
+        return false;
+    if (fmt != DSF_THRIFT_BINARY && fmt != DSF_THRIFT_JSON)
+        return false;
 
+    app_view_ptr app = get_app_view(request.app_name);
+    if (app == nullptr) {
+        zauto_read_lock l(_lock);
+        error_code err;
+        app = get_app_view_unlocked(request.app_name, err);
+        if (app == nullptr)
+            return false;
+    }
+    // ballots of stateless apps don't change with the configuration
+    if (!app->is_stateful)
+        return false;
+
+    int32_t pidx = -1;
+    int64_t version = 0;
+    if (!request.partition_indices.empty()) {
+        pidx = request.partition_indices[0];
+        if (pidx < 0 || pidx >= app->partitions.size())
+            return false;
+        version = app->partitions[pidx]->ballot;
+    } else {
+        version = app->ballot_sum;
+    }
+
+    query_cache_key key(request.app_name, pidx, static_cast<int>(fmt));
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> cl(_query_cache_lock);
+        auto it = _query_cache.find(key);
+        if (it != _query_cache.end() && it->second.app_id == app->app_id &&
+            it->second.version == version) {
+            data = it->second.data;
+            _recent_query_config_cache_hit_count->increment();
+            return true;
+        }
+    }
+
+    // serialize outside the cache lock, it's ok if two requests rebuild the same entry
+    configuration_query_by_index_response response;
     response.err = ERR_OK;
     response.app_id = app->app_id;
     response.partition_count = app->partition_count;
     response.is_stateful = app->is_stateful;
+    if (pidx == -1) {
+        response.partitions.reserve(app->partitions.size());
+        for (const auto &pc : app->partitions)
+            response.partitions.push_back(*pc);
+    } else {
+        response.partitions.push_back(*app->partitions[pidx]);
+    }
+    binary_writer writer;
+    dsn::marshall(writer, response, fmt);
+    data = writer.get_buffer();
+    _recent_query_config_cache_miss_count->increment();
+
+    utils::auto_lock<utils::ex_lock_nr_spin> cl(_query_cache_lock);
+    query_cache_entry &entry = _query_cache[key];
+    entry.app_id = app->app_id;
+    entry.version = version;
+    entry.data = data;
+    return true;
+}
+
+void server_state::subscribe_configuration(dsn::message_ex *msg,
+                                           const configuration_query_by_index_request &request)
+{
+    configuration_query_by_index_response response;
+    {
+        zauto_read_lock l(_lock);
+        query_configuration_by_index_unlocked(request, response);
+        // nothing changed, hold it. it's registered with _lock held, so the change
+        // after the query above won't be missed
+        if (response.err == ERR_OK && response.partitions.empty() &&
+            request.__isset.known_ballots) {
+            zauto_lock sl(_config_subscriptions_lock);
+            const meta_options &opts = _meta_svc->get_meta_options();
+            if (_config_subscription_count < opts.max_config_subscriptions) {
+                uint64_t id = ++_next_config_subscription_id;
+                msg->add_ref();
+                _config_subscriptions[request.app_name].emplace(id,
+                                                                config_subscription{msg, request});
+                ++_config_subscription_count;
+                _held_config_subscriptions->set(_config_subscription_count);
+
+                std::string app_name = request.app_name;
+                tasking::enqueue(
+                    LPC_CONFIG_SUBSCRIPTION_REPLY,
+                    &_tracker,
+                    [this, app_name, id]() { on_config_subscription_timeout(app_name, id); },
+                    0,
+                    std::chrono::milliseconds(opts.config_subscription_wait_ms));
+                return;
+            }
+        }
+    }
+
+    auto resp = msg->create_response();
+    ::dsn::marshall(resp, response);
+    dsn_rpc_reply(resp);
+}
+
+void server_state::reply_config_subscription(dsn::message_ex *msg,
+                                             const configuration_query_by_index_request &request)
+{
+    configuration_query_by_index_response response;
+    query_configuration_by_index(request, response);
+    auto resp = msg->create_response();
+    ::dsn::marshall(resp, response);
+    dsn_rpc_reply(resp);
+    msg->release_ref();
+}
 
-    for (const int32_t &index : request.partition_indices) {
-        if (index >= 0 && index < app->partitions.size())
-            response.partitions.push_back(app->partitions[index]);
+void server_state::on_config_subscription_timeout(const std::string &app_name, uint64_t id)
+{
+    config_subscription sub;
+    {
+        zauto_lock l(_config_subscriptions_lock);
+        auto iter = _config_subscriptions.find(app_name);
+        if (iter == _config_subscriptions.end())
+            return;
+        auto it = iter->second.find(id);
+        if (it == iter->second.end())
+            return;
+        sub = std::move(it->second);
+        iter->second.erase(it);
+        if (iter->second.empty())
+            _config_subscriptions.erase(iter);
+        --_config_subscription_count;
+        _held_config_subscriptions->set(_config_subscription_count);
+    }
+    reply_config_subscription(sub.msg, sub.request);
+}
+
+void server_state::notify_config_subscriptions(const std::string &app_name)
+{
+    std::map<uint64_t, config_subscription> subs;
+    {
+        zauto_lock l(_config_subscriptions_lock);
+        auto iter = _config_subscriptions.find(app_name);
+        if (iter == _config_subscriptions.end())
+            return;
+        subs = std::move(iter->second);
+        _config_subscriptions.erase(iter);
+        _config_subscription_count -= subs.size();
+        _held_config_subscriptions->set(_config_subscription_count);
     }
-    if (response.partitions.empty())
-        response.partitions = app->partitions;
+
+    // _lock is held by the caller, so reply them in another task
+    tasking::enqueue(LPC_CONFIG_SUBSCRIPTION_REPLY, &_tracker, [ this, subs = std::move(subs) ]() {
+        for (const auto &kv : subs) {
+            reply_config_subscription(kv.second.msg, kv.second.request);
+        }
+    });
 }
 
 void server_state::init_app_partition_node(std::shared_ptr<app_state> &app,
@@ -1115,6 +1569,8 @@ void server_state::do_app_drop(std::shared_ptr<app_state> &app)
         if (ERR_OK == ec) {
             zauto_write_lock l(_lock);
             _exist_apps.erase(app->app_name);
+            invalidate_app_view(app->app_name);
+            erase_query_cache(app->app_name);
             for (int i = 0; i < app->partition_count; ++i) {
                 drop_partition(app, i);
             }
@@ -1155,6 +1611,7 @@ void server_state::drop_app(dsn::message_ex *msg)
             case app_status::AS_AVAILABLE:
                 do_dropping = true;
                 app->status = app_status::AS_DROPPING;
+                invalidate_app_view(app->app_name);
                 app->drop_second = dsn_now_ms() / 1000;
                 if (request.options.__isset.reserve_seconds &&
                     request.options.reserve_seconds > 0) {
@@ -1352,6 +1809,20 @@ void server_state::request_check(const partition_configuration &old,
                     old.secondaries.end(),
                 "");
         break;
+    case config_type::CT_HANDOVER_PRIMARY:
+        dassert(old.primary != request.node,
+                "%s VS %s",
+                old.primary.to_string(),
+                request.node.to_string());
+        dassert(std::find(old.secondaries.begin(), old.secondaries.end(), request.node) !=
+                    old.secondaries.end(),
+                "");
+        dassert(new_config.primary == request.node,
+                "%s VS %s",
+                new_config.primary.to_string(),
+                request.node.to_string());
+        dassert(new_config.secondaries.size() == old.secondaries.size(), "");
+        break;
     case config_type::CT_PRIMARY_FORCE_UPDATE_BALLOT:
         dassert(old.primary == new_config.primary,
                 "%s VS %s",
@@ -1406,6 +1877,13 @@ void server_state::update_configuration_locally(
             ns->remove_partition(gpid, true);
             break;
 
+        case config_type::CT_HANDOVER_PRIMARY:
+            ns->put_partition(gpid, true);
+            ns = get_node_state(_nodes, old_cfg.primary, false);
+            if (ns != nullptr)
+                ns->remove_partition(gpid, true);
+            break;
+
         case config_type::CT_DOWNGRADE_TO_INACTIVE:
         case config_type::CT_REMOVE:
             ns->remove_partition(gpid, false);
@@ -1465,6 +1943,8 @@ void server_state::update_configuration_locally(
     // as we sync to remote storage according to it
     std::string old_config_str = boost::lexical_cast<std::string>(old_cfg);
     old_cfg = config_request->config;
+    update_app_view(app, gpid.get_partition_index());
+    append_standby_push(old_cfg);
     auto find_name = _config_type_VALUES_TO_NAMES.find(config_request->type);
     if (find_name != _config_type_VALUES_TO_NAMES.end()) {
         ddebug("meta update config ok: type(%s), old_config=%s, %s",
@@ -1484,6 +1964,7 @@ void server_state::update_configuration_locally(
     if (_config_change_subscriber) {
         _config_change_subscriber(_all_apps);
     }
+    notify_config_subscriptions(app.app_name);
 
     _recent_update_config_count->increment();
     if (old_health_status >= HS_WRITABLE_ILL && new_health_status < HS_WRITABLE_ILL) {
@@ -1519,14 +2000,88 @@ task_ptr server_state::update_configuration_on_remote(
     std::string storage_path = get_partition_path(pc.pid);
 
     blob json_config = dsn::json::json_forwarder<partition_configuration>::encode(pc);
-    return _meta_svc->get_remote_storage()->set_data(
-        storage_path,
-        json_config,
-        LPC_META_STATE_HIGH,
-        std::bind(&server_state::on_update_configuration_on_remote_reply,
-                  this,
-                  std::placeholders::_1,
-                  config_request));
+    auto callback = std::bind(&server_state::on_update_configuration_on_remote_reply,
+                              this,
+                              std::placeholders::_1,
+                              config_request);
+    if (_meta_svc->get_meta_options().config_sync_batch_linger_ms == 0) {
+        return _meta_svc->get_remote_storage()->set_data(
+            storage_path, json_config, LPC_META_STATE_HIGH, callback);
+    }
+
+    // the partition still owns a separate task, so that it can be cancelled alone
+    error_code_future_ptr tsk(new error_code_future(LPC_META_STATE_HIGH, callback, 0));
+    append_remote_config_write(storage_path, json_config, tsk);
+    return tsk;
+}
+
+void server_state::append_remote_config_write(const std::string &path,
+                                              const blob &value,
+                                              error_code_future_ptr callback)
+{
+    const meta_options &opts = _meta_svc->get_meta_options();
+    bool flush_now = false;
+    {
+        zauto_lock l(_remote_config_writes_lock);
+        _remote_config_writes.push_back(remote_config_write{path, value, std::move(callback)});
+        if (_remote_config_writes.size() >= static_cast<size_t>(opts.config_sync_batch_max_size)) {
+            flush_now = true;
+        } else if (_remote_config_flush_task == nullptr) {
+            _remote_config_flush_task =
+                tasking::enqueue(LPC_META_STATE_HIGH,
+                                 &_tracker,
+                                 [this]() { flush_remote_config_writes(); },
+                                 0,
+                                 std::chrono::milliseconds(opts.config_sync_batch_linger_ms));
+        }
+    }
+    if (flush_now) {
+        flush_remote_config_writes();
+    }
+}
+
+void server_state::flush_remote_config_writes()
+{
+    std::vector<remote_config_write> writes;
+    {
+        zauto_lock l(_remote_config_writes_lock);
+        writes.swap(_remote_config_writes);
+        // the pending flush task is harmless if it's already started, as it will find
+        // nothing to write or the writes queued after this
+        if (_remote_config_flush_task != nullptr) {
+            _remote_config_flush_task->cancel(false);
+            _remote_config_flush_task = nullptr;
+        }
+    }
+    if (writes.empty())
+        return;
+
+    dist::meta_state_service *storage = _meta_svc->get_remote_storage();
+    if (writes.size() == 1) {
+        error_code_future_ptr callback = std::move(writes[0].callback);
+        storage->set_data(writes[0].path,
+                          writes[0].value,
+                          LPC_META_STATE_HIGH,
+                          [callback](error_code ec) { callback->enqueue_with(ec); });
+        return;
+    }
+
+    _recent_config_sync_batch_count->increment();
+    dinfo("write %d partition configs to remote storage in one transaction",
+          static_cast<int>(writes.size()));
+    auto entries = storage->new_transaction_entries(writes.size());
+    for (const remote_config_write &w : writes) {
+        error_code err = entries->set_data(w.path, w.value);
+        dassert(err == ERR_OK, "append transaction entry failed, err = %s", err.to_string());
+    }
+    // the transaction is atomic, so all the partitions share the same result, and
+    // they retry separately on timeout, which are likely batched again
+    auto shared_writes = std::make_shared<std::vector<remote_config_write>>(std::move(writes));
+    storage->submit_transaction(entries, LPC_META_STATE_HIGH, [shared_writes](error_code ec) {
+        for (remote_config_write &w : *shared_writes) {
+            w.callback->enqueue_with(ec);
+        }
+    });
 }
 
 void server_state::on_update_configuration_on_remote_reply(
@@ -1564,6 +2119,11 @@ void server_state::on_update_configuration_on_remote_reply(
             cc.msg = nullptr;
         }
 
+        // the new primary doesn't know the handover until it gets the new configuration
+        if (config_request->type == config_type::CT_HANDOVER_PRIMARY) {
+            send_proposal(config_request->node, *config_request);
+        }
+
         _meta_svc->get_balancer()->reconfig({&_all_apps, &_nodes}, *config_request);
         if (config_request->type == config_type::CT_DROP_PARTITION) {
             process_one_partition(app);
@@ -2335,6 +2895,7 @@ bool server_state::check_all_partitions()
     std::vector<gpid> add_secondary_gpids;
     std::vector<bool> add_secondary_proposed;
     std::map<rpc_address, int> add_secondary_running_nodes; // node --> running_count
+    std::map<rpc_address, int> handover_counts;             // node --> primaries handed over
     for (auto &app_pair : _exist_apps) {
         std::shared_ptr<app_state> &app = app_pair.second;
         if (app->status == app_status::AS_CREATING || app->status == app_status::AS_DROPPING) {
@@ -2349,6 +2910,11 @@ bool server_state::check_all_partitions()
             config_context &cc = app->helpers->contexts[i];
 
             if (cc.stage != config_status::pending_remote_sync) {
+                if (drain_primary(app, i, handover_counts)) {
+                    send_proposal_count++;
+                    continue;
+                }
+
                 configuration_proposal_action action;
                 pc_status s =
                     _meta_svc->get_balancer()->cure({&_all_apps, &_nodes}, pc.pid, action);
@@ -2459,6 +3025,12 @@ bool server_state::check_all_partitions()
         return false;
     }
 
+    if (!_draining_nodes.empty()) {
+        ddebug("don't do replica migration coz %d node(s) are draining",
+               (int)_draining_nodes.size());
+        return false;
+    }
+
     if (level == meta_function_level::fl_steady) {
         ddebug("check if any replica migration can be done when meta server is in level(%s)",
                _meta_function_level_VALUES_TO_NAMES.find(level)->second);
@@ -35,6 +35,7 @@
 
 #pragma once
 
+#include <set>
 #include <unordered_map>
 #include <boost/lexical_cast.hpp>
 
@@ -122,6 +123,18 @@ public:
     error_code initialize_data_structure();
     void register_cli_commands();
 
+    // standby meta server. the configurations of all the apps are loaded from remote storage
+    // periodically and then kept up to date by the pushes from the leader, so that read-only
+    // configuration queries can be served, and only the changed partitions need decoding when
+    // taking over the leadership. see server_state_standby.cpp
+    void refresh_standby_snapshot();
+    void on_standby_push(const rpc_address &leader, const meta_standby_push_request &request);
+    // returns false if the query should be forwarded to the leader
+    bool query_standby_configuration(const configuration_query_by_index_request &request,
+                                     /*out*/ configuration_query_by_index_response &response);
+    // leader meta server: push the partitions updated recently to the standby meta servers
+    void push_to_standby_meta_servers();
+
     void lock_read(zauto_read_lock &other);
     void lock_write(zauto_write_lock &other);
     const meta_view get_meta_view() { return {&_all_apps, &_nodes}; }
@@ -146,6 +159,18 @@ public:
     void query_configuration_by_index(const configuration_query_by_index_request &request,
                                       /*out*/ configuration_query_by_index_response &response);
     bool query_configuration_by_gpid(const dsn::gpid id, /*out*/ partition_configuration &config);
+    // get the pre-serialized response of a query_configuration_by_index request for the whole
+    // app or a single partition, which is shared by all the requests until the ballot changes.
+    // returns false if the request is not cacheable, then query_configuration_by_index
+    // should be used instead.
+    bool get_cached_query_response(const configuration_query_by_index_request &request,
+                                   dsn_msg_serialize_format fmt,
+                                   /*out*/ blob &data);
+    // long-poll of the configuration of an app: reply right now if any partition differs
+    // from request.known_ballots, otherwise hold the request until some partition of the
+    // app changes or config_subscription_wait_ms elapses
+    void subscribe_configuration(dsn::message_ex *msg,
+                                 const configuration_query_by_index_request &request);
 
     // app options
     void create_app(dsn::message_ex *msg);
@@ -180,6 +205,11 @@ public:
 
     // return true if no need to do any actions
     bool check_all_partitions();
+
+    // drain mode: the primaries on a draining node are handed over to the secondaries one
+    // by one, and the balancer stops moving replicas until all the nodes leave the mode
+    void set_node_draining(const rpc_address &node, bool draining);
+    void drain_primaries();
     void get_cluster_balance_score(double &primary_stddev /*out*/, double &total_stddev /*out*/);
     void clear_proposals();
 
@@ -199,9 +229,26 @@ private:
     // user should lock it first
     void update_partition_perf_counter();
 
+    // propose a handover if the primary of the partition is draining,
+    // return true if a proposal is sent. user should lock it first
+    bool drain_primary(const std::shared_ptr<app_state> &app,
+                       int pidx,
+                       std::map<rpc_address, int> &handover_counts);
+    std::string query_draining_nodes();
+
     error_code dump_app_states(const char *local_path,
                                const std::function<app_state *()> &iterator);
     error_code sync_apps_from_remote_storage();
+    // read the app nodes under _apps_root and the partition nodes of each app, with at most
+    // remote_storage_read_concurrency reads outstanding. on_app returns the partition count
+    // of the app, the partitions of which are then read by on_partition
+    typedef std::function<int(error_code ec, const std::string &app_path, const blob &value)>
+        app_node_callback;
+    typedef std::function<void(
+        error_code ec, const std::string &app_path, int partition_index, const blob &value)>
+        partition_node_callback;
+    error_code read_apps_from_remote_storage(const app_node_callback &on_app,
+                                             const partition_node_callback &on_partition);
     // sync local state to remote storage,
     // if return OK, all states are synced correctly, and all apps are in stable state
     // else indicate error that remote storage responses
@@ -297,6 +344,70 @@ private:
     void process_one_partition(std::shared_ptr<app_state> &app);
     void transition_staging_state(std::shared_ptr<app_state> &app);
 
+    // read-only view of an available app, with which the client queries are served
+    // without _lock. the views are built by the queries with _lock read-held, then kept
+    // up to date by the writers with _lock write-held: a partition change replaces the
+    // view with a copy (only the pointers of the partitions are copied), and any other
+    // change of the app invalidates the view.
+    struct app_view
+    {
+        int32_t app_id;
+        int32_t partition_count;
+        bool is_stateful;
+        int64_t ballot_sum;
+        std::vector<std::shared_ptr<const partition_configuration>> partitions;
+    };
+    typedef std::shared_ptr<const app_view> app_view_ptr;
+
+    app_view_ptr get_app_view(const std::string &app_name) const;
+    // get the view or build it if not exist, should be called with _lock held
+    app_view_ptr get_app_view_unlocked(const std::string &app_name, /*out*/ error_code &err);
+    // should be called with _lock write-held
+    void update_app_view(const app_state &app, int partition_index);
+    void invalidate_app_view(const std::string &app_name);
+    // free the cached query responses of a dropped app
+    void erase_query_cache(const std::string &app_name);
+    void invalidate_all_app_views();
+    static void fill_query_response(const app_view &view,
+                                    const configuration_query_by_index_request &request,
+                                    /*out*/ configuration_query_by_index_response &response);
+
+    // should be called with _lock held
+    void query_configuration_by_index_unlocked(
+        const configuration_query_by_index_request &request,
+        /*out*/ configuration_query_by_index_response &response);
+    void reply_config_subscription(dsn::message_ex *msg,
+                                   const configuration_query_by_index_request &request);
+    void on_config_subscription_timeout(const std::string &app_name, uint64_t id);
+    // called when the configuration of an app changes, should be called with _lock held
+    void notify_config_subscriptions(const std::string &app_name);
+
+    // queue a partition config write, which is flushed with others in one transaction
+    // after config_sync_batch_linger_ms, or once config_sync_batch_max_size are queued
+    void append_remote_config_write(const std::string &path,
+                                    const blob &value,
+                                    error_code_future_ptr callback);
+    void flush_remote_config_writes();
+
+    struct standby_app
+    {
+        app_info info;
+        // data of the partition nodes on remote storage
+        std::vector<blob> partition_data;
+        app_view_ptr view;
+    };
+    typedef std::map<int32_t, std::shared_ptr<standby_app>> standby_app_map;
+    // called when taking over the leadership, the standby state is no longer maintained
+    standby_app_map take_standby_snapshot();
+    // returns false if the app or the partition of pc is unknown
+    bool apply_standby_push(standby_app_map &apps,
+                            std::unordered_map<std::string, int32_t> &app_ids,
+                            const partition_configuration &pc);
+    // queue a partition updated on the leader for pushing, should be called with _lock held
+    void append_standby_push(const partition_configuration &pc);
+    // app level changes aren't pushed, the standby meta servers are made to reload instead
+    void force_standby_reload();
+
 private:
     friend class replication_checker;
     friend class test::test_checker;
@@ -318,6 +429,68 @@ private:
     // for load balancer
     migration_list _temporary_list;
 
+    // standby state, protected by _standby_lock. pushes from the leader are numbered
+    // continuously, the apps may miss some updates if a push is lost during or after the
+    // last refresh, and queries are not served until they are reloaded
+    zlock _standby_lock;
+    bool _standby_snapshot_used;
+    standby_app_map _standby_apps;
+    std::unordered_map<std::string, int32_t> _standby_app_ids;
+    bool _standby_refreshing;
+    bool _standby_consistent;
+    bool _standby_push_lost_in_refresh;
+    // pushes received during the refresh, replayed on the loaded apps
+    std::vector<meta_standby_push_request> _standby_pushes_in_refresh;
+    size_t _standby_pushes_in_refresh_count;
+    rpc_address _standby_leader;
+    int64_t _standby_push_sequence;
+    uint64_t _standby_last_push_ms;
+
+    // leader: partitions updated since the last push to standby meta servers
+    utils::ex_lock_nr_spin _pending_standby_push_lock;
+    std::vector<partition_configuration> _pending_standby_push;
+    int64_t _last_standby_push_sequence;
+
+    // available apps: name -> view
+    mutable utils::ex_lock_nr_spin _app_views_lock;
+    std::unordered_map<std::string, app_view_ptr> _app_views;
+
+    // cache for get_cached_query_response, key is <app_name, partition_index, format>,
+    // partition_index is -1 for the whole app
+    struct query_cache_entry
+    {
+        int32_t app_id;
+        // ballot of the partition, or sum of ballots of the app. ballots never decrease,
+        // so any change of the configuration changes the version
+        int64_t version;
+        blob data;
+    };
+    typedef std::tuple<std::string, int32_t, int> query_cache_key;
+    utils::ex_lock_nr_spin _query_cache_lock;
+    std::map<query_cache_key, query_cache_entry> _query_cache;
+
+    // held configuration subscriptions: app_name -> <id, request>
+    struct config_subscription
+    {
+        dsn::message_ex *msg;
+        configuration_query_by_index_request request;
+    };
+    zlock _config_subscriptions_lock;
+    uint64_t _next_config_subscription_id;
+    int32_t _config_subscription_count;
+    std::map<std::string, std::map<uint64_t, config_subscription>> _config_subscriptions;
+
+    // partition config writes waiting to be flushed to remote storage
+    struct remote_config_write
+    {
+        std::string path;
+        blob value;
+        error_code_future_ptr callback;
+    };
+    zlock _remote_config_writes_lock;
+    std::vector<remote_config_write> _remote_config_writes;
+    task_ptr _remote_config_flush_task;
+
     // for test
     config_change_subscriber _config_change_subscriber;
     replica_migration_subscriber _replica_migration_subscriber;
@@ -327,6 +500,10 @@ private:
     dsn_handle_t _cli_dump_handle;
     dsn_handle_t _ctrl_add_secondary_enable_flow_control;
     dsn_handle_t _ctrl_add_secondary_max_count_for_one_node;
+    dsn_handle_t _ctrl_drain_node;
+
+    // protected by _lock
+    std::set<rpc_address> _draining_nodes;
 
     perf_counter_wrapper _dead_partition_count;
     perf_counter_wrapper _unreadable_partition_count;
@@ -336,6 +513,10 @@ private:
     perf_counter_wrapper _recent_update_config_count;
     perf_counter_wrapper _recent_partition_change_unwritable_count;
     perf_counter_wrapper _recent_partition_change_writable_count;
+    perf_counter_wrapper _recent_query_config_cache_hit_count;
+    perf_counter_wrapper _recent_query_config_cache_miss_count;
+    perf_counter_wrapper _held_config_subscriptions;
+    perf_counter_wrapper _recent_config_sync_batch_count;
 };
 }
 }
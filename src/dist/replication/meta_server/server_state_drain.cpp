@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     drain mode of replica servers, in which the primaries are handed over to the
+ *     secondaries before a planned restart
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include <sstream>
+
+#include "dist/replication/meta_server/meta_service.h"
+#include "dist/replication/meta_server/server_state.h"
+
+namespace dsn {
+namespace replication {
+
+void server_state::set_node_draining(const rpc_address &node, bool draining)
+{
+    {
+        zauto_write_lock l(_lock);
+        if (draining) {
+            _draining_nodes.insert(node);
+        } else {
+            _draining_nodes.erase(node);
+        }
+        ddebug("node(%s) %s drain mode, %d node(s) are draining",
+               node.to_string(),
+               draining ? "enters" : "leaves",
+               (int)_draining_nodes.size());
+    }
+
+    // don't wait for the next round of check_all_partitions
+    if (draining) {
+        tasking::enqueue(LPC_META_STATE_NORMAL,
+                         &_tracker,
+                         std::bind(&server_state::drain_primaries, this),
+                         server_state::sStateHash);
+    }
+}
+
+void server_state::drain_primaries()
+{
+    if (_meta_svc->get_function_level() <= meta_function_level::fl_freezed)
+        return;
+
+    zauto_write_lock l(_lock);
+    if (_draining_nodes.empty())
+        return;
+
+    std::map<rpc_address, int> handover_counts;
+    int proposal_count = 0;
+    for (auto &app_pair : _exist_apps) {
+        std::shared_ptr<app_state> &app = app_pair.second;
+        if (app->status != app_status::AS_AVAILABLE)
+            continue;
+        for (int i = 0; i < app->partition_count; ++i) {
+            if (app->helpers->contexts[i].stage != config_status::pending_remote_sync &&
+                drain_primary(app, i, handover_counts))
+                ++proposal_count;
+        }
+    }
+    ddebug("drain primaries done, send_proposal_count = %d", proposal_count);
+}
+
+bool server_state::drain_primary(const std::shared_ptr<app_state> &app,
+                                 int pidx,
+                                 std::map<rpc_address, int> &handover_counts)
+{
+    if (_draining_nodes.empty() || !app->is_stateful)
+        return false;
+
+    const partition_configuration &pc = app->partitions[pidx];
+    config_context &cc = app->helpers->contexts[pidx];
+    // the pending proposals, including an earlier handover, are resent by cure
+    if (pc.primary.is_invalid() || _draining_nodes.count(pc.primary) == 0 ||
+        !cc.lb_actions.empty())
+        return false;
+
+    // the alive secondary with the fewest primaries takes over
+    rpc_address new_primary;
+    int min_primaries = 0;
+    for (const rpc_address &secondary : pc.secondaries) {
+        if (_draining_nodes.count(secondary) != 0)
+            continue;
+        node_state *ns = get_node_state(_nodes, secondary, false);
+        if (ns == nullptr || !ns->alive())
+            continue;
+        int primaries = (int)ns->primary_count() + handover_counts[secondary];
+        if (new_primary.is_invalid() || primaries < min_primaries) {
+            new_primary = secondary;
+            min_primaries = primaries;
+        }
+    }
+    if (new_primary.is_invalid()) {
+        dwarn("can't drain the primary of gpid(%d.%d) from node(%s), no secondary can take over",
+              pc.pid.get_app_id(),
+              pc.pid.get_partition_index(),
+              pc.primary.to_string());
+        return false;
+    }
+
+    configuration_proposal_action action;
+    action.type = config_type::CT_HANDOVER_PRIMARY;
+    action.target = pc.primary;
+    action.node = new_primary;
+    cc.lb_actions.assign_balancer_proposals({action});
+    ++handover_counts[new_primary];
+    send_proposal(action, pc, *app);
+    return true;
+}
+
+std::string server_state::query_draining_nodes()
+{
+    zauto_read_lock l(_lock);
+    if (_draining_nodes.empty())
+        return "no draining node";
+
+    std::stringstream ss;
+    for (const rpc_address &node : _draining_nodes) {
+        const node_state *ns = get_node_state(_nodes, node, false);
+        ss << node.to_string() << ": "
+           << (ns == nullptr ? std::string("not found")
+                             : std::to_string(ns->primary_count()) + " primaries left")
+           << std::endl;
+    }
+    return ss.str();
+}
+}
+}
@@ -0,0 +1,351 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     state of a standby meta server, and the pushes from the leader which keep it up to date
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <dsn/cpp/json_helper.h>
+#include <dsn/tool-api/async_calls.h>
+
+#include "dist/replication/meta_server/meta_service.h"
+#include "dist/replication/meta_server/server_state.h"
+
+namespace dsn {
+namespace replication {
+
+// at most this many partitions are queued between two pushes, the standby meta servers
+// are made to reload if there are more
+static const size_t MAX_PENDING_STANDBY_PUSH = 10000;
+
+void server_state::refresh_standby_snapshot()
+{
+    {
+        zauto_lock l(_standby_lock);
+        if (_standby_snapshot_used || _standby_refreshing)
+            return;
+        _standby_refreshing = true;
+        _standby_push_lost_in_refresh = false;
+        _standby_pushes_in_refresh.clear();
+        _standby_pushes_in_refresh_count = 0;
+    }
+
+    // the views are immutable once published, so they are built aside
+    struct loading_app
+    {
+        std::shared_ptr<standby_app> app;
+        std::shared_ptr<app_view> view;
+    };
+    uint64_t start_ms = dsn_now_ms();
+    std::unordered_map<std::string, loading_app> path_apps;
+    zlock apps_lock;
+    std::atomic<bool> ok(true);
+
+    error_code err = read_apps_from_remote_storage(
+        [&](error_code ec, const std::string &app_path, const blob &value) {
+            app_info info;
+            if (ec != ERR_OK || !dsn::json::json_forwarder<app_info>::decode(value, info)) {
+                ok = false;
+                return 0;
+            }
+            loading_app loading;
+            loading.app = std::make_shared<standby_app>();
+            loading.app->info = info;
+            loading.app->partition_data.resize(info.partition_count);
+            loading.view = std::make_shared<app_view>();
+            loading.view->app_id = info.app_id;
+            loading.view->partition_count = info.partition_count;
+            loading.view->is_stateful = info.is_stateful;
+            loading.view->ballot_sum = 0;
+            loading.view->partitions.resize(info.partition_count);
+
+            zauto_lock l(apps_lock);
+            path_apps.emplace(app_path, std::move(loading));
+            return info.partition_count;
+        },
+        [&](error_code ec, const std::string &app_path, int partition_index, const blob &value) {
+            partition_configuration pc;
+            if (ec != ERR_OK ||
+                !dsn::json::json_forwarder<partition_configuration>::decode(value, pc)) {
+                ok = false;
+                return;
+            }
+            zauto_lock l(apps_lock);
+            loading_app &loading = path_apps[app_path];
+            loading.app->partition_data[partition_index] = value;
+            loading.view->ballot_sum += pc.ballot;
+            loading.view->partitions[partition_index] =
+                std::make_shared<const partition_configuration>(std::move(pc));
+        });
+    if (err == ERR_OBJECT_NOT_FOUND) {
+        ok = true;
+    } else if (err != ERR_OK) {
+        ok = false;
+    }
+
+    bool reload = false;
+    {
+        zauto_lock l(_standby_lock);
+        _standby_refreshing = false;
+        std::vector<meta_standby_push_request> pushes;
+        pushes.swap(_standby_pushes_in_refresh);
+        _standby_pushes_in_refresh_count = 0;
+        if (_standby_snapshot_used)
+            return;
+        if (!ok) {
+            dwarn("refresh standby snapshot failed, err = %s, keep the previous one",
+                  err.to_string());
+            return;
+        }
+
+        standby_app_map apps;
+        std::unordered_map<std::string, int32_t> app_ids;
+        for (auto &kv : path_apps) {
+            loading_app &loading = kv.second;
+            standby_app &app = *loading.app;
+            app_view &view = *loading.view;
+
+            bool dropped = false;
+            for (const auto &pc : view.partitions) {
+                if ((pc->partition_flags & pc_flags::dropped) != 0)
+                    dropped = true;
+            }
+            if (app.info.status == app_status::AS_AVAILABLE && !dropped)
+                app_ids[app.info.app_name] = app.info.app_id;
+
+            app.view = loading.view;
+            apps.emplace(app.info.app_id, loading.app);
+        }
+
+        // the pushes received during the refresh may be newer than what have been loaded,
+        // they are replayed in the order of the leader. a push of an app which isn't
+        // loaded means the app is created after it is read
+        bool consistent = !_standby_push_lost_in_refresh;
+        std::stable_sort(
+            pushes.begin(),
+            pushes.end(),
+            [](const meta_standby_push_request &r1, const meta_standby_push_request &r2) {
+                return r1.sequence < r2.sequence;
+            });
+        for (const meta_standby_push_request &push : pushes) {
+            for (const partition_configuration &pc : push.partitions) {
+                if (!apply_standby_push(apps, app_ids, pc))
+                    consistent = false;
+            }
+        }
+
+        _standby_apps = std::move(apps);
+        _standby_app_ids = std::move(app_ids);
+        _standby_consistent = consistent;
+        reload = !consistent;
+
+        ddebug("standby snapshot refreshed, %d apps, consistent = %s, time_used = %" PRIu64
+               " ms",
+               (int)_standby_apps.size(),
+               _standby_consistent ? "true" : "false",
+               dsn_now_ms() - start_ms);
+    }
+
+    if (reload) {
+        tasking::enqueue(LPC_META_STANDBY_SNAPSHOT,
+                         &_tracker,
+                         std::bind(&server_state::refresh_standby_snapshot, this));
+    }
+}
+
+void server_state::on_standby_push(const rpc_address &leader,
+                                   const meta_standby_push_request &request)
+{
+    bool reload = false;
+    {
+        zauto_lock l(_standby_lock);
+        if (_standby_snapshot_used)
+            return;
+
+        if (leader != _standby_leader || request.sequence > _standby_push_sequence + 1) {
+            ddebug("standby push from %s is not continuous, sequence = %" PRId64
+                   ", last push = %s:%" PRId64 ", reload the standby snapshot",
+                   leader.to_string(),
+                   request.sequence,
+                   _standby_leader.to_string(),
+                   _standby_push_sequence);
+            _standby_consistent = false;
+            if (_standby_refreshing)
+                _standby_push_lost_in_refresh = true;
+            reload = true;
+            _standby_leader = leader;
+            _standby_push_sequence = request.sequence;
+        } else if (request.sequence > _standby_push_sequence) {
+            _standby_push_sequence = request.sequence;
+        }
+        _standby_last_push_ms = dsn_now_ms();
+
+        // the refreshing snapshot is read concurrently, so the pushes are kept to be
+        // replayed on it
+        if (_standby_refreshing && !request.partitions.empty()) {
+            _standby_pushes_in_refresh_count += request.partitions.size();
+            if (_standby_pushes_in_refresh_count > MAX_PENDING_STANDBY_PUSH) {
+                _standby_pushes_in_refresh.clear();
+                _standby_push_lost_in_refresh = true;
+            } else if (!_standby_push_lost_in_refresh) {
+                _standby_pushes_in_refresh.push_back(request);
+            }
+        }
+
+        bool unknown = false;
+        for (const partition_configuration &pc : request.partitions) {
+            if (!apply_standby_push(_standby_apps, _standby_app_ids, pc))
+                unknown = true;
+        }
+        if (unknown) {
+            ddebug("standby push from %s contains unknown apps, sequence = %" PRId64
+                   ", reload the standby snapshot",
+                   leader.to_string(),
+                   request.sequence);
+            _standby_consistent = false;
+            if (!_standby_refreshing)
+                reload = true;
+        }
+    }
+
+    if (reload) {
+        tasking::enqueue(LPC_META_STANDBY_SNAPSHOT,
+                         &_tracker,
+                         std::bind(&server_state::refresh_standby_snapshot, this));
+    }
+}
+
+bool server_state::apply_standby_push(standby_app_map &apps,
+                                      std::unordered_map<std::string, int32_t> &app_ids,
+                                      const partition_configuration &pc)
+{
+    auto iter = apps.find(pc.pid.get_app_id());
+    if (iter == apps.end())
+        return false;
+    standby_app &app = *iter->second;
+    int index = pc.pid.get_partition_index();
+    if (index < 0 || index >= app.view->partition_count)
+        return false;
+    // pushes may be handled out of order
+    const partition_configuration &old_pc = *app.view->partitions[index];
+    if (app.info.is_stateful && pc.ballot <= old_pc.ballot)
+        return true;
+
+    std::shared_ptr<app_view> new_view = std::make_shared<app_view>(*app.view);
+    new_view->ballot_sum += pc.ballot - old_pc.ballot;
+    new_view->partitions[index] = std::make_shared<const partition_configuration>(pc);
+    app.view = new_view;
+    app.partition_data[index] = dsn::json::json_forwarder<partition_configuration>::encode(pc);
+    if ((pc.partition_flags & pc_flags::dropped) != 0)
+        app_ids.erase(app.info.app_name);
+    return true;
+}
+
+bool server_state::query_standby_configuration(
+    const configuration_query_by_index_request &request,
+    /*out*/ configuration_query_by_index_response &response)
+{
+    const meta_options &opts = _meta_svc->get_meta_options();
+    if (opts.standby_push_interval_ms == 0)
+        return false;
+
+    app_view_ptr view;
+    {
+        zauto_lock l(_standby_lock);
+        if (_standby_snapshot_used || !_standby_consistent ||
+            dsn_now_ms() > _standby_last_push_ms + opts.standby_query_max_staleness_ms)
+            return false;
+        auto iter = _standby_app_ids.find(request.app_name);
+        if (iter == _standby_app_ids.end())
+            return false;
+        view = _standby_apps[iter->second]->view;
+    }
+    fill_query_response(*view, request, response);
+    return true;
+}
+
+server_state::standby_app_map server_state::take_standby_snapshot()
+{
+    zauto_lock l(_standby_lock);
+    _standby_snapshot_used = true;
+    _standby_consistent = false;
+    _standby_app_ids.clear();
+    standby_app_map apps = std::move(_standby_apps);
+    _standby_apps.clear();
+    return apps;
+}
+
+void server_state::append_standby_push(const partition_configuration &pc)
+{
+    if (_meta_svc->get_meta_options().standby_push_interval_ms == 0 ||
+        _meta_svc->get_options().meta_servers.size() <= 1)
+        return;
+
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_pending_standby_push_lock);
+    if (_pending_standby_push.size() >= MAX_PENDING_STANDBY_PUSH) {
+        // skipping a sequence makes the standby meta servers reload
+        _pending_standby_push.clear();
+        ++_last_standby_push_sequence;
+    }
+    _pending_standby_push.push_back(pc);
+}
+
+void server_state::force_standby_reload()
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_pending_standby_push_lock);
+    _pending_standby_push.clear();
+    ++_last_standby_push_sequence;
+}
+
+void server_state::push_to_standby_meta_servers()
+{
+    // the push is sent even if nothing changes, so the standby meta servers know they are
+    // up to date
+    meta_standby_push_request request;
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_pending_standby_push_lock);
+        request.partitions.swap(_pending_standby_push);
+        request.sequence = ++_last_standby_push_sequence;
+    }
+
+    for (const rpc_address &addr : _meta_svc->get_options().meta_servers) {
+        if (addr == dsn_primary_address())
+            continue;
+        dsn::message_ex *msg = dsn::message_ex::create_request(RPC_CM_STANDBY_PUSH);
+        ::dsn::marshall(msg, request);
+        _meta_svc->send_message(addr, msg);
+    }
+}
+}
+}
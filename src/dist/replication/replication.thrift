@@ -190,7 +190,8 @@ enum config_type
     CT_REMOVE,
     CT_ADD_SECONDARY_FOR_LB,
     CT_PRIMARY_FORCE_UPDATE_BALLOT,
-    CT_DROP_PARTITION
+    CT_DROP_PARTITION,
+    CT_HANDOVER_PRIMARY // target: the current primary, node: the secondary to take over
 }
 
 enum node_status
@@ -242,6 +243,11 @@ struct configuration_query_by_node_request
     1:dsn.rpc_address  node;
     2:optional list<replica_info> stored_replicas;
     3:optional replica_server_info info;
+    // version of the stored_replicas, increased on every sync
+    4:optional i64 sync_version;
+    // set if stored_replicas only contains the replicas changed since base_sync_version,
+    // which is the last version acknowledged by meta server
+    5:optional i64 base_sync_version;
 }
 
 struct configuration_query_by_node_response
@@ -249,6 +255,16 @@ struct configuration_query_by_node_response
     1:dsn.error_code err;
     2:list<configuration_update_request> partitions;
     3:optional list<replica_info> gc_replicas;
+    // meta server doesn't have the base of an incremental sync, e.g. after failover
+    4:optional bool need_full_sync;
+}
+
+// leader meta server => standby meta servers, the partition configurations updated since
+// the last push. sequence is increased by one for each push, a gap means lost updates
+struct meta_standby_push_request
+{
+    1:i64 sequence;
+    2:list<dsn.layer2.partition_configuration> partitions;
 }
 
 struct create_app_options
@@ -418,6 +434,12 @@ struct replica_info
     6:i64                    last_durable_decree;
     7:string                 app_type;
     8:string                 disk_tag;
+    // load of this replica since the last config sync, only reported by
+    // replica servers which support load-aware balancing
+    9:optional i64           read_qps;
+    10:optional i64          write_qps;
+    11:optional i64          read_bytes_per_second;
+    12:optional i64          write_bytes_per_second;
 }
 
 struct query_replica_info_request
@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <gtest/gtest.h>
 
 #include "dist/replication/meta_server/meta_data.h"
@@ -115,6 +117,7 @@ void generate_balanced_apps(/*out*/ app_mapper &apps,
             part_min = kv.second.partition_count();
     }
 
+    generate_app_serving_replica_info(the_app, 1);
     apps.emplace(the_app->app_id, the_app);
 
     ASSERT_TRUE(pri_max - pri_min <= 1);
@@ -123,15 +126,16 @@ void generate_balanced_apps(/*out*/ app_mapper &apps,
 
 void random_move_primary(app_mapper &apps, node_mapper &nodes, int primary_move_ratio)
 {
-    app_state &the_app = *(apps[0]);
-    int space_size = the_app.partition_count * 100;
-    for (dsn::partition_configuration &pc : the_app.partitions) {
-        int n = random32(1, space_size) / 100;
-        if (n < primary_move_ratio) {
-            int indice = random32(0, 1);
-            nodes[pc.primary].remove_partition(pc.pid, true);
-            std::swap(pc.primary, pc.secondaries[indice]);
-            nodes[pc.primary].put_partition(pc.pid, true);
+    for (auto &kv : apps) {
+        app_state &the_app = *(kv.second);
+        for (dsn::partition_configuration &pc : the_app.partitions) {
+            int n = random32(1, 100);
+            if (n <= primary_move_ratio) {
+                int indice = random32(0, 1);
+                nodes[pc.primary].remove_partition(pc.pid, true);
+                std::swap(pc.primary, pc.secondaries[indice]);
+                nodes[pc.primary].put_partition(pc.pid, true);
+            }
         }
     }
 }
@@ -161,14 +165,73 @@ void greedy_balancer_perfect_move_primary()
                 ASSERT_TRUE(act.type != config_type::CT_ADD_SECONDARY_FOR_LB);
             }
         }
+        migration_check_and_apply(apps, nodes, ml, nullptr);
         glb.check({&apps, &nodes}, ml);
         dinfo("round %d: balance checker operation count = %d", ++i, ml.size());
     }
 }
 
+// benchmark of the balancer on a large cluster: every round of balance() is timed, and
+// the decisions are applied until the cluster is balanced or max_rounds is reached
+void greedy_balancer_benchmark(int node_count, int app_count)
+{
+    const int disks_per_node = 4;
+
+    app_mapper apps;
+    node_mapper nodes;
+    nodes_fs_manager manager;
+    std::vector<dsn::rpc_address> node_list;
+
+    generate_node_list(node_list, node_count, node_count);
+    generate_apps(apps,
+                  node_list,
+                  app_count,
+                  disks_per_node,
+                  std::pair<uint32_t, uint32_t>(8, node_count / 2),
+                  true);
+    generate_node_mapper(nodes, apps, node_list);
+    generate_node_fs_manager(apps, nodes, manager, disks_per_node);
+
+    int total_partitions = 0;
+    for (const auto &kv : apps)
+        total_partitions += kv.second->partition_count;
+    std::cout << "benchmark: " << node_count << " nodes, " << app_count << " apps, "
+              << total_partitions << " partitions" << std::endl;
+
+    greedy_load_balancer glb(nullptr);
+    migration_list ml;
+
+    typedef std::chrono::steady_clock clock;
+    clock::duration total_time(0), max_time(0);
+    int round = 0, total_moves = 0;
+    const int max_rounds = 1000;
+    for (; round < max_rounds; ++round) {
+        clock::time_point start = clock::now();
+        bool has_decision = glb.balance({&apps, &nodes}, ml);
+        clock::duration elapsed = clock::now() - start;
+
+        total_time += elapsed;
+        max_time = std::max(max_time, elapsed);
+        if (!has_decision)
+            break;
+
+        total_moves += ml.size();
+        migration_check_and_apply(apps, nodes, ml, &manager);
+    }
+
+    auto to_ms = [](clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    std::cout << "benchmark: " << round << " rounds, " << total_moves << " decisions, "
+              << "total " << to_ms(total_time) << " ms, "
+              << "avg " << to_ms(total_time) / (round + 1) << " ms/round, "
+              << "max " << to_ms(max_time) << " ms/round" << std::endl;
+}
+
 int main(int, char **)
 {
     dsn_run_config("config.ini", false);
     greedy_balancer_perfect_move_primary();
+    greedy_balancer_benchmark(500, 2000);
     return 0;
 }
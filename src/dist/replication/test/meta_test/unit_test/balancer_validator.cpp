@@ -10,6 +10,7 @@
 #include "dist/replication/meta_server/meta_data.h"
 #include "dist/replication/meta_server/server_load_balancer.h"
 #include "dist/replication/meta_server/greedy_load_balancer.h"
+#include "dist/replication/meta_server/min_cost_max_flow.h"
 
 #include "dist/replication/test/meta_test/misc/misc.h"
 
@@ -261,6 +262,203 @@ void meta_service_test_app::balancer_validator()
     }
 }
 
+void meta_service_test_app::min_cost_max_flow_test()
+{
+    // 0 -> 1 -> 3 and 0 -> 2 -> 3 with capacity 2, and a cheaper but narrower 0 -> 3
+    {
+        min_cost_max_flow network(4);
+        int e01 = network.add_edge(0, 1, 2, 1);
+        int e13 = network.add_edge(1, 3, 2, 1);
+        int e02 = network.add_edge(0, 2, 2, 2);
+        int e23 = network.add_edge(2, 3, 2, 2);
+        int e03 = network.add_edge(0, 3, 1, 0);
+
+        int64_t cost = 0;
+        ASSERT_EQ(5, network.solve(0, 3, cost));
+        ASSERT_EQ(0 + 2 * 2 + 2 * 4, cost);
+        ASSERT_EQ(2, network.flow(e01));
+        ASSERT_EQ(2, network.flow(e13));
+        ASSERT_EQ(2, network.flow(e02));
+        ASSERT_EQ(2, network.flow(e23));
+        ASSERT_EQ(1, network.flow(e03));
+    }
+
+    // the first cheapest path 0 -> 1 -> 2 -> 3 must be partially cancelled through the
+    // reverse edge 2 -> 1 to reach the max flow with the min cost
+    {
+        min_cost_max_flow network(4);
+        int e01 = network.add_edge(0, 1, 1, 1);
+        int e02 = network.add_edge(0, 2, 1, 5);
+        int e12 = network.add_edge(1, 2, 1, 1);
+        int e13 = network.add_edge(1, 3, 1, 5);
+        int e23 = network.add_edge(2, 3, 1, 1);
+
+        int64_t cost = 0;
+        ASSERT_EQ(2, network.solve(0, 3, cost));
+        ASSERT_EQ(12, cost);
+        ASSERT_EQ(1, network.flow(e01));
+        ASSERT_EQ(1, network.flow(e02));
+        ASSERT_EQ(0, network.flow(e12));
+        ASSERT_EQ(1, network.flow(e13));
+        ASSERT_EQ(1, network.flow(e23));
+    }
+
+    // no path
+    {
+        min_cost_max_flow network(3);
+        int e01 = network.add_edge(0, 1, 3, 1);
+        int64_t cost = 0;
+        ASSERT_EQ(0, network.solve(0, 2, cost));
+        ASSERT_EQ(0, cost);
+        ASSERT_EQ(0, network.flow(e01));
+    }
+}
+
+// node A holds too many primaries and C too few, but no partition on A has a replica on C,
+// so each unit of flow passes through B or D, and moves one primary from A and another
+// one to C: A -> p -> B -> q -> C
+void meta_service_test_app::move_primary_chain_test()
+{
+    std::vector<dsn::rpc_address> node_list;
+    generate_node_list(node_list, 4, 4);
+    const dsn::rpc_address &a = node_list[0], &b = node_list[1], &c = node_list[2],
+                           &d = node_list[3];
+
+    dsn::app_info info;
+    info.status = dsn::app_status::AS_AVAILABLE;
+    info.app_id = 1;
+    info.is_stateful = true;
+    info.app_name = "test_app1";
+    info.app_type = "test";
+    info.max_replica_count = 3;
+    info.partition_count = 8;
+    std::shared_ptr<app_state> the_app = app_state::create(info);
+    for (int i = 0; i < info.partition_count; ++i) {
+        dsn::partition_configuration &pc = the_app->partitions[i];
+        pc.ballot = 1;
+        if (i < 4) {
+            pc.primary = a;
+            pc.secondaries = {b, d};
+        } else if (i < 6) {
+            pc.primary = b;
+            pc.secondaries = {c, d};
+        } else {
+            pc.primary = d;
+            pc.secondaries = {a, b};
+        }
+    }
+    int disk_on_node = 2;
+    generate_app_serving_replica_info(the_app, disk_on_node);
+
+    app_mapper apps;
+    apps.emplace(the_app->app_id, the_app);
+    node_mapper nodes;
+    generate_node_mapper(nodes, apps, node_list);
+    nodes_fs_manager manager;
+    generate_node_fs_manager(apps, nodes, manager, disk_on_node);
+
+    meta_service svc;
+    greedy_load_balancer glb(&svc);
+    migration_list ml;
+    ASSERT_TRUE(glb.balance({&apps, &nodes}, ml));
+    // 2 units of flow, with 2 moves for each
+    ASSERT_EQ(4, ml.size());
+    for (const auto &kv : ml) {
+        ASSERT_EQ(balancer_request_type::move_primary, kv.second->balance_type);
+    }
+
+    migration_check_and_apply(apps, nodes, ml, &manager);
+    for (const auto &kv : nodes) {
+        ASSERT_EQ(2, kv.second.primary_count(the_app->app_id));
+    }
+}
+
+// the load of partitions are set on all of their serving replicas in the test
+static int64_t max_primary_load(const app_mapper &apps, const node_mapper &nodes)
+{
+    int64_t result = 0;
+    for (const auto &kv : nodes) {
+        int64_t load = 0;
+        for (const auto &app_kv : apps) {
+            const std::shared_ptr<app_state> &app = app_kv.second;
+            kv.second.for_each_primary(app->app_id, [&](const dsn::gpid &pid) {
+                const config_context &cc = app->helpers->contexts[pid.get_partition_index()];
+                load += cc.serving.front().read_qps;
+                return true;
+            });
+        }
+        result = std::max(result, load);
+    }
+    return result;
+}
+
+void meta_service_test_app::load_balancer_validator()
+{
+    std::vector<dsn::rpc_address> node_list;
+    generate_node_list(node_list, 10, 10);
+
+    app_mapper apps;
+    node_mapper nodes;
+    nodes_fs_manager manager;
+    int disk_on_node = 3;
+    generate_apps(
+        apps, node_list, 2, disk_on_node, std::pair<uint32_t, uint32_t>(200, 300), true);
+    generate_node_mapper(nodes, apps, node_list);
+    generate_node_fs_manager(apps, nodes, manager, disk_on_node);
+
+    meta_service svc;
+    greedy_load_balancer glb(&svc);
+    glb._primary_load_balancer = false;
+    migration_list ml;
+
+    // make the replica counts balanced at first
+    for (int i = 0; i < 1000 && glb.balance({&apps, &nodes}, ml); ++i) {
+        migration_check_and_apply(apps, nodes, ml, &manager);
+    }
+
+    // all primaries on the first node are hot
+    const node_state &hot_node = nodes[node_list[0]];
+    for (auto &kv : apps) {
+        std::shared_ptr<app_state> &app = kv.second;
+        for (int i = 0; i < app->partition_count; ++i) {
+            int64_t qps = app->partitions[i].primary == hot_node.addr() ? 10000 : 100;
+            for (serving_replica &r : app->helpers->contexts[i].serving) {
+                r.read_qps = qps;
+                r.read_bytes_per_second = qps * 1024;
+            }
+        }
+    }
+    std::map<std::pair<app_id, rpc_address>, unsigned> primary_counts;
+    for (auto &kv : nodes) {
+        for (auto &app_kv : apps) {
+            primary_counts[std::make_pair(app_kv.first, kv.first)] =
+                kv.second.primary_count(app_kv.first);
+        }
+    }
+
+    int64_t initial_max_load = max_primary_load(apps, nodes);
+    glb._primary_load_balancer = true;
+    glb._load_balancer_cooldown_seconds = 0;
+    int round = 0;
+    for (; round < 1000 && glb.balance({&apps, &nodes}, ml); ++round) {
+        ASSERT_TRUE((int)ml.size() <= glb._max_load_balance_moves);
+        migration_check_and_apply(apps, nodes, ml, &manager);
+    }
+    ASSERT_TRUE(round < 1000);
+    int64_t final_max_load = max_primary_load(apps, nodes);
+    std::cerr << "max primary load: " << initial_max_load << " -> " << final_max_load
+              << ", rounds = " << round << std::endl;
+    ASSERT_TRUE(final_max_load * 4 < initial_max_load);
+
+    // primaries are swapped, so the primary count of each app on each node is unchanged
+    for (auto &kv : nodes) {
+        for (auto &app_kv : apps) {
+            unsigned count = primary_counts[std::make_pair(app_kv.first, kv.first)];
+            ASSERT_EQ(count, kv.second.primary_count(app_kv.first));
+        }
+    }
+}
+
 dsn::rpc_address get_rpc_address(const std::string &ip_port)
 {
     int splitter = ip_port.find_first_of(':');
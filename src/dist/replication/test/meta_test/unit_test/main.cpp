@@ -33,6 +33,15 @@ TEST(meta, data_definition) { g_app->data_definition_op_test(); }
 
 TEST(meta, update_configuration) { g_app->update_configuration_test(); }
 
+TEST(meta, update_configuration_batch) { g_app->update_configuration_batch_test(); }
+
+TEST(meta, drain_node) { g_app->drain_node_test(); }
+
+TEST(meta, config_sync_incremental) { g_app->config_sync_incremental_test(); }
+
+// print-only benchmark, run with --gtest_also_run_disabled_tests
+TEST(meta, DISABLED_config_sync_benchmark) { g_app->config_sync_benchmark(); }
+
 TEST(meta, balancer_validator) { g_app->balancer_validator(); }
 
 TEST(meta, apply_balancer) { g_app->apply_balancer_test(); }
@@ -43,6 +52,12 @@ TEST(meta, construct_apps_test) { g_app->construct_apps_test(); }
 
 TEST(meta, balance_config_file) { g_app->balance_config_file(); }
 
+TEST(meta, load_balancer_validator) { g_app->load_balancer_validator(); }
+
+TEST(meta, min_cost_max_flow) { g_app->min_cost_max_flow_test(); }
+
+TEST(meta, move_primary_chain) { g_app->move_primary_chain_test(); }
+
 TEST(meta, simple_lb_balanced_cure) { g_app->simple_lb_balanced_cure(); }
 
 TEST(meta, simple_lb_cure_test) { g_app->simple_lb_cure_test(); }
@@ -77,8 +77,15 @@ public:
     void state_sync_test();
     void data_definition_op_test();
     void update_configuration_test();
+    void update_configuration_batch_test();
+    void drain_node_test();
+    void config_sync_incremental_test();
+    void config_sync_benchmark();
     void balancer_validator();
     void balance_config_file();
+    void load_balancer_validator();
+    void min_cost_max_flow_test();
+    void move_primary_chain_test();
     void apply_balancer_test();
     void cannot_run_balancer_test();
     void construct_apps_test();
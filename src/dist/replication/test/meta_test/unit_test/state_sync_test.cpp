@@ -159,6 +159,76 @@ void meta_service_test_app::state_sync_test()
         file_data_compare("meta_state.dump1", "meta_state.dump2");
     }
 
+    // take over with a standby snapshot which is a bit stale
+    std::cerr << "testing sync from remote storage with a standby snapshot" << std::endl;
+    {
+        std::shared_ptr<server_state> ss2 = std::make_shared<server_state>();
+        ss2->initialize(svc, apps_root);
+        ss2->refresh_standby_snapshot();
+        ASSERT_FALSE(ss2->_standby_apps.empty());
+
+        dsn::partition_configuration changed_pc = ss1->get_app(apps_count)->partitions[0];
+        changed_pc.ballot += 10;
+        dsn::blob value =
+            dsn::json::json_forwarder<dsn::partition_configuration>::encode(changed_pc);
+        dsn::error_code ec;
+        svc->get_remote_storage()
+            ->set_data(ss1->get_partition_path(changed_pc.pid),
+                       value,
+                       LPC_META_CALLBACK,
+                       [&ec](dsn::error_code error) { ec = error; })
+            ->wait();
+        ASSERT_EQ(dsn::ERR_OK, ec);
+
+        // queries are served only if the pushes from the leader are continuous
+        opt.standby_push_interval_ms = 100;
+        opt.standby_query_max_staleness_ms = 10000;
+        dsn::configuration_query_by_index_request query_req;
+        dsn::configuration_query_by_index_response query_resp;
+        query_req.app_name = ss1->get_app(apps_count)->app_name;
+        ASSERT_FALSE(ss2->query_standby_configuration(query_req, query_resp));
+
+        dsn::rpc_address leader("127.0.0.1", 34601);
+        ss2->_standby_leader = leader;
+        meta_standby_push_request push;
+        push.sequence = 1;
+        push.partitions.push_back(changed_pc);
+        push.partitions.back().ballot += 10;
+        ss2->on_standby_push(leader, push);
+        ASSERT_TRUE(ss2->query_standby_configuration(query_req, query_resp));
+        ASSERT_EQ(dsn::ERR_OK, query_resp.err);
+        ASSERT_EQ(apps_count, query_resp.app_id);
+        ASSERT_EQ(ss1->get_app(apps_count)->partition_count, query_resp.partitions.size());
+        ASSERT_EQ(changed_pc.ballot + 10, query_resp.partitions[0].ballot);
+
+        // a push of an app which is not loaded
+        push.sequence = 2;
+        push.partitions.back().pid = dsn::gpid(apps_count + 1, 0);
+        ss2->on_standby_push(leader, push);
+        ASSERT_FALSE(ss2->query_standby_configuration(query_req, query_resp));
+
+        push.sequence = 4;
+        push.partitions.clear();
+        ss2->on_standby_push(leader, push);
+        ASSERT_FALSE(ss2->query_standby_configuration(query_req, query_resp));
+
+        // the pushed partition is different from remote storage, which is decoded again
+        ec = ss2->sync_apps_from_remote_storage();
+        ASSERT_EQ(dsn::ERR_OK, ec);
+        ASSERT_TRUE(ss2->_standby_apps.empty());
+        for (int i = 1; i <= apps_count; ++i) {
+            std::shared_ptr<app_state> app1 = ss1->get_app(i);
+            std::shared_ptr<app_state> app2 = ss2->get_app(i);
+            ASSERT_EQ(app1->partition_count, app2->partition_count);
+            for (int j = 0; j < app1->partition_count; ++j) {
+                if (app1->partitions[j].pid == changed_pc.pid)
+                    ASSERT_EQ(changed_pc.ballot, app2->partitions[j].ballot);
+                else
+                    ASSERT_EQ(app1->partitions[j].ballot, app2->partitions[j].ballot);
+            }
+        }
+    }
+
     opt.meta_state_service_type = "meta_state_service_zookeeper";
     svc->remote_storage_initialize();
     // first clean up
@@ -288,6 +358,61 @@ void meta_service_test_app::state_sync_test()
         req.app_name = "make_no_sense";
         ss2->query_configuration_by_index(req, resp);
         ASSERT_EQ(dsn::ERR_OBJECT_NOT_FOUND, resp.err);
+
+        // 3.3 delta query with known ballots
+        std::shared_ptr<app_state> app2 = ss2->get_app(15);
+        req.app_name = "test_app15";
+        req.partition_indices.clear();
+        std::vector<int64_t> known_ballots;
+        for (const dsn::partition_configuration &pc : app2->partitions)
+            known_ballots.push_back(pc.ballot);
+        known_ballots[1] -= 1;
+        req.__set_known_ballots(known_ballots);
+        resp.partitions.clear();
+        ss2->query_configuration_by_index(req, resp);
+        ASSERT_EQ(dsn::ERR_OK, resp.err);
+        ASSERT_EQ(1, resp.partitions.size());
+        ASSERT_EQ(app2->partitions[1], resp.partitions[0]);
+
+        req.partition_indices = {1, 2};
+        req.__set_known_ballots({app2->partitions[1].ballot, app2->partitions[2].ballot - 1});
+        resp.partitions.clear();
+        ss2->query_configuration_by_index(req, resp);
+        ASSERT_EQ(1, resp.partitions.size());
+        ASSERT_EQ(app2->partitions[2], resp.partitions[0]);
+
+        // 3.4 cached response is shared until the ballot changes
+        dsn::configuration_query_by_index_request req2;
+        req2.app_name = "test_app15";
+        dsn::blob data1, data2;
+        ASSERT_TRUE(ss2->get_cached_query_response(req2, dsn::DSF_THRIFT_BINARY, data1));
+        ASSERT_TRUE(ss2->get_cached_query_response(req2, dsn::DSF_THRIFT_BINARY, data2));
+        ASSERT_EQ(data1.data(), data2.data());
+
+        dsn::binary_reader reader(data1);
+        dsn::configuration_query_by_index_response resp2;
+        dsn::unmarshall(reader, resp2, dsn::DSF_THRIFT_BINARY);
+        ASSERT_EQ(dsn::ERR_OK, resp2.err);
+        ASSERT_EQ(app2->partitions, resp2.partitions);
+
+        // the cache is keyed on the published app view, so change the ballot the
+        // same way update_configuration_locally does
+        app2->partitions[0].ballot++;
+        ss2->update_app_view(*app2, 0);
+        ASSERT_TRUE(ss2->get_cached_query_response(req2, dsn::DSF_THRIFT_BINARY, data2));
+        ASSERT_NE(data1.data(), data2.data());
+        dsn::binary_reader reader2(data2);
+        dsn::unmarshall(reader2, resp2, dsn::DSF_THRIFT_BINARY);
+        ASSERT_EQ(app2->partitions[0].ballot, resp2.partitions[0].ballot);
+
+        // known ballots are not served from the cache
+        ASSERT_FALSE(ss2->get_cached_query_response(req, dsn::DSF_THRIFT_BINARY, data2));
+
+        // the cached responses are freed when the app is dropped
+        ASSERT_FALSE(ss2->_query_cache.empty());
+        ss2->erase_query_cache(req2.app_name);
+        for (const auto &kv : ss2->_query_cache)
+            ASSERT_NE(req2.app_name, std::get<0>(kv.first));
     }
 
     // simulate the half creating
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
 
 #include <dsn/service_api_c.h>
 #include <dsn/service_api_cpp.h>
@@ -63,6 +65,15 @@ public:
             pc.secondaries.push_back(pc.primary);
             pc.primary.set_invalid();
             break;
+
+        case config_type::CT_HANDOVER_PRIMARY:
+            // the new primary is told after the handover is done
+            if (update_req->node == pc.primary)
+                return;
+            replica_helper::remove_node(update_req->node, pc.secondaries);
+            pc.secondaries.push_back(pc.primary);
+            pc.primary = update_req->node;
+            break;
         default:
             break;
         }
@@ -71,6 +82,21 @@ public:
     }
 };
 
+// keeps the last config sync response
+class sync_recorder_meta_service : public dsn::replication::meta_service
+{
+public:
+    virtual void reply_message(dsn::message_ex *request, dsn::message_ex *response) override
+    {
+        dsn::message_ex *recvd_response = create_corresponding_receive(response);
+        ::dsn::unmarshall(recvd_response, last_response);
+        destroy_message(recvd_response);
+        destroy_message(response);
+    }
+
+    configuration_query_by_node_response last_response;
+};
+
 class null_meta_service : public dsn::replication::meta_service
 {
 public:
@@ -246,6 +272,336 @@ void meta_service_test_app::update_configuration_test()
     ASSERT_TRUE(wait_state(ss, validator3, 10));
 }
 
+void meta_service_test_app::update_configuration_batch_test()
+{
+    dsn::error_code ec;
+    std::shared_ptr<fake_sender_meta_service> svc(new fake_sender_meta_service(this));
+    svc->_failure_detector.reset(new dsn::replication::meta_server_failure_detector(svc.get()));
+    ec = svc->remote_storage_initialize();
+    ASSERT_EQ(ec, dsn::ERR_OK);
+    svc->_balancer.reset(new simple_load_balancer(svc.get()));
+    // long enough to batch the updates caused by a node's death
+    svc->_meta_opts.config_sync_batch_linger_ms = 50;
+    svc->_meta_opts.config_sync_batch_max_size = 5;
+
+    const std::string apps_root = "/meta_test/batch_apps";
+    server_state *ss = svc->_state.get();
+    ss->initialize(svc.get(), apps_root);
+    dsn::app_info info;
+    info.is_stateful = true;
+    info.status = dsn::app_status::AS_CREATING;
+    info.app_id = 1;
+    info.app_name = "simple_kv.instance0";
+    info.app_type = "simple_kv";
+    info.max_replica_count = 3;
+    info.partition_count = 16;
+    std::shared_ptr<app_state> app = app_state::create(info);
+    ss->_all_apps.emplace(1, app);
+
+    std::vector<dsn::rpc_address> nodes;
+    generate_node_list(nodes, 4, 4);
+    for (int i = 0; i < info.partition_count; ++i) {
+        dsn::partition_configuration &pc = app->partitions[i];
+        pc.primary = nodes[i % 3];
+        pc.secondaries.push_back(nodes[(i + 1) % 3]);
+        pc.secondaries.push_back(nodes[(i + 2) % 3]);
+        pc.ballot = 3;
+    }
+
+    ss->sync_apps_to_remote_storage();
+    ASSERT_TRUE(ss->spin_wait_staging(30));
+    ss->initialize_node_state();
+    svc->set_node_state({nodes[0], nodes[1], nodes[2]}, true);
+    svc->_started = true;
+
+    // all the partitions are changed when nodes[0] is dead, and the remote writes are
+    // flushed in batches
+    dsn::rpc_address dead = nodes[0];
+    state_validator validator = [dead](const app_mapper &apps) {
+        const std::shared_ptr<app_state> &app = apps.begin()->second;
+        for (const dsn::partition_configuration &pc : app->partitions) {
+            if (pc.primary.is_invalid() || pc.primary == dead || pc.secondaries.size() != 1 ||
+                pc.secondaries.front() == dead)
+                return false;
+        }
+        return true;
+    };
+    svc->set_node_state({nodes[0]}, false);
+    ASSERT_TRUE(wait_state(ss, validator, 30));
+
+    // the remote storage is consistent with the local state
+    std::shared_ptr<server_state> ss2 = std::make_shared<server_state>();
+    ss2->initialize(svc.get(), apps_root);
+    ASSERT_EQ(dsn::ERR_OK, ss2->sync_apps_from_remote_storage());
+    std::shared_ptr<app_state> app2 = ss2->get_app(1);
+    ASSERT_NE(nullptr, app2);
+    dsn::zauto_read_lock l(ss->_lock);
+    for (int i = 0; i < info.partition_count; ++i) {
+        ASSERT_EQ(app->partitions[i].ballot, app2->partitions[i].ballot);
+        ASSERT_EQ(app->partitions[i].primary, app2->partitions[i].primary);
+        ASSERT_EQ(app->partitions[i].secondaries, app2->partitions[i].secondaries);
+    }
+}
+
+void meta_service_test_app::drain_node_test()
+{
+    dsn::error_code ec;
+    std::shared_ptr<fake_sender_meta_service> svc(new fake_sender_meta_service(this));
+    svc->_failure_detector.reset(new dsn::replication::meta_server_failure_detector(svc.get()));
+    ec = svc->remote_storage_initialize();
+    ASSERT_EQ(ec, dsn::ERR_OK);
+    svc->_balancer.reset(new simple_load_balancer(svc.get()));
+
+    server_state *ss = svc->_state.get();
+    ss->initialize(svc.get(), "/meta_test/drain_apps");
+    dsn::app_info info;
+    info.is_stateful = true;
+    info.status = dsn::app_status::AS_CREATING;
+    info.app_id = 1;
+    info.app_name = "simple_kv.instance0";
+    info.app_type = "simple_kv";
+    info.max_replica_count = 3;
+    info.partition_count = 8;
+    std::shared_ptr<app_state> app = app_state::create(info);
+    ss->_all_apps.emplace(1, app);
+
+    std::vector<dsn::rpc_address> nodes;
+    generate_node_list(nodes, 3, 3);
+    for (int i = 0; i < info.partition_count; ++i) {
+        dsn::partition_configuration &pc = app->partitions[i];
+        pc.primary = nodes[i % 3];
+        pc.secondaries.push_back(nodes[(i + 1) % 3]);
+        pc.secondaries.push_back(nodes[(i + 2) % 3]);
+        pc.ballot = 3;
+    }
+
+    ss->sync_apps_to_remote_storage();
+    ASSERT_TRUE(ss->spin_wait_staging(30));
+    ss->initialize_node_state();
+    svc->set_node_state({nodes[0], nodes[1], nodes[2]}, true);
+    svc->_started = true;
+
+    // the primaries are moved off the draining node without removing any replica
+    dsn::rpc_address draining = nodes[0];
+    state_validator validator = [draining](const app_mapper &apps) {
+        const std::shared_ptr<app_state> &app = apps.begin()->second;
+        for (const dsn::partition_configuration &pc : app->partitions) {
+            if (pc.primary.is_invalid() || pc.primary == draining ||
+                pc.secondaries.size() != 2 ||
+                std::find(pc.secondaries.begin(), pc.secondaries.end(), draining) ==
+                    pc.secondaries.end())
+                return false;
+        }
+        return true;
+    };
+    ss->set_node_draining(draining, true);
+    ASSERT_TRUE(wait_state(ss, validator, 30));
+
+    {
+        dsn::zauto_read_lock l(ss->_lock);
+        ASSERT_EQ(0u, ss->_nodes[nodes[0]].primary_count());
+        ASSERT_EQ((unsigned)info.partition_count,
+                  ss->_nodes[nodes[1]].primary_count() + ss->_nodes[nodes[2]].primary_count());
+        for (const dsn::partition_configuration &pc : app->partitions) {
+            ASSERT_EQ(4, pc.ballot);
+        }
+    }
+    ss->set_node_draining(draining, false);
+}
+
+// checks when an incremental config sync is accepted and when the node is asked
+// to fall back to a full sync
+void meta_service_test_app::config_sync_incremental_test()
+{
+    std::shared_ptr<sync_recorder_meta_service> svc(new sync_recorder_meta_service());
+    svc->_failure_detector.reset(new dsn::replication::meta_server_failure_detector(svc.get()));
+    ASSERT_EQ(dsn::ERR_OK, svc->remote_storage_initialize());
+    svc->_balancer.reset(new simple_load_balancer(svc.get()));
+
+    server_state *ss = svc->_state.get();
+    ss->initialize(svc.get(), "/meta_test/incremental_sync_apps");
+    dsn::app_info info;
+    info.is_stateful = true;
+    info.status = dsn::app_status::AS_CREATING;
+    info.app_id = 1;
+    info.app_name = "incremental_sync";
+    info.app_type = "simple_kv";
+    info.max_replica_count = 3;
+    info.partition_count = 4;
+    std::shared_ptr<app_state> app = app_state::create(info);
+    ss->_all_apps.emplace(1, app);
+
+    std::vector<dsn::rpc_address> nodes;
+    generate_node_list(nodes, 3, 3);
+    for (int i = 0; i < info.partition_count; ++i) {
+        dsn::partition_configuration &pc = app->partitions[i];
+        pc.primary = nodes[0];
+        pc.secondaries = {nodes[1], nodes[2]};
+        pc.ballot = 1;
+    }
+    ASSERT_EQ(dsn::ERR_OK, ss->sync_apps_to_remote_storage());
+    ASSERT_TRUE(ss->spin_wait_staging(30));
+    ss->initialize_node_state();
+
+    auto config_sync = [&](int64_t version, int64_t base_version) {
+        configuration_query_by_node_request request;
+        request.node = nodes[0];
+        request.__set_stored_replicas({});
+        request.__set_sync_version(version);
+        if (base_version != 0)
+            request.__set_base_sync_version(base_version);
+        dsn::message_ex *fake_request = dsn::message_ex::create_request(RPC_CM_CONFIG_SYNC);
+        ::dsn::marshall(fake_request, request);
+        dsn::message_ex *recvd_request = create_corresponding_receive(fake_request);
+        recvd_request->add_ref();
+        destroy_message(fake_request);
+
+        svc->last_response = configuration_query_by_node_response();
+        ss->on_config_sync(recvd_request);
+        return svc->last_response;
+    };
+
+    // the node hasn't done a full sync yet
+    configuration_query_by_node_response resp = config_sync(2, 1);
+    ASSERT_EQ(dsn::ERR_OK, resp.err);
+    ASSERT_TRUE(resp.__isset.need_full_sync && resp.need_full_sync);
+
+    resp = config_sync(3, 0);
+    ASSERT_EQ(dsn::ERR_OK, resp.err);
+    ASSERT_FALSE(resp.__isset.need_full_sync);
+    ASSERT_EQ(4u, resp.partitions.size());
+
+    // the partitions are always replied in full
+    resp = config_sync(4, 3);
+    ASSERT_EQ(dsn::ERR_OK, resp.err);
+    ASSERT_FALSE(resp.__isset.need_full_sync);
+    ASSERT_EQ(4u, resp.partitions.size());
+
+    // based on a version which is not the last one
+    resp = config_sync(5, 3);
+    ASSERT_TRUE(resp.__isset.need_full_sync && resp.need_full_sync);
+
+    resp = config_sync(6, 4);
+    ASSERT_FALSE(resp.__isset.need_full_sync);
+
+    // as when the node is considered dead
+    get_node_state(ss->_nodes, nodes[0], false)->set_replicas_collect_flag(false);
+    resp = config_sync(7, 6);
+    ASSERT_TRUE(resp.__isset.need_full_sync && resp.need_full_sync);
+}
+
+// simulates config sync from 1000 replica servers, with client queries and writers
+// holding _lock in parallel, and reports the throughput and the latency of the queries
+void meta_service_test_app::config_sync_benchmark()
+{
+    const int node_count = 1000;
+    const int partition_count = 3000;
+    const int sync_rounds = 5;
+    const int sync_threads = 8;
+    const int query_threads = 4;
+
+    std::shared_ptr<fake_sender_meta_service> svc(new fake_sender_meta_service(this));
+    svc->_failure_detector.reset(new dsn::replication::meta_server_failure_detector(svc.get()));
+    ASSERT_EQ(dsn::ERR_OK, svc->remote_storage_initialize());
+    svc->_balancer.reset(new simple_load_balancer(svc.get()));
+
+    server_state *ss = svc->_state.get();
+    ss->initialize(svc.get(), "/meta_test/benchmark_apps");
+    dsn::app_info info;
+    info.is_stateful = true;
+    info.status = dsn::app_status::AS_CREATING;
+    info.app_id = 1;
+    info.app_name = "benchmark";
+    info.app_type = "simple_kv";
+    info.max_replica_count = 3;
+    info.partition_count = partition_count;
+    std::shared_ptr<app_state> app = app_state::create(info);
+    ss->_all_apps.emplace(1, app);
+
+    std::vector<dsn::rpc_address> nodes;
+    generate_node_list(nodes, node_count, node_count);
+    for (int i = 0; i < partition_count; ++i) {
+        dsn::partition_configuration &pc = app->partitions[i];
+        pc.primary = nodes[i % node_count];
+        pc.secondaries.push_back(nodes[(i + 1) % node_count]);
+        pc.secondaries.push_back(nodes[(i + 2) % node_count]);
+        pc.ballot = 1;
+    }
+    ASSERT_EQ(dsn::ERR_OK, ss->sync_apps_to_remote_storage());
+    ASSERT_TRUE(ss->spin_wait_staging(30));
+    ss->initialize_node_state();
+
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> query_count(0);
+    // failures in the threads are counted, as ASSERT_* only returns from the thread
+    std::atomic<uint64_t> query_error_count(0);
+    std::atomic<uint64_t> max_query_latency_us(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < query_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            dsn::configuration_query_by_index_request request;
+            request.app_name = info.app_name;
+            for (int i = 0; !stop.load(); ++i) {
+                request.partition_indices.assign(1, (t + i) % partition_count);
+                dsn::configuration_query_by_index_response response;
+                uint64_t start = dsn_now_us();
+                ss->query_configuration_by_index(request, response);
+                uint64_t latency = dsn_now_us() - start;
+                if (response.err != dsn::ERR_OK)
+                    ++query_error_count;
+                uint64_t old_max = max_query_latency_us.load();
+                while (latency > old_max &&
+                       !max_query_latency_us.compare_exchange_weak(old_max, latency)) {
+                }
+                ++query_count;
+            }
+        });
+    }
+    // ddl or balancer operations which hold _lock for a while
+    threads.emplace_back([&]() {
+        while (!stop.load()) {
+            {
+                dsn::zauto_write_lock l(ss->_lock);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(8));
+        }
+    });
+
+    uint64_t start = dsn_now_us();
+    std::vector<std::thread> syncers;
+    for (int t = 0; t < sync_threads; ++t) {
+        syncers.emplace_back([&, t]() {
+            for (int r = 0; r < sync_rounds; ++r) {
+                for (int i = t; i < node_count; i += sync_threads) {
+                    configuration_query_by_node_request request;
+                    request.node = nodes[i];
+                    dsn::message_ex *fake_request =
+                        dsn::message_ex::create_request(RPC_CM_CONFIG_SYNC);
+                    ::dsn::marshall(fake_request, request);
+                    dsn::message_ex *recvd_request = create_corresponding_receive(fake_request);
+                    recvd_request->add_ref();
+                    destroy_message(fake_request);
+                    ss->on_config_sync(recvd_request);
+                }
+            }
+        });
+    }
+    for (std::thread &t : syncers)
+        t.join();
+    uint64_t sync_elapsed_us = dsn_now_us() - start;
+    uint64_t queries = query_count.load();
+    stop.store(true);
+    for (std::thread &t : threads)
+        t.join();
+    ASSERT_EQ(0u, query_error_count.load());
+
+    std::cout << "config sync benchmark: " << node_count << " nodes, " << partition_count
+              << " partitions, " << node_count * sync_rounds << " config syncs in "
+              << sync_elapsed_us / 1000 << " ms, " << queries << " concurrent queries, "
+              << "max query latency " << max_query_latency_us.load() << " us" << std::endl;
+}
+
 void meta_service_test_app::adjust_dropped_size()
 {
     dsn::error_code ec;
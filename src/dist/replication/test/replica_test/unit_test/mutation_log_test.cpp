@@ -95,11 +95,12 @@ TEST(replication, log_file)
 
         if (i == 0) {
             binary_writer temp_writer;
-            lf->write_file_header(temp_writer, mdecrees);
+            lf->write_file_header(temp_writer, mdecrees, true);
             writer->add(temp_writer.get_buffer());
             ASSERT_EQ(mdecrees, lf->previous_log_max_decrees());
             log_file_header &h = lf->header();
             ASSERT_EQ(100, h.start_global_offset);
+            ASSERT_EQ(0x2, h.version);
         }
 
         binary_writer temp_writer;
@@ -242,6 +243,15 @@ TEST(replication, log_file)
             lf->read_file_header(reader);
             ASSERT_TRUE(lf->is_right_header());
             ASSERT_EQ(100, lf->header().start_global_offset);
+            for (task_code code : mutation::log_task_codes()) {
+                ASSERT_LT(code.code(), lf->log_codes().size());
+                ASSERT_EQ(code, lf->log_codes()[code.code()]);
+            }
+
+            // unknown versions are rejected
+            lf->header().version = 0x3;
+            ASSERT_FALSE(lf->is_right_header());
+            lf->header().version = 0x2;
         }
 
         std::string ss;
@@ -257,6 +267,19 @@ TEST(replication, log_file)
     err = lf->read_next_log_block(bb);
     ASSERT_TRUE(err == ERR_HANDLE_EOF);
 
+    // the header without the task code dictionary, which is written by default
+    {
+        binary_writer temp_writer;
+        int header_size = lf->write_file_header(temp_writer, mdecrees);
+        ASSERT_EQ(0x1, lf->header().version);
+        ASSERT_EQ(header_size, temp_writer.total_size());
+        binary_reader reader(temp_writer.get_buffer());
+        ASSERT_EQ(header_size, lf->read_file_header(reader));
+        ASSERT_TRUE(lf->is_right_header());
+        ASSERT_TRUE(lf->log_codes().empty());
+        ASSERT_TRUE(reader.is_eof());
+    }
+
     lf = nullptr;
 
     utils::filesystem::remove_path(fpath);
@@ -445,6 +468,34 @@ TEST_F(mutation_log_test, open)
     }
 }
 
+TEST_F(mutation_log_test, log_task_codes)
+{
+    mutation_ptr mu = create_test_mutation("hello!", 2);
+
+    // the log records the code as a number
+    binary_writer log_writer;
+    mu->write_to([&log_writer](const blob &bb) { log_writer.write(bb.data(), bb.length()); },
+                 true);
+    // while the message records the name
+    binary_writer msg_writer;
+    mu->write_to(msg_writer, nullptr);
+    ASSERT_EQ(strlen(RPC_REPLICATION_WRITE_EMPTY.to_string()),
+              msg_writer.total_size() - log_writer.total_size());
+
+    // the number is mapped by the code dictionary of the log file
+    std::vector<task_code> log_codes(RPC_REPLICATION_WRITE_EMPTY + 1, TASK_CODE_INVALID);
+    log_codes[RPC_REPLICATION_WRITE_EMPTY] = RPC_REPLICATION_WRITE_EMPTY;
+    for (binary_writer *writer : {&log_writer, &msg_writer}) {
+        binary_reader reader(writer->get_buffer());
+        mutation_ptr rmu = mutation::read_from(reader, nullptr, &log_codes);
+        EXPECT_EQ(mu->data.header, rmu->data.header);
+        ASSERT_EQ(1u, rmu->data.updates.size());
+        EXPECT_EQ(RPC_REPLICATION_WRITE_EMPTY, rmu->data.updates[0].code);
+        ASSERT_BLOB_EQ(mu->data.updates[0].data, rmu->data.updates[0].data);
+        EXPECT_TRUE(reader.is_eof());
+    }
+}
+
 TEST_F(mutation_log_test, replay_multiple_files_10000_1mb) { test_replay_multiple_files(10000, 1); }
 
 TEST_F(mutation_log_test, replay_multiple_files_20000_1mb) { test_replay_multiple_files(20000, 1); }
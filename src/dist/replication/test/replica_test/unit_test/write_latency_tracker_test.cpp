@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "dist/replication/lib/write_latency_tracker.h"
+
+#include <gtest/gtest.h>
+
+using namespace ::dsn;
+using namespace ::dsn::replication;
+
+static write_latency_record make_record(decree d, uint64_t total_us)
+{
+    write_latency_record record;
+    record.pid = gpid(1, 2);
+    record.d = d;
+    record.request_count = 1;
+    record.received_ns = 1000000;
+    record.phase_ts.prepared_ns = record.received_ns + 10000;
+    record.phase_ts.logged_ns = record.received_ns + 20000;
+    record.phase_ts.acked_ns.emplace_back(rpc_address("127.0.0.1", 34801),
+                                          record.received_ns + 30000);
+    record.phase_ts.committed_ns = record.received_ns + 40000;
+    record.phase_ts.applied_ns = record.received_ns + total_us * 1000;
+    return record;
+}
+
+TEST(write_latency_tracker, slowest)
+{
+    write_latency_tracker tracker(3);
+    ASSERT_EQ("no write recorded", tracker.dump(10));
+
+    for (decree d = 1; d <= 10; ++d) {
+        // 100us, 200us, ... 1000us, in a shuffled order
+        decree v = (d * 7) % 10 + 1;
+        tracker.add(make_record(v, v * 100));
+    }
+
+    std::string result = tracker.dump(10);
+    ASSERT_EQ(0u, result.find("1.2 decree=10 requests=1 total=1000us: prepared=+10us logged=+20us "
+                              "acked(127.0.0.1:34801)=+30us committed=+40us applied=+1000us\n"));
+    ASSERT_NE(std::string::npos, result.find("decree=9 "));
+    ASSERT_NE(std::string::npos, result.find("decree=8 "));
+    ASSERT_EQ(std::string::npos, result.find("decree=7 "));
+
+    // the slowest first
+    result = tracker.dump(1);
+    ASSERT_NE(std::string::npos, result.find("decree=10 "));
+    ASSERT_EQ(std::string::npos, result.find("decree=9 "));
+
+    // not slower than the kept ones
+    tracker.add(make_record(11, 800));
+    ASSERT_EQ(std::string::npos, tracker.dump(10).find("decree=11 "));
+
+    tracker.reset();
+    ASSERT_EQ("no write recorded", tracker.dump(10));
+    tracker.add(make_record(12, 1));
+    ASSERT_NE(std::string::npos, tracker.dump(10).find("decree=12 "));
+}
@@ -127,8 +127,8 @@ error_code zoo_transaction::set_data(const std::string &name, const blob &value)
     zoo_op_t &op = _pkt->_ops[offset];
     op.type = ZOO_SETDATA_OP;
     op.set_op.path = p.c_str();
-    op.set_op.data = value.data();
-    op.set_op.datalen = value.length();
+    op.set_op.data = b.data();
+    op.set_op.datalen = b.length();
     op.set_op.version = -1;
     op.set_op.stat = (struct Stat *)_pkt->alloc_buffer(sizeof(struct Stat));
 
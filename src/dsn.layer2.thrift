@@ -20,6 +20,11 @@ struct configuration_query_by_index_request
 {
     1:string           app_name;
     2:list<i32>        partition_indices;
+
+    // ballots already known by the client, aligned with partition_indices, or indexed by
+    // partition index if partition_indices is empty. if set, only the partitions whose
+    // ballot is different from the known one are returned.
+    3:optional list<i64> known_ballots;
 }
 
 // for server version > 1.11.2, if err == ERR_FORWARD_TO_OTHERS,
@@ -112,6 +112,15 @@ public:
         zauto_lock l(failure_detector::_lock);
         register_worker(node);
     }
+    void test_on_ping(const beacon_msg &beacon, /*out*/ beacon_ack &ack)
+    {
+        on_ping_internal(beacon, ack);
+    }
+    void test_record_worker_traffic(rpc_address node)
+    {
+        zauto_lock l(failure_detector::_lock);
+        record_worker_traffic(node);
+    }
     void clear()
     {
         _connected_cb = {};
@@ -119,6 +128,20 @@ public:
     }
 };
 
+class phi_fd_test : public failure_detector
+{
+public:
+    void on_master_disconnected(const std::vector<rpc_address> &nodes) override {}
+    void on_master_connected(rpc_address node) override {}
+    void on_worker_disconnected(const std::vector<rpc_address> &nodes) override {}
+    void on_worker_connected(rpc_address node) override {}
+
+    uint64_t test_adapted_lease_ms(const phi_accrual_window &intervals) const
+    {
+        return get_adapted_lease_ms(intervals);
+    }
+};
+
 class test_worker : public service_app, public serverlet<test_worker>
 {
 public:
@@ -694,3 +717,132 @@ TEST(fd, not_in_whitelist)
 
     ASSERT_TRUE(spin_wait_condition([&wait_count] { return wait_count == 1; }, 20));
 }
+
+TEST(fd, phi_accrual_window)
+{
+    phi_accrual_window window(10);
+    ASSERT_EQ(0, window.size());
+    ASSERT_EQ(0.0, window.phi(10000));
+
+    for (int i = 0; i < 20; ++i) {
+        window.add(i % 2 == 0 ? 900 : 1100);
+    }
+    ASSERT_EQ(10, window.size());
+
+    // phi increases with the elapsed time
+    ASSERT_LT(window.phi(500), 0.5);
+    ASSERT_LT(window.phi(1000), window.phi(1500));
+    ASSERT_LT(window.phi(1500), window.phi(2000));
+    ASSERT_GT(window.phi(3000), 8.0);
+
+    uint64_t elapsed = window.elapsed_for_phi(8.0);
+    ASSERT_GT(elapsed, 1000);
+    ASSERT_LT(elapsed, 3000);
+    ASSERT_GE(window.phi(elapsed), 8.0);
+    ASSERT_LT(window.phi(elapsed - 10), 8.0);
+
+    // more jitter, longer time to reach the same phi
+    phi_accrual_window jittery(10);
+    for (int i = 0; i < 10; ++i) {
+        jittery.add(i % 2 == 0 ? 500 : 1500);
+    }
+    ASSERT_GT(jittery.elapsed_for_phi(8.0), elapsed);
+
+    window.clear();
+    ASSERT_EQ(0, window.size());
+}
+
+TEST(fd, announced_lease)
+{
+    test_worker *worker;
+    std::vector<test_master *> masters;
+    ASSERT_TRUE(get_worker_and_master(worker, masters));
+    clear(worker, masters);
+
+    master_fd_test *fd = masters[0]->fd();
+    // started with lease = 4s and grace = 5s
+    uint32_t margin = fd->get_grace_ms() - fd->get_lease_ms();
+
+    beacon_msg msg;
+    beacon_ack ack;
+    msg.from_addr = rpc_address("localhost", 456);
+    msg.to_addr = rpc_address("localhost", MPORT_START);
+    msg.time = dsn_now_ms();
+
+    // no lease announced, the configured grace is used
+    fd->test_on_ping(msg, ack);
+    ASSERT_FALSE(ack.__isset.lease_ms);
+    ASSERT_EQ(fd->get_grace_ms(), fd->get_worker_grace_ms(msg.from_addr));
+
+    // a shorter lease is announced
+    ack = beacon_ack();
+    msg.time += 100;
+    msg.__set_lease_ms(2000);
+    fd->test_on_ping(msg, ack);
+    ASSERT_TRUE(ack.__isset.lease_ms);
+    ASSERT_EQ(2000, ack.lease_ms);
+    ASSERT_EQ(2000 + margin, fd->get_worker_grace_ms(msg.from_addr));
+
+    // an out-dated beacon doesn't change the recorded lease
+    ack = beacon_ack();
+    msg.time -= 50;
+    msg.lease_ms = 3000;
+    fd->test_on_ping(msg, ack);
+    ASSERT_EQ(2000, ack.lease_ms);
+    ASSERT_EQ(2000 + margin, fd->get_worker_grace_ms(msg.from_addr));
+
+    // a longer lease is recorded before the worker applies it
+    ack = beacon_ack();
+    msg.time += 100;
+    msg.lease_ms = 3500;
+    fd->test_on_ping(msg, ack);
+    ASSERT_EQ(3500, ack.lease_ms);
+    ASSERT_EQ(3500 + margin, fd->get_worker_grace_ms(msg.from_addr));
+
+    // config sync and the like are counted as beacons of alive workers only
+    fd->test_record_worker_traffic(msg.from_addr);
+    fd->test_record_worker_traffic(rpc_address("localhost", 789));
+    ASSERT_TRUE(fd->is_worker_connected(msg.from_addr));
+    ASSERT_FALSE(fd->is_worker_connected(rpc_address("localhost", 789)));
+
+    fd->clear_workers();
+}
+
+TEST(fd, phi_lease_with_steady_beacons)
+{
+    // the default options of the replica servers
+    const uint64_t check_interval_ms = 2000;
+    const uint64_t beacon_interval_ms = 3000;
+    const uint64_t lease_ms = 9000;
+    const uint64_t ack_delay_ms = 100;
+
+    phi_fd_test fd;
+    fd.enable_phi_accrual(8.0, 2000);
+    ASSERT_EQ(ERR_OK, fd.start_ms(check_interval_ms, beacon_interval_ms, lease_ms, 10000));
+
+    // the beacons are acked every 3s, and the lease is checked every 2s as check_all_records()
+    // does, which should never find it expired
+    phi_accrual_window intervals;
+    uint64_t lease = lease_ms;
+    uint64_t last_acked_beacon_time = 0;
+    uint64_t next_beacon_time = beacon_interval_ms;
+    for (uint64_t now = 1; now <= 600000; ++now) {
+        if (now == next_beacon_time + ack_delay_ms) {
+            if (last_acked_beacon_time != 0)
+                intervals.add(next_beacon_time - last_acked_beacon_time);
+            last_acked_beacon_time = next_beacon_time;
+            next_beacon_time += beacon_interval_ms;
+            if (intervals.size() >= 10)
+                lease = fd.test_adapted_lease_ms(intervals);
+        }
+        if (last_acked_beacon_time != 0 && now % check_interval_ms == 0) {
+            ASSERT_LE(now + check_interval_ms - last_acked_beacon_time, lease) << now;
+        }
+    }
+
+    // the lease is still adapted
+    ASSERT_LT(lease, lease_ms);
+    ASSERT_GE(lease, beacon_interval_ms + check_interval_ms);
+
+    fd.stop();
+}
@@ -1,4 +1,5 @@
 #include <dsn/dist/meta_state_service.h>
+#include <dsn/utility/filesystem.h>
 #include <boost/lexical_cast.hpp>
 
 #include <gtest/gtest.h>
@@ -261,6 +262,78 @@ TEST(meta_state_service, simple)
     provider_recursively_create_delete_test(simple_service_creator, simple_service_deleter);
 }
 
+TEST(meta_state_service, simple_log_compaction)
+{
+    const std::string work_dir = "./meta_state_service_simple_compaction";
+    dsn::utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(dsn::utils::filesystem::create_directory(work_dir));
+
+    auto creator = [&work_dir] {
+        meta_state_service_simple *svc = new meta_state_service_simple();
+        EXPECT_EQ(ERR_OK, svc->initialize({work_dir}));
+        return svc;
+    };
+    auto expect_ok = [](error_code ec) { EXPECT_EQ(ERR_OK, ec); };
+    auto get_value = [](meta_state_service *svc, const std::string &node) {
+        std::string result;
+        svc->get_data(node,
+                      META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                      [&result](error_code ec, const blob &value) {
+                          ASSERT_EQ(ERR_OK, ec);
+                          result.assign(value.data(), value.length());
+                      })
+            ->wait();
+        return result;
+    };
+
+    // the log is far larger than log_compaction_threshold_kb (1KB in config-test.ini),
+    // so that several snapshots are taken during the writes
+    meta_state_service *service = creator();
+    service->create_node("/c", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+    for (int i = 0; i < 100; ++i) {
+        std::string child = "/c/" + boost::lexical_cast<std::string>(i);
+        std::string value = "value" + boost::lexical_cast<std::string>(i);
+        service
+            ->create_node(child,
+                          META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                          expect_ok,
+                          blob::create_from_bytes(value.data(), value.length()))
+            ->wait();
+        if (i % 2 == 0) {
+            service->delete_node(child, false, META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)
+                ->wait();
+        }
+        service
+            ->set_data("/c",
+                       blob::create_from_bytes(value.data(), value.length()),
+                       META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                       expect_ok)
+            ->wait();
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    delete service;
+
+    ASSERT_TRUE(dsn::utils::filesystem::file_exists(
+        dsn::utils::filesystem::path_combine(work_dir, "meta_state_service.snapshot")));
+
+    // restart from the snapshot and the tail of the log
+    service = creator();
+    ASSERT_EQ("value99", get_value(service, "/c"));
+    service
+        ->get_children("/c",
+                       META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                       [](error_code ec, const std::vector<std::string> &children) {
+                           ASSERT_EQ(ERR_OK, ec);
+                           ASSERT_EQ(50u, children.size());
+                       })
+        ->wait();
+    for (int i = 1; i < 100; i += 2) {
+        ASSERT_EQ("value" + boost::lexical_cast<std::string>(i),
+                  get_value(service, "/c/" + boost::lexical_cast<std::string>(i)));
+    }
+    delete service;
+}
+
 TEST(meta_state_service, zookeeper)
 {
     auto zookeeper_service_creator = [] {